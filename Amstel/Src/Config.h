@@ -15,6 +15,20 @@
 
 #define RIO_RELEASE (!RIO_DEBUG && !RIO_DEVELOPMENT)
 
+#ifndef RIO_PROFILER
+	#define RIO_PROFILER (RIO_DEBUG || RIO_DEVELOPMENT)
+#endif // RIO_PROFILER
+
+// Profiler timestamps are taken with rdtsc instead of the OS clock
+#ifndef RIO_PROFILER_RDTSC
+	#define RIO_PROFILER_RDTSC (RIO_CPU_X86 && !RIO_DEBUG)
+#endif // RIO_PROFILER_RDTSC
+
+// Samples allocations of the default heap with their callstacks
+#ifndef RIO_ALLOCATION_TRACKER
+	#define RIO_ALLOCATION_TRACKER 0
+#endif // RIO_ALLOCATION_TRACKER
+
 #ifndef RIO_BUILD_UNIT_TESTS
 	#define RIO_BUILD_UNIT_TESTS 1
 #endif // RIO_BUILD_UNIT_TESTS
@@ -88,6 +102,18 @@
 	#define RIO_DEFAULT_COMPILER_PORT 10618
 #endif // RIO_DEFAULT_COMPILER_PORT
 
+#ifndef RIO_CONSOLE_SEND_BUFFER_SIZE
+	#define RIO_CONSOLE_SEND_BUFFER_SIZE (256 * 1024) // Bytes queued to each console client, messages past it are dropped
+#endif // RIO_CONSOLE_SEND_BUFFER_SIZE
+
+#ifndef RIO_CONSOLE_MAX_MESSAGE_SIZE
+	#define RIO_CONSOLE_MAX_MESSAGE_SIZE (16 * 1024 * 1024) // Clients sending larger messages are disconnected
+#endif // RIO_CONSOLE_MAX_MESSAGE_SIZE
+
+#ifndef RIO_CONSOLE_MAX_COMMANDS
+	#define RIO_CONSOLE_MAX_COMMANDS 256 // Commands received and not processed yet, must be a power of 2
+#endif // RIO_CONSOLE_MAX_COMMANDS
+
 #ifndef RIO_BOOT_CONFIG
 	#define RIO_BOOT_CONFIG "Boot"
 #endif // RIO_BOOT_CONFIG
@@ -104,14 +130,114 @@
 	#define RIO_BUNDLEIGNORE ".bundleIgnore"
 #endif // RIO_BUNDLEIGNORE
 
+#ifndef RIO_PROFILER_THREAD_BUFFER_SIZE
+	#define RIO_PROFILER_THREAD_BUFFER_SIZE (64 * 1024)
+#endif // RIO_PROFILER_THREAD_BUFFER_SIZE
+
+#ifndef RIO_ALLOCATION_TRACKER_SAMPLE_RATE
+	#define RIO_ALLOCATION_TRACKER_SAMPLE_RATE 64
+#endif // RIO_ALLOCATION_TRACKER_SAMPLE_RATE
+
+#ifndef RIO_ALLOCATION_TRACKER_MAX_CALL_SITES
+	#define RIO_ALLOCATION_TRACKER_MAX_CALL_SITES 4096
+#endif // RIO_ALLOCATION_TRACKER_MAX_CALL_SITES
+
+#ifndef RIO_ALLOCATION_TRACKER_MAX_FRAMES
+	#define RIO_ALLOCATION_TRACKER_MAX_FRAMES 12
+#endif // RIO_ALLOCATION_TRACKER_MAX_FRAMES
+
 #ifndef RIO_LAST_LOG
 	#define RIO_LAST_LOG "Last.log"
 #endif // RIO_LAST_LOG
 
+#ifndef RIO_LOG_MAX_RECORDS
+	#define RIO_LOG_MAX_RECORDS 1024 // Log lines waiting to be written, must be a power of 2
+#endif // RIO_LOG_MAX_RECORDS
+
+#ifndef RIO_LOG_RECORD_SIZE
+	#define RIO_LOG_RECORD_SIZE 1024 // Longer log lines take several records of the ring
+#endif // RIO_LOG_RECORD_SIZE
+
+#ifndef RIO_LOG_MESSAGE_SIZE
+	#define RIO_LOG_MESSAGE_SIZE 8192 // Longer log lines are truncated
+#endif // RIO_LOG_MESSAGE_SIZE
+
+#ifndef RIO_LOG_WRITE_INTERVAL
+	#define RIO_LOG_WRITE_INTERVAL 10 // Milliseconds between the writes of the log lines
+#endif // RIO_LOG_WRITE_INTERVAL
+
+#ifndef RIO_LEVEL_LOAD_BUDGET
+	#define RIO_LEVEL_LOAD_BUDGET 4 // Milliseconds spent spawning the levels being loaded in each world update
+#endif // RIO_LEVEL_LOAD_BUDGET
+
+#ifndef RIO_LEVEL_LOAD_CHUNK_SIZE
+	#define RIO_LEVEL_LOAD_CHUNK_SIZE 64 // Component instances spawned between the checks of the level load budget
+#endif // RIO_LEVEL_LOAD_CHUNK_SIZE
+
+#ifndef RIO_COMPONENT_ALIGNMENT
+	#define RIO_COMPONENT_ALIGNMENT 16 // Bytes, of the array of each field of the component instances, for aligned SIMD loads
+#endif // RIO_COMPONENT_ALIGNMENT
+
+#ifndef RIO_COMPONENT_COMPACT_FRACTION
+	#define RIO_COMPONENT_COMPACT_FRACTION 8 // Batches of destroyed units owning at least 1/N of the instances of a component compact them, smaller ones swap-remove theirs
+#endif // RIO_COMPONENT_COMPACT_FRACTION
+
+#ifndef RIO_COMPONENT_MAX_INSTANCES
+	#define RIO_COMPONENT_MAX_INSTANCES (RIO_ARCH_64BIT ? 1 << 20 : 0) // Instances of each component reserved in virtual memory, 0 to allocate them from the heap
+#endif // RIO_COMPONENT_MAX_INSTANCES
+
 #ifndef RIO_MAX_JOYPADS
 	#define RIO_MAX_JOYPADS 4
 #endif // RIO_MAX_JOYPADS
 
+#ifndef RIO_MAX_MESH_LODS
+	#define RIO_MAX_MESH_LODS 4
+#endif // RIO_MAX_MESH_LODS
+
+#ifndef RIO_MESH_LOD_SCREEN_ERROR
+	#define RIO_MESH_LOD_SCREEN_ERROR 0.001f // Fraction of the screen height
+#endif // RIO_MESH_LOD_SCREEN_ERROR
+
+#ifndef RIO_TEXTURE_COMPILER_THREADS
+	#define RIO_TEXTURE_COMPILER_THREADS 4 // Worker threads besides the compiler thread
+#endif // RIO_TEXTURE_COMPILER_THREADS
+
+#ifndef RIO_SPRITE_ATLAS_SIZE
+	#define RIO_SPRITE_ATLAS_SIZE 2048 // Largest sprite atlas, in pixels
+#endif // RIO_SPRITE_ATLAS_SIZE
+
+#ifndef RIO_SPRITE_ATLAS_PADDING
+	#define RIO_SPRITE_ATLAS_PADDING 4 // Pixels of extruded edge around each sprite texture
+#endif // RIO_SPRITE_ATLAS_PADDING
+
+#ifndef RIO_SHADER_COMPILER_THREADS
+	#define RIO_SHADER_COMPILER_THREADS 4 // Worker threads besides the compiler thread
+#endif // RIO_SHADER_COMPILER_THREADS
+
+#ifndef RIO_MAX_TEXTURE_MIPS
+	#define RIO_MAX_TEXTURE_MIPS 16
+#endif // RIO_MAX_TEXTURE_MIPS
+
+#ifndef RIO_TEXTURE_STREAMING_BUDGET
+	#define RIO_TEXTURE_STREAMING_BUDGET (256 * 1024 * 1024) // Bytes of GPU memory for all the textures
+#endif // RIO_TEXTURE_STREAMING_BUDGET
+
+#ifndef RIO_TEXTURE_STREAMING_RESIDENT_SIZE
+	#define RIO_TEXTURE_STREAMING_RESIDENT_SIZE 64 // Mips up to this size are read at load and never streamed
+#endif // RIO_TEXTURE_STREAMING_RESIDENT_SIZE
+
+#ifndef RIO_TEXTURE_STREAMING_MAX_READS
+	#define RIO_TEXTURE_STREAMING_MAX_READS 4 // Reads in flight
+#endif // RIO_TEXTURE_STREAMING_MAX_READS
+
+#ifndef RIO_SCRIPT_ALLOCATOR
+	#define RIO_SCRIPT_ALLOCATOR RIO_ARCH_32BIT // LuaJIT takes a custom allocator on 32-bit targets only, unless built with LJ_GC64
+#endif // RIO_SCRIPT_ALLOCATOR
+
+#ifndef RIO_SCRIPT_GC_BUDGET
+	#define RIO_SCRIPT_GC_BUDGET 1.0f // Milliseconds of Lua garbage collection per frame
+#endif // RIO_SCRIPT_GC_BUDGET
+
 #ifndef RIO_MAX_LUA_VECTOR3
 	#define RIO_MAX_LUA_VECTOR3 8192
 #endif // RIO_MAX_LUA_VECTOR3
@@ -10,8 +10,9 @@
 #if RIO_PLATFORM_POSIX
 	#include <dlfcn.h> // dlopen, dlclose, dlsym
 	#include <errno.h>
-	#include <stdio.h>  // fputs
+	#include <stdio.h>  // fputs, rename
 	#include <string.h> // memset
+	#include <sys/mman.h> // mmap, mprotect, munmap
 	#include <sys/stat.h> // lstat, mknod, mkdir
 	#include <sys/wait.h> // wait
 	#include <time.h> // clock_gettime
@@ -212,6 +213,17 @@ namespace OsFn
 #endif // RIO_PLATFORM_
 	}
 
+	// Moves the file <path> to <newPath>, replacing any file already there
+	// Returns whether the file was moved, the move is atomic when both are on the same volume
+	inline bool renameFile(const char* path, const char* newPath)
+	{
+#if RIO_PLATFORM_POSIX
+		return ::rename(path, newPath) == 0;
+#elif RIO_PLATFORM_WINDOWS
+		return MoveFileEx(path, newPath, MOVEFILE_REPLACE_EXISTING) != 0;
+#endif // RIO_PLATFORM_
+	}
+
 	inline void createDirectory(const char* path)
 	{
 #if RIO_PLATFORM_POSIX
@@ -263,6 +275,51 @@ namespace OsFn
 #endif // RIO_PLATFORM_
 	}
 
+	// Returns the size of the pages of virtual memory
+	inline uint32_t getPageSize()
+	{
+#if RIO_PLATFORM_POSIX
+		return (uint32_t)::sysconf(_SC_PAGESIZE);
+#elif RIO_PLATFORM_WINDOWS
+		SYSTEM_INFO systemInfo;
+		GetSystemInfo(&systemInfo);
+		return systemInfo.dwPageSize;
+#endif // RIO_PLATFORM_
+	}
+
+	// Reserves <size> bytes of address space, not backed by memory until committed
+	// Returns NULL if the address space is exhausted
+	inline void* reserveVirtualMemory(size_t size)
+	{
+#if RIO_PLATFORM_POSIX
+		void* p = ::mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		return p != MAP_FAILED ? p : NULL;
+#elif RIO_PLATFORM_WINDOWS
+		return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#endif // RIO_PLATFORM_
+	}
+
+	// Backs the <size> bytes at <p>, whole pages of reserved address space, with readable and writable memory
+	inline bool commitVirtualMemory(void* p, size_t size)
+	{
+#if RIO_PLATFORM_POSIX
+		return ::mprotect(p, size, PROT_READ | PROT_WRITE) == 0;
+#elif RIO_PLATFORM_WINDOWS
+		return VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#endif // RIO_PLATFORM_
+	}
+
+	// Releases the <size> bytes of address space reserved at <p>, and the memory committed in it
+	inline void releaseVirtualMemory(void* p, size_t size)
+	{
+#if RIO_PLATFORM_POSIX
+		::munmap(p, size);
+#elif RIO_PLATFORM_WINDOWS
+		RIO_UNUSED(size);
+		VirtualFree(p, 0, MEM_RELEASE);
+#endif // RIO_PLATFORM_
+	}
+
 	// Executes the process <path> with the given <args> and returns its exit code
 	// Fills <output> with stdout and stderr
 	int executeProcess(const char* path, const char* args, StringStream& output);
@@ -21,6 +21,8 @@ namespace HashMapFn
 	template <typename TKey, typename TValue, typename Hash> void set(HashMap<TKey, TValue, Hash>& m, const TKey& key, const TValue& value);
 	// Removes the <key> from the map if it exists
 	template <typename TKey, typename TValue, typename Hash> void remove(HashMap<TKey, TValue, Hash>& m, const TKey& key);
+	// Makes room for <size> items, so that setting up to <size> keys does not rehash the map
+	template <typename TKey, typename TValue, typename Hash> void reserve(HashMap<TKey, TValue, Hash>& m, uint32_t size);
 	// Removes all the items in the map
 	// Calls destructor on the items
 	template <typename TKey, typename TValue, typename Hash> void clear(HashMap<TKey, TValue, Hash>& m);
@@ -212,7 +214,7 @@ namespace HashMapFn
 	template <typename TKey, typename TValue, typename Hash>
 	void set(HashMap<TKey, TValue, Hash>& m, const TKey& key, const TValue& value)
 	{
-		if (m.size == 0)
+		if (m.capacity == 0)
 		{
 			HashMapInternalFn::grow(m);
 		}
@@ -221,7 +223,10 @@ namespace HashMapFn
 		const uint32_t i = HashMapInternalFn::find(m, key);
 		if (i == HashMapInternalFn::END_OF_LIST)
 		{
-			HashMapInternalFn::insert(m, HashMapInternalFn::getHashKey<TKey, Hash>(key), const_cast<TKey&>(key), const_cast<TValue&>(value));
+			// insert() swaps its arguments with the entries it displaces, so it must not get the caller's ones
+			TKey keyCopy(key);
+			TValue valueCopy(value);
+			HashMapInternalFn::insert(m, HashMapInternalFn::getHashKey<TKey, Hash>(key), keyCopy, valueCopy);
 			++m.size;
 		}
 		else
@@ -248,6 +253,21 @@ namespace HashMapFn
 		--m.size;
 	}
 
+	template <typename TKey, typename TValue, typename Hash>
+	void reserve(HashMap<TKey, TValue, Hash>& m, uint32_t size)
+	{
+		uint32_t newCapacity = (m.capacity == 0 ? 16 : m.capacity);
+		while (size >= newCapacity * 0.9f)
+		{
+			newCapacity *= 2;
+		}
+
+		if (newCapacity != m.capacity)
+		{
+			HashMapInternalFn::rehash(m, newCapacity);
+		}
+	}
+
 	template <typename TKey, typename TValue, typename Hash>
 	void clear(HashMap<TKey, TValue, Hash>& m)
 	{
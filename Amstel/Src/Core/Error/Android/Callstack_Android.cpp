@@ -3,6 +3,7 @@
 
 #if RIO_PLATFORM_ANDROID
 
+#include "Core/Strings/StringUtils.h"
 #include "Device/Log.h"
 
 namespace Rio
@@ -14,6 +15,16 @@ namespace ErrorFn
 	{
 		RIO_LOGE("\nCallstack is not supported on Android platform");
 	}
+
+	uint32_t captureCallstack(void** /*frames*/, uint32_t /*maxCount*/, uint32_t /*skipCount*/)
+	{
+		return 0;
+	}
+
+	void getSymbolName(const void* address, char* name, uint32_t size)
+	{
+		snPrintF(name, size, "%p", address);
+	}
 } // namespace ErrorFn
 
 } // namespace Rio
@@ -15,6 +15,7 @@ namespace ErrorFn
 		RIO_LOGEV(format, args);
 		RIO_LOGE("\tIn: %s:%d\n\nStacktrace:", file, line);
 		printCallstack();
+		LogGlobalFn::flush();
 		exit(EXIT_FAILURE);
 	}
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "Config.h"
+#include "Core/Base/Types.h"
 
 namespace Rio
 {
@@ -11,6 +12,11 @@ namespace ErrorFn
 	// Aborts the program execution logging an error message and the stacktrace if the platform supports it
 	void abort(const char* file, int line, const char* format, ...);
 	void printCallstack();
+	// Fills <frames> with up to <maxCount> return addresses of the calling thread, skipping <skipCount> innermost frames
+	// Returns the number of frames captured, 0 if the platform does not support it
+	uint32_t captureCallstack(void** frames, uint32_t maxCount, uint32_t skipCount);
+	// Writes a human readable name of the code at <address> to <name>
+	void getSymbolName(const void* address, char* name, uint32_t size);
 } // namespace ErrorFn
 
 } // namespace Rio
@@ -81,6 +81,48 @@ namespace ErrorFn
 		}
 		free(messages);
 	}
+
+	uint32_t captureCallstack(void** frames, uint32_t maxCount, uint32_t skipCount)
+	{
+		void* array[64];
+		// Unwinding is the expensive part, stop as soon as enough frames are collected
+		const uint32_t wanted = maxCount + 1 + skipCount;
+		const int size = backtrace(array, wanted < RIO_COUNTOF(array) ? (int)wanted : (int)RIO_COUNTOF(array));
+
+		// skip this function as well
+		uint32_t count = 0;
+		for (int i = 1 + skipCount; i < size && count < maxCount; ++i)
+		{
+			frames[count++] = array[i];
+		}
+		return count;
+	}
+
+	void getSymbolName(const void* address, char* name, uint32_t size)
+	{
+		void* array[1] = { (void*)address };
+		char** messages = backtrace_symbols(array, 1);
+
+		char* message = messages != NULL ? messages[0] : NULL;
+		char* mangledName = message != NULL ? strchr(message, '(') : NULL;
+		char* offsetBegin = message != NULL ? strchr(message, '+') : NULL;
+
+		if (mangledName && offsetBegin && mangledName < offsetBegin)
+		{
+			*mangledName++ = '\0';
+			*offsetBegin = '\0';
+
+			int demangleOk;
+			char* realName = abi::__cxa_demangle(mangledName, 0, 0, &demangleOk);
+			snPrintF(name, size, "%s", (demangleOk == 0 ? realName : mangledName));
+			free(realName);
+		}
+		else
+		{
+			snPrintF(name, size, "%p", address);
+		}
+		free(messages);
+	}
 } // namespace ErrorFn
 
 } // namespace Rio
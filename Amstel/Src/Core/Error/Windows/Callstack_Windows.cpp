@@ -3,6 +3,7 @@
 
 #if RIO_PLATFORM_WINDOWS
 
+#include "Core/Strings/StringUtils.h"
 #include "Device/Log.h"
 #include "Device/Windows/Headers_Windows.h"
 
@@ -91,6 +92,34 @@ namespace ErrorFn
 
 		SymCleanup(GetCurrentProcess());
 	}
+
+	uint32_t captureCallstack(void** frames, uint32_t maxCount, uint32_t skipCount)
+	{
+		// skip this function as well
+		return RtlCaptureStackBackTrace(1 + skipCount, maxCount, frames, NULL);
+	}
+
+	void getSymbolName(const void* address, char* name, uint32_t size)
+	{
+		SymInitialize(GetCurrentProcess(), NULL, TRUE);
+		SymSetOptions(SYMOPT_UNDNAME);
+
+		char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR)];
+		PSYMBOL_INFO sym = (PSYMBOL_INFO)buffer;
+		sym->SizeOfStruct = sizeof(SYMBOL_INFO);
+		sym->MaxNameLen = MAX_SYM_NAME;
+
+		if (SymFromAddr(GetCurrentProcess(), (DWORD64)address, 0, sym) == TRUE)
+		{
+			snPrintF(name, size, "%s", sym->Name);
+		}
+		else
+		{
+			snPrintF(name, size, "0x%p", address);
+		}
+
+		SymCleanup(GetCurrentProcess());
+	}
 } // namespace ErrorFn
 
 } // namespace Rio
@@ -7,6 +7,8 @@
 #include "Core/Strings/StringUtils.h"
 #include "Core/Math/Quaternion.h"
 
+#include <stdlib.h> // strtod
+
 namespace Rio
 {
 
@@ -195,57 +197,97 @@ namespace JsonRFn
 		return NULL;
 	}
 
-	double parseDouble(const char* json)
+	inline bool getIsDigit(char c)
 	{
-		RIO_ASSERT_NOT_NULL(json);
-
-		TempAllocator512 alloc;
-	 	Array<char> number(alloc);
+		return uint32_t(c - '0') < 10;
+	}
 
-		if (*json == '-')
+	// Parses the number <json> into <value> and returns the pointer past it
+	// Numbers with at most 19 significant digits and a small exponent are
+	// converted exactly without going through the C library
+	static const char* parseNumber(const char* json, double& value)
+	{
+		// Powers of ten exactly representable as double
+		static const double powersOfTen[] =
 		{
-			ArrayFn::pushBack(number, '-');
-			++json;
-		}
-		while (isdigit(*json))
+			1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const char* begin = json;
+		const bool isNegative = *json == '-';
+		json += isNegative ? 1 : 0;
+
+		uint64_t mantissa = 0;
+		uint32_t digitCount = 0;
+		int32_t exponent = 0;
+
+		for (; getIsDigit(*json); ++json)
 		{
-			ArrayFn::pushBack(number, *json);
-			++json;
+			if (digitCount < 19)
+			{
+				mantissa = mantissa * 10 + uint64_t(*json - '0');
+				digitCount += mantissa != 0 ? 1 : 0;
+			}
+			else
+			{
+				++exponent;
+			}
 		}
 
 		if (*json == '.')
 		{
-			ArrayFn::pushBack(number, '.');
-			while (*++json && isdigit(*json))
+			for (++json; getIsDigit(*json); ++json)
 			{
-				ArrayFn::pushBack(number, *json);
+				if (digitCount < 19)
+				{
+					mantissa = mantissa * 10 + uint64_t(*json - '0');
+					digitCount += mantissa != 0 ? 1 : 0;
+					--exponent;
+				}
 			}
 		}
 
 		if (*json == 'e' || *json == 'E')
 		{
-			ArrayFn::pushBack(number, *json);
 			++json;
+			const bool isExponentNegative = *json == '-';
+			json += (*json == '-' || *json == '+') ? 1 : 0;
 
-			if (*json == '-' || *json == '+')
-			{
-				ArrayFn::pushBack(number, *json);
-				++json;
-			}
-			while (isdigit(*json))
+			int32_t e = 0;
+			for (; getIsDigit(*json); ++json)
 			{
-				ArrayFn::pushBack(number, *json);
-				++json;
+				e = e < 10000 ? e * 10 + (*json - '0') : e;
 			}
+			exponent += isExponentNegative ? -e : e;
+		}
+
+		RIO_ASSERT(json != begin + (isNegative ? 1 : 0), "Bad number");
+
+		if (mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+		{
+			// Both operands are exact, the result is correctly rounded
+			value = exponent < 0
+				? double(mantissa) / powersOfTen[-exponent]
+				: double(mantissa) * powersOfTen[exponent]
+				;
+			value = isNegative ? -value : value;
 		}
+		else
+		{
+			value = strtod(begin, nullptr);
+		}
+
+		return json;
+	}
 
-		ArrayFn::pushBack(number, '\0');
+	double parseDouble(const char* json)
+	{
+		RIO_ASSERT_NOT_NULL(json);
 
-		double val;
-		int ok = sscanf(ArrayFn::begin(number), "%lf", &val);
-		RIO_ASSERT(ok == 1, "Failed to parse double: %s", ArrayFn::begin(number));
-		RIO_UNUSED(ok);
-		return val;
+		double value;
+		parseNumber(json, value);
+		return value;
 	}
 
 	bool parseBool(const char* json)
@@ -289,6 +331,102 @@ namespace JsonRFn
 		return (float)parseDouble(json);
 	}
 
+	uint32_t getArrayCount(const char* json)
+	{
+		RIO_ASSERT_NOT_NULL(json);
+		RIO_ASSERT(*json == '[', "Bad array");
+
+		uint32_t count = 0;
+		for (json = skipSpaces(json + 1); *json != ']'; json = skipSpaces(json))
+		{
+			RIO_ASSERT(*json != '\0', "Bad array");
+			json = skipValue(json);
+			++count;
+		}
+
+		return count;
+	}
+
+	// Returns whether <c> can follow an item of an array
+	inline bool getIsItemEnd(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ']' || c == '/';
+	}
+
+	uint32_t parseFloatArrayInto(const char* json, float* output, uint32_t count)
+	{
+		RIO_ASSERT_NOT_NULL(json);
+
+		if (*json != '[')
+		{
+			return UINT32_MAX;
+		}
+
+		uint32_t i = 0;
+		for (json = skipSpaces(json + 1); *json != ']'; json = skipSpaces(json))
+		{
+			const char* digits = *json == '-' ? json + 1 : json;
+			if (i == count || !getIsDigit(*digits))
+			{
+				return UINT32_MAX;
+			}
+
+			double value;
+			json = parseNumber(json, value);
+			if (!getIsItemEnd(*json))
+			{
+				return UINT32_MAX;
+			}
+
+			output[i++] = (float)value;
+		}
+
+		return i;
+	}
+
+	uint32_t parseUintArrayInto(const char* json, uint32_t* output, uint32_t count)
+	{
+		RIO_ASSERT_NOT_NULL(json);
+
+		if (*json != '[')
+		{
+			return UINT32_MAX;
+		}
+
+		uint32_t i = 0;
+		for (json = skipSpaces(json + 1); *json != ']'; json = skipSpaces(json))
+		{
+			if (i == count || !getIsDigit(*json))
+			{
+				return UINT32_MAX;
+			}
+
+			// Integers take the fast path unless they have a fraction or an exponent
+			uint64_t value = 0;
+			const char* begin = json;
+			for (; getIsDigit(*json) && value <= UINT32_MAX; ++json)
+			{
+				value = value * 10 + uint64_t(*json - '0');
+			}
+
+			if (*json == '.' || *json == 'e' || *json == 'E')
+			{
+				double d;
+				json = parseNumber(begin, d);
+				value = d <= double(UINT32_MAX) ? (uint64_t)d : uint64_t(UINT32_MAX) + 1;
+			}
+
+			if (value > UINT32_MAX || !getIsItemEnd(*json))
+			{
+				return UINT32_MAX;
+			}
+
+			output[i++] = (uint32_t)value;
+		}
+
+		return i;
+	}
+
 	void parseArray(const char* json, JsonArray& array)
 	{
 		RIO_ASSERT_NOT_NULL(json);
@@ -28,6 +28,21 @@ namespace JsonRFn
 	// Returns the JSONR boolean <json> as bool
 	bool parseBool(const char* json);
 
+	// Returns the number of items of the JSONR array <json>
+	uint32_t getArrayCount(const char* json);
+
+	// Decodes the numbers of the JSONR array <json> straight into <output>,
+	// which must have room for <count> items
+	// Returns the number of items decoded or UINT32_MAX if the array has more than <count> items
+	// or an item is not a number
+	uint32_t parseFloatArrayInto(const char* json, float* output, uint32_t count);
+
+	// Decodes the non-negative integers of the JSONR array <json> straight into <output>,
+	// which must have room for <count> items
+	// Returns the number of items decoded or UINT32_MAX if the array has more than <count> items
+	// or an item is not an integer that fits in uint32_t
+	uint32_t parseUintArrayInto(const char* json, uint32_t* output, uint32_t count);
+
 	// Parses the JSONR array <json> and puts it into <array> as pointers to
 	// the corresponding items into the original <json> string
 	void parseArray(const char* json, JsonArray& array);
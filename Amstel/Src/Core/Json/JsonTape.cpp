@@ -0,0 +1,476 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Core/Json/JsonTape.h"
+#include "Core/Json/JsonR.h"
+#include "Core/Error/Error.h"
+#include "Core/Math/MathTypes.h"
+#include "Core/Memory/TempAllocator.h"
+#include "Core/Strings/DynamicString.h"
+#include "Core/Strings/StringId.h"
+
+#include <algorithm> // std::sort
+#include <string.h> // memcmp
+
+namespace Rio
+{
+
+namespace JsonTapeInternalFn
+{
+	inline bool getIsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	// Skips whitespace, comments and the optional commas of JSONR
+	static const char* skipSpaces(const char* json)
+	{
+		while (*json != '\0')
+		{
+			if (getIsSpace(*json) || *json == ',')
+			{
+				++json;
+			}
+			else if (*json == '/' && json[1] == '/')
+			{
+				while (*json != '\0' && *json != '\n')
+				{
+					++json;
+				}
+			}
+			else if (*json == '/' && json[1] == '*')
+			{
+				json += 2;
+				while (*json != '\0' && !(*json == '*' && json[1] == '/'))
+				{
+					++json;
+				}
+				RIO_ASSERT(*json != '\0', "Bad comment");
+				json += 2;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		return json;
+	}
+
+	// Returns the pointer past the closing quote of the string <json>
+	static const char* skipString(const char* json)
+	{
+		for (++json; *json != '\0'; ++json)
+		{
+			if (*json == '\\')
+			{
+				++json;
+			}
+			else if (*json == '"')
+			{
+				return json + 1;
+			}
+		}
+
+		RIO_FATAL("Bad string");
+		return json;
+	}
+
+	// Returns the pointer past the number, boolean or null <json>
+	static const char* skipScalar(const char* json)
+	{
+		while (*json != '\0' && !getIsSpace(*json) && *json != ',' && *json != '}' && *json != ']')
+		{
+			++json;
+		}
+
+		return json;
+	}
+
+	static JsonValueType::Enum getType(char c)
+	{
+		switch (c)
+		{
+			case '"': return JsonValueType::STRING;
+			case '{': return JsonValueType::OBJECT;
+			case '[': return JsonValueType::ARRAY;
+			case 'n': return JsonValueType::NIL;
+			case 't':
+			case 'f': return JsonValueType::BOOL;
+			default: return JsonValueType::NUMBER;
+		}
+	}
+
+	static const char* parseValue(JsonTape& tape, const char* json, const char* key, uint32_t keyLength);
+
+	static bool getHasKey(const JsonTape& tape, uint32_t i, uint32_t keyHash, const char* key, uint32_t keyLength)
+	{
+		const JsonTapeNode& node = tape.nodeList[i];
+		return node.keyHash == keyHash
+			&& node.keyLength == keyLength
+			&& memcmp(tape.json + node.keyOffset, key, keyLength) == 0
+			;
+	}
+
+	// Marks the members of <memberList> that a later member with the same key overrides
+	// <memberList> holds the key hash in the high and the node index in the low 32 bits of each member
+	static void markOverridden(JsonTape& tape, Array<uint64_t>& memberList)
+	{
+		std::sort(ArrayFn::begin(memberList), ArrayFn::end(memberList));
+
+		const uint32_t count = ArrayFn::getCount(memberList);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			// Only members with the same hash can share the key, they are next to each other
+			for (uint32_t j = i + 1; j < count && (memberList[j] >> 32) == (memberList[i] >> 32); ++j)
+			{
+				const JsonTapeNode& later = tape.nodeList[uint32_t(memberList[j])];
+				JsonTapeNode& node = tape.nodeList[uint32_t(memberList[i])];
+				if (getHasKey(tape, uint32_t(memberList[i]), later.keyHash, tape.json + later.keyOffset, later.keyLength))
+				{
+					node.isOverridden = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	// Returns the first member from <i> onwards that is not overridden or JSON_TAPE_INVALID
+	static uint32_t skipOverridden(const JsonTape& tape, uint32_t i)
+	{
+		while (i != JSON_TAPE_INVALID && tape.nodeList[i].isOverridden)
+		{
+			i = tape.nodeList[i].next;
+		}
+		return i;
+	}
+
+	// Parses the members of an object up to the closing <end> character,
+	// '\0' for the root object of JSONR documents
+	static const char* parseMembers(JsonTape& tape, uint32_t object, const char* json, char end)
+	{
+		uint32_t previous = JSON_TAPE_INVALID;
+		TempAllocator512 ta;
+		Array<uint64_t> memberList(ta);
+
+		json = skipSpaces(json);
+		while (*json != end)
+		{
+			RIO_ASSERT(*json != '\0', "Bad object");
+
+			const char* key = json;
+			uint32_t keyLength = 0;
+			if (*json == '"')
+			{
+				json = skipString(json);
+				++key;
+				keyLength = uint32_t(json - key - 1);
+			}
+			else
+			{
+				while (*json != '\0' && !getIsSpace(*json) && *json != '=' && *json != ':')
+				{
+					++json;
+				}
+				keyLength = uint32_t(json - key);
+			}
+
+			json = skipSpaces(json);
+			RIO_ASSERT(*json == '=' || *json == ':', "Expected '=' or ':' got '%c'", *json);
+			json = skipSpaces(json + 1);
+
+			const uint32_t child = ArrayFn::getCount(tape.nodeList);
+			json = parseValue(tape, json, key, keyLength);
+			ArrayFn::pushBack(memberList, (uint64_t(tape.nodeList[child].keyHash) << 32) | child);
+
+			if (previous != JSON_TAPE_INVALID)
+			{
+				tape.nodeList[previous].next = child;
+			}
+			previous = child;
+			++tape.nodeList[object].count;
+
+			json = skipSpaces(json);
+		}
+
+		if (ArrayFn::getCount(memberList) > 1)
+		{
+			markOverridden(tape, memberList);
+		}
+
+		return end != '\0' ? json + 1 : json;
+	}
+
+	static const char* parseElements(JsonTape& tape, uint32_t array, const char* json)
+	{
+		uint32_t previous = JSON_TAPE_INVALID;
+		// Whether every item is a single node, so that the items are consecutive
+		bool isFlat = true;
+
+		json = skipSpaces(json);
+		while (*json != ']')
+		{
+			RIO_ASSERT(*json != '\0', "Bad array");
+
+			const uint32_t child = ArrayFn::getCount(tape.nodeList);
+			json = parseValue(tape, json, nullptr, 0);
+			isFlat = isFlat && ArrayFn::getCount(tape.nodeList) == child + 1;
+
+			if (previous != JSON_TAPE_INVALID)
+			{
+				tape.nodeList[previous].next = child;
+			}
+			previous = child;
+			++tape.nodeList[array].count;
+
+			json = skipSpaces(json);
+		}
+
+		// Nested items are interleaved with their own children, index them separately
+		if (isFlat == false)
+		{
+			tape.nodeList[array].items = ArrayFn::getCount(tape.itemList);
+			for (uint32_t i = array + 1; i != JSON_TAPE_INVALID; i = tape.nodeList[i].next)
+			{
+				ArrayFn::pushBack(tape.itemList, i);
+			}
+		}
+
+		return json + 1;
+	}
+
+	static const char* parseValue(JsonTape& tape, const char* json, const char* key, uint32_t keyLength)
+	{
+		// Nodes are referred by index, <tape.nodeList> grows while the children are parsed
+		const uint32_t index = ArrayFn::getCount(tape.nodeList);
+
+		JsonTapeNode node;
+		node.type = getType(*json);
+		node.isOverridden = 0;
+		node.offset = uint32_t(json - tape.json);
+		node.length = 0;
+		node.count = 0;
+		node.next = JSON_TAPE_INVALID;
+		node.keyHash = key != nullptr ? StringId32(key, keyLength).id : 0;
+		node.keyOffset = key != nullptr ? uint32_t(key - tape.json) : 0;
+		node.keyLength = keyLength;
+		node.items = JSON_TAPE_INVALID;
+		ArrayFn::pushBack(tape.nodeList, node);
+
+		const char* begin = json;
+		switch (*json)
+		{
+			case '{': json = parseMembers(tape, index, json + 1, '}'); break;
+			case '[': json = parseElements(tape, index, json + 1); break;
+			case '"': json = skipString(json); break;
+			default: json = skipScalar(json); break;
+		}
+
+		tape.nodeList[index].length = uint32_t(json - begin);
+		return json;
+	}
+} // namespace JsonTapeInternalFn
+
+namespace JsonTapeFn
+{
+	void parse(const char* json, JsonTape& tape)
+	{
+		RIO_ASSERT_NOT_NULL(json);
+
+		tape.json = json;
+		ArrayFn::clear(tape.nodeList);
+		ArrayFn::clear(tape.itemList);
+
+		json = JsonTapeInternalFn::skipSpaces(json);
+
+		if (*json == '{')
+		{
+			JsonTapeInternalFn::parseValue(tape, json, nullptr, 0);
+			return;
+		}
+
+		// JSONR root objects have no braces
+		JsonTapeNode root;
+		root.type = JsonValueType::OBJECT;
+		root.isOverridden = 0;
+		root.offset = uint32_t(json - tape.json);
+		root.length = 0;
+		root.count = 0;
+		root.next = JSON_TAPE_INVALID;
+		root.keyHash = 0;
+		root.keyOffset = 0;
+		root.keyLength = 0;
+		root.items = JSON_TAPE_INVALID;
+		ArrayFn::pushBack(tape.nodeList, root);
+
+		const char* end = JsonTapeInternalFn::parseMembers(tape, 0, json, '\0');
+		tape.nodeList[0].length = uint32_t(end - json);
+	}
+
+	void parse(Buffer& json, JsonTape& tape)
+	{
+		ArrayFn::pushBack(json, '\0');
+		ArrayFn::popBack(json);
+		parse(ArrayFn::begin(json), tape);
+	}
+
+	uint32_t find(const JsonTape& tape, uint32_t object, const FixedString& key)
+	{
+		RIO_ASSERT(getType(tape, object) == JsonValueType::OBJECT, "Not an object");
+
+		const uint32_t keyLength = key.getLength();
+		const uint32_t keyHash = StringId32(key.getData(), keyLength).id;
+
+		// The last duplicate wins
+		uint32_t found = JSON_TAPE_INVALID;
+		for (uint32_t i = getFirstChild(tape, object); i != JSON_TAPE_INVALID; i = getNext(tape, i))
+		{
+			if (JsonTapeInternalFn::getHasKey(tape, i, keyHash, key.getData(), keyLength))
+			{
+				found = i;
+			}
+		}
+
+		return found;
+	}
+
+	uint32_t get(const JsonTape& tape, uint32_t object, const FixedString& key)
+	{
+		const uint32_t i = find(tape, object, key);
+		RIO_ASSERT(i != JSON_TAPE_INVALID, "Key '%.*s' not found", key.getLength(), key.getData());
+		return i;
+	}
+
+	uint32_t getFirstMember(const JsonTape& tape, uint32_t object)
+	{
+		RIO_ASSERT(getType(tape, object) == JsonValueType::OBJECT, "Not an object");
+		return JsonTapeInternalFn::skipOverridden(tape, getFirstChild(tape, object));
+	}
+
+	uint32_t getNextMember(const JsonTape& tape, uint32_t i)
+	{
+		return JsonTapeInternalFn::skipOverridden(tape, getNext(tape, i));
+	}
+
+	uint32_t getMemberCount(const JsonTape& tape, uint32_t object)
+	{
+		uint32_t count = 0;
+		for (uint32_t i = getFirstMember(tape, object); i != JSON_TAPE_INVALID; i = getNextMember(tape, i))
+		{
+			++count;
+		}
+		return count;
+	}
+
+	uint32_t getItem(const JsonTape& tape, uint32_t array, uint32_t index)
+	{
+		RIO_ASSERT(getType(tape, array) == JsonValueType::ARRAY, "Not an array");
+		RIO_ASSERT(index < getCount(tape, array), "Index out of bounds");
+
+		const JsonTapeNode& node = tape.nodeList[array];
+		return node.items == JSON_TAPE_INVALID ? array + 1 + index : tape.itemList[node.items + index];
+	}
+
+	double parseDouble(const JsonTape& tape, uint32_t i)
+	{
+		RIO_ASSERT(getType(tape, i) == JsonValueType::NUMBER, "Not a number");
+		return JsonRFn::parseDouble(getJson(tape, i));
+	}
+
+	int32_t parseInt(const JsonTape& tape, uint32_t i)
+	{
+		return (int32_t)parseDouble(tape, i);
+	}
+
+	float parseFloat(const JsonTape& tape, uint32_t i)
+	{
+		return (float)parseDouble(tape, i);
+	}
+
+	bool parseBool(const JsonTape& tape, uint32_t i)
+	{
+		return JsonRFn::parseBool(getJson(tape, i));
+	}
+
+	void parseString(const JsonTape& tape, uint32_t i, DynamicString& string)
+	{
+		RIO_ASSERT(getType(tape, i) == JsonValueType::STRING, "Not a string");
+		JsonRFn::parseString(getJson(tape, i), string);
+	}
+
+	uint32_t parseFloatArrayInto(const JsonTape& tape, uint32_t i, float* output, uint32_t count)
+	{
+		RIO_ASSERT(getType(tape, i) == JsonValueType::ARRAY, "Not an array");
+		return JsonRFn::parseFloatArrayInto(getJson(tape, i), output, count);
+	}
+
+	uint32_t parseUintArrayInto(const JsonTape& tape, uint32_t i, uint32_t* output, uint32_t count)
+	{
+		RIO_ASSERT(getType(tape, i) == JsonValueType::ARRAY, "Not an array");
+		return JsonRFn::parseUintArrayInto(getJson(tape, i), output, count);
+	}
+
+	// Reads the first <count> numbers of the array <i> into <output>
+	static void parseFloats(const JsonTape& tape, uint32_t i, float* output, uint32_t count)
+	{
+		RIO_ASSERT(getCount(tape, i) >= count, "Array too short");
+
+		uint32_t item = getFirstChild(tape, i);
+		for (uint32_t n = 0; n < count; ++n, item = getNext(tape, item))
+		{
+			output[n] = parseFloat(tape, item);
+		}
+	}
+
+	Vector2 parseVector2(const JsonTape& tape, uint32_t i)
+	{
+		Vector2 v;
+		parseFloats(tape, i, &v.x, 2);
+		return v;
+	}
+
+	Vector3 parseVector3(const JsonTape& tape, uint32_t i)
+	{
+		Vector3 v;
+		parseFloats(tape, i, &v.x, 3);
+		return v;
+	}
+
+	Vector4 parseVector4(const JsonTape& tape, uint32_t i)
+	{
+		Vector4 v;
+		parseFloats(tape, i, &v.x, 4);
+		return v;
+	}
+
+	Quaternion parseQuaternion(const JsonTape& tape, uint32_t i)
+	{
+		Quaternion q;
+		parseFloats(tape, i, &q.x, 4);
+		return q;
+	}
+
+	Matrix4x4 parseMatrix4x4(const JsonTape& tape, uint32_t i)
+	{
+		Matrix4x4 m;
+		parseFloats(tape, i, &m.x.x, 16);
+		return m;
+	}
+
+	StringId32 parseStringId(const JsonTape& tape, uint32_t i)
+	{
+		TempAllocator1024 ta;
+		DynamicString str(ta);
+		parseString(tape, i, str);
+		return str.getStringId();
+	}
+
+	ResourceId parseResourceId(const JsonTape& tape, uint32_t i)
+	{
+		TempAllocator1024 ta;
+		DynamicString str(ta);
+		parseString(tape, i, str);
+		return ResourceId(str.getCStr());
+	}
+} // namespace JsonTapeFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
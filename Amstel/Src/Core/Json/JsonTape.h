@@ -0,0 +1,170 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Containers/Array.h"
+#include "Core/Json/JsonTypes.h"
+#include "Core/Math/MathTypes.h"
+#include "Core/Strings/StringId.h"
+#include "Core/Strings/StringTypes.h"
+
+namespace Rio
+{
+
+// Single pass JSONR parser
+// The whole document is tokenized once into a JsonTape, values are then
+// addressed by node index so that nested values are never scanned again
+// Unlike JsonObject, which sorts the members by key, the members of an object are visited in file order
+// Duplicate keys are resolved in favor of the last one by lookups and by getFirstMember()/getNextMember(),
+// getFirstChild()/getNext() still visit all of them
+// JsonObject keeps all the duplicates and returns any of them on lookup
+namespace JsonTapeFn
+{
+	// Parses the JSONR-encoded <json> into <tape>
+	// <json> must outlive <tape>
+	void parse(const char* json, JsonTape& tape);
+
+	// Parses the JSONR-encoded <json> into <tape>
+	void parse(Buffer& json, JsonTape& tape);
+
+	// Returns the root object of the <tape>
+	inline uint32_t getRoot(const JsonTape& /*tape*/)
+	{
+		return 0;
+	}
+
+	// Returns the data type of the node <i>
+	inline JsonValueType::Enum getType(const JsonTape& tape, uint32_t i)
+	{
+		return (JsonValueType::Enum)tape.nodeList[i].type;
+	}
+
+	// Returns the number of children of the array or object <i>
+	inline uint32_t getCount(const JsonTape& tape, uint32_t i)
+	{
+		return tape.nodeList[i].count;
+	}
+
+	// Returns the first child of the array or object <i> or JSON_TAPE_INVALID
+	inline uint32_t getFirstChild(const JsonTape& tape, uint32_t i)
+	{
+		return tape.nodeList[i].count != 0 ? i + 1 : JSON_TAPE_INVALID;
+	}
+
+	// Returns the sibling following the node <i> or JSON_TAPE_INVALID
+	inline uint32_t getNext(const JsonTape& tape, uint32_t i)
+	{
+		return tape.nodeList[i].next;
+	}
+
+	// Returns a pointer to the JSONR text of the node <i>, usable with JsonRFn functions
+	inline const char* getJson(const JsonTape& tape, uint32_t i)
+	{
+		return tape.json + tape.nodeList[i].offset;
+	}
+
+	// Returns the key of the member <i> of an object
+	inline FixedString getKey(const JsonTape& tape, uint32_t i)
+	{
+		const JsonTapeNode& node = tape.nodeList[i];
+		return FixedString(tape.json + node.keyOffset, node.keyLength);
+	}
+
+	// Returns the key of the member <i> of an object as StringId32
+	inline StringId32 getKeyId(const JsonTape& tape, uint32_t i)
+	{
+		return StringId32(tape.nodeList[i].keyHash);
+	}
+
+	// Returns the member <key> of the object <object> or JSON_TAPE_INVALID
+	// Returns the last one if <key> appears more than once
+	uint32_t find(const JsonTape& tape, uint32_t object, const FixedString& key);
+
+	// Returns the member <key> of the object <object> or JSON_TAPE_INVALID
+	inline uint32_t find(const JsonTape& tape, uint32_t object, const char* key)
+	{
+		return find(tape, object, FixedString(key));
+	}
+
+	// Returns whether the object <object> has the member <key>
+	inline bool has(const JsonTape& tape, uint32_t object, const char* key)
+	{
+		return find(tape, object, key) != JSON_TAPE_INVALID;
+	}
+
+	// Returns the member <key> of the object <object>, the member must exist
+	uint32_t get(const JsonTape& tape, uint32_t object, const FixedString& key);
+
+	// Returns the member <key> of the object <object>, the member must exist
+	inline uint32_t get(const JsonTape& tape, uint32_t object, const char* key)
+	{
+		return get(tape, object, FixedString(key));
+	}
+
+	// Returns the first member of the object <object> that is not overridden by a later duplicate key or JSON_TAPE_INVALID
+	uint32_t getFirstMember(const JsonTape& tape, uint32_t object);
+
+	// Returns the member following <i> that is not overridden by a later duplicate key or JSON_TAPE_INVALID
+	uint32_t getNextMember(const JsonTape& tape, uint32_t i);
+
+	// Returns the number of distinct keys of the object <object>
+	uint32_t getMemberCount(const JsonTape& tape, uint32_t object);
+
+	// Returns the <index>-th item of the array <array> in constant time
+	uint32_t getItem(const JsonTape& tape, uint32_t array, uint32_t index);
+} // namespace JsonTapeFn
+
+namespace JsonTapeFn
+{
+	// Returns the number <i> as double
+	double parseDouble(const JsonTape& tape, uint32_t i);
+
+	// Returns the number <i> as int
+	int32_t parseInt(const JsonTape& tape, uint32_t i);
+
+	// Returns the number <i> as float
+	float parseFloat(const JsonTape& tape, uint32_t i);
+
+	// Returns the boolean <i> as bool
+	bool parseBool(const JsonTape& tape, uint32_t i);
+
+	// Parses the string <i> and puts it into <string>
+	void parseString(const JsonTape& tape, uint32_t i, DynamicString& string);
+
+	// Decodes the numbers of the array <i> into <output>, which must have room for <count> items
+	// Returns the number of items decoded or UINT32_MAX, see JsonRFn::parseFloatArrayInto()
+	uint32_t parseFloatArrayInto(const JsonTape& tape, uint32_t i, float* output, uint32_t count);
+
+	// Decodes the non-negative integers of the array <i> into <output>, which must have room for <count> items
+	// Returns the number of items decoded or UINT32_MAX, see JsonRFn::parseUintArrayInto()
+	uint32_t parseUintArrayInto(const JsonTape& tape, uint32_t i, uint32_t* output, uint32_t count);
+
+	// Returns the array <i> as Vector2
+	Vector2 parseVector2(const JsonTape& tape, uint32_t i);
+
+	// Returns the array <i> as Vector3
+	Vector3 parseVector3(const JsonTape& tape, uint32_t i);
+
+	// Returns the array <i> as Vector4
+	Vector4 parseVector4(const JsonTape& tape, uint32_t i);
+
+	// Returns the array <i> as Quaternion
+	Quaternion parseQuaternion(const JsonTape& tape, uint32_t i);
+
+	// Returns the array <i> as Matrix4x4
+	Matrix4x4 parseMatrix4x4(const JsonTape& tape, uint32_t i);
+
+	// Returns the string <i> as StringId32
+	StringId32 parseStringId(const JsonTape& tape, uint32_t i);
+
+	// Returns the string <i> as ResourceId
+	ResourceId parseResourceId(const JsonTape& tape, uint32_t i);
+} // namespace JsonTapeFn
+
+inline JsonTape::JsonTape(Allocator& a)
+	: nodeList(a)
+	, itemList(a)
+{
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
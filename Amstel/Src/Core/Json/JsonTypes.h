@@ -34,5 +34,36 @@ struct JsonObject
 	Map<FixedString, const char*> map;
 };
 
+// Index of a non-existent JsonTapeNode
+const uint32_t JSON_TAPE_INVALID = UINT32_MAX;
+
+// A value of a JSONR document as stored in a JsonTape
+// The children of arrays and objects follow their parent in depth-first order
+struct JsonTapeNode
+{
+	uint32_t type : 31; // JsonValueType::Enum
+	uint32_t isOverridden : 1; // Whether a later member of the parent OBJECT has the same key
+	uint32_t offset; // Offset of the value into the source string
+	uint32_t length; // Length of the value in bytes
+	uint32_t count; // Number of children (ARRAY and OBJECT only)
+	uint32_t next; // Index of the next sibling or JSON_TAPE_INVALID
+	uint32_t keyHash; // StringId32 of the key if the parent is an OBJECT, 0 otherwise
+	uint32_t keyOffset;
+	uint32_t keyLength;
+	uint32_t items; // ARRAY only, first child into JsonTape::itemList or JSON_TAPE_INVALID if the children are consecutive nodes
+};
+
+// Flat list of all the values of a JSONR document, built in a single pass
+// Numbers and strings are decoded on access
+struct JsonTape
+{
+	JsonTape(Allocator& a);
+
+	const char* json = nullptr;
+	Array<JsonTapeNode> nodeList;
+	// Children of the arrays whose items are not consecutive nodes, for constant time indexing
+	Array<uint32_t> itemList;
+};
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
@@ -192,7 +192,8 @@ float getRayTriangleIntersection(const Vector3& from, const Vector3& direction,
 	return getRayMeshIntersection(from, direction, MATRIX4X4_IDENTITY, vertices, sizeof(Vector3), indices, 3);
 }
 
-float getRayMeshIntersection(const Vector3& from, const Vector3& direction, const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint16_t* indices, uint32_t num)
+template <typename IndexType>
+static float getRayMeshIntersectionT(const Vector3& from, const Vector3& direction, const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const IndexType* indices, uint32_t num)
 {
 	bool hit = false;
 	float tMin = 999999999.9f;
@@ -260,6 +261,16 @@ float getRayMeshIntersection(const Vector3& from, const Vector3& direction, cons
 	return hit ? tMin : -1.0f;
 }
 
+float getRayMeshIntersection(const Vector3& from, const Vector3& direction, const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint16_t* indices, uint32_t num)
+{
+	return getRayMeshIntersectionT(from, direction, transformMatrix, vertices, stride, indices, num);
+}
+
+float getRayMeshIntersection(const Vector3& from, const Vector3& direction, const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint32_t* indices, uint32_t num)
+{
+	return getRayMeshIntersectionT(from, direction, transformMatrix, vertices, stride, indices, num);
+}
+
 bool getThreePlanesIntersection(const Plane3& a, const Plane3& b, const Plane3& c, Vector3& ip)
 {
 	const Vector3 na = a.n;
@@ -30,6 +30,10 @@ float getRayTriangleIntersection(const Vector3& from, const Vector3& direction,
 // mesh defined by (vertices, stride, indices, num) or -1.0 if no intersection
 float getRayMeshIntersection(const Vector3& from, const Vector3& direction, const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint16_t* indices, uint32_t num);
 
+// Returns the distance along ray (from, direction) to intersection point with the triangle
+// mesh defined by (vertices, stride, 32 bit indices, num) or -1.0 if no intersection
+float getRayMeshIntersection(const Vector3& from, const Vector3& direction, const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint32_t* indices, uint32_t num);
+
 // Returns whether the planes <a>, <b> and <c> intersects and if so fills <ip> with the intersection point
 bool getThreePlanesIntersection(const Plane3& a, const Plane3& b, const Plane3& c, Vector3& ip);
 
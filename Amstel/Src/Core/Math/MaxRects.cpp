@@ -0,0 +1,188 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Core/Math/MaxRects.h"
+#include "Core/Containers/Array.h"
+#include "Core/Error/Error.h"
+#include "Core/Memory/Memory.h"
+
+namespace Rio
+{
+
+namespace MaxRectsInternalFn
+{
+	struct FreeRectangle
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	static bool getIsContained(const FreeRectangle& a, const FreeRectangle& b)
+	{
+		return a.x >= b.x
+			&& a.y >= b.y
+			&& a.x + a.width <= b.x + b.width
+			&& a.y + a.height <= b.y + b.height
+			;
+	}
+
+	// Replaces the free rectangles overlapping <used> with the largest free rectangles around it
+	static void splitFreeRectangles(Array<FreeRectangle>& freeList, const FreeRectangle& used)
+	{
+		const uint32_t count = ArrayFn::getCount(freeList);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const FreeRectangle free = freeList[i];
+			if (used.x >= free.x + free.width
+				|| used.x + used.width <= free.x
+				|| used.y >= free.y + free.height
+				|| used.y + used.height <= free.y
+				)
+			{
+				continue;
+			}
+
+			if (used.x > free.x)
+			{
+				const FreeRectangle left = { free.x, free.y, used.x - free.x, free.height };
+				ArrayFn::pushBack(freeList, left);
+			}
+			if (used.x + used.width < free.x + free.width)
+			{
+				const FreeRectangle right = { used.x + used.width, free.y, free.x + free.width - used.x - used.width, free.height };
+				ArrayFn::pushBack(freeList, right);
+			}
+			if (used.y > free.y)
+			{
+				const FreeRectangle top = { free.x, free.y, free.width, used.y - free.y };
+				ArrayFn::pushBack(freeList, top);
+			}
+			if (used.y + used.height < free.y + free.height)
+			{
+				const FreeRectangle bottom = { free.x, used.y + used.height, free.width, free.y + free.height - used.y - used.height };
+				ArrayFn::pushBack(freeList, bottom);
+			}
+
+			// Marks the rectangle as removed
+			freeList[i].width = 0;
+		}
+
+		// Removes the split rectangles and those contained in others
+		uint32_t kept = 0;
+		for (uint32_t i = 0; i < ArrayFn::getCount(freeList); ++i)
+		{
+			if (freeList[i].width == 0)
+			{
+				continue;
+			}
+
+			bool isContained = false;
+			for (uint32_t j = 0; j < ArrayFn::getCount(freeList) && !isContained; ++j)
+			{
+				// Of two equal rectangles the first is kept
+				isContained = j != i
+					&& freeList[j].width != 0
+					&& getIsContained(freeList[i], freeList[j])
+					&& (j > i || !getIsContained(freeList[j], freeList[i]))
+					;
+			}
+
+			if (isContained)
+			{
+				freeList[i].width = 0;
+			}
+		}
+		for (uint32_t i = 0; i < ArrayFn::getCount(freeList); ++i)
+		{
+			if (freeList[i].width != 0)
+			{
+				freeList[kept++] = freeList[i];
+			}
+		}
+		ArrayFn::resize(freeList, kept);
+	}
+} // namespace MaxRectsInternalFn
+
+namespace MaxRectsFn
+{
+	uint32_t pack(const uint32_t* widthList, const uint32_t* heightList, uint32_t count, uint32_t binWidth, uint32_t binHeight, uint32_t* binList, uint32_t* xList, uint32_t* yList)
+	{
+		using namespace MaxRectsInternalFn;
+
+		const uint32_t NOT_PACKED = UINT32_MAX;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			RIO_ASSERT(widthList[i] <= binWidth && heightList[i] <= binHeight, "Rectangle larger than the bin");
+			binList[i] = NOT_PACKED;
+		}
+
+		Array<FreeRectangle> freeList(getDefaultAllocator());
+
+		uint32_t binCount = 0;
+		uint32_t packedCount = 0;
+		while (packedCount < count)
+		{
+			const FreeRectangle bin = { 0, 0, binWidth, binHeight };
+			ArrayFn::clear(freeList);
+			ArrayFn::pushBack(freeList, bin);
+
+			// Places the rectangle which fits best among all those left, until none fits
+			for (;;)
+			{
+				uint32_t bestRectangle = NOT_PACKED;
+				uint32_t bestFree = 0;
+				uint32_t bestShortSide = UINT32_MAX;
+				uint32_t bestLongSide = UINT32_MAX;
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					if (binList[i] != NOT_PACKED)
+					{
+						continue;
+					}
+
+					for (uint32_t j = 0; j < ArrayFn::getCount(freeList); ++j)
+					{
+						const FreeRectangle& free = freeList[j];
+						if (widthList[i] > free.width || heightList[i] > free.height)
+						{
+							continue;
+						}
+
+						const uint32_t leftoverWidth = free.width - widthList[i];
+						const uint32_t leftoverHeight = free.height - heightList[i];
+						const uint32_t shortSide = leftoverWidth < leftoverHeight ? leftoverWidth : leftoverHeight;
+						const uint32_t longSide = leftoverWidth < leftoverHeight ? leftoverHeight : leftoverWidth;
+						if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+						{
+							bestRectangle = i;
+							bestFree = j;
+							bestShortSide = shortSide;
+							bestLongSide = longSide;
+						}
+					}
+				}
+
+				if (bestRectangle == NOT_PACKED)
+				{
+					break;
+				}
+
+				const FreeRectangle used = { freeList[bestFree].x, freeList[bestFree].y, widthList[bestRectangle], heightList[bestRectangle] };
+				binList[bestRectangle] = binCount;
+				xList[bestRectangle] = used.x;
+				yList[bestRectangle] = used.y;
+				++packedCount;
+
+				splitFreeRectangles(freeList, used);
+			}
+
+			++binCount;
+		}
+
+		return binCount;
+	}
+} // namespace MaxRectsFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,21 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+
+namespace Rio
+{
+
+// Rectangle bin packing used by the sprite atlas compiler
+namespace MaxRectsFn
+{
+	// Packs the <count> rectangles of <widthList> x <heightList> into as few <binWidth> x <binHeight> bins as possible,
+	// without rotating them (Jukka Jylanki's MaxRects, best short side fit)
+	// Writes the bin and the top-left corner of each rectangle to <binList>, <xList> and <yList>
+	// Every rectangle must fit in a bin
+	// Returns the number of bins used
+	uint32_t pack(const uint32_t* widthList, const uint32_t* heightList, uint32_t count, uint32_t binWidth, uint32_t binHeight, uint32_t* binList, uint32_t* xList, uint32_t* yList);
+} // namespace MaxRectsFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
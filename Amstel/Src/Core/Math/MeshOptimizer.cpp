@@ -0,0 +1,605 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Core/Math/MeshOptimizer.h"
+#include "Core/Base/Murmur.h"
+#include "Core/Containers/Array.h"
+#include "Core/Error/Error.h"
+#include "Core/Math/Vector3.h"
+#include "Core/Memory/Memory.h"
+
+#include <algorithm> // std::sort
+#include <math.h> // powf, sqrt
+#include <string.h> // memcmp, memcpy, memset
+
+namespace Rio
+{
+
+namespace MeshOptimizerInternalFn
+{
+	// Forsyth's tuning values
+	const uint32_t CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// Returns the score of a vertex at <cachePosition> (-1 if not cached) still used by <remainingValence> triangles
+	static float getVertexScore(int32_t cachePosition, uint32_t remainingValence)
+	{
+		if (remainingValence == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The vertices of the last triangle get a fixed score so that
+			// the next triangle does not always reuse the same edge
+			if (cachePosition < 3)
+			{
+				score = LAST_TRIANGLE_SCORE;
+			}
+			else
+			{
+				const float scale = 1.0f / float(CACHE_SIZE - 3);
+				score = powf(1.0f - float(cachePosition - 3) * scale, CACHE_DECAY_POWER);
+			}
+		}
+
+		// Vertices with few triangles left are finished first
+		score += VALENCE_BOOST_SCALE * powf(float(remainingValence), -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	// Symmetric 4x4 matrix of the sum of squared distances to a set of planes
+	struct Quadric
+	{
+		double a2, ab, ac, ad;
+		double b2, bc, bd;
+		double c2, cd;
+		double d2;
+		double weight;
+	};
+
+	static void addPlane(Quadric& q, double a, double b, double c, double d)
+	{
+		q.a2 += a*a; q.ab += a*b; q.ac += a*c; q.ad += a*d;
+		q.b2 += b*b; q.bc += b*c; q.bd += b*d;
+		q.c2 += c*c; q.cd += c*d;
+		q.d2 += d*d;
+		q.weight += 1.0;
+	}
+
+	static void addQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a2 += other.a2; q.ab += other.ab; q.ac += other.ac; q.ad += other.ad;
+		q.b2 += other.b2; q.bc += other.bc; q.bd += other.bd;
+		q.c2 += other.c2; q.cd += other.cd;
+		q.d2 += other.d2;
+		q.weight += other.weight;
+	}
+
+	// Returns the mean squared distance of <p> to the planes of <q>
+	static double getQuadricError(const Quadric& q, const Vector3& p)
+	{
+		const double x = p.x;
+		const double y = p.y;
+		const double z = p.z;
+		const double error = q.a2*x*x + 2.0*q.ab*x*y + 2.0*q.ac*x*z + 2.0*q.ad*x
+			+ q.b2*y*y + 2.0*q.bc*y*z + 2.0*q.bd*y
+			+ q.c2*z*z + 2.0*q.cd*z
+			+ q.d2
+			;
+		return error > 0.0 && q.weight > 0.0 ? error / q.weight : 0.0;
+	}
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	inline bool operator<(const Collapse& a, const Collapse& b)
+	{
+		return a.error < b.error;
+	}
+} // namespace MeshOptimizerInternalFn
+
+namespace MeshOptimizerFn
+{
+	uint32_t weldVertices(const void* vertices, uint32_t vertexCount, uint32_t stride, void* uniqueVertices, uint32_t* indices)
+	{
+		uint32_t tableSize = 1;
+		while (tableSize < vertexCount * 2)
+		{
+			tableSize <<= 1;
+		}
+
+		Array<uint32_t> table(getDefaultAllocator());
+		ArrayFn::resize(table, tableSize);
+		memset(ArrayFn::begin(table), 0xff, tableSize * sizeof(uint32_t));
+
+		const char* source = (const char*)vertices;
+		char* destination = (char*)uniqueVertices;
+		uint32_t uniqueCount = 0;
+
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			const char* vertex = source + i * stride;
+			uint32_t slot = getMurmurHash32(vertex, stride, 0) & (tableSize - 1);
+
+			// Linear probing
+			while (table[slot] != UINT32_MAX && memcmp(destination + table[slot] * stride, vertex, stride) != 0)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+
+			if (table[slot] == UINT32_MAX)
+			{
+				memcpy(destination + uniqueCount * stride, vertex, stride);
+				table[slot] = uniqueCount++;
+			}
+
+			indices[i] = table[slot];
+		}
+
+		return uniqueCount;
+	}
+
+	void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+	{
+		using namespace MeshOptimizerInternalFn;
+
+		const uint32_t triangleCount = indexCount / 3;
+		Allocator& a = getDefaultAllocator();
+
+		// Triangles using each vertex, the first <valenceList[v]> entries from <adjacencyOffsetList[v]> are still to be emitted
+		Array<uint32_t> valenceList(a);
+		Array<uint32_t> adjacencyOffsetList(a);
+		Array<uint32_t> adjacencyList(a);
+		ArrayFn::resize(valenceList, vertexCount);
+		ArrayFn::resize(adjacencyOffsetList, vertexCount + 1);
+		ArrayFn::resize(adjacencyList, triangleCount * 3);
+		memset(ArrayFn::begin(valenceList), 0, vertexCount * sizeof(uint32_t));
+
+		for (uint32_t i = 0; i < triangleCount * 3; ++i)
+		{
+			RIO_ASSERT(indices[i] < vertexCount, "Index out of bounds");
+			++valenceList[indices[i]];
+		}
+
+		adjacencyOffsetList[0] = 0;
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsetList[v + 1] = adjacencyOffsetList[v] + valenceList[v];
+		}
+
+		{
+			Array<uint32_t> fillList(a);
+			ArrayFn::resize(fillList, vertexCount);
+			memcpy(ArrayFn::begin(fillList), ArrayFn::begin(adjacencyOffsetList), vertexCount * sizeof(uint32_t));
+			for (uint32_t i = 0; i < triangleCount * 3; ++i)
+			{
+				adjacencyList[fillList[indices[i]]++] = i / 3;
+			}
+		}
+
+		Array<int32_t> cachePositionList(a);
+		Array<float> vertexScoreList(a);
+		ArrayFn::resize(cachePositionList, vertexCount);
+		ArrayFn::resize(vertexScoreList, vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			cachePositionList[v] = -1;
+			vertexScoreList[v] = getVertexScore(-1, valenceList[v]);
+		}
+
+		Array<uint8_t> isEmittedList(a);
+		ArrayFn::resize(isEmittedList, triangleCount);
+		memset(ArrayFn::begin(isEmittedList), 0, triangleCount);
+
+		Array<uint32_t> outputList(a);
+		ArrayFn::resize(outputList, triangleCount * 3);
+
+		uint32_t cache[CACHE_SIZE + 3];
+		uint32_t cacheCount = 0;
+		uint32_t scanPosition = 0;
+		uint32_t bestTriangle = UINT32_MAX;
+
+		for (uint32_t emitted = 0; emitted < triangleCount; ++emitted)
+		{
+			if (bestTriangle == UINT32_MAX)
+			{
+				// Nothing left around the cached vertices, continue with the next triangle in input order
+				while (isEmittedList[scanPosition] != 0)
+				{
+					++scanPosition;
+				}
+				bestTriangle = scanPosition;
+			}
+
+			const uint32_t* triangle = &indices[bestTriangle * 3];
+			isEmittedList[bestTriangle] = 1;
+			outputList[emitted*3 + 0] = triangle[0];
+			outputList[emitted*3 + 1] = triangle[1];
+			outputList[emitted*3 + 2] = triangle[2];
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t v = triangle[k];
+				uint32_t* adjacency = &adjacencyList[adjacencyOffsetList[v]];
+				for (uint32_t j = 0; j < valenceList[v]; ++j)
+				{
+					if (adjacency[j] == bestTriangle)
+					{
+						adjacency[j] = adjacency[valenceList[v] - 1];
+						break;
+					}
+				}
+				--valenceList[v];
+			}
+
+			// The vertices of the triangle move to the front of the LRU cache
+			uint32_t newCache[CACHE_SIZE + 3];
+			uint32_t newCacheCount = 0;
+			newCache[newCacheCount++] = triangle[0];
+			newCache[newCacheCount++] = triangle[1];
+			newCache[newCacheCount++] = triangle[2];
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				const uint32_t v = cache[i];
+				if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				{
+					newCache[newCacheCount++] = v;
+				}
+			}
+
+			for (uint32_t i = 0; i < newCacheCount; ++i)
+			{
+				const uint32_t v = newCache[i];
+				cachePositionList[v] = i < CACHE_SIZE ? int32_t(i) : -1;
+				vertexScoreList[v] = getVertexScore(cachePositionList[v], valenceList[v]);
+			}
+
+			cacheCount = newCacheCount < CACHE_SIZE ? newCacheCount : CACHE_SIZE;
+			memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+			// Pick the best triangle around the cached vertices
+			bestTriangle = UINT32_MAX;
+			float bestScore = -1.0f;
+			for (uint32_t i = 0; i < cacheCount; ++i)
+			{
+				const uint32_t v = newCache[i];
+				const uint32_t* adjacency = &adjacencyList[adjacencyOffsetList[v]];
+				for (uint32_t j = 0; j < valenceList[v]; ++j)
+				{
+					const uint32_t t = adjacency[j];
+					const float score = vertexScoreList[indices[t*3 + 0]]
+						+ vertexScoreList[indices[t*3 + 1]]
+						+ vertexScoreList[indices[t*3 + 2]]
+						;
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = t;
+					}
+				}
+			}
+		}
+
+		memcpy(indices, ArrayFn::begin(outputList), triangleCount * 3 * sizeof(uint32_t));
+	}
+
+	uint32_t optimizeVertexFetch(void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t* indices, uint32_t indexCount)
+	{
+		Allocator& a = getDefaultAllocator();
+
+		Array<uint32_t> remapList(a);
+		ArrayFn::resize(remapList, vertexCount);
+		memset(ArrayFn::begin(remapList), 0xff, vertexCount * sizeof(uint32_t));
+
+		Array<char> vertexList(a);
+		ArrayFn::resize(vertexList, vertexCount * stride);
+
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			const uint32_t v = indices[i];
+			if (remapList[v] == UINT32_MAX)
+			{
+				memcpy(&vertexList[count * stride], (const char*)vertices + v * stride, stride);
+				remapList[v] = count++;
+			}
+			indices[i] = remapList[v];
+		}
+
+		memcpy(vertices, ArrayFn::begin(vertexList), count * stride);
+		return count;
+	}
+
+	uint32_t simplify(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const void* positions, uint32_t vertexCount, uint32_t stride, uint32_t targetIndexCount, float& resultError)
+	{
+		using namespace MeshOptimizerInternalFn;
+
+		Allocator& a = getDefaultAllocator();
+		resultError = 0.0f;
+
+		indexCount -= indexCount % 3;
+		memcpy(destination, indices, indexCount * sizeof(uint32_t));
+
+		Array<Vector3> positionList(a);
+		ArrayFn::resize(positionList, vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			memcpy(&positionList[v], (const char*)positions + v * stride, sizeof(Vector3));
+		}
+
+		// Vertices sharing their position with another vertex lie on an attribute seam
+		Array<uint8_t> isLockedList(a);
+		ArrayFn::resize(isLockedList, vertexCount);
+		memset(ArrayFn::begin(isLockedList), 0, vertexCount);
+		{
+			Array<Vector3> uniquePositionList(a);
+			Array<uint32_t> positionRemapList(a);
+			Array<uint32_t> useCountList(a);
+			ArrayFn::resize(uniquePositionList, vertexCount);
+			ArrayFn::resize(positionRemapList, vertexCount);
+			ArrayFn::resize(useCountList, vertexCount);
+			memset(ArrayFn::begin(useCountList), 0, vertexCount * sizeof(uint32_t));
+
+			weldVertices(ArrayFn::begin(positionList), vertexCount, sizeof(Vector3), ArrayFn::begin(uniquePositionList), ArrayFn::begin(positionRemapList));
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				++useCountList[positionRemapList[v]];
+			}
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				isLockedList[v] = useCountList[positionRemapList[v]] > 1 ? 1 : 0;
+			}
+		}
+
+		// Edges used by a single triangle are on an open border
+		{
+			Array<uint64_t> edgeList(a);
+			ArrayFn::resize(edgeList, indexCount);
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				const uint32_t v0 = destination[i];
+				const uint32_t v1 = destination[i - i % 3 + (i + 1) % 3];
+				edgeList[i] = v0 < v1 ? (uint64_t(v0) << 32 | v1) : (uint64_t(v1) << 32 | v0);
+			}
+			std::sort(ArrayFn::begin(edgeList), ArrayFn::end(edgeList));
+
+			for (uint32_t i = 0; i < indexCount; )
+			{
+				uint32_t j = i + 1;
+				while (j < indexCount && edgeList[j] == edgeList[i])
+				{
+					++j;
+				}
+				if (j - i == 1)
+				{
+					isLockedList[uint32_t(edgeList[i] >> 32)] = 1;
+					isLockedList[uint32_t(edgeList[i] & 0xffffffff)] = 1;
+				}
+				i = j;
+			}
+		}
+
+		// Plane of every triangle around each vertex
+		Array<Quadric> quadricList(a);
+		ArrayFn::resize(quadricList, vertexCount);
+		memset(ArrayFn::begin(quadricList), 0, vertexCount * sizeof(Quadric));
+		for (uint32_t i = 0; i < indexCount; i += 3)
+		{
+			const Vector3& p0 = positionList[destination[i + 0]];
+			const Vector3& p1 = positionList[destination[i + 1]];
+			const Vector3& p2 = positionList[destination[i + 2]];
+			Vector3 n = cross(p1 - p0, p2 - p0);
+			const float length = getLength(n);
+			if (length == 0.0f)
+			{
+				continue;
+			}
+			n *= 1.0f / length;
+
+			const float d = -dot(n, p0);
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				addPlane(quadricList[destination[i + k]], n.x, n.y, n.z, d);
+			}
+		}
+
+		Array<uint32_t> valenceList(a);
+		Array<uint32_t> adjacencyOffsetList(a);
+		Array<uint32_t> adjacencyList(a);
+		Array<uint32_t> remapList(a);
+		Array<uint8_t> isTouchedList(a);
+		Array<Collapse> collapseList(a);
+		ArrayFn::resize(valenceList, vertexCount);
+		ArrayFn::resize(adjacencyOffsetList, vertexCount + 1);
+		ArrayFn::resize(remapList, vertexCount);
+		ArrayFn::resize(isTouchedList, vertexCount);
+
+		double maxError = 0.0;
+
+		while (indexCount > targetIndexCount)
+		{
+			const uint32_t triangleCount = indexCount / 3;
+
+			// Triangles around each vertex
+			memset(ArrayFn::begin(valenceList), 0, vertexCount * sizeof(uint32_t));
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				++valenceList[destination[i]];
+			}
+			adjacencyOffsetList[0] = 0;
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				adjacencyOffsetList[v + 1] = adjacencyOffsetList[v] + valenceList[v];
+			}
+			ArrayFn::resize(adjacencyList, indexCount);
+			memset(ArrayFn::begin(valenceList), 0, vertexCount * sizeof(uint32_t));
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				const uint32_t v = destination[i];
+				adjacencyList[adjacencyOffsetList[v] + valenceList[v]++] = i / 3;
+			}
+
+			// Cheapest collapses first, every vertex moves onto one of its neighbours
+			ArrayFn::clear(collapseList);
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				const uint32_t from = destination[i];
+				const uint32_t to = destination[i - i % 3 + (i + 1) % 3];
+				if (isLockedList[from] != 0)
+				{
+					continue;
+				}
+
+				Quadric q = quadricList[from];
+				addQuadric(q, quadricList[to]);
+
+				Collapse collapse;
+				collapse.from = from;
+				collapse.to = to;
+				collapse.error = float(getQuadricError(q, positionList[to]));
+				ArrayFn::pushBack(collapseList, collapse);
+
+				if (isLockedList[to] == 0)
+				{
+					collapse.from = to;
+					collapse.to = from;
+					collapse.error = float(getQuadricError(q, positionList[from]));
+					ArrayFn::pushBack(collapseList, collapse);
+				}
+			}
+			std::sort(ArrayFn::begin(collapseList), ArrayFn::end(collapseList));
+
+			for (uint32_t v = 0; v < vertexCount; ++v)
+			{
+				remapList[v] = v;
+			}
+			memset(ArrayFn::begin(isTouchedList), 0, vertexCount);
+
+			// A collapse removes two triangles on closed surfaces
+			const uint32_t targetTriangleCount = targetIndexCount / 3;
+			const uint32_t collapseLimit = triangleCount > targetTriangleCount + 2 ? (triangleCount - targetTriangleCount) / 2 : 1;
+			uint32_t collapseCount = 0;
+
+			// Much worse collapses wait for the quadrics to be updated by the next pass
+			const uint32_t collapseListCount = ArrayFn::getCount(collapseList);
+			const float errorLimit = collapseListCount != 0
+				? collapseList[(collapseLimit < collapseListCount ? collapseLimit : collapseListCount) - 1].error * 1.5f
+				: 0.0f
+				;
+
+			for (uint32_t c = 0; c < collapseListCount && collapseCount < collapseLimit; ++c)
+			{
+				const Collapse& collapse = collapseList[c];
+				if (collapse.error > errorLimit && collapseCount != 0)
+				{
+					break;
+				}
+				if (isTouchedList[collapse.from] != 0 || isTouchedList[collapse.to] != 0)
+				{
+					continue;
+				}
+
+				// Moving <from> must not flip the triangles that stay
+				const uint32_t* adjacency = &adjacencyList[adjacencyOffsetList[collapse.from]];
+				const uint32_t adjacencyCount = valenceList[collapse.from];
+				bool isFlipping = false;
+				for (uint32_t j = 0; j < adjacencyCount && !isFlipping; ++j)
+				{
+					const uint32_t* triangle = &destination[adjacency[j] * 3];
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					{
+						continue;
+					}
+
+					const uint32_t k = triangle[0] == collapse.from ? 0 : (triangle[1] == collapse.from ? 1 : 2);
+					const Vector3& p1 = positionList[triangle[(k + 1) % 3]];
+					const Vector3& p2 = positionList[triangle[(k + 2) % 3]];
+					const Vector3 before = cross(p1 - positionList[collapse.from], p2 - positionList[collapse.from]);
+					const Vector3 after = cross(p1 - positionList[collapse.to], p2 - positionList[collapse.to]);
+					isFlipping = dot(before, after) <= 0.0f;
+				}
+				if (isFlipping)
+				{
+					continue;
+				}
+
+				remapList[collapse.from] = collapse.to;
+				addQuadric(quadricList[collapse.to], quadricList[collapse.from]);
+				maxError = collapse.error > maxError ? collapse.error : maxError;
+				++collapseCount;
+
+				// The neighbourhood of the collapse waits for the next pass
+				for (uint32_t j = 0; j < adjacencyCount; ++j)
+				{
+					const uint32_t* triangle = &destination[adjacency[j] * 3];
+					isTouchedList[triangle[0]] = 1;
+					isTouchedList[triangle[1]] = 1;
+					isTouchedList[triangle[2]] = 1;
+				}
+			}
+
+			if (collapseCount == 0)
+			{
+				break;
+			}
+
+			// Remove the degenerate triangles
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < indexCount; i += 3)
+			{
+				const uint32_t v0 = remapList[destination[i + 0]];
+				const uint32_t v1 = remapList[destination[i + 1]];
+				const uint32_t v2 = remapList[destination[i + 2]];
+				if (v0 != v1 && v1 != v2 && v2 != v0)
+				{
+					destination[count + 0] = v0;
+					destination[count + 1] = v1;
+					destination[count + 2] = v2;
+					count += 3;
+				}
+			}
+			indexCount = count;
+		}
+
+		resultError = float(sqrt(maxError));
+		return indexCount;
+	}
+
+	float getAverageCacheMissRatio(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+	{
+		if (indexCount < 3)
+		{
+			return 0.0f;
+		}
+
+		// A vertex is in the cache if fewer than <cacheSize> vertices were inserted after it
+		Array<uint32_t> timeList(getDefaultAllocator());
+		ArrayFn::resize(timeList, vertexCount);
+		memset(ArrayFn::begin(timeList), 0, vertexCount * sizeof(uint32_t));
+
+		uint32_t time = cacheSize + 1;
+		uint32_t missCount = 0;
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			const uint32_t v = indices[i];
+			if (time - timeList[v] > cacheSize)
+			{
+				timeList[v] = time++;
+				++missCount;
+			}
+		}
+
+		return float(missCount) / float(indexCount / 3);
+	}
+} // namespace MeshOptimizerFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
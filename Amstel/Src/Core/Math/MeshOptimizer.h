@@ -0,0 +1,41 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+
+namespace Rio
+{
+
+// Triangle list optimizations run by the mesh compiler
+namespace MeshOptimizerFn
+{
+	// Merges the bitwise identical vertices among the <vertexCount> vertices of <stride> bytes at <vertices>
+	// Writes the unique vertices to <uniqueVertices>, which must have room for <vertexCount> vertices,
+	// and the index of the unique vertex of each input vertex to <indices>
+	// Returns the number of unique vertices
+	uint32_t weldVertices(const void* vertices, uint32_t vertexCount, uint32_t stride, void* uniqueVertices, uint32_t* indices);
+
+	// Reorders the triangles of the list <indices> so that they reuse the vertices
+	// recently transformed by the GPU (Tom Forsyth's linear-speed vertex cache optimisation)
+	void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+	// Reorders the <vertexCount> <vertices> by first use in <indices> and remaps <indices> accordingly
+	// Vertices not referenced by <indices> are dropped
+	// Returns the number of vertices left
+	uint32_t optimizeVertexFetch(void* vertices, uint32_t vertexCount, uint32_t stride, uint32_t* indices, uint32_t indexCount);
+
+	// Simplifies the triangle list <indices> by quadric edge collapses until it has at most <targetIndexCount> indices
+	// or no more edge can be collapsed, the <vertexCount> <positions> (3 floats every <stride> bytes) are not modified
+	// Vertices on open borders and on attribute seams are kept in place
+	// Writes the simplified list to <destination>, which must have room for <indexCount> indices,
+	// and the largest distance introduced to <resultError>
+	// Returns the number of indices written
+	uint32_t simplify(uint32_t* destination, const uint32_t* indices, uint32_t indexCount, const void* positions, uint32_t vertexCount, uint32_t stride, uint32_t targetIndexCount, float& resultError);
+
+	// Returns the average number of vertices transformed per triangle by a FIFO cache of <cacheSize> entries
+	// 3.0 is the worst case, 0.5 the best for regular meshes
+	float getAverageCacheMissRatio(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize);
+} // namespace MeshOptimizerFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,165 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+#include "Core/Math/MathTypes.h"
+#include "Core/Math/MathUtils.h"
+
+#include <string.h> // memcpy
+
+namespace Rio
+{
+
+// Returns the IEEE 754 half precision float nearest to <a>
+inline uint16_t getHalfFromFloat(float a)
+{
+	uint32_t f;
+	memcpy(&f, &a, sizeof(f));
+
+	const uint32_t sign = (f >> 16) & 0x8000;
+	const int32_t exponent = int32_t((f >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = f & 0x007fffff;
+
+	if (exponent >= 31)
+	{
+		// Overflow, infinity and NaN
+		const bool isNaN = ((f >> 23) & 0xff) == 0xff && mantissa != 0;
+		return uint16_t(sign | 0x7c00 | (isNaN ? 0x200 : 0));
+	}
+
+	if (exponent <= 0)
+	{
+		// Denormal or zero
+		if (exponent < -10)
+		{
+			return uint16_t(sign);
+		}
+
+		mantissa |= 0x00800000;
+		const uint32_t shift = uint32_t(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1) != 0))
+		{
+			++half;
+		}
+		return uint16_t(sign | half);
+	}
+
+	// Round to nearest even, a carry into the exponent is still correct
+	uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0))
+	{
+		++half;
+	}
+	return uint16_t(half);
+}
+
+// Returns the float value of the half precision float <h>
+inline float getFloatFromHalf(uint16_t h)
+{
+	const uint32_t sign = uint32_t(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+
+	uint32_t f;
+	if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			f = sign;
+		}
+		else
+		{
+			// Normalize the denormal
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400) == 0)
+			{
+				mantissa <<= 1;
+				--exponent;
+			}
+			f = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+	}
+	else if (exponent == 31)
+	{
+		f = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else
+	{
+		f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float a;
+	memcpy(&a, &f, sizeof(a));
+	return a;
+}
+
+// Returns <a> in [-1, 1] as signed normalized 16 bit integer
+inline int16_t getSnorm16FromFloat(float a)
+{
+	const float c = getClampedFloat(-1.0f, 1.0f, a) * 32767.0f;
+	return int16_t(c >= 0.0f ? c + 0.5f : c - 0.5f);
+}
+
+// Returns the value in [-1, 1] of the signed normalized 16 bit integer <a>
+inline float getFloatFromSnorm16(int16_t a)
+{
+	return getMaxFloat(float(a) / 32767.0f, -1.0f);
+}
+
+// Returns <a> in [0, 1] as unsigned normalized 8 bit integer
+inline uint8_t getUnorm8FromFloat(float a)
+{
+	return uint8_t(getClampedFloat(0.0f, 1.0f, a) * 255.0f + 0.5f);
+}
+
+// Returns the value in [0, 1] of the unsigned normalized 8 bit integer <a>
+inline float getFloatFromUnorm8(uint8_t a)
+{
+	return float(a) / 255.0f;
+}
+
+// Returns the octahedral encoding in [-1, 1] of the unit vector <n>
+inline Vector2 getOctahedralFromNormal(const Vector3& n)
+{
+	const float invL1 = 1.0f / (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+
+	Vector2 e;
+	e.x = n.x * invL1;
+	e.y = n.y * invL1;
+
+	// The lower hemisphere is folded over the diagonals
+	if (n.z < 0.0f)
+	{
+		const float x = e.x;
+		e.x = (1.0f - fabsf(e.y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		e.y = (1.0f - fabsf(x)) * (e.y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	return e;
+}
+
+// Returns the unit vector encoded by the octahedral coordinates <e> in [-1, 1]
+inline Vector3 getNormalFromOctahedral(const Vector2& e)
+{
+	Vector3 n;
+	n.x = e.x;
+	n.y = e.y;
+	n.z = 1.0f - fabsf(e.x) - fabsf(e.y);
+
+	const float t = getMaxFloat(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+
+	const float invLength = 1.0f / sqrtf(n.x*n.x + n.y*n.y + n.z*n.z);
+	n.x *= invLength;
+	n.y *= invLength;
+	n.z *= invLength;
+	return n;
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,432 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Core/Memory/AllocationTracker.h"
+#include "Core/Strings/StringStream.h"
+
+#if RIO_ALLOCATION_TRACKER
+
+#include "Core/Base/Macros.h"
+#include "Core/Base/Murmur.h"
+#include "Core/Containers/Array.h"
+#include "Core/Error/Error.h"
+#include "Core/Memory/Memory.h"
+#include "Core/Thread/AtomicInt.h"
+#include "Device/Log.h"
+
+#include <algorithm> // std::sort
+
+namespace Rio
+{
+
+namespace AllocationTrackerInternalFn
+{
+	RIO_STATIC_ASSERT((RIO_ALLOCATION_TRACKER_MAX_CALL_SITES & (RIO_ALLOCATION_TRACKER_MAX_CALL_SITES - 1)) == 0);
+
+	struct CallSite
+	{
+		AtomicInt hash = AtomicInt(0); // 0 marks a free slot
+		AtomicInt ready = AtomicInt(0); // Set once <frames> are written
+		uint32_t depth = 0;
+		void* frames[RIO_ALLOCATION_TRACKER_MAX_FRAMES];
+
+		AtomicInt liveBytes = AtomicInt(0);
+		AtomicInt liveCount = AtomicInt(0);
+		AtomicInt frameBytes = AtomicInt(0);
+		AtomicInt frameAllocationCount = AtomicInt(0);
+		AtomicInt lastFrameBytes = AtomicInt(0);
+		AtomicInt lastFrameAllocationCount = AtomicInt(0);
+	};
+
+	struct CallSiteSnapshot
+	{
+		uint32_t index;
+		uint32_t bytes;
+		uint32_t count;
+	};
+
+	// Sorts by decreasing bytes, then by decreasing count
+	struct CompareBytes
+	{
+		bool operator()(const CallSiteSnapshot& a, const CallSiteSnapshot& b) const
+		{
+			return a.bytes != b.bytes ? a.bytes > b.bytes : a.count > b.count;
+		}
+	};
+
+	// Sorts by decreasing count, then by decreasing bytes
+	struct CompareCount
+	{
+		bool operator()(const CallSiteSnapshot& a, const CallSiteSnapshot& b) const
+		{
+			return a.count != b.count ? a.count > b.count : a.bytes > b.bytes;
+		}
+	};
+
+	static CallSite callSiteList[RIO_ALLOCATION_TRACKER_MAX_CALL_SITES];
+	static AtomicInt sampleRate(RIO_ALLOCATION_TRACKER_SAMPLE_RATE);
+	static AtomicInt droppedCount(0);
+	static RIO_THREAD uint32_t countdown = 0;
+	// Set while the calling thread is inside the tracker, the platform unwinder may allocate
+	static RIO_THREAD bool isTracking = false;
+
+	// Returns whether <callSite> holds the callstack <frames>
+	// Waits for the thread that claimed the slot to finish writing its frames
+	static bool isSameCallstack(const CallSite& callSite, void** frames, uint32_t frameCount)
+	{
+		while (callSite.ready.load() == 0)
+		{
+		}
+
+		if (callSite.depth != frameCount)
+		{
+			return false;
+		}
+
+		for (uint32_t f = 0; f < frameCount; ++f)
+		{
+			if (callSite.frames[f] != frames[f])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Returns the index of the call site for <frames> or RIO_ALLOCATION_TRACKER_MAX_CALL_SITES if the table is full
+	// Callstacks with colliding hashes get a slot each
+	static uint32_t findOrInsert(void** frames, uint32_t frameCount)
+	{
+		uint32_t hash = getMurmurHash32(frames, frameCount * sizeof(void*), 0);
+		hash = hash == 0 ? 1 : hash;
+
+		uint32_t index = hash & (RIO_ALLOCATION_TRACKER_MAX_CALL_SITES - 1);
+		for (uint32_t i = 0; i < RIO_ALLOCATION_TRACKER_MAX_CALL_SITES; ++i)
+		{
+			CallSite& callSite = callSiteList[index];
+			const int current = callSite.hash.load();
+
+			if (current == (int)hash && isSameCallstack(callSite, frames, frameCount))
+			{
+				return index;
+			}
+
+			if (current == 0 && callSite.hash.compareAndSwap(0, (int)hash) == 0)
+			{
+				for (uint32_t f = 0; f < frameCount; ++f)
+				{
+					callSite.frames[f] = frames[f];
+				}
+				callSite.depth = frameCount;
+				callSite.ready.store(1);
+				return index;
+			}
+
+			// Somebody else claimed the slot, it might be for the same callstack
+			if (current == 0 && callSite.hash.load() == (int)hash && isSameCallstack(callSite, frames, frameCount))
+			{
+				return index;
+			}
+
+			index = (index + 1) & (RIO_ALLOCATION_TRACKER_MAX_CALL_SITES - 1);
+		}
+
+		return RIO_ALLOCATION_TRACKER_MAX_CALL_SITES;
+	}
+
+	template <typename Compare>
+	static void getTop(Array<CallSiteSnapshot>& snapshotList, bool lastFrame, uint32_t count, Compare compare)
+	{
+		for (uint32_t i = 0; i < RIO_ALLOCATION_TRACKER_MAX_CALL_SITES; ++i)
+		{
+			const CallSite& callSite = callSiteList[i];
+			if (callSite.ready.load() == 0)
+			{
+				continue;
+			}
+
+			CallSiteSnapshot snapshot;
+			snapshot.index = i;
+			snapshot.bytes = (uint32_t)(lastFrame ? callSite.lastFrameBytes.load() : callSite.liveBytes.load());
+			snapshot.count = (uint32_t)(lastFrame ? callSite.lastFrameAllocationCount.load() : callSite.liveCount.load());
+			if (snapshot.count != 0)
+			{
+				ArrayFn::pushBack(snapshotList, snapshot);
+			}
+		}
+
+		std::sort(ArrayFn::begin(snapshotList), ArrayFn::end(snapshotList), compare);
+		if (ArrayFn::getCount(snapshotList) > count)
+		{
+			ArrayFn::resize(snapshotList, count);
+		}
+	}
+
+	static void writeCallSites(StringStream& json, const Array<CallSiteSnapshot>& snapshotList, uint32_t rate)
+	{
+		json << "[";
+		for (uint32_t i = 0; i < ArrayFn::getCount(snapshotList); ++i)
+		{
+			const CallSiteSnapshot& snapshot = snapshotList[i];
+			const CallSite& callSite = callSiteList[snapshot.index];
+
+			json << (i == 0 ? "{" : ",{");
+			json << "\"bytes\":" << uint64_t(snapshot.bytes) * rate;
+			json << ",\"count\":" << uint64_t(snapshot.count) * rate;
+			json << ",\"callstack\":[";
+			for (uint32_t f = 0; f < callSite.depth; ++f)
+			{
+				char name[256];
+				ErrorFn::getSymbolName(callSite.frames[f], name, sizeof(name));
+				json << (f == 0 ? "\"" : ",\"");
+				for (const char* ch = name; *ch != '\0'; ++ch)
+				{
+					if (*ch == '"' || *ch == '\\')
+					{
+						json << '\\';
+					}
+					json << *ch;
+				}
+				json << "\"";
+			}
+			json << "]}";
+		}
+		json << "]";
+	}
+} // namespace AllocationTrackerInternalFn
+
+namespace AllocationTrackerFn
+{
+	uint32_t onAllocate(uint32_t size)
+	{
+		using namespace AllocationTrackerInternalFn;
+
+		if (isTracking)
+		{
+			return 0;
+		}
+
+		const uint32_t rate = (uint32_t)sampleRate.load();
+		if (rate == 0)
+		{
+			return 0;
+		}
+
+		// The rate may have been lowered since the countdown started
+		if (countdown >= rate)
+		{
+			countdown = rate - 1;
+		}
+
+		if (countdown != 0)
+		{
+			--countdown;
+			return 0;
+		}
+		countdown = rate - 1;
+
+		isTracking = true;
+
+		void* frames[RIO_ALLOCATION_TRACKER_MAX_FRAMES];
+		// Skip onAllocate() and the allocator itself
+		const uint32_t frameCount = ErrorFn::captureCallstack(frames, RIO_COUNTOF(frames), 2);
+		const uint32_t index = findOrInsert(frames, frameCount);
+
+		isTracking = false;
+
+		if (index == RIO_ALLOCATION_TRACKER_MAX_CALL_SITES)
+		{
+			droppedCount.fetchAdd(1);
+			return 0;
+		}
+
+		CallSite& callSite = callSiteList[index];
+		callSite.liveBytes.fetchAdd((int)size);
+		callSite.liveCount.fetchAdd(1);
+		callSite.frameBytes.fetchAdd((int)size);
+		callSite.frameAllocationCount.fetchAdd(1);
+
+		return index + 1;
+	}
+
+	void onDeallocate(uint32_t callSite, uint32_t size)
+	{
+		using namespace AllocationTrackerInternalFn;
+
+		RIO_ASSERT(callSite != 0 && callSite <= RIO_ALLOCATION_TRACKER_MAX_CALL_SITES, "Bad call site");
+		CallSite& cs = callSiteList[callSite - 1];
+		cs.liveBytes.fetchAdd(-(int)size);
+		cs.liveCount.fetchAdd(-1);
+	}
+} // namespace AllocationTrackerFn
+
+namespace AllocationTrackerGlobalFn
+{
+	void setSampleRate(uint32_t rate)
+	{
+		AllocationTrackerInternalFn::sampleRate.store((int)rate);
+	}
+
+	uint32_t getSampleRate()
+	{
+		return (uint32_t)AllocationTrackerInternalFn::sampleRate.load();
+	}
+
+	void updateFrame()
+	{
+		using namespace AllocationTrackerInternalFn;
+
+		for (uint32_t i = 0; i < RIO_ALLOCATION_TRACKER_MAX_CALL_SITES; ++i)
+		{
+			CallSite& callSite = callSiteList[i];
+			if (callSite.ready.load() == 0)
+			{
+				continue;
+			}
+
+			callSite.lastFrameBytes.store(callSite.frameBytes.load());
+			callSite.lastFrameAllocationCount.store(callSite.frameAllocationCount.load());
+			callSite.frameBytes.store(0);
+			callSite.frameAllocationCount.store(0);
+		}
+	}
+
+	void writeJson(StringStream& json, uint32_t count)
+	{
+		using namespace AllocationTrackerInternalFn;
+
+		const uint32_t rate = getSampleRate();
+
+		json << "{\"sampleRate\":" << rate;
+		json << ",\"dropped\":" << (uint32_t)droppedCount.load();
+
+		const char* nameList[] = { "frameBytes", "frameCount", "liveBytes", "liveCount" };
+		for (uint32_t i = 0; i < RIO_COUNTOF(nameList); ++i)
+		{
+			const bool lastFrame = i < 2;
+			const bool byCount = (i & 1) != 0;
+
+			Array<CallSiteSnapshot> snapshotList(getDefaultAllocator());
+			if (byCount)
+			{
+				getTop(snapshotList, lastFrame, count, CompareCount());
+			}
+			else
+			{
+				getTop(snapshotList, lastFrame, count, CompareBytes());
+			}
+
+			json << ",\"" << nameList[i] << "\":";
+			writeCallSites(json, snapshotList, rate);
+		}
+		json << "}";
+	}
+
+	void logLive(uint32_t count)
+	{
+		using namespace AllocationTrackerInternalFn;
+
+		const uint32_t rate = getSampleRate();
+		if (rate == 0)
+		{
+			return;
+		}
+
+		// The tracker must not sample its own report, this runs while the heap is shutting down
+		isTracking = true;
+
+		// Selects the biggest call sites without allocating, the heap is being destroyed
+		uint32_t previousBytes = 0xffffffffu;
+		uint32_t previousIndex = RIO_ALLOCATION_TRACKER_MAX_CALL_SITES;
+		for (uint32_t n = 0; n < count; ++n)
+		{
+			uint32_t best = RIO_ALLOCATION_TRACKER_MAX_CALL_SITES;
+			uint32_t bestBytes = 0;
+
+			for (uint32_t i = 0; i < RIO_ALLOCATION_TRACKER_MAX_CALL_SITES; ++i)
+			{
+				const CallSite& callSite = callSiteList[i];
+				if (callSite.ready.load() == 0 || callSite.liveCount.load() <= 0)
+				{
+					continue;
+				}
+
+				const uint32_t bytes = (uint32_t)callSite.liveBytes.load();
+				// Ties are broken by index so that every call site is visited once
+				const bool isAfterPrevious = bytes < previousBytes || (bytes == previousBytes && i > previousIndex);
+				const bool isBetter = best == RIO_ALLOCATION_TRACKER_MAX_CALL_SITES || bytes > bestBytes;
+				if (isAfterPrevious && isBetter)
+				{
+					best = i;
+					bestBytes = bytes;
+				}
+			}
+
+			if (best == RIO_ALLOCATION_TRACKER_MAX_CALL_SITES)
+			{
+				break;
+			}
+
+			const CallSite& callSite = callSiteList[best];
+			RIO_LOGW("Live allocations: ~%u bytes in ~%u blocks", bestBytes * rate, (uint32_t)callSite.liveCount.load() * rate);
+			for (uint32_t f = 0; f < callSite.depth; ++f)
+			{
+				char name[256];
+				ErrorFn::getSymbolName(callSite.frames[f], name, sizeof(name));
+				RIO_LOGW("\t[%2u] %s", f, name);
+			}
+
+			previousBytes = bestBytes;
+			previousIndex = best;
+		}
+
+		isTracking = false;
+	}
+} // namespace AllocationTrackerGlobalFn
+
+} // namespace Rio
+
+#else
+
+namespace Rio
+{
+
+namespace AllocationTrackerFn
+{
+	uint32_t onAllocate(uint32_t /*size*/)
+	{
+		return 0;
+	}
+
+	void onDeallocate(uint32_t /*callSite*/, uint32_t /*size*/)
+	{
+	}
+} // namespace AllocationTrackerFn
+
+namespace AllocationTrackerGlobalFn
+{
+	void setSampleRate(uint32_t /*rate*/)
+	{
+	}
+
+	uint32_t getSampleRate()
+	{
+		return 0;
+	}
+
+	void updateFrame()
+	{
+	}
+
+	void writeJson(StringStream& json, uint32_t /*count*/)
+	{
+		json << "{\"sampleRate\":0,\"dropped\":0,\"frameBytes\":[],\"frameCount\":[],\"liveBytes\":[],\"liveCount\":[]}";
+	}
+
+	void logLive(uint32_t /*count*/)
+	{
+	}
+} // namespace AllocationTrackerGlobalFn
+
+} // namespace Rio
+
+#endif // RIO_ALLOCATION_TRACKER
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
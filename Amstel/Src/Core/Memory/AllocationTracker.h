@@ -0,0 +1,40 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Config.h"
+#include "Core/Base/Types.h"
+#include "Core/Strings/StringTypes.h"
+
+namespace Rio
+{
+
+// Samples one in every N allocations of the default heap and attributes them
+// to the callstack that made them
+// Call sites live in a fixed size lock-free hash table, nothing is allocated while tracking
+// Reported bytes and counts are estimates, i.e. the sampled values multiplied by the sample rate
+namespace AllocationTrackerFn
+{
+	// Records an allocation of <size> bytes
+	// Returns the call site to pass to onDeallocate() or 0 if the allocation was not sampled
+	uint32_t onAllocate(uint32_t size);
+
+	// Records the deallocation of <size> bytes previously sampled at <callSite>
+	void onDeallocate(uint32_t callSite, uint32_t size);
+} // namespace AllocationTrackerFn
+
+namespace AllocationTrackerGlobalFn
+{
+	// Samples one in every <rate> allocations, 0 stops sampling
+	void setSampleRate(uint32_t rate);
+	uint32_t getSampleRate();
+	// Closes the current frame for the per frame counters
+	void updateFrame();
+	// Writes the <count> top call sites as JSON, ordered by bytes and by number of allocations,
+	// both for the last frame and for the live allocations
+	void writeJson(StringStream& json, uint32_t count);
+	// Logs the <count> top call sites by live bytes
+	void logLive(uint32_t count);
+} // namespace AllocationTrackerGlobalFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,221 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Core/Memory/ArenaAllocator.h"
+#include "Core/Memory/Memory.h"
+
+namespace Rio
+{
+
+namespace ArenaAllocatorInternalFn
+{
+	static const uint32_t sizeClassList[] =
+	{
+		16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+	};
+
+	// Returns the smallest size class which fits <size>
+	inline uint32_t getSizeClass(uint32_t size)
+	{
+		uint32_t i = 0;
+		while (i < RIO_COUNTOF(sizeClassList) && sizeClassList[i] < size)
+		{
+			++i;
+		}
+		return i;
+	}
+} // namespace ArenaAllocatorInternalFn
+
+ArenaAllocator::ArenaAllocator(Allocator& backingAllocator, uint32_t chunkSize)
+	: backingAllocator(backingAllocator)
+	, chunkSize(chunkSize)
+{
+	RIO_STATIC_ASSERT(RIO_COUNTOF(ArenaAllocatorInternalFn::sizeClassList) == SIZE_CLASS_COUNT);
+	RIO_STATIC_ASSERT(sizeof(Header) <= HEADER_SIZE);
+	RIO_ASSERT(chunkSize >= 2048 + HEADER_SIZE + MAX_SMALL_ALIGN, "Chunk size too small");
+
+	for (uint32_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+	{
+		freeList[i] = nullptr;
+	}
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+	releaseAll();
+}
+
+ArenaAllocator::Header* ArenaAllocator::getHeader(const void* data)
+{
+	return (Header*)((char*)data - HEADER_SIZE);
+}
+
+void* ArenaAllocator::allocate(uint32_t size, uint32_t align)
+{
+	ScopedMutex scopedMutex(mutex);
+
+	const uint32_t sizeClass = ArenaAllocatorInternalFn::getSizeClass(size);
+	if (sizeClass == SIZE_CLASS_COUNT || align > MAX_SMALL_ALIGN)
+	{
+		return allocateLarge(size, align);
+	}
+
+	const uint32_t classSize = ArenaAllocatorInternalFn::sizeClassList[sizeClass];
+	char* data = (char*)freeList[sizeClass];
+
+	if (data != nullptr)
+	{
+		freeList[sizeClass] = *(void**)data;
+	}
+	else
+	{
+		const uint32_t blockSize = HEADER_SIZE + classSize;
+
+		if (chunkCurrent == nullptr || chunkCurrent + blockSize > chunkEnd)
+		{
+			// The tail of the previous chunk is simply abandoned
+			Chunk* chunk = (Chunk*)backingAllocator.allocate(chunkSize, MAX_SMALL_ALIGN);
+			chunk->next = chunkList;
+			chunkList = chunk;
+			reservedSize += chunkSize;
+
+			chunkCurrent = (char*)MemoryFn::alignTop(chunk + 1, MAX_SMALL_ALIGN);
+			chunkEnd = (char*)chunk + chunkSize;
+		}
+
+		data = chunkCurrent + HEADER_SIZE;
+		chunkCurrent += blockSize;
+
+		Header* header = getHeader(data);
+		header->sizeClass = sizeClass;
+		header->offset = 0;
+	}
+
+	allocatedSize += classSize;
+	return data;
+}
+
+void* ArenaAllocator::allocateLarge(uint32_t size, uint32_t align)
+{
+	align = align < MAX_SMALL_ALIGN ? MAX_SMALL_ALIGN : align;
+	const uint32_t actualSize = sizeof(LargeBlock) + HEADER_SIZE + size + align;
+
+	LargeBlock* block = (LargeBlock*)backingAllocator.allocate(actualSize, alignof(LargeBlock));
+	block->size = size;
+	block->actualSize = actualSize;
+	block->prev = nullptr;
+	block->next = largeList;
+	if (largeList != nullptr)
+	{
+		largeList->prev = block;
+	}
+	largeList = block;
+
+	char* data = (char*)MemoryFn::alignTop((char*)(block + 1) + HEADER_SIZE, align);
+	Header* header = getHeader(data);
+	header->sizeClass = LARGE_BLOCK;
+	header->offset = uint32_t(data - (char*)block);
+
+	allocatedSize += size;
+	reservedSize += actualSize;
+	return data;
+}
+
+void ArenaAllocator::deallocate(void* data)
+{
+	if (data == nullptr)
+	{
+		return;
+	}
+
+	ScopedMutex scopedMutex(mutex);
+
+	Header* header = getHeader(data);
+
+	if (header->sizeClass == LARGE_BLOCK)
+	{
+		LargeBlock* block = (LargeBlock*)((char*)data - header->offset);
+
+		if (block->prev != nullptr)
+		{
+			block->prev->next = block->next;
+		}
+		else
+		{
+			largeList = block->next;
+		}
+
+		if (block->next != nullptr)
+		{
+			block->next->prev = block->prev;
+		}
+
+		allocatedSize -= block->size;
+		reservedSize -= block->actualSize;
+		backingAllocator.deallocate(block);
+		return;
+	}
+
+	RIO_ASSERT(header->sizeClass < SIZE_CLASS_COUNT, "Bad size class");
+	*(void**)data = freeList[header->sizeClass];
+	freeList[header->sizeClass] = data;
+	allocatedSize -= ArenaAllocatorInternalFn::sizeClassList[header->sizeClass];
+}
+
+void ArenaAllocator::clear()
+{
+	ScopedMutex scopedMutex(mutex);
+	releaseAll();
+}
+
+void ArenaAllocator::releaseAll()
+{
+	while (chunkList != nullptr)
+	{
+		Chunk* next = chunkList->next;
+		backingAllocator.deallocate(chunkList);
+		chunkList = next;
+	}
+
+	while (largeList != nullptr)
+	{
+		LargeBlock* next = largeList->next;
+		backingAllocator.deallocate(largeList);
+		largeList = next;
+	}
+
+	for (uint32_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+	{
+		freeList[i] = nullptr;
+	}
+
+	chunkCurrent = nullptr;
+	chunkEnd = nullptr;
+	allocatedSize = 0;
+	reservedSize = 0;
+}
+
+uint32_t ArenaAllocator::getAllocatedSize(const void* ptr)
+{
+	const Header* header = getHeader(ptr);
+
+	if (header->sizeClass == LARGE_BLOCK)
+	{
+		return ((const LargeBlock*)((const char*)ptr - header->offset))->size;
+	}
+
+	return ArenaAllocatorInternalFn::sizeClassList[header->sizeClass];
+}
+
+uint32_t ArenaAllocator::getTotalAllocatedBytes()
+{
+	ScopedMutex scopedMutex(mutex);
+	return allocatedSize;
+}
+
+uint32_t ArenaAllocator::getReservedBytes()
+{
+	ScopedMutex scopedMutex(mutex);
+	return reservedSize;
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,79 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Memory/Allocator.h"
+#include "Core/Thread/Mutex.h"
+
+namespace Rio
+{
+
+// Services small allocations from per-size-class free lists carved out of
+// big chunks obtained from the backing allocator
+// Requests bigger than the largest size class are forwarded to the backing allocator
+// and tracked so that clear() (or the destructor) can give everything back at once
+// All the operations are thread-safe
+class ArenaAllocator : public Allocator
+{
+public:
+	// Uses <backingAllocator> to allocate chunks of <chunkSize> bytes
+	ArenaAllocator(Allocator& backingAllocator, uint32_t chunkSize = 64 * 1024);
+	// Releases all the memory regardless of outstanding allocations
+	~ArenaAllocator();
+	void* allocate(uint32_t size, uint32_t align = Allocator::DEFAULT_ALIGN);
+	void deallocate(void* data);
+	// Returns all the chunks and big blocks to the backing allocator
+	// Every pointer returned by allocate() becomes invalid
+	void clear();
+	uint32_t getAllocatedSize(const void* ptr);
+	uint32_t getTotalAllocatedBytes();
+	// Returns the number of bytes currently obtained from the backing allocator
+	uint32_t getReservedBytes();
+private:
+	enum
+	{
+		SIZE_CLASS_COUNT = 14,
+		HEADER_SIZE = 16,
+		MAX_SMALL_ALIGN = 16,
+		LARGE_BLOCK = 0xffffffffu
+	};
+
+	// Stored right before the user data
+	struct Header
+	{
+		uint32_t sizeClass;
+		uint32_t offset; // Distance from the LargeBlock, big blocks only
+	};
+
+	struct Chunk
+	{
+		Chunk* next;
+	};
+
+	struct LargeBlock
+	{
+		LargeBlock* next;
+		LargeBlock* prev;
+		uint32_t size;
+		uint32_t actualSize;
+	};
+
+	static Header* getHeader(const void* data);
+	void* allocateLarge(uint32_t size, uint32_t align);
+	void releaseAll();
+
+	Mutex mutex;
+	Allocator& backingAllocator;
+	uint32_t chunkSize;
+
+	void* freeList[SIZE_CLASS_COUNT];
+	Chunk* chunkList = nullptr;
+	char* chunkCurrent = nullptr;
+	char* chunkEnd = nullptr;
+	LargeBlock* largeList = nullptr;
+
+	uint32_t allocatedSize = 0;
+	uint32_t reservedSize = 0;
+};
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -1,6 +1,7 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Core/Memory/Memory.h"
 #include "Core/Memory/Allocator.h"
+#include "Core/Memory/AllocationTracker.h"
 #include "Core/Thread/Mutex.h"
 
 #include <stdlib.h> // malloc
@@ -42,6 +43,9 @@ namespace MemoryFn
 	struct Header
 	{
 		uint32_t size;
+#if RIO_ALLOCATION_TRACKER
+		uint32_t callSite; // Never equal to HEADER_PAD_VALUE
+#endif // RIO_ALLOCATION_TRACKER
 	};
 
 	// If we need to align the memory allocation we pad the header with this
@@ -70,6 +74,10 @@ namespace MemoryFn
 	inline void fill(Header*header, void *data, uint32_t size)
 	{
 		header->size = size;
+#if RIO_ALLOCATION_TRACKER
+		// Untracked, the memory may hold HEADER_PAD_VALUE from an earlier allocation
+		header->callSite = 0;
+#endif // RIO_ALLOCATION_TRACKER
 		uint32_t *p = (uint32_t*)(header + 1);
 		while (p < data)
 		{
@@ -103,6 +111,12 @@ namespace MemoryFn
 
 		~HeapAllocator()
 		{
+#if RIO_ALLOCATION_TRACKER
+			if (allocationCount != 0)
+			{
+				AllocationTrackerGlobalFn::logLive(16);
+			}
+#endif // RIO_ALLOCATION_TRACKER
 			RIO_ASSERT(allocationCount == 0 && getTotalAllocatedBytes() == 0
 				, "Missing %d deallocations causing a leak of %d bytes"
 				, allocationCount
@@ -112,12 +126,20 @@ namespace MemoryFn
 
 		void* allocate(uint32_t size, uint32_t align = Allocator::DEFAULT_ALIGN)
 		{
-			ScopedMutex scopedMutex(mutex);
-
 			uint32_t actualSize = getActualAllocationSize(size, align);
 
+#if RIO_ALLOCATION_TRACKER
+			// Outside of the lock, capturing the callstack is slow
+			const uint32_t callSite = AllocationTrackerFn::onAllocate(actualSize);
+#endif // RIO_ALLOCATION_TRACKER
+
+			ScopedMutex scopedMutex(mutex);
+
 			Header* h = (Header*)malloc(actualSize);
 			h->size = actualSize;
+#if RIO_ALLOCATION_TRACKER
+			h->callSite = callSite;
+#endif // RIO_ALLOCATION_TRACKER
 
 			void* data = MemoryFn::alignTop(h + 1, align);
 
@@ -125,6 +147,7 @@ namespace MemoryFn
 
 			allocatedSize += actualSize;
 			allocationCount++;
+			peakAllocatedSize = allocatedSize > peakAllocatedSize ? allocatedSize : peakAllocatedSize;
 
 			return data;
 		}
@@ -140,6 +163,13 @@ namespace MemoryFn
 
 			Header* h = header(data);
 
+#if RIO_ALLOCATION_TRACKER
+			if (h->callSite != 0)
+			{
+				AllocationTrackerFn::onDeallocate(h->callSite, h->size);
+			}
+#endif // RIO_ALLOCATION_TRACKER
+
 			allocatedSize -= h->size;
 			allocationCount--;
 
@@ -158,16 +188,30 @@ namespace MemoryFn
 		}
 
 		// Returns the size (in bytes) of the block of memory pointed by <data>
+		// The header is written before <data> is handed out and is only read afterwards, so no lock is taken:
+		// proxies ask for the size on every allocation and deallocation
 		uint32_t getSize(const void* data)
 		{
-			ScopedMutex scopedMutex(mutex);
 			Header* h = header(data);
 			return h->size;
 		}
+
+		uint32_t getPeakAllocatedBytes()
+		{
+			ScopedMutex scopedMutex(mutex);
+			return peakAllocatedSize;
+		}
+
+		void resetPeakAllocatedBytes()
+		{
+			ScopedMutex scopedMutex(mutex);
+			peakAllocatedSize = allocatedSize;
+		}
 	private:
 		Mutex mutex;
 		uint32_t allocatedSize = 0;
 		uint32_t allocationCount = 0;
+		uint32_t peakAllocatedSize = 0;
 	};
 
 	// An allocator used to allocate temporary "scratch" memory
@@ -332,6 +376,16 @@ namespace MemoryGlobalFn
 		defaultScratchAllocator->~ScratchAllocator();
 		defaultAllocator->~HeapAllocator();
 	}
+
+	uint32_t getPeakAllocatedBytes()
+	{
+		return defaultAllocator->getPeakAllocatedBytes();
+	}
+
+	void resetPeakAllocatedBytes()
+	{
+		defaultAllocator->resetPeakAllocatedBytes();
+	}
 } // namespace MemoryGlobalFn
 
 Allocator& getDefaultAllocator()
@@ -101,6 +101,10 @@ namespace MemoryGlobalFn
 	// Destroys the allocators created with MemoryGlobalFn::init()
 	// Should be the last call of the program
 	void shutdown();
+	// Returns the most bytes the default allocator had in use since the last reset
+	uint32_t getPeakAllocatedBytes();
+	// Restarts the peak from the bytes the default allocator has in use now
+	void resetPeakAllocatedBytes();
 } // namespace MemoryGlobalFn
 
 } // namespace Rio
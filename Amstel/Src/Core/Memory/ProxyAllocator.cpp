@@ -1,28 +1,96 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Core/Memory/ProxyAllocator.h"
+#include "Core/Containers/Array.h"
 #include "Core/Error/Error.h"
+#include "Core/Strings/StringStream.h"
+#include "Core/Thread/Mutex.h"
 #include "Device/Profiler.h"
 
 namespace Rio
 {
 
+namespace ProxyAllocatorInternalFn
+{
+	static Mutex proxyListMutex;
+	static ProxyAllocator* proxyList = nullptr;
+} // namespace ProxyAllocatorInternalFn
+
 ProxyAllocator::ProxyAllocator(Allocator& allocator, const char* proxyName)
 	: allocator(allocator)
 	, proxyName(proxyName)
 {
 	RIO_ASSERT(proxyName != nullptr, "Name must not be NULL");
+	link();
+}
+
+ProxyAllocator::ProxyAllocator(ProxyAllocator& parent, const char* proxyName)
+	: allocator(parent)
+	, proxyName(proxyName)
+	, parent(&parent)
+{
+	RIO_ASSERT(proxyName != nullptr, "Name must not be NULL");
+	link();
+}
+
+ProxyAllocator::~ProxyAllocator()
+{
+	using namespace ProxyAllocatorInternalFn;
+
+	ScopedMutex scopedMutex(proxyListMutex);
+
+	ProxyAllocator** p = &proxyList;
+	while (*p != this)
+	{
+		p = &(*p)->next;
+	}
+	*p = next;
+}
+
+void ProxyAllocator::link()
+{
+	using namespace ProxyAllocatorInternalFn;
+
+	ScopedMutex scopedMutex(proxyListMutex);
+	next = proxyList;
+	proxyList = this;
 }
 
 void* ProxyAllocator::allocate(uint32_t size, uint32_t align)
 {
 	void* p = allocator.allocate(size, align);
-	ALLOCATE_MEMORY(proxyName, allocator.getAllocatedSize(p));
+	const uint32_t trackedSize = getTrackedSize(p);
+
+	const int current = currentBytes.fetchAdd(int(trackedSize)) + int(trackedSize);
+	int peak = peakBytes.load();
+	while (current > peak)
+	{
+		const int previous = peakBytes.compareAndSwap(peak, current);
+		if (previous == peak)
+		{
+			break;
+		}
+		peak = previous;
+	}
+
+	allocationCount.fetchAdd(1);
+	frameAllocationCount.fetchAdd(1);
+
+	ALLOCATE_MEMORY(proxyName, trackedSize);
 	return p;
 }
 
 void ProxyAllocator::deallocate(void* data)
 {
-	DEALLOCATE_MEMORY(proxyName, (data == nullptr) ? 0 : allocator.getAllocatedSize((const void*)data));
+	if (data == nullptr)
+	{
+		return;
+	}
+
+	const uint32_t trackedSize = getTrackedSize(data);
+	currentBytes.fetchAdd(-int(trackedSize));
+	allocationCount.fetchAdd(-1);
+
+	DEALLOCATE_MEMORY(proxyName, trackedSize);
 	allocator.deallocate(data);
 }
 
@@ -31,5 +99,103 @@ const char* ProxyAllocator::getName() const
 	return proxyName;
 }
 
+uint32_t ProxyAllocator::getCurrentBytes() const
+{
+	return (uint32_t)currentBytes.load();
+}
+
+uint32_t ProxyAllocator::getTrackedSize(const void* data)
+{
+	// Proxies do not track sizes themselves
+	if (parent != nullptr)
+	{
+		return parent->getTrackedSize(data);
+	}
+
+	const uint32_t size = allocator.getAllocatedSize(data);
+	return size == SIZE_NOT_TRACKED ? 0 : size;
+}
+
+const ProxyAllocator* ProxyAllocator::getParent() const
+{
+	return parent;
+}
+
+void ProxyAllocator::getChildrenStats(Array<ProxyAllocatorStats>& statsList, const ProxyAllocator* parent, uint32_t depth)
+{
+	using namespace ProxyAllocatorInternalFn;
+
+	for (ProxyAllocator* p = proxyList; p != nullptr; p = p->next)
+	{
+		if (p->parent != parent)
+		{
+			continue;
+		}
+
+		ProxyAllocatorStats stats;
+		stats.name = p->proxyName;
+		stats.parentName = parent != nullptr ? parent->proxyName : nullptr;
+		stats.depth = depth;
+		stats.currentBytes = (uint32_t)p->currentBytes.load();
+		stats.peakBytes = (uint32_t)p->peakBytes.load();
+		stats.allocationCount = (uint32_t)p->allocationCount.load();
+		stats.frameAllocationCount = (uint32_t)p->lastFrameAllocationCount.load();
+		ArrayFn::pushBack(statsList, stats);
+
+		getChildrenStats(statsList, p, depth + 1);
+	}
+}
+
+namespace ProxyAllocatorGlobalFn
+{
+	void updateFrame()
+	{
+		using namespace ProxyAllocatorInternalFn;
+
+		ScopedMutex scopedMutex(proxyListMutex);
+		for (ProxyAllocator* p = proxyList; p != nullptr; p = p->next)
+		{
+			p->lastFrameAllocationCount.store(p->frameAllocationCount.load());
+			p->frameAllocationCount.store(0);
+		}
+	}
+
+	void getStats(Array<ProxyAllocatorStats>& statsList)
+	{
+		ScopedMutex scopedMutex(ProxyAllocatorInternalFn::proxyListMutex);
+		ProxyAllocator::getChildrenStats(statsList, nullptr, 0);
+	}
+
+	void writeJson(StringStream& json)
+	{
+		Array<ProxyAllocatorStats> statsList(getDefaultAllocator());
+		getStats(statsList);
+
+		json << "[";
+		for (uint32_t i = 0; i < ArrayFn::getCount(statsList); ++i)
+		{
+			const ProxyAllocatorStats& stats = statsList[i];
+			json << (i == 0 ? "{" : ",{");
+			json << "\"name\":\"" << stats.name << "\"";
+			json << ",\"parent\":";
+			if (stats.parentName != nullptr)
+			{
+				json << "\"" << stats.parentName << "\"";
+			}
+			else
+			{
+				json << "null";
+			}
+			json << ",\"depth\":" << stats.depth;
+			json << ",\"current\":" << stats.currentBytes;
+			json << ",\"peak\":" << stats.peakBytes;
+			json << ",\"allocations\":" << stats.allocationCount;
+			json << ",\"frameAllocations\":" << stats.frameAllocationCount;
+			json << "}";
+		}
+		json << "]";
+	}
+} // namespace ProxyAllocatorGlobalFn
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
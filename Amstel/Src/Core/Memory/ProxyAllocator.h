@@ -2,27 +2,82 @@
 #pragma once
 
 #include "Core/Memory/Allocator.h"
+#include "Core/Containers/ContainerTypes.h"
+#include "Core/Strings/StringTypes.h"
+#include "Core/Thread/AtomicInt.h"
 
 namespace Rio
 {
 
+// Snapshot of the counters of a proxy allocator
+struct ProxyAllocatorStats
+{
+	const char* name;
+	const char* parentName; // nullptr for the roots
+	uint32_t depth;
+	uint32_t currentBytes;
+	uint32_t peakBytes;
+	uint32_t allocationCount; // Live allocations
+	uint32_t frameAllocationCount; // Allocations made during the last frame
+};
+
+namespace ProxyAllocatorGlobalFn
+{
+	// Closes the current frame for the allocations per frame counters
+	void updateFrame();
+	// Fills <statsList> with the counters of all the live proxies
+	// Children follow their parent
+	void getStats(Array<ProxyAllocatorStats>& statsList);
+	// Writes the counters of all the live proxies as a JSON array
+	void writeJson(StringStream& json);
+} // namespace ProxyAllocatorGlobalFn
+
 // Offers the facility to tag allocators by a string identifier
 // Proxy allocator is appended to a global linked list when instantiated
 // so that it is possible to later visit that list for debugging purposes
+// Every proxy keeps atomic counters of its live memory, cheap enough to be left on in shipping builds
 class ProxyAllocator : public Allocator
 {
 public:
 	// Tag all allocations made with <allocator> by the given <name>
 	ProxyAllocator(Allocator& allocator, const char* proxyName);
+	// Tag all allocations made with <parent> by the given <name>
+	// The proxy is reported as a child of <parent>, which accounts for the allocations as well
+	ProxyAllocator(ProxyAllocator& parent, const char* proxyName);
+	~ProxyAllocator();
 	void* allocate(uint32_t size, uint32_t align = Allocator::DEFAULT_ALIGN);
 	void deallocate(void* data);
 	uint32_t getAllocatedSize(const void* /*ptr*/) { return SIZE_NOT_TRACKED; }
 	uint32_t getTotalAllocatedBytes() { return SIZE_NOT_TRACKED; }
 	// Returns the name of the proxy allocator
 	const char* getName() const;
+	// Returns the bytes currently allocated through the proxy
+	uint32_t getCurrentBytes() const;
+	// Returns the parent proxy or nullptr
+	const ProxyAllocator* getParent() const;
 private:
+	// Disable copying
+	ProxyAllocator(const ProxyAllocator&) = delete;
+	ProxyAllocator& operator=(const ProxyAllocator&) = delete;
+
+	void link();
+	// Returns the size of the allocation <data>, as seen by the allocator under all the proxies
+	uint32_t getTrackedSize(const void* data);
+	static void getChildrenStats(Array<ProxyAllocatorStats>& statsList, const ProxyAllocator* parent, uint32_t depth);
+
 	Allocator& allocator;
 	const char* proxyName;
+	ProxyAllocator* parent = nullptr;
+	ProxyAllocator* next = nullptr;
+
+	AtomicInt currentBytes = AtomicInt(0);
+	AtomicInt peakBytes = AtomicInt(0);
+	AtomicInt allocationCount = AtomicInt(0);
+	AtomicInt frameAllocationCount = AtomicInt(0);
+	AtomicInt lastFrameAllocationCount = AtomicInt(0);
+
+	friend void ProxyAllocatorGlobalFn::updateFrame();
+	friend void ProxyAllocatorGlobalFn::getStats(Array<ProxyAllocatorStats>& statsList);
 };
 
 } // namespace Rio
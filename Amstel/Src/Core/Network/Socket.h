@@ -308,6 +308,11 @@ struct TcpSocket
 				readResult.error = ReadResult::REMOTE_CLOSED;
 				return readResult;
 			}
+			else if (bytesRead == -1)
+			{
+				readResult.error = ReadResult::UNKNOWN;
+				return readResult;
+			}
 #elif RIO_PLATFORM_WINDOWS
 			int bytesRead = ::recv(socket, buffer, (int)toRead, 0);
 
@@ -325,6 +330,11 @@ struct TcpSocket
 				readResult.error = ReadResult::REMOTE_CLOSED;
 				return readResult;
 			}
+			else if (bytesRead == SOCKET_ERROR)
+			{
+				readResult.error = ReadResult::UNKNOWN;
+				return readResult;
+			}
 #endif // RIO_PLATFORM_
 			buffer += bytesRead;
 			toRead -= bytesRead;
@@ -358,7 +368,12 @@ struct TcpSocket
 		while (toSend > 0)
 		{
 #if RIO_PLATFORM_POSIX
+#if RIO_PLATFORM_LINUX || RIO_PLATFORM_ANDROID
+			// Closed connections return an error rather than raising SIGPIPE
+			ssize_t bytesWritten = ::send(socket, buffer, toSend, MSG_NOSIGNAL);
+#else
 			ssize_t bytesWritten = ::send(socket, buffer, toSend, 0);
+#endif // RIO_PLATFORM_LINUX || RIO_PLATFORM_ANDROID
 
 			if (bytesWritten == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
 			{
@@ -374,7 +389,7 @@ struct TcpSocket
 				wr.error = WriteResult::REMOTE_CLOSED;
 				return wr;
 			}
-			else
+			else if (bytesWritten == -1)
 			{
 				wr.error = WriteResult::UNKNOWN;
 				return wr;
@@ -396,7 +411,7 @@ struct TcpSocket
 				wr.error = WriteResult::REMOTE_CLOSED;
 				return wr;
 			}
-			else
+			else if (bytesWritten == SOCKET_ERROR)
 			{
 				wr.error = WriteResult::UNKNOWN;
 				return wr;
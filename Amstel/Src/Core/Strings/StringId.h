@@ -2,6 +2,7 @@
 #pragma once
 
 #include "Core/Strings/StringTypes.h"
+#include "Core/Base/Functional.h"
 #include "Core/Base/Types.h"
 
 namespace Rio
@@ -75,5 +76,14 @@ inline bool operator<(const StringId64& a, const StringId64& b)
 	return a.id < b.id;
 }
 
+template <>
+struct THash<StringId64>
+{
+	uint32_t operator()(const StringId64& id) const
+	{
+		return uint32_t(id.id);
+	}
+};
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
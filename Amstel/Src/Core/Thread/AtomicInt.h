@@ -38,6 +38,26 @@ struct AtomicInt
 #endif // RIO_PLATFORM_
 	}
 
+	// Adds <val> and returns the previous value
+	int fetchAdd(int val)
+	{
+#if RIO_PLATFORM_POSIX && RIO_COMPILER_GCC
+		return __sync_fetch_and_add(&atomicValue, val);
+#elif RIO_PLATFORM_WINDOWS
+		return InterlockedExchangeAdd(&atomicValue, val);
+#endif // RIO_PLATFORM_
+	}
+
+	// Stores <desired> if the current value equals <expected>, returns the previous value
+	int compareAndSwap(int expected, int desired)
+	{
+#if RIO_PLATFORM_POSIX && RIO_COMPILER_GCC
+		return __sync_val_compare_and_swap(&atomicValue, expected, desired);
+#elif RIO_PLATFORM_WINDOWS
+		return InterlockedCompareExchange(&atomicValue, desired, expected);
+#endif // RIO_PLATFORM_
+	}
+
 #if RIO_PLATFORM_POSIX && RIO_COMPILER_GCC
 	mutable int atomicValue;
 #elif RIO_PLATFORM_WINDOWS
@@ -7,8 +7,12 @@
 #include "Core/Base/Murmur.h"
 #include "Core/Base/CommandLine.h"
 #include "Core/Base/Guid.h"
+#include "Core/Base/Os.h"
 
+#include "Core/Memory/AllocationTracker.h"
+#include "Core/Memory/ArenaAllocator.h"
 #include "Core/Memory/Memory.h"
+#include "Core/Memory/ProxyAllocator.h"
 #include "Core/Memory/TempAllocator.h"
 
 #include "Core/Containers/Array.h"
@@ -25,15 +29,44 @@
 #include "Core/Math/Color4.h"
 #include "Core/Math/Quaternion.h"
 #include "Core/Math/Sphere.h"
+#include "Core/Math/MaxRects.h"
+#include "Core/Math/MeshOptimizer.h"
+#include "Core/Math/Quantization.h"
 
 #include "Core/Strings/StringId.h"
 #include "Core/Strings/StringUtils.h"
 #include "Core/Strings/DynamicString.h"
+#include "Core/Strings/StringStream.h"
 
+#include "Core/FileSystem/File.h"
+#include "Core/FileSystem/FileSystemDisk.h"
 #include "Core/FileSystem/Path.h"
 
 #include "Core/Json/Json.h"
+#include "Core/Json/JsonObject.h"
 #include "Core/Json/JsonR.h"
+#include "Core/Json/JsonTape.h"
+
+#include "Device/Benchmark.h"
+#include "Device/Profiler.h"
+
+#include "Resource/CompileOptions.h"
+#include "Resource/DataCompiler.h"
+#include "Resource/LevelResource.h"
+#include "Resource/PackageResource.h"
+#include "Resource/ResourceLoader.h"
+#include "Resource/ResourceManager.h"
+#include "Resource/ResourcePackage.h"
+#include "Resource/TextureResource.h"
+#include "Resource/TextureStreamer.h"
+
+#include "Script/ScriptEnvironment.h"
+
+#include "World/ComponentStorage.h"
+#include "World/Level.h"
+#include "World/SceneGraph.h"
+#include "World/UnitManager.h"
+#include "World/World.h"
 
 #define ENSURE(condition) do { if (!(condition)) {\
 	printf("Assertion failed: '%s' in %s:%d\n\n", #condition, __FILE__, __LINE__); abort(); }} while (0)
@@ -50,6 +83,187 @@ static void testMemory()
 	ENSURE(a.getAllocatedSize(p) >= 64);
 	a.deallocate(p);
 
+	// The peak survives the deallocation until it is reset
+	MemoryGlobalFn::resetPeakAllocatedBytes();
+	const uint32_t base = a.getTotalAllocatedBytes();
+	void* q = a.allocate(4096);
+	a.deallocate(q);
+	ENSURE(MemoryGlobalFn::getPeakAllocatedBytes() >= base + 4096);
+	MemoryGlobalFn::resetPeakAllocatedBytes();
+	ENSURE(MemoryGlobalFn::getPeakAllocatedBytes() == a.getTotalAllocatedBytes());
+
+	MemoryGlobalFn::shutdown();
+}
+
+static void testVirtualMemory()
+{
+	const uint32_t pageSize = OsFn::getPageSize();
+	ENSURE(pageSize > 0 && (pageSize & (pageSize - 1)) == 0);
+
+	const size_t size = 1024 * size_t(pageSize);
+	char* p = (char*)OsFn::reserveVirtualMemory(size);
+	ENSURE(p != NULL);
+
+	// Pages committed later keep the ones before in place
+	ENSURE(OsFn::commitVirtualMemory(p, pageSize));
+	memset(p, 0xab, pageSize);
+	ENSURE(OsFn::commitVirtualMemory(p + pageSize, 2 * pageSize));
+	memset(p + pageSize, 0xcd, 2 * pageSize);
+	ENSURE((uint8_t)p[pageSize - 1] == 0xab);
+	ENSURE((uint8_t)p[3 * pageSize - 1] == 0xcd);
+
+	OsFn::releaseVirtualMemory(p, size);
+}
+
+static void testScratchAllocator()
+{
+	MemoryGlobalFn::init();
+	Allocator& a = getDefaultScratchAllocator();
+	{
+		// Wraps around the ring many times, over the padding left by previous allocations
+		const uint32_t alignList[] = { 4, 8, 16, 64 };
+		for (uint32_t i = 0; i < 4000; ++i)
+		{
+			const uint32_t size = 4 + (i * 37) % 2048;
+			void* p = a.allocate(size, alignList[i % RIO_COUNTOF(alignList)]);
+			ENSURE(a.getAllocatedSize(p) == (size + 3) / 4 * 4);
+			a.deallocate(p);
+		}
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+static void testAllocationTracker()
+{
+	MemoryGlobalFn::init();
+#if RIO_ALLOCATION_TRACKER
+	{
+		Allocator& a = getDefaultAllocator();
+		const uint32_t sampleRate = AllocationTrackerGlobalFn::getSampleRate();
+		AllocationTrackerGlobalFn::setSampleRate(1);
+		AllocationTrackerGlobalFn::updateFrame();
+
+		// Many small allocations from one call site, a single big one from another
+		void* smallList[16];
+		for (uint32_t i = 0; i < RIO_COUNTOF(smallList); ++i)
+		{
+			smallList[i] = a.allocate(100);
+		}
+		void* big = a.allocate(10000);
+		AllocationTrackerGlobalFn::updateFrame();
+
+		TempAllocator4096 ta;
+		StringStream json(ta);
+		AllocationTrackerGlobalFn::writeJson(json, 4);
+
+		JsonObject object(ta);
+		JsonFn::parse(StringStreamFn::getCStr(json), object);
+		ENSURE(JsonFn::parseInt(object["sampleRate"]) == 1);
+
+		JsonArray frameBytesList(ta);
+		JsonFn::parseArray(object["frameBytes"], frameBytesList);
+		ENSURE(ArrayFn::getCount(frameBytesList) == 2);
+		JsonObject frameBytes(ta);
+		JsonFn::parse(frameBytesList[0], frameBytes);
+		ENSURE(JsonFn::parseInt(frameBytes["count"]) == 1);
+		ENSURE(JsonFn::parseInt(frameBytes["bytes"]) >= 10000);
+
+		JsonArray frameCountList(ta);
+		JsonFn::parseArray(object["frameCount"], frameCountList);
+		ENSURE(ArrayFn::getCount(frameCountList) == 2);
+		JsonObject frameCount(ta);
+		JsonFn::parse(frameCountList[0], frameCount);
+		ENSURE(JsonFn::parseInt(frameCount["count"]) == 16);
+
+		JsonArray liveCountList(ta);
+		JsonFn::parseArray(object["liveCount"], liveCountList);
+		JsonObject liveCount(ta);
+		JsonFn::parse(liveCountList[0], liveCount);
+		ENSURE(JsonFn::parseInt(liveCount["count"]) >= 16);
+
+		for (uint32_t i = 0; i < RIO_COUNTOF(smallList); ++i)
+		{
+			a.deallocate(smallList[i]);
+		}
+		a.deallocate(big);
+		AllocationTrackerGlobalFn::setSampleRate(sampleRate);
+	}
+#endif // RIO_ALLOCATION_TRACKER
+	MemoryGlobalFn::shutdown();
+}
+
+static void testArenaAllocator()
+{
+	MemoryGlobalFn::init();
+	Allocator& a = getDefaultAllocator();
+	const uint32_t allocatedBefore = a.getTotalAllocatedBytes();
+	{
+		ArenaAllocator arena(a, 4096);
+
+		void* p = arena.allocate(24);
+		ENSURE(arena.getAllocatedSize(p) == 32);
+		ENSURE(((uintptr_t)p % 16) == 0);
+		arena.deallocate(p);
+		void* q = arena.allocate(20);
+		ENSURE(q == p);
+
+		void* big = arena.allocate(10000, 64);
+		ENSURE(((uintptr_t)big % 64) == 0);
+		ENSURE(arena.getAllocatedSize(big) == 10000);
+		ENSURE(arena.getTotalAllocatedBytes() == 10032);
+		arena.deallocate(big);
+		ENSURE(arena.getTotalAllocatedBytes() == 32);
+
+		for (uint32_t i = 0; i < 1000; ++i)
+		{
+			arena.allocate(100);
+		}
+		arena.allocate(5000);
+		ENSURE(arena.getReservedBytes() > 0);
+
+		// Everything is given back in bulk
+		arena.clear();
+		ENSURE(arena.getTotalAllocatedBytes() == 0);
+		ENSURE(arena.getReservedBytes() == 0);
+	}
+	ENSURE(a.getTotalAllocatedBytes() == allocatedBefore);
+	MemoryGlobalFn::shutdown();
+}
+
+static void testProxyAllocator()
+{
+	MemoryGlobalFn::init();
+	Allocator& a = getDefaultAllocator();
+	{
+		ProxyAllocator parent(a, "parent");
+		ProxyAllocator child(parent, "child");
+		ENSURE(child.getParent() == &parent);
+		ENSURE(child.getAllocatedSize(&parent) == Allocator::SIZE_NOT_TRACKED);
+		ENSURE(child.getTotalAllocatedBytes() == Allocator::SIZE_NOT_TRACKED);
+
+		void* p = child.allocate(64);
+		void* q = child.allocate(64);
+		ENSURE(child.getCurrentBytes() >= 128);
+		ENSURE(parent.getCurrentBytes() == child.getCurrentBytes());
+		child.deallocate(p);
+		ProxyAllocatorGlobalFn::updateFrame();
+
+		Array<ProxyAllocatorStats> statsList(a);
+		ProxyAllocatorGlobalFn::getStats(statsList);
+		ENSURE(ArrayFn::getCount(statsList) == 2);
+		ENSURE(strcmp(statsList[0].name, "parent") == 0);
+		ENSURE(statsList[0].parentName == nullptr);
+		ENSURE(strcmp(statsList[1].name, "child") == 0);
+		ENSURE(strcmp(statsList[1].parentName, "parent") == 0);
+		ENSURE(statsList[1].depth == 1);
+		ENSURE(statsList[1].allocationCount == 1);
+		ENSURE(statsList[1].frameAllocationCount == 2);
+		ENSURE(statsList[1].peakBytes >= 2 * statsList[1].currentBytes);
+
+		child.deallocate(q);
+		ENSURE(child.getCurrentBytes() == 0);
+		ENSURE(parent.getCurrentBytes() == 0);
+	}
 	MemoryGlobalFn::shutdown();
 }
 
@@ -113,6 +327,46 @@ static void testHashMap()
 			ENSURE(!HashMapFn::has(m, i));
 		}
 	}
+	{
+		HashMap<int32_t, int32_t> m(a);
+
+		HashMapFn::reserve(m, 1000);
+		const uint32_t capacity = m.capacity;
+		ENSURE(capacity * 0.9f > 1000.0f);
+
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			HashMapFn::set(m, i, i*i);
+		}
+		ENSURE(m.capacity == capacity);
+		ENSURE(HashMapFn::getCount(m) == 1000);
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			ENSURE(HashMapFn::get(m, i, 0) == i*i);
+		}
+	}
+	{
+		// Inserting displaces entries, the keys and values set must not change
+		HashMap<int32_t, int32_t> m(a);
+
+		int32_t keyList[1000];
+		int32_t valueList[1000];
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			keyList[i] = (i * 37) % 1000;
+			valueList[i] = i;
+		}
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			HashMapFn::set(m, keyList[i], valueList[i]);
+		}
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			ENSURE(keyList[i] == (i * 37) % 1000);
+			ENSURE(valueList[i] == i);
+			ENSURE(HashMapFn::get(m, keyList[i], -1) == i);
+		}
+	}
 	MemoryGlobalFn::shutdown();
 }
 
@@ -820,6 +1074,193 @@ static void testSphere()
 	}
 }
 
+static void testMeshOptimizer()
+{
+	// 16x16 quads grid, every triangle corner has its own vertex
+	const uint32_t size = 16;
+	const uint32_t cornerCount = size * size * 6;
+
+	Array<Vector3> cornerList(getDefaultAllocator());
+	for (uint32_t y = 0; y < size; ++y)
+	{
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			const Vector3 a = createVector3(float(x + 0), float(y + 0), 0.0f);
+			const Vector3 b = createVector3(float(x + 1), float(y + 0), 0.0f);
+			const Vector3 c = createVector3(float(x + 1), float(y + 1), 0.0f);
+			const Vector3 d = createVector3(float(x + 0), float(y + 1), 0.0f);
+			ArrayFn::pushBack(cornerList, a);
+			ArrayFn::pushBack(cornerList, b);
+			ArrayFn::pushBack(cornerList, c);
+			ArrayFn::pushBack(cornerList, a);
+			ArrayFn::pushBack(cornerList, c);
+			ArrayFn::pushBack(cornerList, d);
+		}
+	}
+
+	Array<Vector3> vertexList(getDefaultAllocator());
+	Array<uint32_t> indexList(getDefaultAllocator());
+	ArrayFn::resize(vertexList, cornerCount);
+	ArrayFn::resize(indexList, cornerCount);
+
+	uint32_t vertexCount = MeshOptimizerFn::weldVertices(ArrayFn::begin(cornerList)
+		, cornerCount
+		, sizeof(Vector3)
+		, ArrayFn::begin(vertexList)
+		, ArrayFn::begin(indexList)
+		);
+	ENSURE(vertexCount == (size + 1) * (size + 1));
+	for (uint32_t i = 0; i < cornerCount; ++i)
+	{
+		ENSURE(vertexList[indexList[i]] == cornerList[i]);
+	}
+
+	const float acmrBefore = MeshOptimizerFn::getAverageCacheMissRatio(ArrayFn::begin(indexList), cornerCount, vertexCount, 16);
+	MeshOptimizerFn::optimizeVertexCache(ArrayFn::begin(indexList), cornerCount, vertexCount);
+	vertexCount = MeshOptimizerFn::optimizeVertexFetch(ArrayFn::begin(vertexList)
+		, vertexCount
+		, sizeof(Vector3)
+		, ArrayFn::begin(indexList)
+		, cornerCount
+		);
+	const float acmrAfter = MeshOptimizerFn::getAverageCacheMissRatio(ArrayFn::begin(indexList), cornerCount, vertexCount, 16);
+	ENSURE(vertexCount == (size + 1) * (size + 1));
+	ENSURE(acmrAfter < acmrBefore);
+	ENSURE(acmrAfter < 0.8f);
+
+	// Same area covered, vertices in first use order
+	float area = 0.0f;
+	uint32_t nextVertex = 0;
+	for (uint32_t i = 0; i < cornerCount; i += 3)
+	{
+		const Vector3 e1 = vertexList[indexList[i + 1]] - vertexList[indexList[i]];
+		const Vector3 e2 = vertexList[indexList[i + 2]] - vertexList[indexList[i]];
+		area += cross(e1, e2).z * 0.5f;
+
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			ENSURE(indexList[i + k] <= nextVertex);
+			nextVertex = indexList[i + k] == nextVertex ? nextVertex + 1 : nextVertex;
+		}
+	}
+	ENSURE(getAreFloatsEqual(area, float(size * size), 0.0001f));
+
+	// Flat interior collapses without error, the border stays
+	Array<uint32_t> lodList(getDefaultAllocator());
+	ArrayFn::resize(lodList, cornerCount);
+	float error = 1.0f;
+	const uint32_t lodCount = MeshOptimizerFn::simplify(ArrayFn::begin(lodList)
+		, ArrayFn::begin(indexList)
+		, cornerCount
+		, ArrayFn::begin(vertexList)
+		, vertexCount
+		, sizeof(Vector3)
+		, cornerCount / 4
+		, error
+		);
+	ENSURE(lodCount <= cornerCount / 4);
+	ENSURE(lodCount > 0 && lodCount % 3 == 0);
+	ENSURE(getAreFloatsEqual(error, 0.0f, 0.0001f));
+
+	float lodArea = 0.0f;
+	for (uint32_t i = 0; i < lodCount; i += 3)
+	{
+		const Vector3 e1 = vertexList[lodList[i + 1]] - vertexList[lodList[i]];
+		const Vector3 e2 = vertexList[lodList[i + 2]] - vertexList[lodList[i]];
+		ENSURE(cross(e1, e2).z > 0.0f);
+		lodArea += cross(e1, e2).z * 0.5f;
+	}
+	ENSURE(getAreFloatsEqual(lodArea, float(size * size), 0.001f));
+}
+
+static void testMaxRects()
+{
+	{
+		// Four quarters fill a bin exactly
+		const uint32_t widthList[] = { 64, 64, 64, 64 };
+		const uint32_t heightList[] = { 64, 64, 64, 64 };
+		uint32_t binList[4];
+		uint32_t xList[4];
+		uint32_t yList[4];
+		ENSURE(MaxRectsFn::pack(widthList, heightList, 4, 128, 128, binList, xList, yList) == 1);
+		uint32_t coveredMask = 0;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			ENSURE(binList[i] == 0);
+			ENSURE(xList[i] % 64 == 0 && yList[i] % 64 == 0);
+			coveredMask |= 1 << (xList[i] / 64 + yList[i] / 64 * 2);
+		}
+		ENSURE(coveredMask == 0xf);
+	}
+	{
+		// Mixed sizes spill to a second bin, and never overlap
+		const uint32_t count = 12;
+		const uint32_t widthList[count] = { 100, 30, 60, 20, 80, 10, 50, 40, 70, 25, 90, 15 };
+		const uint32_t heightList[count] = { 40, 90, 60, 20, 30, 100, 50, 70, 20, 25, 60, 15 };
+		uint32_t binList[count];
+		uint32_t xList[count];
+		uint32_t yList[count];
+		const uint32_t binCount = MaxRectsFn::pack(widthList, heightList, count, 128, 128, binList, xList, yList);
+		ENSURE(binCount >= 2 && binCount <= 3);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			ENSURE(binList[i] < binCount);
+			ENSURE(xList[i] + widthList[i] <= 128 && yList[i] + heightList[i] <= 128);
+			for (uint32_t j = i + 1; j < count; ++j)
+			{
+				const bool isOverlapping = binList[i] == binList[j]
+					&& xList[i] < xList[j] + widthList[j]
+					&& xList[j] < xList[i] + widthList[i]
+					&& yList[i] < yList[j] + heightList[j]
+					&& yList[j] < yList[i] + heightList[i]
+					;
+				ENSURE(!isOverlapping);
+			}
+		}
+	}
+}
+
+static void testQuantization()
+{
+	{
+		ENSURE(getHalfFromFloat(0.0f) == 0x0000);
+		ENSURE(getHalfFromFloat(1.0f) == 0x3c00);
+		ENSURE(getHalfFromFloat(-2.0f) == 0xc000);
+		ENSURE(getHalfFromFloat(65504.0f) == 0x7bff);
+		ENSURE(getHalfFromFloat(100000.0f) == 0x7c00);
+		ENSURE(getFloatFromHalf(0x3555) == 0.333251953125f);
+		ENSURE(getFloatFromHalf(0x0001) == 5.9604644775390625e-8f);
+		ENSURE(getFloatFromHalf(getHalfFromFloat(0.1f)) == 0.0999755859375f);
+		ENSURE(getFloatFromHalf(getHalfFromFloat(1.0e-6f)) == getFloatFromHalf(0x0011));
+	}
+	{
+		ENSURE(getSnorm16FromFloat(1.0f) == 32767);
+		ENSURE(getSnorm16FromFloat(-1.0f) == -32767);
+		ENSURE(getSnorm16FromFloat(2.0f) == 32767);
+		ENSURE(getFloatFromSnorm16(-32768) == -1.0f);
+		ENSURE(getUnorm8FromFloat(0.5f) == 128);
+		ENSURE(getFloatFromUnorm8(255) == 1.0f);
+	}
+	{
+		const Vector3 normals[] =
+		{
+			{  0.0f,  0.0f,  1.0f },
+			{  0.0f,  0.0f, -1.0f },
+			{  0.6f, -0.8f,  0.0f },
+			{ -0.48f, 0.6f, -0.64f }
+		};
+		for (uint32_t i = 0; i < RIO_COUNTOF(normals); ++i)
+		{
+			const Vector2 e = getOctahedralFromNormal(normals[i]);
+			ENSURE(fabsf(e.x) <= 1.0f && fabsf(e.y) <= 1.0f);
+			const Vector3 n = getNormalFromOctahedral(e);
+			ENSURE(getAreFloatsEqual(n.x, normals[i].x, 0.0001f));
+			ENSURE(getAreFloatsEqual(n.y, normals[i].y, 0.0001f));
+			ENSURE(getAreFloatsEqual(n.z, normals[i].z, 0.0001f));
+		}
+	}
+}
+
 static void testMurmur()
 {
 	const uint32_t m = getMurmurHash32("murmur32", 8, 0);
@@ -1024,6 +1465,50 @@ static void testJsonR()
 		const int32_t a = JsonRFn::parseInt("3.14");
 		ENSURE(a == 3);
 	}
+	{
+		ENSURE(JsonRFn::parseDouble("-0.5") == -0.5);
+		ENSURE(JsonRFn::parseDouble("1e3") == 1000.0);
+		ENSURE(JsonRFn::parseDouble("2.5E-2") == 0.025);
+		ENSURE(JsonRFn::parseDouble("0.001") == 0.001);
+		ENSURE(JsonRFn::parseDouble("123456789012345678901234") == 123456789012345678901234.0);
+		ENSURE(JsonRFn::parseDouble("1.7976931348623157e308") == 1.7976931348623157e308);
+		ENSURE(JsonRFn::parseFloat("0.1") == 0.1f);
+	}
+	{
+		const char* json = "[ 1.5, -2 3e1 // Comment\n 0.25 ]";
+		ENSURE(JsonRFn::getArrayCount(json) == 4);
+		float a[4];
+		ENSURE(JsonRFn::parseFloatArrayInto(json, a, 4) == 4);
+		ENSURE(a[0] == 1.5f && a[1] == -2.0f && a[2] == 30.0f && a[3] == 0.25f);
+
+		uint32_t b[3];
+		ENSURE(JsonRFn::parseUintArrayInto("[ 7 65536 4e2 ]", b, 3) == 3);
+		ENSURE(b[0] == 7 && b[1] == 65536 && b[2] == 400);
+		ENSURE(JsonRFn::parseUintArrayInto("[]", b, 3) == 0);
+		ENSURE(JsonRFn::parseUintArrayInto("[ 4294967295 ]", b, 3) == 1);
+		ENSURE(b[0] == UINT32_MAX);
+	}
+	{
+		// Malformed arrays are rejected instead of overflowing <output> or looping forever
+		float a[2];
+		ENSURE(JsonRFn::parseFloatArrayInto("[ 1 2 3 ]", a, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseFloatArrayInto("[ 1 x ]", a, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseFloatArrayInto("[ 1 \"2\" ]", a, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseFloatArrayInto("[ - ]", a, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseFloatArrayInto("[ 1.5.5 ]", a, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseFloatArrayInto("[ 1 2", a, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseFloatArrayInto("{ a = 1 }", a, 2) == UINT32_MAX);
+
+		uint32_t b[2];
+		ENSURE(JsonRFn::parseUintArrayInto("[ 1 2 3 ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ -1 ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ true ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ 4294967296 ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ 99999999999999999999 ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ 5e9 ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ 12ab ]", b, 2) == UINT32_MAX);
+		ENSURE(JsonRFn::parseUintArrayInto("[ 1", b, 2) == UINT32_MAX);
+	}
 	{
 		const float a = JsonRFn::parseFloat("3.14");
 		ENSURE(getAreFloatsEqual(a, 3.14f));
@@ -1104,6 +1589,152 @@ static void testJsonR()
 	MemoryGlobalFn::shutdown();
 }
 
+static void testJsonTape()
+{
+	MemoryGlobalFn::init();
+	{
+		TempAllocator4096 ta;
+		JsonTape tape(ta);
+		JsonTapeFn::parse(
+			"// Comment\n"
+			"name = \"box\"\n"
+			"\"size\" = [ 1.5 2 -3 ]\n"
+			"nodes = { a = { visible = true } b = [] /* empty */ }\n"
+			"count = 42\n"
+			"tag = null\n"
+			, tape
+			);
+
+		const uint32_t root = JsonTapeFn::getRoot(tape);
+		ENSURE(JsonTapeFn::getType(tape, root) == JsonValueType::OBJECT);
+		ENSURE(JsonTapeFn::getCount(tape, root) == 5);
+		ENSURE(JsonTapeFn::has(tape, root, "count"));
+		ENSURE(!JsonTapeFn::has(tape, root, "coun"));
+
+		TempAllocator128 sa;
+		DynamicString name(sa);
+		JsonTapeFn::parseString(tape, JsonTapeFn::get(tape, root, "name"), name);
+		ENSURE(strcmp(name.getCStr(), "box") == 0);
+
+		const uint32_t size = JsonTapeFn::get(tape, root, "size");
+		ENSURE(JsonTapeFn::getType(tape, size) == JsonValueType::ARRAY);
+		ENSURE(JsonTapeFn::getCount(tape, size) == 3);
+		ENSURE(JsonTapeFn::parseInt(tape, JsonTapeFn::getItem(tape, size, 1)) == 2);
+		const Vector3 v = JsonTapeFn::parseVector3(tape, size);
+		ENSURE(getAreFloatsEqual(v.x,  1.5f));
+		ENSURE(getAreFloatsEqual(v.y,  2.0f));
+		ENSURE(getAreFloatsEqual(v.z, -3.0f));
+
+		const uint32_t nodes = JsonTapeFn::get(tape, root, "nodes");
+		ENSURE(JsonTapeFn::getCount(tape, nodes) == 2);
+		const uint32_t a = JsonTapeFn::getFirstChild(tape, nodes);
+		const uint32_t b = JsonTapeFn::getNext(tape, a);
+		ENSURE(JsonTapeFn::getKey(tape, a) == FixedString("a"));
+		ENSURE(JsonTapeFn::getKeyId(tape, b).id == StringId32("b").id);
+		ENSURE(JsonTapeFn::getNext(tape, b) == JSON_TAPE_INVALID);
+		ENSURE(JsonTapeFn::parseBool(tape, JsonTapeFn::get(tape, a, "visible")) == true);
+		ENSURE(JsonTapeFn::getFirstChild(tape, b) == JSON_TAPE_INVALID);
+
+		// Siblings skip over nested values
+		ENSURE(JsonTapeFn::getNext(tape, nodes) == JsonTapeFn::get(tape, root, "count"));
+		ENSURE(JsonTapeFn::getType(tape, JsonTapeFn::get(tape, root, "tag")) == JsonValueType::NIL);
+
+		// Nodes can be handed to JsonRFn
+		ENSURE(JsonRFn::parseInt(JsonTapeFn::getJson(tape, JsonTapeFn::get(tape, root, "count"))) == 42);
+	}
+	{
+		TempAllocator1024 ta;
+		JsonTape tape(ta);
+		JsonTapeFn::parse("{ \"a\": { \"b\": [ { \"c\": \"d\\\"e\" } ] } }", tape);
+
+		const uint32_t c = JsonTapeFn::get(tape, JsonTapeFn::getFirstChild(tape, JsonTapeFn::get(tape, JsonTapeFn::get(tape, 0, "a"), "b")), "c");
+		TempAllocator128 sa;
+		DynamicString str(sa);
+		JsonTapeFn::parseString(tape, c, str);
+		ENSURE(strcmp(str.getCStr(), "d\"e") == 0);
+		ENSURE(ArrayFn::getCount(tape.nodeList) == 5);
+	}
+	{
+		// Members keep the file order, lookups and member iteration see the last duplicate only
+		TempAllocator1024 ta;
+		JsonTape tape(ta);
+		JsonTapeFn::parse("z = 1 a = 2 z = 3", tape);
+
+		const uint32_t root = JsonTapeFn::getRoot(tape);
+		ENSURE(JsonTapeFn::getCount(tape, root) == 3);
+		ENSURE(JsonTapeFn::getMemberCount(tape, root) == 2);
+		ENSURE(JsonTapeFn::parseInt(tape, JsonTapeFn::get(tape, root, "z")) == 3);
+
+		const uint32_t first = JsonTapeFn::getFirstMember(tape, root);
+		ENSURE(JsonTapeFn::getKey(tape, first) == FixedString("a"));
+		const uint32_t second = JsonTapeFn::getNextMember(tape, first);
+		ENSURE(JsonTapeFn::parseInt(tape, second) == 3);
+		ENSURE(JsonTapeFn::getNextMember(tape, second) == JSON_TAPE_INVALID);
+		ENSURE(JsonTapeFn::getKey(tape, JsonTapeFn::getFirstChild(tape, root)) == FixedString("z"));
+	}
+	{
+		// Items of arrays with nested values
+		TempAllocator1024 ta;
+		JsonTape tape(ta);
+		JsonTapeFn::parse("list = [ [ 1 2 ] { x = 1 } 3 [ 4 ] ] flat = [ 5 6 7 ]", tape);
+
+		const uint32_t list = JsonTapeFn::get(tape, 0, "list");
+		ENSURE(JsonTapeFn::getType(tape, JsonTapeFn::getItem(tape, list, 1)) == JsonValueType::OBJECT);
+		ENSURE(JsonTapeFn::parseInt(tape, JsonTapeFn::getItem(tape, list, 2)) == 3);
+		ENSURE(JsonTapeFn::parseInt(tape, JsonTapeFn::getItem(tape, JsonTapeFn::getItem(tape, list, 3), 0)) == 4);
+		ENSURE(JsonTapeFn::parseInt(tape, JsonTapeFn::getItem(tape, JsonTapeFn::getItem(tape, list, 0), 1)) == 2);
+		ENSURE(JsonTapeFn::parseInt(tape, JsonTapeFn::getItem(tape, JsonTapeFn::get(tape, 0, "flat"), 2)) == 7);
+	}
+	{
+		// The tape decodes the same numbers as JsonRFn
+		StringStream mesh(getDefaultAllocator());
+		mesh << "geometries = {\n";
+		for (uint32_t g = 0; g < 4; ++g)
+		{
+			mesh << "\tgeometry" << 3 - g << " = {\n\t\tposition = [";
+			for (uint32_t i = 0; i < 3000; ++i)
+			{
+				mesh << " " << float((i * 7 + g) % 2048) * 0.125f - 128.0f;
+			}
+			mesh << " ]\n\t}\n";
+		}
+		mesh << "}\n";
+		const char* json = StringStreamFn::getCStr(mesh);
+
+		JsonTape tape(getDefaultAllocator());
+		JsonTapeFn::parse(json, tape);
+		const uint32_t geometries = JsonTapeFn::get(tape, JsonTapeFn::getRoot(tape), "geometries");
+
+		TempAllocator4096 ta;
+		JsonObject root(ta);
+		JsonRFn::parse(json, root);
+		JsonObject geometryMap(ta);
+		JsonRFn::parse(root["geometries"], geometryMap);
+		ENSURE(JsonObjectFn::getCount(geometryMap) == JsonTapeFn::getMemberCount(tape, geometries));
+
+		Array<float> tapeList(getDefaultAllocator());
+		for (uint32_t geometry = JsonTapeFn::getFirstMember(tape, geometries); geometry != JSON_TAPE_INVALID; geometry = JsonTapeFn::getNextMember(tape, geometry))
+		{
+			const uint32_t position = JsonTapeFn::get(tape, geometry, "position");
+			ArrayFn::resize(tapeList, JsonTapeFn::getCount(tape, position));
+			ENSURE(JsonTapeFn::parseFloatArrayInto(tape, position, ArrayFn::begin(tapeList), ArrayFn::getCount(tapeList)) == 3000);
+
+			// Geometries are compared by key, the two parsers visit them in a different order
+			JsonObject geometryJson(ta);
+			JsonRFn::parse(geometryMap[JsonTapeFn::getKey(tape, geometry)], geometryJson);
+			JsonArray positionJson(ta);
+			JsonRFn::parseArray(geometryJson["position"], positionJson);
+			ENSURE(ArrayFn::getCount(positionJson) == ArrayFn::getCount(tapeList));
+
+			for (uint32_t i = 0; i < ArrayFn::getCount(tapeList); ++i)
+			{
+				ENSURE(getAreFloatsEqual(JsonRFn::parseFloat(positionJson[i]), tapeList[i], 0.0001f));
+			}
+		}
+	}
+	MemoryGlobalFn::shutdown();
+}
+
 static void testPath()
 {
 #if RIO_PLATFORM_POSIX
@@ -1184,9 +1815,629 @@ static void testCommandLine()
 	ENSURE(orange != NULL && strcmp(orange, "orange") == 0);
 }
 
+// Returns the number of events collected by the last ProfilerGlobalFn::flush() with the given <type>
+static uint32_t getProfilerEventCount(ProfilerEventType::Enum type)
+{
+	uint32_t count = 0;
+	const char* p = ProfilerGlobalFn::getBuffer();
+	for (;;)
+	{
+		const uint32_t eventType = *(const uint32_t*)p;
+		if (eventType == ProfilerEventType::COUNT)
+		{
+			return count;
+		}
+		count += eventType == type ? 1 : 0;
+		p += sizeof(uint32_t) + sizeof(uint32_t) + *(const uint32_t*)(p + sizeof(uint32_t));
+	}
+}
+
+// Counts the batches and the units destroyed, userPtr points to two uint32_t
+static void countDestroyedUnit(UnitId /*unitId*/, void* userPtr)
+{
+	uint32_t* countList = (uint32_t*)userPtr;
+	++countList[0];
+	++countList[1];
+}
+
+static void countDestroyedUnits(const UnitId* /*unitIdList*/, uint32_t count, void* userPtr)
+{
+	uint32_t* countList = (uint32_t*)userPtr;
+	++countList[0];
+	countList[1] += count;
+}
+
+static void testUnitManager()
+{
+	MemoryGlobalFn::init();
+	{
+		Allocator& a = getDefaultAllocator();
+		UnitManager unitManager(a);
+		uint32_t countList[2] = { 0, 0 };
+		unitManager.registerDestroyFunction(countDestroyedUnit, countList, countDestroyedUnits);
+
+		const UnitId unitA = unitManager.create();
+		const UnitId unitB = unitManager.create();
+		const UnitId unitC = unitManager.create();
+		const UnitId unitD = unitManager.create();
+		unitManager.destroy(unitA);
+		ENSURE(countList[0] == 1 && countList[1] == 1);
+
+		// Duplicates and units already destroyed are skipped
+		const UnitId unitIdList[] = { unitB, unitA, unitB, unitC };
+		Array<UnitId> destroyedUnitIdList(a);
+		unitManager.destroyBatch(unitIdList, RIO_COUNTOF(unitIdList), destroyedUnitIdList);
+		ENSURE(ArrayFn::getCount(destroyedUnitIdList) == 2);
+		ENSURE(destroyedUnitIdList[0] == unitB);
+		ENSURE(destroyedUnitIdList[1] == unitC);
+		ENSURE(countList[0] == 2 && countList[1] == 3);
+		ENSURE(!unitManager.getIsAlive(unitB));
+		ENSURE(!unitManager.getIsAlive(unitC));
+		ENSURE(unitManager.getIsAlive(unitD));
+
+		// Nothing left to destroy, no call back
+		ArrayFn::clear(destroyedUnitIdList);
+		unitManager.destroyBatch(unitIdList, RIO_COUNTOF(unitIdList), destroyedUnitIdList);
+		ENSURE(ArrayFn::getCount(destroyedUnitIdList) == 0);
+		ENSURE(countList[0] == 2 && countList[1] == 3);
+
+		unitManager.unregisterDestroyFunction(countList);
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+static void testComponentStorage()
+{
+	MemoryGlobalFn::init();
+	{
+		Allocator& a = getDefaultAllocator();
+		UnitManager unitManager(a);
+
+		// Two pages of units reserved, the instances go past them
+		const uint32_t maxInstancesCount = 2 * OsFn::getPageSize() / sizeof(UnitId);
+		ComponentStorage<float, Vector3> storage(a, maxInstancesCount);
+		ENSURE(storage.maxInstancesCount == maxInstancesCount);
+
+		UnitId* unitList = nullptr;
+		float* valueList = nullptr;
+		Vector3* positionList = nullptr;
+		ComponentStorageFn::bind(storage, &unitList, &valueList, &positionList);
+
+		const uint32_t count = maxInstancesCount + maxInstancesCount / 2;
+		Array<UnitId> unitIdList(a);
+		const UnitId* reservedUnitList = nullptr;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const UnitId unitId = unitManager.create();
+			ArrayFn::pushBack(unitIdList, unitId);
+			ENSURE(ComponentStorageFn::create(storage, unitId) == i);
+			valueList[i] = float(i);
+			positionList[i] = createVector3(float(i), 0.0f, 0.0f);
+
+			// Growing past a page commits the next one in place
+			if (i == 0)
+			{
+				reservedUnitList = unitList;
+			}
+			if (i < maxInstancesCount)
+			{
+				ENSURE(unitList == reservedUnitList);
+			}
+		}
+
+		// Past the reserved instances they moved to the heap, with the bound pointers
+		ENSURE(storage.size == count);
+		ENSURE(storage.maxInstancesCount == 0);
+		ENSURE(unitList == ComponentStorageFn::getUnitList(storage));
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			ENSURE(ComponentStorageFn::getInstance(storage, unitIdList[i]) == i);
+			ENSURE(unitList[i] == unitIdList[i]);
+			ENSURE(valueList[i] == float(i));
+			ENSURE(positionList[i].x == float(i));
+		}
+
+		// The last instance takes the place of the one destroyed
+		ENSURE(ComponentStorageFn::destroy(storage, 0) == count - 1);
+		ENSURE(ComponentStorageFn::getInstance(storage, unitIdList[0]) == UINT32_MAX);
+		ENSURE(ComponentStorageFn::getInstance(storage, unitIdList[count - 1]) == 0);
+		ENSURE(valueList[0] == float(count - 1));
+		ENSURE(storage.size == count - 1);
+
+		// Every other unit dies, the others keep their order
+		Array<UnitId> previousUnitList(a);
+		ArrayFn::push(previousUnitList, unitList, storage.size);
+		for (uint32_t i = 1; i < storage.size; i += 2)
+		{
+			unitManager.destroy(unitList[i]);
+		}
+		Array<uint32_t> indexList(a);
+		ArrayFn::resize(indexList, storage.size);
+		ComponentStorageFn::destroyDead(storage, unitManager, ArrayFn::begin(indexList));
+		ENSURE(storage.size == (ArrayFn::getCount(previousUnitList) + 1) / 2);
+		for (uint32_t i = 0; i < ArrayFn::getCount(previousUnitList); ++i)
+		{
+			if (i % 2 == 1)
+			{
+				ENSURE(indexList[i] == UINT32_MAX);
+				ENSURE(ComponentStorageFn::getInstance(storage, previousUnitList[i]) == UINT32_MAX);
+				continue;
+			}
+			ENSURE(indexList[i] == i / 2);
+			ENSURE(unitList[i / 2] == previousUnitList[i]);
+			ENSURE(ComponentStorageFn::getInstance(storage, previousUnitList[i]) == i / 2);
+		}
+
+		// A unit reusing the index of another does not find its instance
+		const UnitId unitId = unitList[1];
+		const UnitId staleUnitId = unitManager.makeUnit(unitId.getIndex(), uint8_t(unitId.getId() + 1));
+		ENSURE(ComponentStorageFn::getInstance(storage, unitId) == 1);
+		ENSURE(ComponentStorageFn::getInstance(storage, staleUnitId) == UINT32_MAX);
+
+		// Without reserved instances the arrays are in the heap from the start
+		ComponentStorage<float> heapStorage(a, 0);
+		for (uint32_t i = 0; i < 100; ++i)
+		{
+			ENSURE(ComponentStorageFn::create(heapStorage, unitIdList[i]) == i);
+			ComponentStorageFn::getField<1>(heapStorage)[i] = float(i);
+		}
+		for (uint32_t i = 0; i < 100; ++i)
+		{
+			ENSURE(ComponentStorageFn::getInstance(heapStorage, unitIdList[i]) == i);
+			ENSURE(ComponentStorageFn::getField<1>(heapStorage)[i] == float(i));
+		}
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+static void testSceneGraph()
+{
+	MemoryGlobalFn::init();
+	{
+		Allocator& a = getDefaultAllocator();
+		UnitManager unitManager(a);
+		SceneGraph sceneGraph(a, unitManager);
+
+		// root -> (childA -> grandChild, childB), other
+		UnitId unitList[5];
+		for (uint32_t i = 0; i < RIO_COUNTOF(unitList); ++i)
+		{
+			unitList[i] = unitManager.create();
+			sceneGraph.create(unitList[i], createMatrix4x4(QUATERNION_IDENTITY, createVector3(float(i), 0.0f, 0.0f)));
+		}
+		const UnitId root = unitList[0];
+		const UnitId childA = unitList[1];
+		const UnitId childB = unitList[2];
+		const UnitId grandChild = unitList[3];
+		const UnitId other = unitList[4];
+		sceneGraph.link(sceneGraph.get(childA), sceneGraph.get(root));
+		sceneGraph.link(sceneGraph.get(childB), sceneGraph.get(root));
+		sceneGraph.link(sceneGraph.get(grandChild), sceneGraph.get(childA));
+		ENSURE(sceneGraph.instanceData.parent[sceneGraph.get(grandChild).i].i == sceneGraph.get(childA).i);
+		const Vector3 grandChildPosition = sceneGraph.getWorldPosition(sceneGraph.get(grandChild));
+
+		// Destroying the root and the node after it moves the others down
+		const UnitId destroyList[] = { root, childA, root };
+		Array<UnitId> destroyedUnitIdList(a);
+		unitManager.destroyBatch(destroyList, RIO_COUNTOF(destroyList), destroyedUnitIdList);
+		ENSURE(ArrayFn::getCount(destroyedUnitIdList) == 2);
+		ENSURE(sceneGraph.getNodeCount() == 3);
+		ENSURE(!sceneGraph.getIsValid(sceneGraph.get(root)));
+		ENSURE(!sceneGraph.getIsValid(sceneGraph.get(childA)));
+
+		// Each unit left finds its own node, in the order they were created
+		const TransformInstance childBInstance = sceneGraph.get(childB);
+		const TransformInstance grandChildInstance = sceneGraph.get(grandChild);
+		const TransformInstance otherInstance = sceneGraph.get(other);
+		ENSURE(childBInstance.i == 0 && grandChildInstance.i == 1 && otherInstance.i == 2);
+		ENSURE(sceneGraph.instanceData.unit[childBInstance.i] == childB);
+		ENSURE(sceneGraph.instanceData.unit[grandChildInstance.i] == grandChild);
+		ENSURE(sceneGraph.instanceData.unit[otherInstance.i] == other);
+
+		// The children of the nodes destroyed became roots, where they were in the world
+		for (uint32_t i = 0; i < sceneGraph.getNodeCount(); ++i)
+		{
+			const TransformInstance transformInstance = sceneGraph.makeInstance(i);
+			ENSURE(!sceneGraph.getIsValid(sceneGraph.instanceData.parent[i]));
+			ENSURE(!sceneGraph.getIsValid(sceneGraph.instanceData.firstChild[i]));
+			ENSURE(!sceneGraph.getIsValid(sceneGraph.instanceData.nextSibling[i]));
+			ENSURE(!sceneGraph.getIsValid(sceneGraph.instanceData.prevSibling[i]));
+			ENSURE(getLength(sceneGraph.getLocalPosition(transformInstance) - sceneGraph.getWorldPosition(transformInstance)) < 0.00001f);
+		}
+		ENSURE(getLength(sceneGraph.getWorldPosition(grandChildInstance) - grandChildPosition) < 0.00001f);
+
+		// The links left are remapped to the new indices
+		sceneGraph.link(otherInstance, childBInstance);
+		sceneGraph.link(grandChildInstance, otherInstance);
+		const UnitId destroyListAgain[] = { childB };
+		unitManager.destroyBatch(destroyListAgain, RIO_COUNTOF(destroyListAgain), destroyedUnitIdList);
+		ENSURE(sceneGraph.getNodeCount() == 2);
+		ENSURE(sceneGraph.get(grandChild).i == 0 && sceneGraph.get(other).i == 1);
+		ENSURE(!sceneGraph.getIsValid(sceneGraph.instanceData.parent[1]));
+		ENSURE(sceneGraph.instanceData.firstChild[1].i == 0);
+		ENSURE(sceneGraph.instanceData.parent[0].i == 1);
+
+		// A few units among many nodes are swap-removed, the last node takes the place of the one destroyed
+		UnitId manyUnitList[32];
+		for (uint32_t i = 0; i < RIO_COUNTOF(manyUnitList); ++i)
+		{
+			manyUnitList[i] = unitManager.create();
+			sceneGraph.create(manyUnitList[i], MATRIX4X4_IDENTITY);
+		}
+		const uint32_t nodeCount = sceneGraph.getNodeCount();
+		const uint32_t firstIndex = sceneGraph.get(manyUnitList[0]).i;
+		sceneGraph.link(sceneGraph.get(manyUnitList[31]), sceneGraph.get(manyUnitList[0]));
+		unitManager.destroyBatch(manyUnitList, 1, destroyedUnitIdList);
+		ENSURE(sceneGraph.getNodeCount() == nodeCount - 1);
+		ENSURE(sceneGraph.get(manyUnitList[31]).i == firstIndex);
+		ENSURE(!sceneGraph.getIsValid(sceneGraph.instanceData.parent[firstIndex]));
+		ENSURE(sceneGraph.get(manyUnitList[1]).i == firstIndex + 1);
+
+		// Units without nodes leave the nodes alone
+		const UnitId unitWithoutNode = unitManager.create();
+		unitManager.destroyBatch(&unitWithoutNode, 1, destroyedUnitIdList);
+		ENSURE(sceneGraph.getNodeCount() == nodeCount - 1);
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+static void testTextureStreamer()
+{
+	MemoryGlobalFn::init();
+	{
+		Allocator& a = getDefaultAllocator();
+
+		char buffer[1024];
+		DynamicString directory(a);
+		PathFn::join(OsFn::getCurrentWorkingDirectory(buffer, sizeof(buffer)), "TextureStreamerTest", directory);
+		OsFn::createDirectory(directory.getCStr());
+
+		FileSystemDisk fileSystem(a);
+		fileSystem.setPrefix(directory.getCStr());
+		fileSystem.createDirectory(RIO_DATA_DIRECTORY);
+
+		// A 64x64 texture with all its mips, compiled like a .texture
+		DataCompiler dataCompiler;
+		Buffer outputBuffer(a);
+		jmp_buf jmpBuf;
+		CompileOptions compileOptions(dataCompiler, fileSystem, outputBuffer, "linux", &jmpBuf);
+		ENSURE(setjmp(jmpBuf) == 0);
+
+		Array<uint8_t> rgba(a);
+		ArrayFn::resize(rgba, 64 * 64 * 4);
+		for (uint32_t i = 0; i < ArrayFn::getCount(rgba); ++i)
+		{
+			rgba[i] = uint8_t(i * 7);
+		}
+		TextureSettings textureSettings(a);
+		textureSettings.format = bgfx::TextureFormat::RGBA8;
+		textureSettings.generateMips = true;
+		textureSettings.isNormalMap = false;
+		TextureResourceInternalFn::compileRgba8("test", rgba, 64, 64, textureSettings, compileOptions);
+
+		const uint32_t mipCount = *(const uint32_t*)&outputBuffer[sizeof(uint32_t) * 4];
+		ENSURE(mipCount > 1 && mipCount <= RIO_MAX_TEXTURE_MIPS);
+		TextureMip mipList[RIO_MAX_TEXTURE_MIPS];
+		memcpy(mipList, &outputBuffer[sizeof(uint32_t) * 5], sizeof(TextureMip) * mipCount);
+
+		TempAllocator128 ta;
+		DynamicString resourceTypeStr(ta);
+		DynamicString resourceNameStr(ta);
+		RESOURCE_TYPE_TEXTURE.toString(resourceTypeStr);
+		StringId64("test").toString(resourceNameStr);
+		DynamicString resoursePath(ta);
+		resoursePath += resourceTypeStr;
+		resoursePath += '-';
+		resoursePath += resourceNameStr;
+		DynamicString path(ta);
+		PathFn::join(RIO_DATA_DIRECTORY, resoursePath.getCStr(), path);
+
+		File* file = fileSystem.open(path.getCStr(), FileOpenMode::WRITE);
+		file->write(ArrayFn::begin(outputBuffer), ArrayFn::getCount(outputBuffer));
+		fileSystem.close(*file);
+
+		// From mip 1 to the smallest one, as the streamer asks
+		TextureStreamRead textureStreamRead;
+		textureStreamRead.textureResource = nullptr;
+		textureStreamRead.name = StringId64("test");
+		textureStreamRead.mip = 1;
+		textureStreamRead.offset = mipList[1].offset;
+		textureStreamRead.size = ArrayFn::getCount(outputBuffer) - mipList[1].offset;
+		ENSURE(TextureStreamerFn::read(fileSystem, textureStreamRead));
+		ENSURE(memcmp(textureStreamRead.data, &outputBuffer[mipList[1].offset], textureStreamRead.size) == 0);
+		a.deallocate(textureStreamRead.data);
+
+		// Past the end of the file
+		textureStreamRead.size += 1;
+		ENSURE(!TextureStreamerFn::read(fileSystem, textureStreamRead));
+		ENSURE(textureStreamRead.data == nullptr);
+
+		// No such texture
+		textureStreamRead.name = StringId64("missing");
+		textureStreamRead.size -= 1;
+		ENSURE(!TextureStreamerFn::read(fileSystem, textureStreamRead));
+		ENSURE(textureStreamRead.data == nullptr);
+
+		fileSystem.deleteFile(path.getCStr());
+		fileSystem.deleteDirectory(RIO_DATA_DIRECTORY);
+		OsFn::deleteDirectory(directory.getCStr());
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+// A package of a single texture which is never loaded, so it stays pending
+static void* loadPendingPackage(File& file, Allocator& a)
+{
+	RIO_UNUSED(file);
+	PackageResource* packageResource = RIO_NEW(a, PackageResource)(a);
+	ArrayFn::pushBack(packageResource->resources, PackageResource::Resource(RESOURCE_TYPE_TEXTURE, StringId64("pending")));
+	return packageResource;
+}
+
+static void unloadPendingPackage(Allocator& a, void* resource)
+{
+	RIO_DELETE(a, (PackageResource*)resource);
+}
+
+// Returns the path of the compiled resource <type>-<name> in the data directory
+static void getResourcePath(StringId64 type, StringId64 name, DynamicString& path)
+{
+	TempAllocator128 ta;
+	DynamicString resourceTypeStr(ta);
+	DynamicString resourceNameStr(ta);
+	type.toString(resourceTypeStr);
+	name.toString(resourceNameStr);
+	DynamicString resoursePath(ta);
+	resoursePath += resourceTypeStr;
+	resoursePath += '-';
+	resoursePath += resourceNameStr;
+	PathFn::join(RIO_DATA_DIRECTORY, resoursePath.getCStr(), path);
+}
+
+// Upvalues: the ScriptEnvironment and the ResourcePackage
+static int waitForPendingPackage(lua_State* scriptState)
+{
+	ScriptEnvironment* scriptEnvironment = (ScriptEnvironment*)lua_touserdata(scriptState, lua_upvalueindex(1));
+	return scriptEnvironment->waitForPackage(scriptState, (const ResourcePackage*)lua_touserdata(scriptState, lua_upvalueindex(2)));
+}
+
+// Upvalues: the ScriptEnvironment
+static int waitForTime(lua_State* scriptState)
+{
+	ScriptEnvironment* scriptEnvironment = (ScriptEnvironment*)lua_touserdata(scriptState, lua_upvalueindex(1));
+	return scriptEnvironment->waitForTime(scriptState, (float)lua_tonumber(scriptState, 1));
+}
+
+static void testScriptCoroutines()
+{
+	MemoryGlobalFn::init();
+	{
+		Allocator& a = getDefaultAllocator();
+
+		char buffer[1024];
+		DynamicString directory(a);
+		PathFn::join(OsFn::getCurrentWorkingDirectory(buffer, sizeof(buffer)), "ScriptCoroutineTest", directory);
+		OsFn::createDirectory(directory.getCStr());
+
+		FileSystemDisk fileSystem(a);
+		fileSystem.setPrefix(directory.getCStr());
+		fileSystem.createDirectory(RIO_DATA_DIRECTORY);
+
+		TempAllocator128 ta;
+		DynamicString path(ta);
+		getResourcePath(RESOURCE_TYPE_PACKAGE, StringId64("test"), path);
+		fileSystem.close(*fileSystem.open(path.getCStr(), FileOpenMode::WRITE));
+
+		ResourceLoader resourceLoader(fileSystem);
+		ResourceManager resourceManager(resourceLoader);
+		resourceManager.registerType(RESOURCE_TYPE_PACKAGE, loadPendingPackage, unloadPendingPackage, nullptr, nullptr);
+		ResourcePackage* resourcePackage = RIO_NEW(a, ResourcePackage)(StringId64("test"), resourceManager);
+		ENSURE(resourcePackage->getPendingCount() == 1);
+
+		ScriptEnvironment scriptEnvironment;
+		lua_State* scriptState = scriptEnvironment.scriptState;
+
+		luaL_loadstring(scriptState, "local wait = ... packageResult = wait()");
+		lua_pushlightuserdata(scriptState, &scriptEnvironment);
+		lua_pushlightuserdata(scriptState, resourcePackage);
+		lua_pushcclosure(scriptState, waitForPendingPackage, 2);
+		scriptEnvironment.spawnCoroutine(scriptState, 1);
+
+		luaL_loadstring(scriptState, "local wait = ... timeResult = wait(1.0)");
+		lua_pushlightuserdata(scriptState, &scriptEnvironment);
+		lua_pushcclosure(scriptState, waitForTime, 1);
+		scriptEnvironment.spawnCoroutine(scriptState, 1);
+
+		ENSURE(scriptEnvironment.getCoroutineCount() == 2);
+		scriptEnvironment.updateCoroutines(0.5f);
+		ENSURE(scriptEnvironment.getCoroutineCount() == 2);
+
+		// The package goes away while waited for, its waiter must not look at it again
+		scriptEnvironment.failWaitForPackage(resourcePackage);
+		RIO_DELETE(a, resourcePackage);
+		scriptEnvironment.updateCoroutines(0.6f);
+		ENSURE(scriptEnvironment.getCoroutineCount() == 0);
+
+		lua_getglobal(scriptState, "packageResult");
+		ENSURE(lua_isboolean(scriptState, -1) && !lua_toboolean(scriptState, -1));
+		lua_getglobal(scriptState, "timeResult");
+		ENSURE(lua_isboolean(scriptState, -1) && lua_toboolean(scriptState, -1));
+		lua_pop(scriptState, 2);
+
+		fileSystem.deleteFile(path.getCStr());
+		fileSystem.deleteDirectory(RIO_DATA_DIRECTORY);
+		OsFn::deleteDirectory(directory.getCStr());
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+// A level resource which is never read, the level waits for its package before looking at it
+static void* loadUnreadLevel(File& file, Allocator& a)
+{
+	RIO_UNUSED(file);
+	return a.allocate(sizeof(LevelResource));
+}
+
+static void unloadUnreadLevel(Allocator& a, void* resource)
+{
+	a.deallocate(resource);
+}
+
+static void testLevelPackageWait()
+{
+	MemoryGlobalFn::init();
+	{
+		Allocator& a = getDefaultAllocator();
+
+		char buffer[1024];
+		DynamicString directory(a);
+		PathFn::join(OsFn::getCurrentWorkingDirectory(buffer, sizeof(buffer)), "LevelPackageWaitTest", directory);
+		OsFn::createDirectory(directory.getCStr());
+
+		FileSystemDisk fileSystem(a);
+		fileSystem.setPrefix(directory.getCStr());
+		fileSystem.createDirectory(RIO_DATA_DIRECTORY);
+
+		TempAllocator256 ta;
+		DynamicString packagePath(ta);
+		getResourcePath(RESOURCE_TYPE_PACKAGE, StringId64("test"), packagePath);
+		fileSystem.close(*fileSystem.open(packagePath.getCStr(), FileOpenMode::WRITE));
+		DynamicString levelPath(ta);
+		getResourcePath(RESOURCE_TYPE_LEVEL, StringId64("test"), levelPath);
+		fileSystem.close(*fileSystem.open(levelPath.getCStr(), FileOpenMode::WRITE));
+
+		ResourceLoader resourceLoader(fileSystem);
+		ResourceManager resourceManager(resourceLoader);
+		resourceManager.registerType(RESOURCE_TYPE_PACKAGE, loadPendingPackage, unloadPendingPackage, nullptr, nullptr);
+		resourceManager.registerType(RESOURCE_TYPE_LEVEL, loadUnreadLevel, unloadUnreadLevel, nullptr, nullptr);
+		ResourcePackage* resourcePackage = RIO_NEW(a, ResourcePackage)(StringId64("test"), resourceManager);
+		ENSURE(resourcePackage->getPendingCount() == 1);
+
+		// The level only touches its world once it spawns units, which it never gets to here
+		alignas(World) char worldBuffer[sizeof(World)];
+		UnitManager unitManager(a);
+		Level* level = RIO_NEW(a, Level)(a, resourceManager, unitManager, *(World*)worldBuffer, StringId64("test"));
+		level->beginLoad(VECTOR3_ZERO, QUATERNION_IDENTITY, resourcePackage);
+		resourceManager.flush();
+		ENSURE(!level->update(INT64_MAX));
+		ENSURE(level->getLoadState() == LevelLoadState::WAITING);
+
+		// The package goes away while waited for, the level must not look at it again
+		level->failWaitForPackage(resourcePackage);
+		RIO_DELETE(a, resourcePackage);
+		ENSURE(level->getLoadState() == LevelLoadState::CANCELED);
+		ENSURE(!level->update(INT64_MAX));
+		ENSURE(!level->getIsLoading());
+		RIO_DELETE(a, level);
+
+		fileSystem.deleteFile(levelPath.getCStr());
+		fileSystem.deleteFile(packagePath.getCStr());
+		fileSystem.deleteDirectory(RIO_DATA_DIRECTORY);
+		OsFn::deleteDirectory(directory.getCStr());
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+static void testBenchmark()
+{
+	MemoryGlobalFn::init();
+	{
+		BenchmarkGlobalFn::init(getDefaultAllocator(), 2);
+		BenchmarkFn::addTime(BenchmarkCounter::FRAME, 0.016);
+		BenchmarkGlobalFn::endFrame(1024);
+		ENSURE(BenchmarkGlobalFn::getFrameCount() == 1);
+
+		StringStream json(getDefaultAllocator());
+		BenchmarkGlobalFn::writeReport(json, "levels\\\"quoted\"\n");
+		ENSURE(strstr(StringStreamFn::getCStr(json), "{\"level\":\"levels\\\\\\\"quoted\\\"\\u000a\",") != NULL);
+		BenchmarkGlobalFn::shutdown();
+	}
+	MemoryGlobalFn::shutdown();
+}
+
+static void testProfiler()
+{
+	MemoryGlobalFn::init();
+	{
+		ProfilerGlobalFn::init();
+		ProfilerFn::enterProfileScope("scope");
+		ProfilerGlobalFn::shutdown();
+
+		// The buffer of the previous session is freed, the thread gets a new one
+		ProfilerGlobalFn::init();
+		ProfilerFn::enterProfileScope("scope");
+		ProfilerFn::leaveProfileScope();
+		ProfilerGlobalFn::flush();
+		ENSURE(getProfilerEventCount(ProfilerEventType::ENTER_PROFILE_SCOPE) == 1);
+		ENSURE(getProfilerEventCount(ProfilerEventType::LEAVE_PROFILE_SCOPE) == 1);
+		ProfilerGlobalFn::shutdown();
+	}
+	{
+		ProfilerGlobalFn::init();
+
+		// Events wrap around the ring many times
+		for (uint32_t round = 0; round < 64; ++round)
+		{
+			for (uint32_t i = 0; i < 500; ++i)
+			{
+				ProfilerFn::recordFloat("value", float(i));
+			}
+			ProfilerGlobalFn::clear();
+			ProfilerGlobalFn::flush();
+			ENSURE(getProfilerEventCount(ProfilerEventType::RECORD_FLOAT) == 500);
+		}
+
+		// Events past the size of the ring are dropped until it is flushed
+		const uint32_t eventSize = 2 * sizeof(uint32_t) + sizeof(EnterProfileScope);
+		const uint32_t eventCount = RIO_PROFILER_THREAD_BUFFER_SIZE / eventSize;
+		for (uint32_t i = 0; i < eventCount + 100; ++i)
+		{
+			ProfilerFn::enterProfileScope("scope");
+		}
+		ProfilerGlobalFn::clear();
+		ProfilerGlobalFn::flush();
+		ENSURE(getProfilerEventCount(ProfilerEventType::ENTER_PROFILE_SCOPE) == eventCount);
+
+		ProfilerGlobalFn::shutdown();
+	}
+	{
+		ProfilerGlobalFn::init();
+		ProfilerFn::setThreadName("main \"thread\"");
+		ProfilerFn::enterProfileScope("C:\\scope \"quoted\"");
+		ProfilerFn::recordFloat("value\n", 1.0f);
+		ProfilerFn::leaveProfileScope();
+		ProfilerGlobalFn::flush();
+
+		TempAllocator4096 ta;
+		StringStream json(ta);
+		ProfilerGlobalFn::writeChromeTrace(json);
+		const char* trace = StringStreamFn::getCStr(json);
+		ENSURE(strstr(trace, "\"name\":\"C:\\\\scope \\\"quoted\\\"\"") != NULL);
+		ENSURE(strstr(trace, "\"name\":\"value\\u000a\"") != NULL);
+		ENSURE(strstr(trace, "\"name\":\"main \\\"thread\\\"\"") != NULL);
+
+		JsonObject object(ta);
+		JsonFn::parse(trace, object);
+		ENSURE(JsonObjectFn::has(object, "traceEvents"));
+
+		JsonArray eventList(ta);
+		JsonFn::parseArray(object["traceEvents"], eventList);
+		// Thread name, scope begin and end, value
+		ENSURE(ArrayFn::getCount(eventList) == 4);
+
+		ProfilerGlobalFn::shutdown();
+	}
+	MemoryGlobalFn::shutdown();
+}
+
 static void runUnitTests()
 {
 	testMemory();
+	testVirtualMemory();
+	testScratchAllocator();
+	testAllocationTracker();
+	testArenaAllocator();
+	testProxyAllocator();
 	testArray();
 	testVector();
 	testHashMap();
@@ -1199,14 +2450,26 @@ static void runUnitTests()
 	testMatrix4x4();
 	testAabb();
 	testSphere();
+	testMeshOptimizer();
+	testMaxRects();
+	testQuantization();
 	testMurmur();
 	testStringId();
 	testDynamicString();
 	testGuid();
 	testJson();
 	testJsonR();
+	testJsonTape();
 	testPath();
 	testCommandLine();
+	testUnitManager();
+	testComponentStorage();
+	testSceneGraph();
+	testTextureStreamer();
+	testScriptCoroutines();
+	testLevelPackageWait();
+	testBenchmark();
+	testProfiler();
 }
 
 } // namespace Rio
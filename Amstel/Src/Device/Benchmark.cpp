@@ -0,0 +1,239 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Device/Benchmark.h"
+
+#include "Core/Base/Os.h"
+#include "Core/Containers/Array.h"
+#include "Core/Memory/Memory.h"
+#include "Core/Memory/ProxyAllocator.h"
+#include "Core/Strings/StringStream.h"
+#include "Core/Strings/StringUtils.h"
+
+#include <algorithm> // std::sort
+
+namespace Rio
+{
+
+namespace BenchmarkInternalFn
+{
+	static const char* counterNameList[] =
+	{
+		"scriptUpdate",
+		"scriptRender",
+		"sceneUpdate",
+		"physics",
+		"spawn",
+		"renderSubmission",
+		"bgfxCpu",
+		"frame"
+	};
+
+	struct Benchmark
+	{
+		Benchmark(Allocator& a, uint32_t maxFrameCount)
+			: timeList(a)
+			, maxFrameCount(maxFrameCount)
+		{
+			ArrayFn::resize(timeList, maxFrameCount * BenchmarkCounter::COUNT);
+			for (uint32_t i = 0; i < BenchmarkCounter::COUNT; ++i)
+			{
+				currentTimeList[i] = 0.0f;
+			}
+		}
+
+		// Milliseconds, BenchmarkCounter::COUNT entries per frame
+		Array<float> timeList;
+		float currentTimeList[BenchmarkCounter::COUNT];
+		uint32_t maxFrameCount;
+		uint32_t frameCount = 0;
+		uint32_t peakMemory = 0;
+	};
+
+	static Allocator* allocator = nullptr;
+	static Benchmark* benchmark = nullptr;
+
+	static void writeFloat(StringStream& json, float value)
+	{
+		char buffer[32];
+		snPrintF(buffer, sizeof(buffer), "%.4f", value);
+		json << buffer;
+	}
+
+	// Writes <string> as a JSON string, escaping the quotes, backslashes and control characters
+	static void writeString(StringStream& json, const char* string)
+	{
+		json << "\"";
+		for (const char* ch = string; *ch != '\0'; ++ch)
+		{
+			if (*ch == '"' || *ch == '\\')
+			{
+				json << '\\' << *ch;
+			}
+			else if ((unsigned char)*ch < 0x20)
+			{
+				char escaped[8];
+				snPrintF(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*ch);
+				json << escaped;
+			}
+			else
+			{
+				json << *ch;
+			}
+		}
+		json << "\"";
+	}
+} // namespace BenchmarkInternalFn
+
+namespace BenchmarkFn
+{
+	void addTime(BenchmarkCounter::Enum counter, double seconds)
+	{
+		using namespace BenchmarkInternalFn;
+
+		if (benchmark == nullptr)
+		{
+			return;
+		}
+
+		benchmark->currentTimeList[counter] += float(seconds * 1000.0);
+	}
+} // namespace BenchmarkFn
+
+namespace BenchmarkGlobalFn
+{
+	void init(Allocator& a, uint32_t frameCount)
+	{
+		using namespace BenchmarkInternalFn;
+		RIO_STATIC_ASSERT(RIO_COUNTOF(counterNameList) == BenchmarkCounter::COUNT);
+
+		allocator = &a;
+		benchmark = RIO_NEW(a, Benchmark)(a, frameCount);
+	}
+
+	void shutdown()
+	{
+		using namespace BenchmarkInternalFn;
+
+		if (benchmark != nullptr)
+		{
+			RIO_DELETE(*allocator, benchmark);
+			benchmark = nullptr;
+		}
+	}
+
+	bool getIsRunning()
+	{
+		return BenchmarkInternalFn::benchmark != nullptr;
+	}
+
+	void endFrame(uint32_t peakMemoryBytes)
+	{
+		using namespace BenchmarkInternalFn;
+
+		if (benchmark == nullptr || benchmark->frameCount == benchmark->maxFrameCount)
+		{
+			return;
+		}
+
+		float* frameTimeList = ArrayFn::begin(benchmark->timeList) + benchmark->frameCount * BenchmarkCounter::COUNT;
+		for (uint32_t i = 0; i < BenchmarkCounter::COUNT; ++i)
+		{
+			frameTimeList[i] = benchmark->currentTimeList[i];
+			benchmark->currentTimeList[i] = 0.0f;
+		}
+
+		benchmark->peakMemory = peakMemoryBytes > benchmark->peakMemory ? peakMemoryBytes : benchmark->peakMemory;
+		++benchmark->frameCount;
+	}
+
+	uint32_t getFrameCount()
+	{
+		using namespace BenchmarkInternalFn;
+		return benchmark != nullptr ? benchmark->frameCount : 0;
+	}
+
+	void writeReport(StringStream& json, const char* level)
+	{
+		using namespace BenchmarkInternalFn;
+		RIO_ASSERT_NOT_NULL(benchmark);
+
+		const uint32_t frameCount = benchmark->frameCount;
+		const float* timeList = ArrayFn::begin(benchmark->timeList);
+
+		// The level name comes from the command line
+		json << "{\"level\":";
+		writeString(json, level);
+		json << ",\"frames\":" << frameCount;
+		json << ",\"peakMemory\":" << benchmark->peakMemory;
+		json << ",\"allocators\":";
+		ProxyAllocatorGlobalFn::writeJson(json);
+
+		// Percentiles
+		Array<float> sortedList(*allocator);
+		ArrayFn::resize(sortedList, frameCount);
+
+		json << ",\"summary\":{";
+		for (uint32_t c = 0; c < BenchmarkCounter::COUNT; ++c)
+		{
+			float total = 0.0f;
+			for (uint32_t f = 0; f < frameCount; ++f)
+			{
+				sortedList[f] = timeList[f * BenchmarkCounter::COUNT + c];
+				total += sortedList[f];
+			}
+			std::sort(ArrayFn::begin(sortedList), ArrayFn::end(sortedList));
+
+			json << (c == 0 ? "\"" : ",\"") << counterNameList[c] << "\":{";
+			if (frameCount != 0)
+			{
+				json << "\"min\":"; writeFloat(json, sortedList[0]);
+				json << ",\"mean\":"; writeFloat(json, total / frameCount);
+				json << ",\"p50\":"; writeFloat(json, sortedList[frameCount * 50 / 100]);
+				json << ",\"p90\":"; writeFloat(json, sortedList[frameCount * 90 / 100]);
+				json << ",\"p99\":"; writeFloat(json, sortedList[frameCount * 99 / 100]);
+				json << ",\"max\":"; writeFloat(json, sortedList[frameCount - 1]);
+			}
+			json << "}";
+		}
+		json << "}";
+
+		// Per frame timings
+		json << ",\"counters\":[";
+		for (uint32_t c = 0; c < BenchmarkCounter::COUNT; ++c)
+		{
+			json << (c == 0 ? "\"" : ",\"") << counterNameList[c] << "\"";
+		}
+		json << "],\"frameTimes\":[";
+		for (uint32_t f = 0; f < frameCount; ++f)
+		{
+			json << (f == 0 ? "[" : ",[");
+			for (uint32_t c = 0; c < BenchmarkCounter::COUNT; ++c)
+			{
+				if (c != 0)
+				{
+					json << ",";
+				}
+				writeFloat(json, timeList[f * BenchmarkCounter::COUNT + c]);
+			}
+			json << "]";
+		}
+		json << "]}";
+	}
+} // namespace BenchmarkGlobalFn
+
+BenchmarkScope::BenchmarkScope(BenchmarkCounter::Enum counter)
+	: counter(counter)
+	, startTime(BenchmarkGlobalFn::getIsRunning() ? OsFn::getClockTime() : 0)
+{
+}
+
+BenchmarkScope::~BenchmarkScope()
+{
+	if (BenchmarkGlobalFn::getIsRunning())
+	{
+		const int64_t time = OsFn::getClockTime() - startTime;
+		BenchmarkFn::addTime(counter, double(time) / double(OsFn::getClockFrequency()));
+	}
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
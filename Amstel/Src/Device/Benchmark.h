@@ -0,0 +1,73 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+#include "Core/Memory/MemoryTypes.h"
+#include "Core/Strings/StringTypes.h"
+#include "Device/DeviceEventQueue.h"
+
+namespace Rio
+{
+
+struct BenchmarkCounter
+{
+	enum Enum
+	{
+		SCRIPT_UPDATE,
+		SCRIPT_RENDER,
+		SCENE_UPDATE, // Includes PHYSICS
+		PHYSICS,
+		SPAWN, // World::spawnUnits(), usually within SCRIPT_UPDATE
+		RENDER_SUBMISSION,
+		BGFX_CPU,
+		FRAME,
+
+		COUNT
+	};
+};
+
+// An input event replayed at the beginning of the frame <frame>
+struct InputLogEvent
+{
+	uint32_t frame;
+	OsEvent event;
+};
+
+// Collects per frame CPU timings while the device runs in benchmark mode
+// Everything is a no-op when the benchmark is not running
+namespace BenchmarkFn
+{
+	// Adds <seconds> to the <counter> of the current frame
+	void addTime(BenchmarkCounter::Enum counter, double seconds);
+} // namespace BenchmarkFn
+
+namespace BenchmarkGlobalFn
+{
+	// Starts collecting timings for <frameCount> frames
+	void init(Allocator& a, uint32_t frameCount);
+	void shutdown();
+	bool getIsRunning();
+	// Closes the current frame, <peakMemoryBytes> is the most memory in use during the frame
+	void endFrame(uint32_t peakMemoryBytes);
+	// Returns the number of frames closed so far
+	uint32_t getFrameCount();
+	// Writes per frame timings (in milliseconds), their percentiles and the peak memory as JSON
+	void writeReport(StringStream& json, const char* level);
+} // namespace BenchmarkGlobalFn
+
+// Adds the time spent in the enclosing C++ scope to a benchmark counter
+struct BenchmarkScope
+{
+	BenchmarkScope(BenchmarkCounter::Enum counter);
+	~BenchmarkScope();
+private:
+	// Disable copying
+	BenchmarkScope(const BenchmarkScope&) = delete;
+	BenchmarkScope& operator=(const BenchmarkScope&) = delete;
+
+	BenchmarkCounter::Enum counter;
+	int64_t startTime;
+};
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -6,8 +6,15 @@
 #include "Core/Json/JsonObject.h"
 #include "Script/ScriptEnvironment.h"
 #include "Core/Json/JsonR.h"
+#include "Core/Json/JsonTape.h"
+#include "Core/Base/Os.h"
 #include "Core/Strings/StringStream.h"
 #include "Core/Memory/TempAllocator.h"
+#include "Core/Memory/ProxyAllocator.h"
+#include "Core/Memory/AllocationTracker.h"
+#include "Core/FileSystem/File.h"
+#include "Core/FileSystem/FileSystem.h"
+#include "Device/Profiler.h"
 
 namespace Rio
 {
@@ -86,6 +93,284 @@ static void consoleCommandCompileResource(ConsoleServer& consoleServer, TcpSocke
 	}
 }
 
+// Exports the events of the last frame as Chrome trace JSON
+// Writes them to "path" if given, sends them back to the client otherwise
+static void consoleCommandProfiler(ConsoleServer& consoleServer, TcpSocket client, const char* json)
+{
+	TempAllocator4096 ta;
+	JsonObject jsonObject(ta);
+	JsonRFn::parse(json, jsonObject);
+
+	StringStream trace(getDefaultAllocator());
+	ProfilerGlobalFn::writeChromeTrace(trace);
+
+	if (JsonObjectFn::has(jsonObject, "path"))
+	{
+		DynamicString path(ta);
+		JsonRFn::parseString(jsonObject["path"], path);
+
+		FileSystem* fileSystem = getDevice()->getFileSystem();
+		File* file = fileSystem->open(path.getCStr(), FileOpenMode::WRITE);
+		file->write(ArrayFn::begin(trace), ArrayFn::getCount(trace));
+		fileSystem->close(*file);
+
+		RIO_LOGI("Profiler trace written to '%s'", path.getCStr());
+		return;
+	}
+
+	consoleServer.send(client, StringStreamFn::getCStr(trace));
+}
+
+// Sends the counters of all the proxy allocators
+static void consoleCommandMemory(ConsoleServer& consoleServer, TcpSocket client, const char* /*json*/)
+{
+	TempAllocator4096 ta;
+	StringStream stringStream(ta);
+	stringStream << "{\"type\":\"memory\",\"allocators\":";
+	ProxyAllocatorGlobalFn::writeJson(stringStream);
+	stringStream << "}";
+	consoleServer.send(client, StringStreamFn::getCStr(stringStream));
+}
+
+// Sends the top call sites of the allocation tracker
+// "sampleRate" changes the sampling rate, "count" the number of call sites reported
+static void consoleCommandAllocations(ConsoleServer& consoleServer, TcpSocket client, const char* json)
+{
+	TempAllocator4096 ta;
+	JsonObject jsonObject(ta);
+	JsonRFn::parse(json, jsonObject);
+
+	if (JsonObjectFn::has(jsonObject, "sampleRate"))
+	{
+		AllocationTrackerGlobalFn::setSampleRate((uint32_t)JsonRFn::parseInt(jsonObject["sampleRate"]));
+	}
+
+	const uint32_t count = JsonObjectFn::has(jsonObject, "count") ? (uint32_t)JsonRFn::parseInt(jsonObject["count"]) : 16;
+
+	StringStream stringStream(getDefaultAllocator());
+	stringStream << "{\"type\":\"allocations\",\"report\":";
+	AllocationTrackerGlobalFn::writeJson(stringStream, count);
+	stringStream << "}";
+	consoleServer.send(client, StringStreamFn::getCStr(stringStream));
+}
+
+static const char* logSeverityNameMap[] = { "info", "warning", "error", "debug" };
+RIO_STATIC_ASSERT(RIO_COUNTOF(logSeverityNameMap) == LogSeverity::COUNT);
+
+// Enables or disables the log messages of "severity", one of the <logSeverityNameMap>
+static void consoleCommandLog(ConsoleServer& consoleServer, TcpSocket client, const char* json)
+{
+	TempAllocator4096 ta;
+	JsonObject jsonObject(ta);
+	DynamicString severityName(ta);
+	JsonRFn::parse(json, jsonObject);
+	JsonRFn::parseString(jsonObject["severity"], severityName);
+	const bool enable = JsonRFn::parseBool(jsonObject["enable"]);
+
+	for (uint32_t i = 0; i < LogSeverity::COUNT; ++i)
+	{
+		if (severityName == logSeverityNameMap[i])
+		{
+			LogFn::setEnabled(LogSeverity::Enum(i), enable);
+			consoleServer.success(client, "Log severity updated");
+			return;
+		}
+	}
+
+	consoleServer.error(client, "Unknown log severity");
+}
+
+// Starts sampling the Lua call stacks every "interval" milliseconds (1 by default)
+// Samples collected by previous runs are dropped unless "keep" is true
+static void consoleCommandLuaProfilerStart(ConsoleServer& /*consoleServer*/, TcpSocket /*client*/, const char* json)
+{
+	TempAllocator4096 ta;
+	JsonObject jsonObject(ta);
+	JsonRFn::parse(json, jsonObject);
+
+	const uint32_t interval = JsonObjectFn::has(jsonObject, "interval") ? (uint32_t)JsonRFn::parseInt(jsonObject["interval"]) : 1;
+	const bool keep = JsonObjectFn::has(jsonObject, "keep") && JsonRFn::parseBool(jsonObject["keep"]);
+
+	ScriptEnvironment* scriptEnvironment = getDevice()->getScriptEnvironment();
+	if (!keep)
+	{
+		scriptEnvironment->profiler.clear();
+	}
+	scriptEnvironment->profiler.start(scriptEnvironment->scriptState, interval);
+	RIO_LOGI("Lua profiler started, sampling every %u ms", interval);
+}
+
+static void consoleCommandLuaProfilerStop(ConsoleServer& /*consoleServer*/, TcpSocket /*client*/, const char* /*json*/)
+{
+	ScriptProfiler& profiler = getDevice()->getScriptEnvironment()->profiler;
+	profiler.stop();
+	RIO_LOGI("Lua profiler stopped, %u samples", profiler.getSampleCount());
+}
+
+// Exports the Lua stacks sampled so far in the folded format of the flamegraph tools
+// Writes them to "path" if given, sends them back to the client otherwise
+static void consoleCommandLuaProfilerDump(ConsoleServer& consoleServer, TcpSocket client, const char* json)
+{
+	TempAllocator4096 ta;
+	JsonObject jsonObject(ta);
+	JsonRFn::parse(json, jsonObject);
+
+	const ScriptProfiler& profiler = getDevice()->getScriptEnvironment()->profiler;
+	StringStream folded(getDefaultAllocator());
+	profiler.writeFolded(folded);
+
+	if (JsonObjectFn::has(jsonObject, "path"))
+	{
+		DynamicString path(ta);
+		JsonRFn::parseString(jsonObject["path"], path);
+
+		FileSystem* fileSystem = getDevice()->getFileSystem();
+		File* file = fileSystem->open(path.getCStr(), FileOpenMode::WRITE);
+		file->write(ArrayFn::begin(folded), ArrayFn::getCount(folded));
+		fileSystem->close(*file);
+
+		RIO_LOGI("Lua profiler stacks written to '%s'", path.getCStr());
+		return;
+	}
+
+	// Stack names come from the Lua sources, escape them for the JSON string
+	StringStream stringStream(getDefaultAllocator());
+	stringStream << "{\"type\":\"luaProfiler\",\"samples\":" << profiler.getSampleCount() << ",\"folded\":\"";
+	for (uint32_t i = 0; i < ArrayFn::getCount(folded); ++i)
+	{
+		const char c = folded[i];
+		if (c == '\n')
+		{
+			stringStream << "\\n";
+		}
+		else
+		{
+			if (c == '"' || c == '\\')
+			{
+				stringStream << '\\';
+			}
+			stringStream << c;
+		}
+	}
+	stringStream << "\"}";
+	consoleServer.send(client, StringStreamFn::getCStr(stringStream));
+}
+
+namespace ConsoleApiInternalFn
+{
+	// Decodes every number of the "position" arrays of all the geometries of a mesh
+	// Returns the number of values decoded
+	static uint32_t decodeMeshWithJsonR(const char* json)
+	{
+		TempAllocator4096 ta;
+		JsonObject root(ta);
+		JsonRFn::parse(json, root);
+		JsonObject geometries(ta);
+		JsonRFn::parse(root["geometries"], geometries);
+
+		uint32_t count = 0;
+		auto begin = JsonObjectFn::begin(geometries);
+		auto end = JsonObjectFn::end(geometries);
+		for (; begin != end; ++begin)
+		{
+			JsonObject geometry(ta);
+			JsonRFn::parse(begin->pair.second, geometry);
+
+			JsonArray position(getDefaultAllocator());
+			JsonRFn::parseArray(geometry["position"], position);
+			for (uint32_t i = 0; i < ArrayFn::getCount(position); ++i)
+			{
+				JsonRFn::parseFloat(position[i]);
+			}
+			count += ArrayFn::getCount(position);
+		}
+		return count;
+	}
+
+	static uint32_t decodeMeshWithJsonTape(const char* json)
+	{
+		JsonTape tape(getDefaultAllocator());
+		JsonTapeFn::parse(json, tape);
+		const uint32_t geometries = JsonTapeFn::get(tape, JsonTapeFn::getRoot(tape), "geometries");
+
+		uint32_t count = 0;
+		Array<float> position(getDefaultAllocator());
+		for (uint32_t geometry = JsonTapeFn::getFirstMember(tape, geometries); geometry != JSON_TAPE_INVALID; geometry = JsonTapeFn::getNextMember(tape, geometry))
+		{
+			const uint32_t positionJson = JsonTapeFn::get(tape, geometry, "position");
+			ArrayFn::resize(position, JsonTapeFn::getCount(tape, positionJson));
+			JsonTapeFn::parseFloatArrayInto(tape, positionJson, ArrayFn::begin(position), ArrayFn::getCount(position));
+			count += ArrayFn::getCount(position);
+		}
+		return count;
+	}
+
+	static double getElapsedMilliseconds(int64_t start)
+	{
+		return double(OsFn::getClockTime() - start) * 1000.0 / double(OsFn::getClockFrequency());
+	}
+} // namespace ConsoleApiInternalFn
+
+// Measures JsonRFn against JsonTapeFn on a mesh file
+// Reads the mesh from "path" if given, generates one of "megabytes" (50 by default) otherwise
+// Whether both parsers decode the same values is checked by the unit tests, this only reports their times
+static void consoleCommandJsonBenchmark(ConsoleServer& consoleServer, TcpSocket client, const char* json)
+{
+	using namespace ConsoleApiInternalFn;
+
+	TempAllocator4096 ta;
+	JsonObject jsonObject(ta);
+	JsonRFn::parse(json, jsonObject);
+
+	StringStream mesh(getDefaultAllocator());
+	if (JsonObjectFn::has(jsonObject, "path"))
+	{
+		DynamicString path(ta);
+		JsonRFn::parseString(jsonObject["path"], path);
+
+		FileSystem* fileSystem = getDevice()->getFileSystem();
+		File* file = fileSystem->open(path.getCStr(), FileOpenMode::READ);
+		ArrayFn::resize(mesh, file->getSize());
+		file->read(ArrayFn::begin(mesh), ArrayFn::getCount(mesh));
+		fileSystem->close(*file);
+	}
+	else
+	{
+		const uint32_t megabytes = JsonObjectFn::has(jsonObject, "megabytes") ? (uint32_t)JsonRFn::parseInt(jsonObject["megabytes"]) : 50;
+		const uint32_t size = megabytes * 1024 * 1024;
+
+		mesh << "geometries = {\n";
+		for (uint32_t g = 0; ArrayFn::getCount(mesh) < size; ++g)
+		{
+			mesh << "\tgeometry" << g << " = {\n\t\tposition = [";
+			for (uint32_t i = 0; i < 3 * 65536 && ArrayFn::getCount(mesh) < size; ++i)
+			{
+				mesh << " " << float(i % 2048) * 0.125f - 128.0f;
+			}
+			mesh << " ]\n\t}\n";
+		}
+		mesh << "}\n";
+	}
+	const char* data = StringStreamFn::getCStr(mesh);
+
+	int64_t start = OsFn::getClockTime();
+	const uint32_t countJsonR = decodeMeshWithJsonR(data);
+	const double jsonR = getElapsedMilliseconds(start);
+
+	start = OsFn::getClockTime();
+	const uint32_t countJsonTape = decodeMeshWithJsonTape(data);
+	const double jsonTape = getElapsedMilliseconds(start);
+
+	StringStream stringStream(ta);
+	stringStream << "{\"type\":\"jsonBenchmark\",\"bytes\":" << ArrayFn::getCount(mesh);
+	stringStream << ",\"jsonR\":" << jsonR;
+	stringStream << ",\"jsonTape\":" << jsonTape;
+	stringStream << ",\"jsonRValues\":" << countJsonR;
+	stringStream << ",\"jsonTapeValues\":" << countJsonTape;
+	stringStream << "}";
+	consoleServer.send(client, StringStreamFn::getCStr(stringStream));
+}
+
 void loadConsoleApi(ConsoleServer& consoleServer)
 {
 	consoleServer.registerCommand("script", consoleCommandExecuteScript);
@@ -93,6 +378,14 @@ void loadConsoleApi(ConsoleServer& consoleServer)
 	consoleServer.registerCommand("pause", consoleCommandPause);
 	consoleServer.registerCommand("unpause", consoleCommandUnpause);
 	consoleServer.registerCommand("compile", consoleCommandCompileResource);
+	consoleServer.registerCommand("profiler", consoleCommandProfiler);
+	consoleServer.registerCommand("memory", consoleCommandMemory);
+	consoleServer.registerCommand("allocations", consoleCommandAllocations);
+	consoleServer.registerCommand("jsonBenchmark", consoleCommandJsonBenchmark);
+	consoleServer.registerCommand("log", consoleCommandLog);
+	consoleServer.registerCommand("luaProfilerStart", consoleCommandLuaProfilerStart);
+	consoleServer.registerCommand("luaProfilerStop", consoleCommandLuaProfilerStop);
+	consoleServer.registerCommand("luaProfilerDump", consoleCommandLuaProfilerDump);
 }
 
 } // namespace Rio
@@ -2,18 +2,54 @@
 #include "Device/ConsoleServer.h"
 #include "Core/Json/JsonObject.h"
 #include "Core/Json/JsonR.h"
+#include "Core/Containers/Array.h"
+#include "Core/Containers/Queue.h"
 #include "Core/Containers/SortMap.h"
 #include "Core/Strings/StringId.h"
 #include "Core/Strings/StringStream.h"
+#include "Core/Strings/StringUtils.h"
 #include "Core/Memory/TempAllocator.h"
+#include "Device/Profiler.h"
+
+#include <string.h> // memcpy, memmove
+
+#if RIO_CONSOLE_EPOLL
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+#elif RIO_PLATFORM_POSIX
+	#include <sys/select.h>
+#endif // RIO_CONSOLE_EPOLL
 
 namespace Rio
 {
 
+RIO_STATIC_ASSERT((RIO_CONSOLE_MAX_COMMANDS & (RIO_CONSOLE_MAX_COMMANDS - 1)) == 0);
+
+namespace ConsoleServerInternalFn
+{
+	// Copies <data> at the end of the <count> bytes from <begin> in the ring buffer <ring>
+	static void writeRing(char* ring, uint32_t begin, uint32_t count, const void* data, uint32_t size)
+	{
+		const uint32_t end = (begin + count) % RIO_CONSOLE_SEND_BUFFER_SIZE;
+		const uint32_t firstSize = RIO_CONSOLE_SEND_BUFFER_SIZE - end < size ? RIO_CONSOLE_SEND_BUFFER_SIZE - end : size;
+		memcpy(ring + end, data, firstSize);
+		memcpy(ring, (const char*)data + firstSize, size - firstSize);
+	}
+} // namespace ConsoleServerInternalFn
+
 ConsoleServer::ConsoleServer(Allocator& a)
-	: clientList(a)
+	: allocator(&a)
+	, clientList(a)
 	, commandFunctionMap(a)
+	, commandBegin(0)
+	, commandEnd(0)
+	, pendingCommandList(a)
+{
+}
+
+ConsoleServer::~ConsoleServer()
 {
+	RIO_ASSERT(!consoleThread.getIsRunning(), "Console server still running, call shutdown()");
 }
 
 void ConsoleServer::listen(uint16_t port, bool wait)
@@ -21,6 +57,20 @@ void ConsoleServer::listen(uint16_t port, bool wait)
 	server.bind(port);
 	server.listen(5);
 
+#if RIO_CONSOLE_EPOLL
+	epollFd = epoll_create1(0);
+	RIO_ASSERT(epollFd != -1, "epoll_create1: errno = %d", errno);
+	wakeUpFd = eventfd(0, EFD_NONBLOCK);
+	RIO_ASSERT(wakeUpFd != -1, "eventfd: errno = %d", errno);
+
+	epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = nullptr;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, server.socket, &event);
+	event.data.ptr = &wakeUpFd;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeUpFd, &event);
+#endif // RIO_CONSOLE_EPOLL
+
 	if (wait)
 	{
 		AcceptResult acceptResult;
@@ -33,23 +83,76 @@ void ConsoleServer::listen(uint16_t port, bool wait)
 
 		addClient(client);
 	}
+
+	server.setBlocking(false);
+	consoleThread.start(ConsoleServer::threadProcedure, this);
 }
 
 void ConsoleServer::shutdown()
 {
-	for (uint32_t i = 0; i < VectorFn::getCount(clientList); ++i)
+	if (consoleThread.getIsRunning())
+	{
+		clientMutex.lock();
+		exitRequested = true;
+		clientMutex.unlock();
+		wakeUp();
+		consoleThread.stop();
+	}
+
+	while (ArrayFn::getCount(clientList) != 0)
 	{
-		clientList[i].close();
+		removeClient(ArrayFn::getCount(clientList) - 1);
+	}
+
+	// Commands nobody will run, the subsystems they act on may be gone already
+	const uint32_t end = uint32_t(commandEnd.load());
+	for (uint32_t i = uint32_t(commandBegin.load()); i != end; ++i)
+	{
+		allocator->deallocate(commandList[i & (RIO_CONSOLE_MAX_COMMANDS - 1)].json);
+	}
+	commandBegin.store(int32_t(end));
+	while (!QueueFn::getIsEmpty(pendingCommandList))
+	{
+		allocator->deallocate(QueueFn::front(pendingCommandList).json);
+		QueueFn::popFront(pendingCommandList);
 	}
 
 	server.close();
+
+#if RIO_CONSOLE_EPOLL
+	if (epollFd != -1)
+	{
+		close(epollFd);
+		close(wakeUpFd);
+		epollFd = -1;
+		wakeUpFd = -1;
+	}
+#endif // RIO_CONSOLE_EPOLL
 }
 
 void ConsoleServer::send(TcpSocket client, const char* json)
 {
-	uint32_t length = getStringLength32(json);
-	client.write(&length, 4);
-	client.write(json, length);
+	const uint32_t length = getStringLength32(json);
+	bool needToWakeUp = false;
+
+	clientMutex.lock();
+	for (uint32_t i = 0; i < ArrayFn::getCount(clientList); ++i)
+	{
+		Client& c = *clientList[i];
+		if (c.socket.socket == client.socket)
+		{
+			const bool wasEmpty = c.sendCount == 0;
+			push(c, json, length);
+			needToWakeUp = wasEmpty && c.sendCount != 0;
+			break;
+		}
+	}
+	clientMutex.unlock();
+
+	if (needToWakeUp)
+	{
+		wakeUp();
+	}
 }
 
 void ConsoleServer::error(TcpSocket client, const char* msg)
@@ -70,108 +173,380 @@ void ConsoleServer::success(TcpSocket client, const char* msg)
 
 void ConsoleServer::send(const char* json)
 {
-	for (uint32_t i = 0; i < VectorFn::getCount(clientList); ++i)
+	const uint32_t length = getStringLength32(json);
+	bool needToWakeUp = false;
+
+	clientMutex.lock();
+	for (uint32_t i = 0; i < ArrayFn::getCount(clientList); ++i)
+	{
+		Client& c = *clientList[i];
+		const bool wasEmpty = c.sendCount == 0;
+		push(c, json, length);
+		needToWakeUp = needToWakeUp || (wasEmpty && c.sendCount != 0);
+	}
+	clientMutex.unlock();
+
+	if (needToWakeUp)
 	{
-		send(clientList[i], json);
+		wakeUp();
 	}
 }
 
 void ConsoleServer::update()
+{
+	const uint32_t end = uint32_t(commandEnd.load());
+	for (uint32_t i = uint32_t(commandBegin.load()); i != end; ++i)
+	{
+		Command& command = commandList[i & (RIO_CONSOLE_MAX_COMMANDS - 1)];
+		command.commandFunction(*this, command.client, command.json);
+		allocator->deallocate(command.json);
+
+		// Gives the slot back to the console thread
+		commandBegin.fetchAdd(1);
+	}
+}
+
+void ConsoleServer::addClient(TcpSocket socket)
+{
+	socket.setBlocking(false);
+
+	Client* client = RIO_NEW(*allocator, Client)(*allocator);
+	client->socket = socket;
+	client->sendBuffer = (char*)allocator->allocate(RIO_CONSOLE_SEND_BUFFER_SIZE);
+
+#if RIO_CONSOLE_EPOLL
+	epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = client;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, socket.socket, &event);
+#endif // RIO_CONSOLE_EPOLL
+
+	ScopedMutex scopedMutex(clientMutex);
+	ArrayFn::pushBack(clientList, client);
+}
+
+void ConsoleServer::removeClient(uint32_t index)
+{
+	Client* client = clientList[index];
+
+#if RIO_CONSOLE_EPOLL
+	epoll_event event;
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, client->socket.socket, &event);
+#endif // RIO_CONSOLE_EPOLL
+
+	clientMutex.lock();
+	client->socket.close();
+	// swap with last idiom
+	clientList[index] = clientList[ArrayFn::getCount(clientList) - 1];
+	ArrayFn::popBack(clientList);
+	clientMutex.unlock();
+
+	allocator->deallocate(client->sendBuffer);
+	RIO_DELETE(*allocator, client);
+}
+
+void ConsoleServer::acceptClients()
 {
 	TcpSocket client;
-	AcceptResult acceptResult = server.acceptNonblock(client);
-	if (acceptResult.error == AcceptResult::NO_ERROR)
+	while (server.acceptInternal(client).error == AcceptResult::NO_ERROR)
 	{
 		addClient(client);
 	}
+}
 
-	TempAllocator256 alloc;
-	Array<uint32_t> toRemove(alloc);
-
-	// Update all clients
-	for (uint32_t i = 0; i < VectorFn::getCount(clientList); ++i)
+bool ConsoleServer::receive(Client& client)
+{
+	for (;;)
 	{
-		ReadResult readResult = updateClient(clientList[i]);
+		char buffer[4096];
+		const ReadResult readResult = client.socket.readInternal(buffer, sizeof(buffer));
+		ArrayFn::push(client.receiveBuffer, buffer, readResult.bytesRead);
+
 		if (readResult.error != ReadResult::NO_ERROR)
 		{
-			ArrayFn::pushBack(toRemove, i);
+			return false;
+		}
+		if (readResult.bytesRead < sizeof(buffer))
+		{
+			break;
 		}
 	}
 
-	// Remove clients
-	for (uint32_t i = 0; i < ArrayFn::getCount(toRemove); ++i)
+	// Each message is its length followed by the JSON string
+	char* data = ArrayFn::begin(client.receiveBuffer);
+	const uint32_t size = ArrayFn::getCount(client.receiveBuffer);
+	uint32_t offset = 0;
+	while (size - offset >= 4)
 	{
-		const uint32_t last = VectorFn::getCount(clientList) - 1;
-		const uint32_t clientIndex = toRemove[i];
+		uint32_t messageLength;
+		memcpy(&messageLength, data + offset, 4);
+		if (messageLength > RIO_CONSOLE_MAX_MESSAGE_SIZE)
+		{
+			return false;
+		}
+		if (size - offset - 4 < messageLength)
+		{
+			break;
+		}
 
-		clientList[clientIndex].close();
-		// swap with last idiom
-		clientList[clientIndex] = clientList[last];
-		VectorFn::popBack(clientList);
+		addCommand(client.socket, data + offset + 4, messageLength);
+		offset += 4 + messageLength;
 	}
-}
 
-void ConsoleServer::addClient(TcpSocket socket)
-{
-	VectorFn::pushBack(clientList, socket);
+	// Keep the bytes of the message still being received
+	memmove(data, data + offset, size - offset);
+	ArrayFn::resize(client.receiveBuffer, size - offset);
+	return true;
 }
 
-ReadResult ConsoleServer::updateClient(TcpSocket client)
+bool ConsoleServer::flush(Client& client)
 {
-	uint32_t messageLength = 0;
-	ReadResult readResult = client.readNonblock(&messageLength, 4);
+	ScopedMutex scopedMutex(clientMutex);
 
-	// If no data received, return
-	if (readResult.error == ReadResult::NO_ERROR && readResult.bytesRead == 0)
+	while (client.sendCount != 0)
 	{
-		return readResult;
-	}
-	if (readResult.error == ReadResult::REMOTE_CLOSED)
-	{
-		return readResult;
+		const uint32_t untilWrap = RIO_CONSOLE_SEND_BUFFER_SIZE - client.sendBegin;
+		const uint32_t size = client.sendCount < untilWrap ? client.sendCount : untilWrap;
+		const WriteResult writeResult = client.socket.writeInternal(client.sendBuffer + client.sendBegin, size);
+		client.sendBegin = (client.sendBegin + writeResult.bytesWritten) % RIO_CONSOLE_SEND_BUFFER_SIZE;
+		client.sendCount -= writeResult.bytesWritten;
+
+		if (writeResult.error != WriteResult::NO_ERROR)
+		{
+			return false;
+		}
+		// The socket takes no more for now
+		if (writeResult.bytesWritten < size)
+		{
+			break;
+		}
 	}
-	if (readResult.error != ReadResult::NO_ERROR)
+
+	// Resume when the socket can take more
+	const bool needToWaitWritable = client.sendCount != 0;
+	if (needToWaitWritable != client.isWaitingWritable)
 	{
-		return readResult;
+		client.isWaitingWritable = needToWaitWritable;
+#if RIO_CONSOLE_EPOLL
+		epoll_event event;
+		event.events = needToWaitWritable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+		event.data.ptr = &client;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, client.socket.socket, &event);
+#endif // RIO_CONSOLE_EPOLL
 	}
 
-	// Else read the message
-	TempAllocator4096 ta;
-	Array<char> messageBuffer(ta);
-	ArrayFn::resize(messageBuffer, messageLength);
-	ReadResult messageResult = client.read(ArrayFn::begin(messageBuffer), messageLength);
-	ArrayFn::pushBack(messageBuffer, '\0');
+	return true;
+}
+
+void ConsoleServer::push(Client& client, const char* json, uint32_t length)
+{
+	using namespace ConsoleServerInternalFn;
 
-	if (messageResult.error == ReadResult::REMOTE_CLOSED)
+	// Once full, keep dropping until half the buffer has been sent, then tell the client how many were dropped
+	if (client.droppedCount != 0)
 	{
-		return messageResult;
+		if (client.sendCount > RIO_CONSOLE_SEND_BUFFER_SIZE / 2)
+		{
+			++client.droppedCount;
+			return;
+		}
+
+		char notice[128];
+		const uint32_t noticeLength = uint32_t(snPrintF(notice
+			, sizeof(notice)
+			, "{\"type\":\"message\",\"severity\":\"warning\",\"message\":\"%u console messages dropped\"}"
+			, client.droppedCount
+			));
+
+		writeRing(client.sendBuffer, client.sendBegin, client.sendCount, &noticeLength, 4);
+		writeRing(client.sendBuffer, client.sendBegin, client.sendCount + 4, notice, noticeLength);
+		client.sendCount += 4 + noticeLength;
+		client.droppedCount = 0;
 	}
-	if (messageResult.error != ReadResult::NO_ERROR)
+
+	if (4 + length > RIO_CONSOLE_SEND_BUFFER_SIZE - client.sendCount)
 	{
-		return messageResult;
+		++client.droppedCount;
+		return;
 	}
 
-	process(client, ArrayFn::begin(messageBuffer));
-	return messageResult;
+	writeRing(client.sendBuffer, client.sendBegin, client.sendCount, &length, 4);
+	writeRing(client.sendBuffer, client.sendBegin, client.sendCount + 4, json, length);
+	client.sendCount += 4 + length;
 }
 
-void ConsoleServer::process(TcpSocket client, const char* json)
+void ConsoleServer::addCommand(TcpSocket client, const char* json, uint32_t length)
 {
+	char* jsonCopy = (char*)allocator->allocate(length + 1);
+	memcpy(jsonCopy, json, length);
+	jsonCopy[length] = '\0';
+
 	TempAllocator4096 ta;
 	JsonObject jsonObject(ta);
-	JsonRFn::parse(json, jsonObject);
+	JsonRFn::parse(jsonCopy, jsonObject);
 
 	CommandFunction commandFunction = SortMapFn::get(commandFunctionMap, JsonRFn::parseStringId(jsonObject["type"]), (CommandFunction)nullptr);
-	if (commandFunction != nullptr)
+	if (commandFunction == nullptr)
 	{
-		commandFunction(*this, client, json);
+		error(client, "Unknown command");
+		allocator->deallocate(jsonCopy);
+		return;
 	}
-	else
+
+	Command command;
+	command.client = client;
+	command.commandFunction = commandFunction;
+	command.json = jsonCopy;
+	QueueFn::pushBack(pendingCommandList, command);
+}
+
+void ConsoleServer::flushCommands()
+{
+	while (!QueueFn::getIsEmpty(pendingCommandList))
 	{
-		error(client, "Unknown command");
+		const uint32_t end = uint32_t(commandEnd.load());
+		if (end - uint32_t(commandBegin.load()) == RIO_CONSOLE_MAX_COMMANDS)
+		{
+			break;
+		}
+
+		commandList[end & (RIO_CONSOLE_MAX_COMMANDS - 1)] = QueueFn::front(pendingCommandList);
+		QueueFn::popFront(pendingCommandList);
+
+		// Hands the slot over to the main thread
+		commandEnd.fetchAdd(1);
 	}
 }
 
+void ConsoleServer::wakeUp()
+{
+#if RIO_CONSOLE_EPOLL
+	const uint64_t value = 1;
+	ssize_t bytesWritten = write(wakeUpFd, &value, sizeof(value));
+	RIO_UNUSED(bytesWritten);
+#endif // RIO_CONSOLE_EPOLL
+}
+
+int32_t ConsoleServer::run()
+{
+	ProfilerFn::setThreadName("console");
+
+	for (;;)
+	{
+		clientMutex.lock();
+		const bool exit = exitRequested;
+		clientMutex.unlock();
+		if (exit)
+		{
+			break;
+		}
+
+		// Retry soon when the main thread has yet to make room for the commands received
+		const bool hasPendingCommands = !QueueFn::getIsEmpty(pendingCommandList);
+
+#if RIO_CONSOLE_EPOLL
+		epoll_event eventList[32];
+		const int eventCount = epoll_wait(epollFd, eventList, RIO_COUNTOF(eventList), hasPendingCommands ? 10 : -1);
+		for (int i = 0; i < eventCount; ++i)
+		{
+			const epoll_event& event = eventList[i];
+			if (event.data.ptr == nullptr)
+			{
+				acceptClients();
+			}
+			else if (event.data.ptr == &wakeUpFd)
+			{
+				uint64_t value;
+				ssize_t bytesRead = read(wakeUpFd, &value, sizeof(value));
+				RIO_UNUSED(bytesRead);
+
+				for (uint32_t j = 0; j < ArrayFn::getCount(clientList); ++j)
+				{
+					Client& client = *clientList[j];
+					client.isClosed = client.isClosed || !flush(client);
+				}
+			}
+			else
+			{
+				Client& client = *(Client*)event.data.ptr;
+				if ((event.events & EPOLLIN) != 0 && !client.isClosed)
+				{
+					client.isClosed = !receive(client);
+				}
+				if ((event.events & EPOLLOUT) != 0 && !client.isClosed)
+				{
+					client.isClosed = !flush(client);
+				}
+				client.isClosed = client.isClosed || (event.events & EPOLLERR) != 0;
+			}
+		}
+#else
+		// Without a way to wake select() up, the send buffers are polled
+		fd_set readSet;
+		fd_set writeSet;
+		FD_ZERO(&readSet);
+		FD_ZERO(&writeSet);
+		FD_SET(server.socket, &readSet);
+		int maxFd = int(server.socket);
+
+		const uint32_t clientCount = ArrayFn::getCount(clientList);
+		clientMutex.lock();
+		for (uint32_t i = 0; i < clientCount; ++i)
+		{
+			FD_SET(clientList[i]->socket.socket, &readSet);
+			if (clientList[i]->sendCount != 0)
+			{
+				FD_SET(clientList[i]->socket.socket, &writeSet);
+			}
+			maxFd = int(clientList[i]->socket.socket) > maxFd ? int(clientList[i]->socket.socket) : maxFd;
+		}
+		clientMutex.unlock();
+
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 10 * 1000;
+		if (select(maxFd + 1, &readSet, &writeSet, NULL, &timeout) > 0)
+		{
+			for (uint32_t i = 0; i < clientCount; ++i)
+			{
+				Client& client = *clientList[i];
+				if (FD_ISSET(client.socket.socket, &readSet))
+				{
+					client.isClosed = !receive(client);
+				}
+				if (FD_ISSET(client.socket.socket, &writeSet) && !client.isClosed)
+				{
+					client.isClosed = !flush(client);
+				}
+			}
+
+			if (FD_ISSET(server.socket, &readSet))
+			{
+				acceptClients();
+			}
+		}
+#endif // RIO_CONSOLE_EPOLL
+
+		// Closed clients are removed after the events which may still point to them
+		for (uint32_t i = ArrayFn::getCount(clientList); i > 0; --i)
+		{
+			if (clientList[i - 1]->isClosed)
+			{
+				removeClient(i - 1);
+			}
+		}
+
+		flushCommands();
+	}
+
+	return 0;
+}
+
+int32_t ConsoleServer::threadProcedure(void* thiz)
+{
+	return ((ConsoleServer*)thiz)->run();
+}
+
 void ConsoleServer::registerCommand(const char* type, CommandFunction commandFunction)
 {
 	RIO_ASSERT_NOT_NULL(type);
@@ -1,28 +1,64 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #pragma once
 
+#include "Config.h"
 #include "Core/Containers/ContainerTypes.h"
 #include "Core/Network/Socket.h"
 #include "Core/Strings/StringTypes.h"
+#include "Core/Thread/AtomicInt.h"
+#include "Core/Thread/Mutex.h"
+#include "Core/Thread/Thread.h"
+
+#define RIO_CONSOLE_EPOLL (RIO_PLATFORM_LINUX || RIO_PLATFORM_ANDROID)
 
 namespace Rio
 {
 
 // Provides the service to communicate with engine via TCP/IP
+// The clients are served by a thread of their own, the main thread only runs the commands they sent
 class ConsoleServer
 {
 private:
 	using CommandFunction = void (*)(ConsoleServer& consoleServer, TcpSocket client, const char* json);
+
+	struct Client
+	{
+		Client(Allocator& a)
+			: receiveBuffer(a)
+		{
+		}
+
+		TcpSocket socket;
+		Array<char> receiveBuffer; // Bytes of the messages not received in full yet
+		char* sendBuffer = nullptr; // Ring buffer of the messages to send
+		uint32_t sendBegin = 0;
+		uint32_t sendCount = 0;
+		uint32_t droppedCount = 0; // Messages which did not fit in <sendBuffer>
+		bool isWaitingWritable = false;
+		bool isClosed = false; // Removed by the console thread once done with its events
+	};
+
+	// A command received from <client>, <json> is owned by the queue
+	struct Command
+	{
+		TcpSocket client;
+		CommandFunction commandFunction;
+		char* json;
+	};
 public:
 	ConsoleServer(Allocator& a);
+	~ConsoleServer();
 	// If <wait> is true, this function blocks until a client is connected
 	void listen(uint16_t port, bool wait);
+	// Stops the console thread and closes the connections, the commands not run yet are dropped
+	// Can be called again once shut down
 	void shutdown();
-	// Collects requests from clients and processes them all
+	// Runs the commands received from clients since the last call
 	void update();
 	// Sends JSON-encoded string to all clients
 	void send(const char* json);
 	// Sends JSON-encoded string to <client>
+	// Returns right away, messages which do not fit in the send buffer of a slow client are dropped
 	void send(TcpSocket client, const char* json);
 	// Sends the error message to <client>
 	void error(TcpSocket client, const char* msg);
@@ -32,12 +68,41 @@ public:
 	void registerCommand(const char* type, CommandFunction commandFunction);
 private:
 	void addClient(TcpSocket socket);
-	ReadResult updateClient(TcpSocket client);
-	void process(TcpSocket client, const char* json);
+	void removeClient(uint32_t index);
+	void acceptClients();
+	// Reads what <client> sent and queues the commands received in full
+	// Returns false if the connection has been closed
+	bool receive(Client& client);
+	// Writes as much of the send buffer of <client> as the socket takes
+	// Returns false if the connection has been closed
+	bool flush(Client& client);
+	// Appends the message <json> to the send buffer of <client>, <clientMutex> must be locked
+	void push(Client& client, const char* json, uint32_t length);
+	void addCommand(TcpSocket client, const char* json, uint32_t length);
+	// Moves the commands waiting for room to the command queue
+	void flushCommands();
+	void wakeUp();
+	int32_t run();
+	static int32_t threadProcedure(void* thiz);
 
+	Allocator* allocator;
 	TcpSocket server;
-	Vector<TcpSocket> clientList;
+	Array<Client*> clientList; // Changed by the console thread with <clientMutex> locked
 	SortMap<StringId32, CommandFunction> commandFunctionMap;
+
+	// Single producer, single consumer queue from the console thread to the main thread
+	Command commandList[RIO_CONSOLE_MAX_COMMANDS];
+	AtomicInt commandBegin;
+	AtomicInt commandEnd;
+	Queue<Command> pendingCommandList; // Received while the queue was full
+
+	Thread consoleThread;
+	Mutex clientMutex; // Guards <clientList> and the send buffers
+	bool exitRequested = false;
+#if RIO_CONSOLE_EPOLL
+	int epollFd = -1;
+	int wakeUpFd = -1;
+#endif // RIO_CONSOLE_EPOLL
 };
 
 } // namespace Rio
@@ -16,12 +16,15 @@
 #if RIO_PLATFORM_ANDROID
 #include "Core/FileSystem/Android/FileSystemApk_Android.h"
 #endif //RIO_PLATFORM_ANDROID
+#include "Core/Memory/AllocationTracker.h"
 #include "Core/Memory/Memory.h"
 #include "Core/Memory/ProxyAllocator.h"
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Map.h"
+#include "Core/Math/MathUtils.h"
 #include "Core/Math/Matrix4x4.h"
 
+#include "Device/Benchmark.h"
 #include "Device/DeviceEventQueue.h"
 #include "Device/ConsoleServer.h"
 #include "Device/ConsoleApi.h"
@@ -43,6 +46,7 @@
 #include "Resource/ShaderResource.h"
 #include "Resource/PhysicsResource.h"
 #include "Resource/TextureResource.h"
+#include "Resource/TextureStreamer.h"
 #include "Resource/ResourceLoader.h"
 #include "Resource/ResourceManager.h"
 #include "Resource/ResourcePackage.h"
@@ -144,11 +148,104 @@ private:
 	ProxyAllocator allocator;
 };
 
+// Stands in for the platform display when the device runs headless
+struct HeadlessDisplay : public Display
+{
+	void getModes(Array<DisplayMode>& /*modes*/)
+	{
+	}
+
+	void setMode(uint32_t /*id*/)
+	{
+	}
+};
+
+// Stands in for the platform window when the device runs headless
+struct HeadlessWindow : public Window
+{
+	HeadlessWindow()
+	{
+		title[0] = '\0';
+	}
+
+	void open(uint16_t /*x*/, uint16_t /*y*/, uint16_t /*width*/, uint16_t /*height*/, uint32_t /*parent*/)
+	{
+	}
+
+	void close()
+	{
+	}
+
+	void show()
+	{
+	}
+
+	void hide()
+	{
+	}
+
+	void resize(uint16_t /*width*/, uint16_t /*height*/)
+	{
+	}
+
+	void move(uint16_t /*x*/, uint16_t /*y*/)
+	{
+	}
+
+	void minimize()
+	{
+	}
+
+	void restore()
+	{
+	}
+
+	const char* getTitle()
+	{
+		return title;
+	}
+
+	void setTitle(const char* title)
+	{
+		strncpy(this->title, title, sizeof(this->title) - 1);
+		this->title[sizeof(this->title) - 1] = '\0';
+	}
+
+	void* getHandle()
+	{
+		return nullptr;
+	}
+
+	void setShowCursor(bool /*show*/)
+	{
+	}
+
+	void setFullscreen(bool /*isFullscreen*/)
+	{
+	}
+
+	void setupBgfx()
+	{
+	}
+
+	char title[512];
+};
+
+// Input is what an input log records and replays, window and exit events always come from the platform
+static bool getIsInputEvent(const OsEvent& ev)
+{
+	return ev.type == OsEventType::BUTTON
+		|| ev.type == OsEventType::AXIS
+		|| ev.type == OsEventType::STATUS
+		;
+}
+
 Device::Device(const DeviceOptions& deviceOptions)
 	: allocator(getDefaultAllocator(), MAX_SUBSYSTEMS_HEAP)
 	, deviceOptions(deviceOptions)
 	, bootConfig(getDefaultAllocator())
 	, worldList(getDefaultAllocator())
+	, inputLogEventList(getDefaultAllocator())
 {
 }
 
@@ -173,13 +270,119 @@ void Device::readConfig()
 	resourceManager->unload(RESOURCE_TYPE_CONFIG, configFileName);
 }
 
+bool Device::getNextInputEvent(OsEvent& ev)
+{
+	if (deviceOptions.inputLogPath != nullptr)
+	{
+		// Replays the input recorded for the current frame, ignores the platform input
+		OsEvent platformEvent;
+		while (getNextEvent(platformEvent))
+		{
+			if (getIsInputEvent(platformEvent) == false)
+			{
+				ev = platformEvent;
+				return true;
+			}
+		}
+
+		if (inputLogPosition == ArrayFn::getCount(inputLogEventList)
+			|| inputLogEventList[inputLogPosition].frame != (uint32_t)frameCount)
+		{
+			return false;
+		}
+
+		ev = inputLogEventList[inputLogPosition++].event;
+		return true;
+	}
+
+	if (!getNextEvent(ev))
+	{
+		return false;
+	}
+
+	if (deviceOptions.recordInputLogPath != nullptr && getIsInputEvent(ev) == true)
+	{
+		InputLogEvent inputLogEvent;
+		inputLogEvent.frame = (uint32_t)frameCount;
+		inputLogEvent.event = ev;
+		ArrayFn::pushBack(inputLogEventList, inputLogEvent);
+	}
+
+	return true;
+}
+
+void Device::loadInputLog(const char* path)
+{
+	File* file = bundleFileSystem->open(path, FileOpenMode::READ);
+	const uint32_t size = file->getSize();
+	RIO_ASSERT(size % sizeof(InputLogEvent) == 0, "Input log '%s' is corrupted", path);
+
+	ArrayFn::resize(inputLogEventList, size / sizeof(InputLogEvent));
+	file->read(ArrayFn::begin(inputLogEventList), size);
+	bundleFileSystem->close(*file);
+
+	inputLogPosition = 0;
+	RIO_LOGI("Replaying %u input events from '%s'", ArrayFn::getCount(inputLogEventList), path);
+}
+
+void Device::saveInputLog(const char* path)
+{
+	File* file = bundleFileSystem->open(path, FileOpenMode::WRITE);
+	file->write(ArrayFn::begin(inputLogEventList), ArrayFn::getCount(inputLogEventList) * sizeof(InputLogEvent));
+	bundleFileSystem->close(*file);
+
+	RIO_LOGI("Input log written to '%s'", path);
+}
+
+void Device::respawnBenchmarkUnits(Array<UnitId>& unitIdList)
+{
+	for (uint32_t i = 0; i < ArrayFn::getCount(unitIdList); ++i)
+	{
+		benchmarkWorld->destroyUnit(unitIdList[i]);
+	}
+
+	// A square grid of copies, one meter apart
+	const uint32_t count = deviceOptions.benchmarkSpawnCount;
+	const uint32_t side = uint32_t(sqrtf(float(count))) + 1;
+
+	Array<Vector3> positionList(getDefaultAllocator());
+	Array<Quaternion> rotationList(getDefaultAllocator());
+	ArrayFn::resize(positionList, count);
+	ArrayFn::resize(rotationList, count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		positionList[i] = createVector3(float(i % side), 0.0f, float(i / side));
+		rotationList[i] = QUATERNION_IDENTITY;
+	}
+
+	ArrayFn::resize(unitIdList, count);
+	benchmarkWorld->spawnUnits(StringId64(deviceOptions.benchmarkSpawnUnit)
+		, count
+		, ArrayFn::begin(positionList)
+		, ArrayFn::begin(rotationList)
+		, ArrayFn::begin(unitIdList)
+		);
+}
+
+void Device::writeBenchmarkReport()
+{
+	StringStream json(getDefaultAllocator());
+	BenchmarkGlobalFn::writeReport(json, deviceOptions.benchmarkLevel);
+
+	File* file = bundleFileSystem->open(deviceOptions.benchmarkReport, FileOpenMode::WRITE);
+	file->write(ArrayFn::begin(json), ArrayFn::getCount(json));
+	bundleFileSystem->close(*file);
+
+	RIO_LOGI("Benchmark report written to '%s'", deviceOptions.benchmarkReport);
+}
+
 bool Device::processEvents(int16_t& mouseX, int16_t& mouseY, int16_t& mouseLastX, int16_t& mouseLastY, bool isVsyncEnabled)
 {
 	bool exit = false;
 	bool reset = false;
 
 	OsEvent event;
-	while (getNextEvent(event))
+	while (getNextInputEvent(event))
 	{
 		if (event.type == OsEventType::NONE)
 		{
@@ -378,9 +581,11 @@ void Device::run()
 
 		lastLogFile = bundleFileSystem->open(RIO_LAST_LOG, FileOpenMode::WRITE);
 #endif // RIO_PLATFORM_ANDROID
+		LogGlobalFn::init();
 		RIO_LOGI("Initializing Rio Engine %s...", getVersion());
 
 		ProfilerGlobalFn::init();
+		ProfilerFn::setThreadName("main");
 
 		resourceLoader = RIO_NEW(allocator, ResourceLoader)(*bundleFileSystem);
 		resourceManager = RIO_NEW(allocator, ResourceManager)(*resourceLoader);
@@ -409,25 +614,40 @@ void Device::run()
 		bgfxAllocator = RIO_NEW(allocator, BgfxAllocator)(getDefaultAllocator());
 		bgfxCallback = RIO_NEW(allocator, BgfxCallback)();
 
-		mainDisplay = DisplayFn::create(allocator);
-		mainWindow = WindowFn::create(allocator);
-		mainWindow->open(deviceOptions.windowX
-			, deviceOptions.windowY
-			, bootConfig.windowWidth
-			, bootConfig.windowHeight
-			, deviceOptions.parentWindow
-			);
-		mainWindow->setTitle(bootConfig.windowTitle.getCStr());
-		mainWindow->setFullscreen(bootConfig.isFullscreen);
-		mainWindow->setupBgfx();
+		const bool isBenchmark = deviceOptions.benchmarkLevel != nullptr;
 
-		bgfx::init(bgfx::RendererType::Count
+		// The benchmark runs headless
+		if (isBenchmark == true)
+		{
+			mainDisplay = RIO_NEW(allocator, HeadlessDisplay)();
+			mainWindow = RIO_NEW(allocator, HeadlessWindow)();
+			mainWindow->setTitle(bootConfig.windowTitle.getCStr());
+			width = bootConfig.windowWidth;
+			height = bootConfig.windowHeight;
+		}
+		else
+		{
+			mainDisplay = DisplayFn::create(allocator);
+			mainWindow = WindowFn::create(allocator);
+			mainWindow->open(deviceOptions.windowX
+				, deviceOptions.windowY
+				, bootConfig.windowWidth
+				, bootConfig.windowHeight
+				, deviceOptions.parentWindow
+				);
+			mainWindow->setTitle(bootConfig.windowTitle.getCStr());
+			mainWindow->setFullscreen(bootConfig.isFullscreen);
+			mainWindow->setupBgfx();
+		}
+
+		bgfx::init(isBenchmark ? bgfx::RendererType::Null : bgfx::RendererType::Count
 			, BGFX_PCI_ID_NONE
 			, 0
 			, bgfxCallback
 			, bgfxAllocator
 			);
 
+		textureStreamer = RIO_NEW(allocator, TextureStreamer)(*bundleFileSystem, RIO_TEXTURE_STREAMING_BUDGET);
 		shaderManager = RIO_NEW(allocator, ShaderManager)(getDefaultAllocator());
 		materialManager = RIO_NEW(allocator, MaterialManager)(getDefaultAllocator(), *resourceManager);
 		inputManager = RIO_NEW(allocator, InputManager)(getDefaultAllocator());
@@ -446,10 +666,29 @@ void Device::run()
 
 		scriptEnvironment->loadScriptLibraries();
 		scriptEnvironment->execute((ScriptResource*)resourceManager->get(RESOURCE_TYPE_SCRIPT, bootConfig.bootScriptName));
+		if (deviceOptions.inputLogPath != nullptr)
+		{
+			loadInputLog(deviceOptions.inputLogPath);
+		}
+
+		if (isBenchmark == true)
+		{
+			const StringId64 levelName(deviceOptions.benchmarkLevel);
+			RIO_ASSERT(resourceManager->canGet(RESOURCE_TYPE_LEVEL, levelName), "Benchmark level '%s' not found in the boot package", deviceOptions.benchmarkLevel);
+
+			benchmarkWorld = createWorld();
+			benchmarkWorld->loadLevel(levelName, VECTOR3_ZERO, QUATERNION_IDENTITY);
+			BenchmarkGlobalFn::init(getDefaultAllocator(), deviceOptions.benchmarkFrameCount);
+			MemoryGlobalFn::resetPeakAllocatedBytes();
+		}
+
 		scriptEnvironment->callGlobalFunction("init", 0);
 
 		RIO_LOGD("Engine initialized");
 
+		// Units respawned every frame of the spawn benchmark
+		Array<UnitId> benchmarkUnitList(getDefaultAllocator());
+
 		int16_t mouse_x = 0;
 		int16_t mouse_y = 0;
 		int16_t mouse_last_x = 0;
@@ -464,26 +703,60 @@ void Device::run()
 			const int64_t time = currentTime - lastTime;
 			lastTime = currentTime;
 			const double frequency = static_cast<double>(OsFn::getClockFrequency());
-			lastDeltaTime = float(time * (1.0 / frequency));
+			// The benchmark uses a fixed timestep so that runs are comparable
+			lastDeltaTime = isBenchmark ? 1.0f / 60.0f : float(time * (1.0 / frequency));
 			timeSinceStart += lastDeltaTime;
 
+			{
+				PROFILE_SCOPE("console.update");
+				// Console commands still see the events of the previous frame
+				consoleServer->update();
+			}
 			ProfilerGlobalFn::clear();
-			consoleServer->update();
 
 			RECORD_FLOAT("device.dt", lastDeltaTime);
 			RECORD_FLOAT("device.fps", 1.0f/ lastDeltaTime);
 
 			if (paused == false)
 			{
-				resourceManager->completeRequests();
+				{
+					PROFILE_SCOPE("resource.completeRequests");
+					resourceManager->completeRequests();
+				}
+
+				{
+					PROFILE_SCOPE("lua.coroutines");
+					scriptEnvironment->updateCoroutines(getLastDeltaTime());
+				}
 
 				{
+					PROFILE_SCOPE("lua.update");
+					BenchmarkScope benchmarkScope(BenchmarkCounter::SCRIPT_UPDATE);
 					const int64_t t0 = OsFn::getClockTime();
 					scriptEnvironment->callGlobalFunction("update", 1, ARGUMENT_FLOAT, getLastDeltaTime());
 					const int64_t t1 = OsFn::getClockTime();
 					RECORD_FLOAT("lua.update", static_cast<float>((t1 - t0)*(1.0 / frequency)));
 				}
+				if (benchmarkWorld != nullptr)
 				{
+					if (deviceOptions.benchmarkSpawnUnit != nullptr)
+					{
+						respawnBenchmarkUnits(benchmarkUnitList);
+					}
+
+					benchmarkWorld->update(getLastDeltaTime());
+
+					// Renders from the first camera of the level, if any
+					if (benchmarkWorld->cameraGetCount() != 0)
+					{
+						const CameraInstance camera = { 0 };
+						render(*benchmarkWorld, camera);
+					}
+				}
+
+				{
+					PROFILE_SCOPE("lua.render");
+					BenchmarkScope benchmarkScope(BenchmarkCounter::SCRIPT_RENDER);
 					const int64_t t0 = OsFn::getClockTime();
 					scriptEnvironment->callGlobalFunction("render", 1, ARGUMENT_FLOAT, getLastDeltaTime());
 					const int64_t t1 = OsFn::getClockTime();
@@ -491,22 +764,67 @@ void Device::run()
 				}
 			}
 
+			{
+				PROFILE_SCOPE("lua.gc");
+				scriptEnvironment->collectGarbage(RIO_SCRIPT_GC_BUDGET);
+			}
+
 			inputManager->update();
 
+			{
+				PROFILE_SCOPE("textureStreamer.update");
+				textureStreamer->update();
+			}
+
 			const bgfx::Stats* stats = bgfx::getStats();
 			RECORD_FLOAT("bgfx.gpu_time", float(double(stats->gpuTimeEnd - stats->gpuTimeBegin)*1000.0/stats->gpuTimerFreq));
 			RECORD_FLOAT("bgfx.cpu_time", float(double(stats->cpuTimeEnd - stats->cpuTimeBegin)*1000.0/stats->cpuTimerFreq));
+			BenchmarkFn::addTime(BenchmarkCounter::BGFX_CPU, double(stats->cpuTimeEnd - stats->cpuTimeBegin)/stats->cpuTimerFreq);
 
-			bgfx::frame();
+			{
+				PROFILE_SCOPE("bgfx.frame");
+				bgfx::frame();
+			}
 			ProfilerGlobalFn::flush();
+			ProxyAllocatorGlobalFn::updateFrame();
+			AllocationTrackerGlobalFn::updateFrame();
 
 			scriptEnvironment->resetTemporaryTypes();
 
+			if (isBenchmark == true)
+			{
+				BenchmarkFn::addTime(BenchmarkCounter::FRAME, double(OsFn::getClockTime() - currentTime) / frequency);
+				// Sampled by the heap on every allocation, the end of the frame misses transient peaks
+				BenchmarkGlobalFn::endFrame(MemoryGlobalFn::getPeakAllocatedBytes());
+				MemoryGlobalFn::resetPeakAllocatedBytes();
+				quitRequested = BenchmarkGlobalFn::getFrameCount() == deviceOptions.benchmarkFrameCount;
+			}
+
 			frameCount++;
 		}
 
+		if (isBenchmark == true)
+		{
+			writeBenchmarkReport();
+			BenchmarkGlobalFn::shutdown();
+		}
+
+		if (deviceOptions.recordInputLogPath != nullptr)
+		{
+			saveInputLog(deviceOptions.recordInputLogPath);
+		}
+
+		// No command may run against the subsystems destroyed below
+		consoleServer->shutdown();
+
 		scriptEnvironment->callGlobalFunction("shutdown", 0);
 
+		if (benchmarkWorld != nullptr)
+		{
+			destroyWorld(*benchmarkWorld);
+			benchmarkWorld = nullptr;
+		}
+
 		bootResourcePackage->unload();
 		destroyResourcePackage(*bootResourcePackage);
 
@@ -523,17 +841,30 @@ void Device::run()
 		RIO_DELETE(allocator, shaderManager);
 		RIO_DELETE(allocator, resourceManager);
 		RIO_DELETE(allocator, resourceLoader);
+		RIO_DELETE(allocator, textureStreamer);
 
 		bgfx::shutdown();
-		mainWindow->close();
-		WindowFn::destroy(allocator, *mainWindow);
-		DisplayFn::destroy(allocator, *mainDisplay);
+		if (isBenchmark == true)
+		{
+			RIO_DELETE(allocator, (HeadlessWindow*)mainWindow);
+			RIO_DELETE(allocator, (HeadlessDisplay*)mainDisplay);
+		}
+		else
+		{
+			mainWindow->close();
+			WindowFn::destroy(allocator, *mainWindow);
+			DisplayFn::destroy(allocator, *mainDisplay);
+		}
 		RIO_DELETE(allocator, bgfxCallback);
 		RIO_DELETE(allocator, bgfxAllocator);
 
+		// Other threads have stopped, nothing logs into the queue any more
+		LogGlobalFn::shutdown();
+
 		if (lastLogFile != nullptr)
 		{
 			bundleFileSystem->close(*lastLogFile);
+			lastLogFile = nullptr;
 		}
 
 		RIO_DELETE(allocator, bundleFileSystem);
@@ -544,6 +875,7 @@ void Device::run()
 	RIO_DELETE(allocator, dataCompiler);
 	consoleServer->shutdown();
 	RIO_DELETE(allocator, consoleServer);
+	consoleServer = nullptr;
 	allocator.clear();
 }
 
@@ -681,6 +1013,12 @@ ResourcePackage* Device::createResourcePackage(StringId64 id)
 
 void Device::destroyResourcePackage(ResourcePackage& rp)
 {
+	// Coroutines and levels waiting for the package must not look at it again
+	scriptEnvironment->failWaitForPackage(&rp);
+	for (uint32_t i = 0; i < ArrayFn::getCount(worldList); ++i)
+	{
+		worldList[i]->failWaitForPackage(&rp);
+	}
 	RIO_DELETE(getDefaultAllocator(), &rp);
 }
 
@@ -726,7 +1064,6 @@ void Device::log(const char* msg, LogSeverity::Enum severity)
 	{
 		lastLogFile->write(msg, getStringLength32(msg));
 		lastLogFile->write("\n", 1);
-		lastLogFile->flush();
 	}
 
 	if (consoleServer != nullptr)
@@ -743,6 +1080,14 @@ void Device::log(const char* msg, LogSeverity::Enum severity)
 	}
 }
 
+void Device::flushLog()
+{
+	if (lastLogFile != nullptr)
+	{
+		lastLogFile->flush();
+	}
+}
+
 ConsoleServer* Device::getConsoleServer()
 {
 	return consoleServer;
@@ -753,11 +1098,21 @@ DataCompiler* Device::getDataCompiler()
 	return dataCompiler;
 }
 
+FileSystem* Device::getFileSystem()
+{
+	return bundleFileSystem;
+}
+
 ResourceManager* Device::getResourceManager()
 {
 	return resourceManager;
 }
 
+TextureStreamer* Device::getTextureStreamer()
+{
+	return textureStreamer;
+}
+
 ScriptEnvironment* Device::getScriptEnvironment()
 {
 	return scriptEnvironment;
@@ -783,6 +1138,11 @@ UnitManager* Device::getUnitManager()
 	return unitManager;
 }
 
+World* Device::getBenchmarkWorld()
+{
+	return benchmarkWorld;
+}
+
 Display& Device::getMainDisplay()
 {
 	return *mainDisplay;
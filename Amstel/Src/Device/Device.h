@@ -30,6 +30,8 @@ namespace Rio
 
 struct BgfxAllocator;
 struct BgfxCallback;
+struct InputLogEvent;
+union OsEvent;
 
 // This is the place where to look for accessing all of the engine subsystems
 class Device
@@ -76,11 +78,15 @@ public:
 	void reload(StringId64 type, StringId64 name);
 	// Logs <message> to log file and console
 	void log(const char* message, LogSeverity::Enum severity);
+	// Writes the lines logged so far to the log file
+	void flushLog();
 
 	// Getters
 	ConsoleServer* getConsoleServer();
 	DataCompiler* getDataCompiler();
+	FileSystem* getFileSystem();
 	ResourceManager* getResourceManager();
+	TextureStreamer* getTextureStreamer();
 	ScriptEnvironment* getScriptEnvironment();
 	InputManager* getInputManager();
 	ShaderManager* getShaderManager();
@@ -89,6 +95,8 @@ public:
 
 	Display& getMainDisplay();
 	Window* getMainWindow();
+	// Returns the world running the benchmark level or nullptr if not in benchmark mode
+	World* getBenchmarkWorld();
 private:
 	// Disable copying
 	Device(const Device&) = delete;
@@ -96,6 +104,13 @@ private:
 private:
 	void readConfig();
 	bool processEvents(int16_t& mouseX, int16_t& mouseY, int16_t& mouseLastX, int16_t& mouseLastY, bool isVsyncEnabled);
+	// Returns the next event from the OS or from the input log being replayed
+	bool getNextInputEvent(OsEvent& ev);
+	void loadInputLog(const char* path);
+	void saveInputLog(const char* path);
+	void writeBenchmarkReport();
+	// Destroys the units in <unitIdList> and spawns the copies of the benchmark unit in their place
+	void respawnBenchmarkUnits(Array<UnitId>& unitIdList);
 
 	LinearAllocator allocator;
 	const DeviceOptions& deviceOptions;
@@ -107,6 +122,7 @@ private:
 	File* lastLogFile = nullptr;
 	ResourceLoader* resourceLoader = nullptr;
 	ResourceManager* resourceManager = nullptr;
+	TextureStreamer* textureStreamer = nullptr;
 	BgfxAllocator* bgfxAllocator = nullptr;
 	BgfxCallback* bgfxCallback = nullptr;
 	ShaderManager* shaderManager = nullptr;
@@ -123,6 +139,11 @@ private:
 	uint16_t configWindowHeight = RIO_DEFAULT_WINDOW_HEIGHT;
 
 	Array<World*> worldList;
+	World* benchmarkWorld = nullptr;
+
+	// Events replayed from, or recorded to, an input log
+	Array<InputLogEvent> inputLogEventList;
+	uint32_t inputLogPosition = 0;
 
 	uint16_t width = 0;
 	uint16_t height = 0;
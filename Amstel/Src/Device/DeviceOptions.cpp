@@ -36,6 +36,14 @@ static void help(const char* message = nullptr)
 		"  --waitForConsole           Wait for a console connection before starting up.\n"
 		"  --parentWindow <handle>    Set the parent window <handle> of the main window.\n"
 		"  --server                   Run the engine in server mode.\n"
+		"  --benchmark <level>        Run <level> headless with a fixed timestep and write a timing report.\n"
+		"                             The level must be part of the boot package.\n"
+		"  --frames <count>           Run the benchmark for <count> frames.\n"
+		"  --report <path>            Write the benchmark report to <path>.\n"
+		"  --spawn <unit>             Respawn copies of <unit> every frame of the benchmark.\n"
+		"  --spawnCount <count>       Respawn <count> copies of the unit every frame.\n"
+		"  --inputLog <path>          Replay the input events recorded in <path>.\n"
+		"  --recordInputLog <path>    Record the input events to <path>.\n"
 	);
 
 	if (message != nullptr)
@@ -183,6 +191,40 @@ int DeviceOptions::parse()
 		}
 	}
 
+	benchmarkLevel = commandLine.getParameter(0, "benchmark");
+	if (benchmarkLevel != nullptr)
+	{
+		const char* frames = commandLine.getParameter(0, "frames");
+		if (frames != nullptr)
+		{
+			if (sscanf(frames, "%u", &benchmarkFrameCount) != 1 || benchmarkFrameCount == 0)
+			{
+				help("Frame count is invalid.");
+				return EXIT_FAILURE;
+			}
+		}
+
+		const char* report = commandLine.getParameter(0, "report");
+		if (report != nullptr)
+		{
+			benchmarkReport = report;
+		}
+
+		benchmarkSpawnUnit = commandLine.getParameter(0, "spawn");
+		const char* spawnCount = commandLine.getParameter(0, "spawnCount");
+		if (spawnCount != nullptr)
+		{
+			if (sscanf(spawnCount, "%u", &benchmarkSpawnCount) != 1 || benchmarkSpawnCount == 0)
+			{
+				help("Spawn count is invalid.");
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	inputLogPath = commandLine.getParameter(0, "inputLog");
+	recordInputLogPath = commandLine.getParameter(0, "recordInputLog");
+
 	return EXIT_SUCCESS;
 }
 
@@ -23,6 +23,13 @@ struct DeviceOptions
 	const char* dataDirectory = nullptr;
 	const char* bootDirectory = nullptr;
 	const char* platformName = nullptr;
+	const char* benchmarkLevel = nullptr;
+	const char* benchmarkReport = "Benchmark.json";
+	const char* benchmarkSpawnUnit = nullptr;
+	const char* inputLogPath = nullptr;
+	const char* recordInputLogPath = nullptr;
+	uint32_t benchmarkFrameCount = 1000;
+	uint32_t benchmarkSpawnCount = 1000;
 	bool needToWaitForConsole = false;
 	bool needToCompile = false;
 	bool doContinue = false;
@@ -763,6 +763,12 @@ int main(int argumentListCount, char** argumentList)
 	{
 		return EXIT_FAILURE;
 	}
+	if (deviceOptions.benchmarkLevel != nullptr)
+	{
+		// Headless, no X11 connection needed
+		Rio::run(deviceOptions);
+		return EXIT_SUCCESS;
+	}
 	return linuxDevice.run(&deviceOptions);
 }
 
@@ -1,28 +1,59 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Device/Log.h"
 
+#include "Config.h"
 #include "Core/Base/Os.h"
 #include "Core/Base/Platform.h"
+#include "Core/Memory/Memory.h"
+#include "Core/Thread/AtomicInt.h"
 #include "Core/Thread/Mutex.h"
+#include "Core/Thread/Thread.h"
 #include "Core/Strings/StringUtils.h"
 #include "Core/Memory/TempAllocator.h"
 #include "Device/Device.h"
+#include "Device/Profiler.h"
+
+#if RIO_PLATFORM_POSIX
+	#include <signal.h> // sigaction, raise
+#endif // RIO_PLATFORM_POSIX
+
+#include <string.h> // memcpy
 
 namespace Rio
 {
 
+RIO_STATIC_ASSERT((RIO_LOG_MAX_RECORDS & (RIO_LOG_MAX_RECORDS - 1)) == 0);
+RIO_STATIC_ASSERT(RIO_LOG_MESSAGE_SIZE % RIO_LOG_RECORD_SIZE == 0);
+RIO_STATIC_ASSERT(RIO_LOG_MESSAGE_SIZE / RIO_LOG_RECORD_SIZE <= RIO_LOG_MAX_RECORDS);
+
 namespace LogInternalFn
 {
+	// A log line formatted by the thread which logged it
+	// Longer lines continue in the next records, only the first one has <severity> and <recordCount>
+	struct LogRecord
+	{
+		AtomicInt sequence; // Index of the record plus one once written, free when equal to the index
+		LogSeverity::Enum severity;
+		uint32_t recordCount; // Records the line takes
+		char message[RIO_LOG_RECORD_SIZE];
+	};
+
 	static Mutex mutex;
+	static AtomicInt enabledSeverityMask((1 << LogSeverity::COUNT) - 1);
 
-	void logEx(LogSeverity::Enum sev, const char* msg, va_list args)
-	{
-		ScopedMutex scopedMutex(mutex);
+	// Lock-free ring of log lines, any thread appends, the log thread consumes
+	static LogRecord* recordList = nullptr;
+	static AtomicInt recordEnd(0);
+	static uint32_t recordBegin = 0; // Owned by whoever holds <isConsuming>
+	static AtomicInt isConsuming(0);
+	static AtomicInt droppedCount(0);
 
-		char buffer[8192];
-		int length = vsnPrintF(buffer, sizeof(buffer), msg, args);
-		buffer[length] = '\0';
+	static AtomicInt isRunning(0);
+	static AtomicInt exitRequested(0);
+	static Thread logThread;
 
+	static void write(LogSeverity::Enum sev, const char* message)
+	{
 #if RIO_PLATFORM_POSIX
 		#define ANSI_RESET  "\x1b[0m"
 		#define ANSI_YELLOW "\x1b[33m"
@@ -37,16 +68,232 @@ namespace LogInternalFn
 		};
 
 		OsFn::log(stt[sev]);
-		OsFn::log(buffer);
+		OsFn::log(message);
 		OsFn::log(ANSI_RESET);
 #else
-		OsFn::log(buffer);
+		OsFn::log(message);
 #endif // RIO_PLATFORM_POSIX
 		OsFn::log("\n");
 
 		if (getDevice())
 		{
-			getDevice()->log(buffer, sev);
+			getDevice()->log(message, sev);
+		}
+	}
+
+	// Writes the lines in the ring up to the first one still being formatted
+	// Returns false if another thread is already consuming the ring
+	static bool consume()
+	{
+		if (isConsuming.compareAndSwap(0, 1) != 0)
+		{
+			return false;
+		}
+
+		uint32_t count = 0;
+		for (;;)
+		{
+			// The first record is written last, the others are ready once it is
+			LogRecord& record = recordList[recordBegin & (RIO_LOG_MAX_RECORDS - 1)];
+			if (uint32_t(record.sequence.load()) != recordBegin + 1)
+			{
+				break;
+			}
+
+			const uint32_t recordCount = record.recordCount;
+			if (recordCount == 1)
+			{
+				write(record.severity, record.message);
+			}
+			else
+			{
+				char message[RIO_LOG_MESSAGE_SIZE];
+				for (uint32_t i = 0; i < recordCount; ++i)
+				{
+					memcpy(message + i * RIO_LOG_RECORD_SIZE, recordList[(recordBegin + i) & (RIO_LOG_MAX_RECORDS - 1)].message, RIO_LOG_RECORD_SIZE);
+				}
+				write(record.severity, message);
+			}
+
+			// Frees the records for the lines RIO_LOG_MAX_RECORDS ahead
+			for (uint32_t i = 0; i < recordCount; ++i)
+			{
+				recordList[(recordBegin + i) & (RIO_LOG_MAX_RECORDS - 1)].sequence.fetchAdd(RIO_LOG_MAX_RECORDS - 1);
+			}
+			recordBegin += recordCount;
+			++count;
+		}
+
+		const int dropped = droppedCount.load();
+		if (dropped != 0)
+		{
+			droppedCount.fetchAdd(-dropped);
+
+			char message[64];
+			snPrintF(message, sizeof(message), "%d log messages dropped", dropped);
+			write(LogSeverity::WARN, message);
+			++count;
+		}
+
+		if (count != 0 && getDevice())
+		{
+			getDevice()->flushLog();
+		}
+
+		isConsuming.store(0);
+		return true;
+	}
+
+	// Appends the line to the ring, in as many records as it takes
+	static void push(LogSeverity::Enum sev, const char* msg, va_list args)
+	{
+		char message[RIO_LOG_MESSAGE_SIZE];
+		int length = vsnPrintF(message, sizeof(message), msg, args);
+		if (length < 0)
+		{
+			message[0] = '\0';
+			length = 0;
+		}
+		length = length < int(sizeof(message)) ? length : int(sizeof(message)) - 1;
+		const uint32_t recordCount = uint32_t(length) / RIO_LOG_RECORD_SIZE + 1;
+
+		// Records are freed in order, so the whole range is free when its last record is
+		uint32_t index = uint32_t(recordEnd.load());
+		for (;;)
+		{
+			const uint32_t last = index + recordCount - 1;
+			const int32_t difference = int32_t(uint32_t(recordList[last & (RIO_LOG_MAX_RECORDS - 1)].sequence.load()) - last);
+			if (difference == 0)
+			{
+				// Claims the records unless another thread did first
+				const uint32_t previous = uint32_t(recordEnd.compareAndSwap(int(index), int(index + recordCount)));
+				if (previous == index)
+				{
+					break;
+				}
+				index = previous;
+			}
+			else if (difference < 0)
+			{
+				// The log thread is behind by a whole ring
+				droppedCount.fetchAdd(1);
+				return;
+			}
+			else
+			{
+				index = uint32_t(recordEnd.load());
+			}
+		}
+
+		// Hands the records over to the log thread, the first one last
+		for (uint32_t i = recordCount; i-- > 0;)
+		{
+			LogRecord& record = recordList[(index + i) & (RIO_LOG_MAX_RECORDS - 1)];
+			const uint32_t offset = i * RIO_LOG_RECORD_SIZE;
+			const uint32_t size = uint32_t(length) + 1 - offset;
+			memcpy(record.message, message + offset, size < RIO_LOG_RECORD_SIZE ? size : RIO_LOG_RECORD_SIZE);
+			record.severity = sev;
+			record.recordCount = recordCount;
+			record.sequence.fetchAdd(1);
+		}
+	}
+
+#if RIO_PLATFORM_POSIX
+	static const int crashSignalList[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+	static struct sigaction previousActionList[RIO_COUNTOF(crashSignalList)];
+
+	// Writes the lines still queued, then lets the signal crash the process as it would have
+	static void crashHandler(int signalNumber)
+	{
+		LogGlobalFn::flush();
+		raise(signalNumber);
+	}
+#elif RIO_PLATFORM_WINDOWS
+	static LPTOP_LEVEL_EXCEPTION_FILTER previousExceptionFilter = nullptr;
+
+	// Writes the lines still queued, then lets the exception crash the process as it would have
+	static LONG WINAPI crashHandler(EXCEPTION_POINTERS* exceptionPointers)
+	{
+		LogGlobalFn::flush();
+		return previousExceptionFilter != nullptr ? previousExceptionFilter(exceptionPointers) : EXCEPTION_CONTINUE_SEARCH;
+	}
+#endif // RIO_PLATFORM_
+
+	static void installCrashHandler()
+	{
+#if RIO_PLATFORM_POSIX
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = crashHandler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = SA_RESETHAND; // Back to the previous behavior for the raise() in the handler
+		for (uint32_t i = 0; i < RIO_COUNTOF(crashSignalList); ++i)
+		{
+			sigaction(crashSignalList[i], &action, &previousActionList[i]);
+		}
+#elif RIO_PLATFORM_WINDOWS
+		previousExceptionFilter = SetUnhandledExceptionFilter(crashHandler);
+#endif // RIO_PLATFORM_
+	}
+
+	static void uninstallCrashHandler()
+	{
+#if RIO_PLATFORM_POSIX
+		for (uint32_t i = 0; i < RIO_COUNTOF(crashSignalList); ++i)
+		{
+			sigaction(crashSignalList[i], &previousActionList[i], nullptr);
+		}
+#elif RIO_PLATFORM_WINDOWS
+		SetUnhandledExceptionFilter(previousExceptionFilter);
+		previousExceptionFilter = nullptr;
+#endif // RIO_PLATFORM_
+	}
+
+	static int32_t run(void* /*userData*/)
+	{
+		ProfilerFn::setThreadName("log");
+
+		for (;;)
+		{
+			const bool exit = exitRequested.load() != 0;
+			consume();
+			if (exit)
+			{
+				break;
+			}
+			OsFn::sleep(RIO_LOG_WRITE_INTERVAL);
+		}
+
+		return 0;
+	}
+
+	void logEx(LogSeverity::Enum sev, const char* msg, va_list args)
+	{
+		if ((enabledSeverityMask.load() & (1 << sev)) == 0)
+		{
+			return;
+		}
+
+		if (isRunning.load() != 0)
+		{
+			push(sev, msg, args);
+			return;
+		}
+
+		ScopedMutex scopedMutex(mutex);
+
+		char buffer[RIO_LOG_MESSAGE_SIZE];
+		const int length = vsnPrintF(buffer, sizeof(buffer), msg, args);
+		if (length < 0)
+		{
+			buffer[0] = '\0';
+		}
+
+		write(sev, buffer);
+
+		if (getDevice())
+		{
+			getDevice()->flushLog();
 		}
 	}
 
@@ -59,5 +306,81 @@ namespace LogInternalFn
 	}
 } // namespace LogInternalFn
 
+namespace LogFn
+{
+	void setEnabled(LogSeverity::Enum severity, bool enabled)
+	{
+		using namespace LogInternalFn;
+
+		for (;;)
+		{
+			const int mask = enabledSeverityMask.load();
+			const int newMask = enabled ? mask | (1 << severity) : mask & ~(1 << severity);
+			if (enabledSeverityMask.compareAndSwap(mask, newMask) == mask)
+			{
+				break;
+			}
+		}
+	}
+
+	bool getIsEnabled(LogSeverity::Enum severity)
+	{
+		return (LogInternalFn::enabledSeverityMask.load() & (1 << severity)) != 0;
+	}
+} // namespace LogFn
+
+namespace LogGlobalFn
+{
+	void init()
+	{
+		using namespace LogInternalFn;
+
+		recordList = (LogRecord*)getDefaultAllocator().allocate(sizeof(LogRecord) * RIO_LOG_MAX_RECORDS);
+		for (uint32_t i = 0; i < RIO_LOG_MAX_RECORDS; ++i)
+		{
+			recordList[i].sequence.store(int(i));
+		}
+		recordEnd.store(0);
+		recordBegin = 0;
+		exitRequested.store(0);
+
+		logThread.start(run);
+		isRunning.store(1);
+		installCrashHandler();
+	}
+
+	void shutdown()
+	{
+		using namespace LogInternalFn;
+
+		uninstallCrashHandler();
+
+		// Lines logged from now on are written right away
+		isRunning.store(0);
+		exitRequested.store(1);
+		logThread.stop();
+		flush();
+
+		getDefaultAllocator().deallocate(recordList);
+		recordList = nullptr;
+	}
+
+	void flush()
+	{
+		using namespace LogInternalFn;
+
+		if (recordList == nullptr)
+		{
+			return;
+		}
+
+		// The log thread may be writing, give it some time to finish
+		for (uint32_t i = 0; i < 100 && !consume(); ++i)
+		{
+			OsFn::sleep(1);
+		}
+	}
+} // namespace LogGlobalFn
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
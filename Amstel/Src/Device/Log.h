@@ -25,6 +25,26 @@ namespace LogInternalFn
 	void logEx(LogSeverity::Enum sev, const char* msg, ...);
 } // namespace LogInternalFn
 
+namespace LogFn
+{
+	// Sets whether messages of <severity> are logged, disabled ones are not even formatted
+	void setEnabled(LogSeverity::Enum severity, bool enabled);
+	// Returns whether messages of <severity> are logged
+	bool getIsEnabled(LogSeverity::Enum severity);
+} // namespace LogFn
+
+// Until init() and after shutdown() messages are written as they are logged
+// In between they are queued by the logging thread and written by a thread of their own
+// In between a crash signal or an unhandled exception writes the queued messages before the process dies
+namespace LogGlobalFn
+{
+	void init();
+	void shutdown();
+	// Writes the messages still queued, from any thread
+	// Called when the engine aborts or crashes so that the reason makes it to the log
+	void flush();
+} // namespace LogGlobalFn
+
 } // namespace Rio
 
 #define RIO_LOGIV(msg, va_list) Rio::LogInternalFn::logEx(Rio::LogSeverity::INFO, msg, va_list)
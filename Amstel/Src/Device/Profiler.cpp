@@ -3,13 +3,160 @@
 
 #include "Core/Base/Os.h"
 #include "Core/Containers/Array.h"
+#include "Core/Thread/AtomicInt.h"
 #include "Core/Thread/Mutex.h"
 #include "Core/Memory/Memory.h"
 #include "Core/Math/Vector3.h"
+#include "Core/Strings/StringStream.h"
+#include "Core/Strings/StringUtils.h"
+
+#include <string.h> // memcpy
+
+#if RIO_PROFILER_RDTSC
+	#if RIO_COMPILER_MSVC
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif // RIO_COMPILER_MSVC
+#endif // RIO_PROFILER_RDTSC
 
 namespace Rio
 {
 
+namespace ProfilerInternalFn
+{
+	// Single producer (the owning thread), single consumer (ProfilerGlobalFn::flush()) ring buffer
+	// Positions grow monotonically and are wrapped on access
+	struct ThreadBuffer
+	{
+		char data[RIO_PROFILER_THREAD_BUFFER_SIZE];
+		AtomicInt writePosition = AtomicInt(0);
+		AtomicInt readPosition = AtomicInt(0);
+		AtomicInt droppedCount = AtomicInt(0);
+		const char* name = nullptr;
+		uint32_t threadId = 0;
+		ThreadBuffer* next = nullptr;
+	};
+
+	RIO_STATIC_ASSERT((RIO_PROFILER_THREAD_BUFFER_SIZE & (RIO_PROFILER_THREAD_BUFFER_SIZE - 1)) == 0);
+
+	static Mutex threadBufferListMutex;
+	static ThreadBuffer* threadBufferList = nullptr;
+	static uint32_t threadCount = 0;
+	// Bumped by every init(), invalidates the thread local pointers of the previous session
+	static uint32_t generation = 0;
+	static AtomicInt initialized(0);
+
+	static RIO_THREAD ThreadBuffer* threadBuffer = nullptr;
+	// Generation of <threadBuffer>, read instead of the buffer itself which shutdown() may have freed
+	static RIO_THREAD uint32_t threadBufferGeneration = 0;
+	static RIO_THREAD const char* threadName = nullptr;
+
+	static int64_t startTicks = 0;
+	static int64_t startClockTime = 0;
+
+	static ThreadBuffer* getThreadBuffer()
+	{
+		if (threadBuffer != nullptr && threadBufferGeneration == generation)
+		{
+			return threadBuffer;
+		}
+
+		ScopedMutex scopedMutex(threadBufferListMutex);
+
+		ThreadBuffer* buffer = RIO_NEW(getDefaultAllocator(), ThreadBuffer)();
+		buffer->name = threadName;
+		buffer->threadId = threadCount++;
+		buffer->next = threadBufferList;
+		threadBufferList = buffer;
+
+		threadBuffer = buffer;
+		threadBufferGeneration = generation;
+		return buffer;
+	}
+
+	static void copyToRing(ThreadBuffer& buffer, uint32_t position, const void* data, uint32_t size)
+	{
+		const uint32_t offset = position & (RIO_PROFILER_THREAD_BUFFER_SIZE - 1);
+		const uint32_t firstSize = RIO_PROFILER_THREAD_BUFFER_SIZE - offset;
+
+		if (size <= firstSize)
+		{
+			memcpy(buffer.data + offset, data, size);
+		}
+		else
+		{
+			memcpy(buffer.data + offset, data, firstSize);
+			memcpy(buffer.data, (const char*)data + firstSize, size - firstSize);
+		}
+	}
+
+	static void copyFromRing(const ThreadBuffer& buffer, uint32_t position, void* data, uint32_t size)
+	{
+		const uint32_t offset = position & (RIO_PROFILER_THREAD_BUFFER_SIZE - 1);
+		const uint32_t firstSize = RIO_PROFILER_THREAD_BUFFER_SIZE - offset;
+
+		if (size <= firstSize)
+		{
+			memcpy(data, buffer.data + offset, size);
+		}
+		else
+		{
+			memcpy(data, buffer.data + offset, firstSize);
+			memcpy((char*)data + firstSize, buffer.data, size - firstSize);
+		}
+	}
+
+	template <typename T>
+	static void push(ThreadBuffer& buffer, ProfilerEventType::Enum type, const T& ev)
+	{
+		const uint32_t header[2] = { uint32_t(type), uint32_t(sizeof(ev)) };
+		const uint32_t eventSize = sizeof(header) + sizeof(ev);
+		const uint32_t writePosition = (uint32_t)buffer.writePosition.load();
+		const uint32_t readPosition = (uint32_t)buffer.readPosition.load();
+
+		if (writePosition - readPosition + eventSize > RIO_PROFILER_THREAD_BUFFER_SIZE)
+		{
+			// Nobody flushed the ring in time
+			buffer.droppedCount.store(buffer.droppedCount.load() + 1);
+			return;
+		}
+
+		copyToRing(buffer, writePosition, header, sizeof(header));
+		copyToRing(buffer, writePosition + sizeof(header), &ev, sizeof(ev));
+		buffer.writePosition.store(int(writePosition + eventSize));
+	}
+
+	template <typename T>
+	static void push(ProfilerEventType::Enum type, const T& ev)
+	{
+		if (initialized.load() == 0)
+		{
+			return;
+		}
+
+		push(*getThreadBuffer(), type, ev);
+	}
+
+	// Moves all the events currently in <buffer> to the end of <output>
+	static void drain(ThreadBuffer& buffer, Buffer& output)
+	{
+		const uint32_t writePosition = (uint32_t)buffer.writePosition.load();
+		const uint32_t readPosition = (uint32_t)buffer.readPosition.load();
+		const uint32_t size = writePosition - readPosition;
+
+		if (size == 0)
+		{
+			return;
+		}
+
+		const uint32_t outputSize = ArrayFn::getCount(output);
+		ArrayFn::resize(output, outputSize + size);
+		copyFromRing(buffer, readPosition, ArrayFn::begin(output) + outputSize, size);
+		buffer.readPosition.store(int(writePosition));
+	}
+} // namespace ProfilerInternalFn
+
 namespace ProfilerGlobalFn
 {
 	char memoryBuffer[sizeof(Buffer)];
@@ -17,11 +164,35 @@ namespace ProfilerGlobalFn
 
 	void init()
 	{
+		using namespace ProfilerInternalFn;
+
 		buffer = new (memoryBuffer)Buffer(getDefaultAllocator());
+
+		startClockTime = OsFn::getClockTime();
+		startTicks = ProfilerFn::getTicks();
+
+		ScopedMutex scopedMutex(threadBufferListMutex);
+		++generation;
+		threadCount = 0;
+		initialized.store(1);
 	}
 
 	void shutdown()
 	{
+		using namespace ProfilerInternalFn;
+
+		initialized.store(0);
+
+		{
+			ScopedMutex scopedMutex(threadBufferListMutex);
+			while (threadBufferList != nullptr)
+			{
+				ThreadBuffer* next = threadBufferList->next;
+				RIO_DELETE(getDefaultAllocator(), threadBufferList);
+				threadBufferList = next;
+			}
+		}
+
 		buffer->~Buffer();
 		buffer = nullptr;
 	}
@@ -34,51 +205,58 @@ namespace ProfilerGlobalFn
 
 namespace ProfilerFn
 {
-	enum { THREAD_BUFFER_SIZE = 4 * 1024 };
-	static char threadBuffer[THREAD_BUFFER_SIZE];
-	static uint32_t threadBufferSize = 0;
-	static Mutex bufferMutex;
-
-	static void flushLocalBuffer()
+	int64_t getTicks()
 	{
-		ScopedMutex scopedMutex(bufferMutex);
-		ArrayFn::push(*ProfilerGlobalFn::buffer, threadBuffer, threadBufferSize);
-		threadBufferSize = 0;
+#if RIO_PROFILER_RDTSC
+		return (int64_t)__rdtsc();
+#else
+		return OsFn::getClockTime();
+#endif // RIO_PROFILER_RDTSC
 	}
 
-	template <typename T>
-	static void push(ProfilerEventType::Enum type, const T& ev)
+	void setThreadName(const char* name)
 	{
-		if (threadBufferSize + 2 * sizeof(uint32_t) + sizeof(ev) >= THREAD_BUFFER_SIZE)
+		using namespace ProfilerInternalFn;
+
+		threadName = name;
+		if (threadBuffer != nullptr && threadBufferGeneration == generation)
 		{
-			flushLocalBuffer();
+			ScopedMutex scopedMutex(threadBufferListMutex);
+			threadBuffer->name = name;
 		}
-
-		char* p = threadBuffer + threadBufferSize;
-		*(uint32_t*)p = type;
-		p += sizeof(uint32_t);
-		*(uint32_t*)p = sizeof(ev);
-		p += sizeof(uint32_t);
-		*(T*)p = ev;
-
-		threadBufferSize += 2 * sizeof(uint32_t) + sizeof(ev);
 	}
 
 	void enterProfileScope(const char* name)
 	{
+		if (ProfilerInternalFn::initialized.load() == 0)
+		{
+			return;
+		}
+
+		ProfilerInternalFn::ThreadBuffer& buffer = *ProfilerInternalFn::getThreadBuffer();
+
 		EnterProfileScope ev;
 		ev.name = name;
-		ev.time = OsFn::getClockTime();
+		ev.time = getTicks();
+		ev.threadId = buffer.threadId;
 
-		push(ProfilerEventType::ENTER_PROFILE_SCOPE, ev);
+		ProfilerInternalFn::push(buffer, ProfilerEventType::ENTER_PROFILE_SCOPE, ev);
 	}
 
 	void leaveProfileScope()
 	{
+		if (ProfilerInternalFn::initialized.load() == 0)
+		{
+			return;
+		}
+
+		ProfilerInternalFn::ThreadBuffer& buffer = *ProfilerInternalFn::getThreadBuffer();
+
 		LeaveProfileScope ev;
-		ev.time = OsFn::getClockTime();
+		ev.time = getTicks();
+		ev.threadId = buffer.threadId;
 
-		push(ProfilerEventType::LEAVE_PROFILE_SCOPE, ev);
+		ProfilerInternalFn::push(buffer, ProfilerEventType::LEAVE_PROFILE_SCOPE, ev);
 	}
 
 	void recordFloat(const char* name, float value)
@@ -87,7 +265,7 @@ namespace ProfilerFn
 		ev.name = name;
 		ev.value = value;
 
-		push(ProfilerEventType::RECORD_FLOAT, ev);
+		ProfilerInternalFn::push(ProfilerEventType::RECORD_FLOAT, ev);
 	}
 
 	void recordVector3(const char* name, const Vector3& value)
@@ -96,7 +274,7 @@ namespace ProfilerFn
 		ev.name = name;
 		ev.value = value;
 
-		push(ProfilerEventType::RECORD_VECTOR3, ev);
+		ProfilerInternalFn::push(ProfilerEventType::RECORD_VECTOR3, ev);
 	}
 
 	void allocateMemory(const char* name, uint32_t size)
@@ -105,7 +283,7 @@ namespace ProfilerFn
 		ev.name = name;
 		ev.size = size;
 
-		push(ProfilerEventType::ALLOCATE_MEMORY, ev);
+		ProfilerInternalFn::push(ProfilerEventType::ALLOCATE_MEMORY, ev);
 	}
 
 	void deallocateMemory(const char* name, uint32_t size)
@@ -114,7 +292,7 @@ namespace ProfilerFn
 		ev.name = name;
 		ev.size = size;
 
-		push(ProfilerEventType::DEALLOCATE_MEMORY, ev);
+		ProfilerInternalFn::push(ProfilerEventType::DEALLOCATE_MEMORY, ev);
 	}
 } // namespace ProfilerFn
 
@@ -122,7 +300,16 @@ namespace ProfilerGlobalFn
 {
 	void flush()
 	{
-		ProfilerFn::flushLocalBuffer();
+		using namespace ProfilerInternalFn;
+
+		{
+			ScopedMutex scopedMutex(threadBufferListMutex);
+			for (ThreadBuffer* tb = threadBufferList; tb != nullptr; tb = tb->next)
+			{
+				drain(*tb, *buffer);
+			}
+		}
+
 		uint32_t end = ProfilerEventType::COUNT;
 		ArrayFn::push(*buffer, (const char*)&end, (uint32_t)sizeof(end));
 	}
@@ -131,7 +318,159 @@ namespace ProfilerGlobalFn
 	{
 		ArrayFn::clear(*buffer);
 	}
-}
+
+	double getTicksFrequency()
+	{
+		using namespace ProfilerInternalFn;
+#if RIO_PROFILER_RDTSC
+		const int64_t clockTime = OsFn::getClockTime();
+		const int64_t ticks = ProfilerFn::getTicks();
+		const double seconds = double(clockTime - startClockTime) / double(OsFn::getClockFrequency());
+		return seconds > 0.0 ? double(ticks - startTicks) / seconds : 1.0;
+#else
+		return double(OsFn::getClockFrequency());
+#endif // RIO_PROFILER_RDTSC
+	}
+
+	static void writeEventHeader(StringStream& json, bool& first, const char* phase, uint32_t threadId)
+	{
+		if (!first)
+		{
+			json << ",";
+		}
+		first = false;
+
+		json << "{\"ph\":\"" << phase << "\",\"pid\":0,\"tid\":" << threadId;
+	}
+
+	// Writes <string> as a JSON string, escaping the quotes, backslashes and control characters
+	static void writeString(StringStream& json, const char* string)
+	{
+		json << "\"";
+		for (const char* ch = string; *ch != '\0'; ++ch)
+		{
+			if (*ch == '"' || *ch == '\\')
+			{
+				json << '\\' << *ch;
+			}
+			else if ((unsigned char)*ch < 0x20)
+			{
+				char escaped[8];
+				snPrintF(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*ch);
+				json << escaped;
+			}
+			else
+			{
+				json << *ch;
+			}
+		}
+		json << "\"";
+	}
+
+	static void writeTimestamp(StringStream& json, int64_t time, double microsecondsPerTick)
+	{
+		char timestamp[64];
+		snPrintF(timestamp, sizeof(timestamp), "%.3f", double(time - ProfilerInternalFn::startTicks) * microsecondsPerTick);
+		json << ",\"ts\":" << timestamp;
+	}
+
+	void writeChromeTrace(StringStream& json)
+	{
+		using namespace ProfilerInternalFn;
+
+		const double microsecondsPerTick = 1000000.0 / getTicksFrequency();
+		bool first = true;
+		// Counters have no thread, they are stamped with the time of the last scope event
+		int64_t lastTime = startTicks;
+
+		json << "{\"traceEvents\":[";
+
+		{
+			ScopedMutex scopedMutex(threadBufferListMutex);
+			for (ThreadBuffer* tb = threadBufferList; tb != nullptr; tb = tb->next)
+			{
+				writeEventHeader(json, first, "M", tb->threadId);
+				json << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+				if (tb->name != nullptr)
+				{
+					writeString(json, tb->name);
+				}
+				else
+				{
+					json << "\"thread" << tb->threadId << "\"";
+				}
+				json << "}}";
+			}
+		}
+
+		const char* p = ArrayFn::begin(*buffer);
+		const char* end = ArrayFn::end(*buffer);
+		while (p < end)
+		{
+			const uint32_t type = *(uint32_t*)p;
+			if (type == ProfilerEventType::COUNT)
+			{
+				break;
+			}
+			p += sizeof(uint32_t);
+			const uint32_t size = *(uint32_t*)p;
+			p += sizeof(uint32_t);
+
+			switch (type)
+			{
+				case ProfilerEventType::ENTER_PROFILE_SCOPE:
+				{
+					const EnterProfileScope& ev = *(EnterProfileScope*)p;
+					writeEventHeader(json, first, "B", ev.threadId);
+					writeTimestamp(json, ev.time, microsecondsPerTick);
+					json << ",\"name\":";
+					writeString(json, ev.name);
+					json << "}";
+					lastTime = ev.time;
+					break;
+				}
+				case ProfilerEventType::LEAVE_PROFILE_SCOPE:
+				{
+					const LeaveProfileScope& ev = *(LeaveProfileScope*)p;
+					writeEventHeader(json, first, "E", ev.threadId);
+					writeTimestamp(json, ev.time, microsecondsPerTick);
+					json << "}";
+					lastTime = ev.time;
+					break;
+				}
+				case ProfilerEventType::RECORD_FLOAT:
+				{
+					const RecordFloat& ev = *(RecordFloat*)p;
+					writeEventHeader(json, first, "C", 0);
+					writeTimestamp(json, lastTime, microsecondsPerTick);
+					json << ",\"name\":";
+					writeString(json, ev.name);
+					json << ",\"args\":{\"value\":" << ev.value << "}}";
+					break;
+				}
+				case ProfilerEventType::RECORD_VECTOR3:
+				{
+					const RecordVector3& ev = *(RecordVector3*)p;
+					writeEventHeader(json, first, "C", 0);
+					writeTimestamp(json, lastTime, microsecondsPerTick);
+					json << ",\"name\":";
+					writeString(json, ev.name);
+					json << ",\"args\":{\"x\":" << ev.value.x << ",\"y\":" << ev.value.y << ",\"z\":" << ev.value.z << "}}";
+					break;
+				}
+				default:
+				{
+					// Memory events are not part of the trace
+					break;
+				}
+			}
+
+			p += size;
+		}
+
+		json << "]}";
+	}
+} // namespace ProfilerGlobalFn
 
 } // namespace Rio
 
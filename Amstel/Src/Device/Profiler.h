@@ -1,8 +1,11 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #pragma once
 
+#include "Config.h"
+#include "Core/Base/Macros.h"
 #include "Core/Base/Types.h"
 #include "Core/Math/MathTypes.h"
+#include "Core/Strings/StringTypes.h"
 
 namespace Rio
 {
@@ -38,11 +41,13 @@ struct EnterProfileScope
 {
 	const char* name;
 	int64_t time;
+	uint32_t threadId;
 };
 
 struct LeaveProfileScope
 {
 	int64_t time;
+	uint32_t threadId;
 };
 
 struct AllocateMemory
@@ -59,8 +64,16 @@ struct DeallocateMemory
 
 // The profiler does not copy pointer data
 // You have to store it somewhere and make sure it is valid throughout the program execution
+// Each thread records into its own ring buffer, the rings are drained into
+// the global buffer by ProfilerGlobalFn::flush()
 namespace ProfilerFn
 {
+	// Returns the current profiler timestamp
+	int64_t getTicks();
+
+	// Names the calling thread in the exported traces
+	void setThreadName(const char* name);
+
 	// Starts a new profile scope with the given <name>
 	void enterProfileScope(const char* name);
 
@@ -85,24 +98,53 @@ namespace ProfilerGlobalFn
 	void init();
 	void shutdown();
 	const char* getBuffer();
+	// Drains the buffers of all the threads into the global buffer
 	void flush();
 	void clear();
+	// Returns the number of profiler ticks per second
+	double getTicksFrequency();
+	// Writes the events collected by the last flush() as Chrome trace JSON (chrome://tracing, Perfetto)
+	void writeChromeTrace(StringStream& json);
 } // namespace ProfilerGlobalFn
 
+// Profiles the enclosing C++ scope
+struct ProfileScope
+{
+	ProfileScope(const char* name)
+	{
+		ProfilerFn::enterProfileScope(name);
+	}
+
+	~ProfileScope()
+	{
+		ProfilerFn::leaveProfileScope();
+	}
+private:
+	// Disable copying
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
 } // namespace Rio
 
-#if RIO_DEBUG
+#if RIO_PROFILER
+	#define PROFILE_SCOPE(name) ProfileScope RIO_CONCATENATE(profileScope, __LINE__)(name)
 	#define ENTER_PROFILE_SCOPE(name) ProfilerFn::enterProfileScope(name)
 	#define LEAVE_PROFILE_SCOPE() ProfilerFn::leaveProfileScope()
 	#define RECORD_FLOAT(name, value) ProfilerFn::recordFloat(name, value)
 	#define RECORD_VECTOR3(name, value) ProfilerFn::recordVector3(name, value)
-	#define ALLOCATE_MEMORY(name, size) ProfilerFn::allocateMemory(name, size)
-	#define DEALLOCATE_MEMORY(name, size) ProfilerFn::deallocateMemory(name, size)
 #else
+	#define PROFILE_SCOPE(name) ((void)0)
 	#define ENTER_PROFILE_SCOPE(name) ((void)0)
 	#define LEAVE_PROFILE_SCOPE() ((void)0)
 	#define RECORD_FLOAT(name, value) ((void)0)
 	#define RECORD_VECTOR3(name, value) ((void)0)
+#endif // RIO_PROFILER
+
+#if RIO_DEBUG
+	#define ALLOCATE_MEMORY(name, size) ProfilerFn::allocateMemory(name, size)
+	#define DEALLOCATE_MEMORY(name, size) ProfilerFn::deallocateMemory(name, size)
+#else
 	#define ALLOCATE_MEMORY(name, size) ((void)0)
 	#define DEALLOCATE_MEMORY(name, size) ((void)0)
 #endif // RIO_DEBUG
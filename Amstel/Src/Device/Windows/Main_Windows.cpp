@@ -715,6 +715,13 @@ int main(int argumentListCount, char** argumentList)
 	{
 		return EXIT_FAILURE;
 	}
+	if (deviceOptions.benchmarkLevel != nullptr)
+	{
+		// Headless, no window needed
+		Rio::run(deviceOptions);
+		WSACleanup();
+		return EXIT_SUCCESS;
+	}
 	return windowsDevice.run(&deviceOptions);
 }
 
@@ -8,11 +8,13 @@
 #include "Core/FileSystem/Path.h"
 #include "Core/FileSystem/FileSystem.h"
 #include "Core/Base/Guid.h"
+#include "Core/Base/Os.h"
 #include "Core/Memory/TempAllocator.h"
 
 #include "Device/Log.h"
 
 #include "Resource/DataCompiler.h"
+#include "Resource/SpriteAtlas.h"
 
 #include <setjmp.h> // jmp_buf
 
@@ -144,11 +146,41 @@ public:
 		absolutePath += suffix;
 	}
 
+	// Returns the absolute path of the file <name> kept in the temporary directory across compilations
+	void getCachePath(const char* name, DynamicString& absolutePath)
+	{
+		bundleFileSystem.getAbsolutePath(RIO_TEMP_DIRECTORY, absolutePath);
+		absolutePath += '/';
+		absolutePath += name;
+	}
+
+	bool doesTemporaryExist(const char* path)
+	{
+		return bundleFileSystem.getDoesExist(path);
+	}
+
 	void deleteFile(const char* path)
 	{
 		bundleFileSystem.deleteFile(path);
 	}
 
+	// Writes <data> to the file <path> in the temporary directory through a temporary file
+	// Readers of <path> see either the previous file or all of <data>, never a partial write
+	void writeTemporaryAtomic(const char* path, const Buffer& data)
+	{
+		TempAllocator512 ta;
+		DynamicString temporaryPath(ta);
+		getTemporaryPath("partial", temporaryPath);
+		writeTemporary(temporaryPath.getCStr(), data);
+
+		DynamicString absolutePath(ta);
+		bundleFileSystem.getAbsolutePath(path, absolutePath);
+		if (!OsFn::renameFile(temporaryPath.getCStr(), absolutePath.getCStr()))
+		{
+			bundleFileSystem.deleteFile(temporaryPath.getCStr());
+		}
+	}
+
 	void write(const void* data, uint32_t size)
 	{
 		ArrayFn::push(outputBuffer, (const char*)data, size);
@@ -165,6 +197,11 @@ public:
 		ArrayFn::push(outputBuffer, ArrayFn::begin(data), ArrayFn::getCount(data));
 	}
 
+	SpriteAtlasTable& getSpriteAtlasTable()
+	{
+		return dataCompiler.getSpriteAtlasTable();
+	}
+
 	const char* getPlatform() const
 	{
 		return platformName;
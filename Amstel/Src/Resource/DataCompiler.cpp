@@ -24,6 +24,8 @@
 #include "Device/Log.h"
 
 #include "Resource/CompileOptions.h"
+#include "Resource/ResourceTypes.h"
+#include "Resource/SpriteAtlas.h"
 
 #include <setjmp.h>
 
@@ -63,6 +65,7 @@ DataCompiler::DataCompiler()
 	, resourceCompilerTable(getDefaultAllocator())
 	, fileNameList(getDefaultAllocator())
 	, globList(getDefaultAllocator())
+	, spriteAtlasTable(getDefaultAllocator())
 {
 }
 
@@ -189,6 +192,73 @@ bool DataCompiler::compile(FileSystemDisk& bundleFileSystem, const char* type, c
 	return success;
 }
 
+bool DataCompiler::packSpriteAtlases(FileSystemDisk& bundleFileSystem, const char* path, const char* platform)
+{
+	bool success = true;
+
+	jmp_buf jmpBuffer;
+	Buffer output(getDefaultAllocator());
+
+	if (!setjmp(jmpBuffer))
+	{
+		CompileOptions compileOptions(*this, bundleFileSystem, output, platform, &jmpBuffer);
+		SpriteAtlasInternalFn::pack(path, compileOptions);
+	}
+	else
+	{
+		success = false;
+	}
+
+	return success;
+}
+
+bool DataCompiler::compileSpriteAtlas(FileSystemDisk& bundleFileSystem, const SpriteAtlas& spriteAtlas, const char* platform)
+{
+	TempAllocator1024 ta;
+	DynamicString path(ta);
+	DynamicString resourceTypeStr(ta);
+	DynamicString resourceNameStr(ta);
+	DynamicString destinationPath(ta);
+
+	// Atlases are ordinary textures
+	StringId64 resourceType(RESOURCE_EXTENSION_TEXTURE);
+	StringId64 resourceName(spriteAtlas.name.getCStr());
+	resourceType.toString(resourceTypeStr);
+	resourceName.toString(resourceNameStr);
+
+	destinationPath += resourceTypeStr;
+	destinationPath += '-';
+	destinationPath += resourceNameStr;
+
+	PathFn::join(RIO_DATA_DIRECTORY, destinationPath.getCStr(), path);
+
+	RIO_LOGI("%s <= %s", destinationPath.getCStr(), spriteAtlas.name.getCStr());
+
+	bool success = true;
+
+	jmp_buf jmpBuffer;
+	Buffer output(getDefaultAllocator());
+	ArrayFn::reserve(output, 4 * 1024 * 1024);
+
+	if (!setjmp(jmpBuffer))
+	{
+		CompileOptions compileOptions(*this, bundleFileSystem, output, platform, &jmpBuffer);
+		SpriteAtlasInternalFn::compile(spriteAtlas, compileOptions);
+
+		File* outputFile = bundleFileSystem.open(path.getCStr(), FileOpenMode::WRITE);
+		uint32_t size = ArrayFn::getCount(output);
+		uint32_t written = outputFile->write(ArrayFn::begin(output), size);
+		bundleFileSystem.close(*outputFile);
+		success = size == written;
+	}
+	else
+	{
+		success = false;
+	}
+
+	return success;
+}
+
 void DataCompiler::mapSourceDirectory(const char* name, const char* sourceDirectoryStr)
 {
 	TempAllocator256 ta;
@@ -310,6 +380,23 @@ bool DataCompiler::compile(const char* dataDirectory, const char* platform)
 		bundleFileSystem.createDirectory(RIO_TEMP_DIRECTORY);
 	}
 
+	// Sprite textures are packed first, the sprites, materials and packages compiled next refer to the atlases
+	SpriteAtlasInternalFn::clear(spriteAtlasTable);
+	for (uint32_t i = 0; i < VectorFn::getCount(fileNameList); ++i)
+	{
+		const char* fileName = fileNameList[i].getCStr();
+		const char* type = PathFn::getExtension(fileName);
+		if (type == nullptr || strcmp(type, RESOURCE_EXTENSION_PACKAGE) != 0)
+		{
+			continue;
+		}
+
+		if (!packSpriteAtlases(bundleFileSystem, fileName, platform))
+		{
+			return false;
+		}
+	}
+
 	// Compile all changed resources
 	for (uint32_t i = 0; i < VectorFn::getCount(fileNameList); ++i)
 	{
@@ -331,6 +418,14 @@ bool DataCompiler::compile(const char* dataDirectory, const char* platform)
 		}
 	}
 
+	for (uint32_t i = 0; i < VectorFn::getCount(spriteAtlasTable.atlasList); ++i)
+	{
+		if (!compileSpriteAtlas(bundleFileSystem, spriteAtlasTable.atlasList[i], platform))
+		{
+			return false;
+		}
+	}
+
 	return true;
 }
 
@@ -354,5 +449,10 @@ uint32_t DataCompiler::getResourceCompilerVersion(StringId64 type)
 	return SortMapFn::get(resourceCompilerTable, type, ResourceTypeData()).version;
 }
 
+SpriteAtlasTable& DataCompiler::getSpriteAtlasTable()
+{
+	return spriteAtlasTable;
+}
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
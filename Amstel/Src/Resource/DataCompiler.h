@@ -4,6 +4,7 @@
 #include "Core/Containers/ContainerTypes.h"
 #include "Core/FileSystem/FileSystemDisk.h"
 #include "Resource/CompilerTypes.h"
+#include "Resource/SpriteAtlas.h"
 
 namespace Rio
 {
@@ -32,18 +33,23 @@ public:
 	void registerResourceCompiler(StringId64 type, uint32_t version, CompileFunction compileFunction);
 	// Returns the version of the compiler for <type>
 	uint32_t getResourceCompilerVersion(StringId64 type);
+	// Returns the atlases of the sprite textures packed by the current compilation
+	SpriteAtlasTable& getSpriteAtlasTable();
 private:
 	void addFile(const char* path);
 	bool canCompile(StringId64 type);
 	void compile(StringId64 type, const char* path, CompileOptions& compileOptions);
 	void scanSourceDirectory(const char* prefix, const char* path);
 	bool compile(FileSystemDisk& bundleFileSystem, const char* type, const char* name, const char* platform);
+	bool packSpriteAtlases(FileSystemDisk& bundleFileSystem, const char* path, const char* platform);
+	bool compileSpriteAtlas(FileSystemDisk& bundleFileSystem, const SpriteAtlas& spriteAtlas, const char* platform);
 
 	FileSystemDisk sourceFileSystem;
 	Map<DynamicString, DynamicString> sourceDirectoriesMap;
 	SortMap<StringId64, ResourceTypeData> resourceCompilerTable;
 	Vector<DynamicString> fileNameList;
 	Vector<DynamicString> globList;
+	SpriteAtlasTable spriteAtlasTable;
 };
 
 } // namespace Rio
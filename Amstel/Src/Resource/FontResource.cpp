@@ -4,7 +4,7 @@
 #include "Core/Strings/StringUtils.h"
 #include "Core/Memory/Allocator.h"
 #include "Core/FileSystem/FileSystem.h"
-#include "Core/Json/JsonObject.h"
+#include "Core/Json/JsonTape.h"
 #include "Resource/ResourceTypes.h"
 #include "Resource/CompileOptions.h"
 
@@ -26,43 +26,39 @@ namespace FontResourceInternalFn
 		}
 	};
 
-	void parseGlyph(const char* json, GlyphInfo& glyph)
+	void parseGlyph(const JsonTape& tape, uint32_t glyphJson, GlyphInfo& glyph)
 	{
-		TempAllocator512 ta;
-		JsonObject jsonObject(ta);
-		JsonRFn::parse(json, jsonObject);
-
-		glyph.codePoint = JsonRFn::parseInt(jsonObject["id"]);
-		glyph.glyphData.x = JsonRFn::parseFloat(jsonObject["x"]);
-		glyph.glyphData.y = JsonRFn::parseFloat(jsonObject["y"]);
-		glyph.glyphData.width = JsonRFn::parseFloat(jsonObject["width"]);
-		glyph.glyphData.height = JsonRFn::parseFloat(jsonObject["height"]);
-		glyph.glyphData.xOffset = JsonRFn::parseFloat(jsonObject["xOffset"]);
-		glyph.glyphData.yOffset = JsonRFn::parseFloat(jsonObject["yOffset"]);
-		glyph.glyphData.xAdvance = JsonRFn::parseFloat(jsonObject["xAdvance"]);
+		glyph.codePoint = JsonTapeFn::parseInt(tape, JsonTapeFn::get(tape, glyphJson, "id"));
+		glyph.glyphData.x = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "x"));
+		glyph.glyphData.y = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "y"));
+		glyph.glyphData.width = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "width"));
+		glyph.glyphData.height = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "height"));
+		glyph.glyphData.xOffset = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "xOffset"));
+		glyph.glyphData.yOffset = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "yOffset"));
+		glyph.glyphData.xAdvance = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, glyphJson, "xAdvance"));
 	}
 
 	void compile(const char* path, CompileOptions& compileOptions)
 	{
 		Buffer buffer = compileOptions.read(path);
 
-		TempAllocator4096 ta;
-		JsonObject object(ta);
-		JsonArray glyphs(ta);
+		JsonTape tape(getDefaultAllocator());
+		JsonTapeFn::parse(buffer, tape);
 
-		JsonRFn::parse(buffer, object);
-		JsonRFn::parseArray(object["glyphs"], glyphs);
+		const uint32_t root = JsonTapeFn::getRoot(tape);
+		const uint32_t glyphs = JsonTapeFn::get(tape, root, "glyphs");
 
-		const uint32_t textureSize = JsonRFn::parseInt(object["size"]);
-		const uint32_t fontSize = JsonRFn::parseInt(object["fontSize"]);
-		const uint32_t glyphCount = ArrayFn::getCount(glyphs);
+		const uint32_t textureSize = JsonTapeFn::parseInt(tape, JsonTapeFn::get(tape, root, "size"));
+		const uint32_t fontSize = JsonTapeFn::parseInt(tape, JsonTapeFn::get(tape, root, "fontSize"));
+		const uint32_t glyphCount = JsonTapeFn::getCount(tape, glyphs);
 
 		Array<GlyphInfo> glyphInfoList(getDefaultAllocator());
 		ArrayFn::resize(glyphInfoList, glyphCount);
 
-		for (uint32_t i = 0; i < glyphCount; ++i)
+		uint32_t glyph = JsonTapeFn::getFirstChild(tape, glyphs);
+		for (uint32_t i = 0; i < glyphCount; ++i, glyph = JsonTapeFn::getNext(tape, glyph))
 		{
-			parseGlyph(glyphs[i], glyphInfoList[i]);
+			parseGlyph(tape, glyph, glyphInfoList[i]);
 		}
 
 		std::sort(ArrayFn::begin(glyphInfoList), ArrayFn::end(glyphInfoList));
@@ -3,8 +3,7 @@
 #include "Core/Containers/Array.h"
 #include "Core/FileSystem/FileSystem.h"
 #include "Core/Memory/Memory.h"
-#include "Core/Json/JsonR.h"
-#include "Core/Json/JsonObject.h"
+#include "Core/Json/JsonTape.h"
 #include "Resource/CompileOptions.h"
 #include "Resource/UnitCompiler.h"
 
@@ -16,35 +15,28 @@ namespace LevelResourceInternalFn
 	void compile(const char* path, CompileOptions& compileOptions)
 	{
 		Buffer buffer = compileOptions.read(path);
-		TempAllocator4096 ta;
-		JsonObject jsonObject(ta);
-		JsonRFn::parse(buffer, jsonObject);
+		JsonTape tape(getDefaultAllocator());
+		JsonTapeFn::parse(buffer, tape);
+		const uint32_t root = JsonTapeFn::getRoot(tape);
 
 		Array<LevelSound> sounds(getDefaultAllocator());
 		{
-			JsonObject soundsJson(ta);
-			JsonRFn::parseObject(jsonObject["sounds"], soundsJson);
-
-			auto begin = JsonObjectFn::begin(soundsJson);
-			auto end = JsonObjectFn::end(soundsJson);
-			for (; begin != end; ++begin)
+			const uint32_t soundsJson = JsonTapeFn::get(tape, root, "sounds");
+			for (uint32_t sound = JsonTapeFn::getFirstMember(tape, soundsJson); sound != JSON_TAPE_INVALID; sound = JsonTapeFn::getNextMember(tape, sound))
 			{
-				JsonObject sound(ta);
-				JsonRFn::parseObject(begin->pair.second, sound);
-
 				LevelSound levelSound;
-				levelSound.name = JsonRFn::parseResourceId(sound["name"]);
-				levelSound.position = JsonRFn::parseVector3(sound["position"]);
-				levelSound.volume = JsonRFn::parseFloat(sound["volume"]);
-				levelSound.range = JsonRFn::parseFloat(sound["range"]);
-				levelSound.loop = JsonRFn::parseBool(sound["loop"]);
+				levelSound.name = JsonTapeFn::parseResourceId(tape, JsonTapeFn::get(tape, sound, "name"));
+				levelSound.position = JsonTapeFn::parseVector3(tape, JsonTapeFn::get(tape, sound, "position"));
+				levelSound.volume = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, sound, "volume"));
+				levelSound.range = JsonTapeFn::parseFloat(tape, JsonTapeFn::get(tape, sound, "range"));
+				levelSound.loop = JsonTapeFn::parseBool(tape, JsonTapeFn::get(tape, sound, "loop"));
 
 				ArrayFn::pushBack(sounds, levelSound);
 			}
 		}
 
 		UnitCompiler unitCompiler(compileOptions);
-		unitCompiler.compileMultipleUnits(jsonObject["units"]);
+		unitCompiler.compileMultipleUnits(tape, JsonTapeFn::get(tape, root, "units"));
 		Buffer unitBlob = unitCompiler.getBlob();
 
 		// Write
@@ -74,7 +74,7 @@ namespace MaterialResourceInternalFn
 		return offset;
 	}
 
-	static void parseTextures(const char* json, Array<TextureData>& textures, Array<char>& names, Array<char>& dynamic, CompileOptions& compileOptions)
+	static void parseTextures(const char* json, bool isSpriteMaterial, Array<TextureData>& textures, Array<char>& names, Array<char>& dynamic, CompileOptions& compileOptions)
 	{
 		TempAllocator4096 ta;
 		JsonObject object(ta);
@@ -103,6 +103,13 @@ namespace MaterialResourceInternalFn
 			TextureData textureData;
 			textureData.samplerUniformNameOffset = samplerUniformNameOffset;
 			textureData.id = JsonRFn::parseResourceId(value);
+
+			// Sprite materials sample the atlas of the packed sprite textures, the others keep the textures
+			SpriteAtlasRegion region;
+			if (isSpriteMaterial && SpriteAtlasInternalFn::getRegion(compileOptions.getSpriteAtlasTable(), texture.getCStr(), region))
+			{
+				textureData.id = region.atlasName;
+			}
 			textureData.dataOffset = reserveDynamicData(textureHandle, dynamic);
 
 			ArrayFn::pushBack(textures, textureData);
@@ -201,7 +208,12 @@ namespace MaterialResourceInternalFn
 		DynamicString shaderName(ta);
 		JsonRFn::parseString(jsonObject["shader"], shaderName);
 
-		parseTextures(jsonObject["textures"], textureDataList, names, dynamicBlob, compileOptions);
+		TempAllocator1024 taa;
+		DynamicString materialName(taa);
+		materialName.set(path, getStringLength32(path) - getStringLength32("." RESOURCE_EXTENSION_MATERIAL));
+		const bool isSpriteMaterial = SpriteAtlasInternalFn::getIsSpriteMaterial(compileOptions.getSpriteAtlasTable(), materialName.getCStr());
+
+		parseTextures(jsonObject["textures"], isSpriteMaterial, textureDataList, names, dynamicBlob, compileOptions);
 		parseUniforms(jsonObject["uniforms"], uniformDataList, names, dynamicBlob, compileOptions);
 
 		MaterialResource materialResource;
@@ -1,6 +1,7 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Resource/MeshResource.h"
 
+#include "Core/Base/Macros.h"
 #include "Core/Math/Aabb.h"
 #include "Core/Math/Vector2.h"
 #include "Core/Math/Vector3.h"
@@ -8,9 +9,11 @@
 #include "Core/FileSystem/FileSystem.h"
 #include "Core/Containers/Map.h"
 #include "Core/Math/Matrix4x4.h"
+#include "Core/Math/MeshOptimizer.h"
+#include "Core/Math/Quantization.h"
+#include "Core/Math/Vector4.h"
 #include "Core/FileSystem/ReaderWriter.h"
-#include "Core/Json/JsonR.h"
-#include "Core/Json/JsonObject.h"
+#include "Core/Json/JsonTape.h"
 #include "Core/Memory/TempAllocator.h"
 #include "Core/Containers/Vector.h"
 
@@ -19,11 +22,18 @@
 
 #include "Device/Log.h"
 
+#include <string.h> // memcpy
+
 namespace Rio
 {
 
 namespace MeshResourceInternalFn
 {
+	// Indexed by MeshPositionFormat::Enum, MeshNormalFormat::Enum and MeshUvFormat::Enum
+	static const char* const positionFormatNameList[] = { "float", "half", "int16" };
+	static const char* const normalFormatNameList[] = { "float", "octahedral8", "octahedral16" };
+	static const char* const uvFormatNameList[] = { "float", "half" };
+
 	struct MeshCompiler
 	{
 		MeshCompiler(CompileOptions& compileOptions)
@@ -58,6 +68,7 @@ namespace MeshResourceInternalFn
 			ArrayFn::clear(binormalIndexList);
 
 			vertexStride = 0;
+			indexStride = 0;
 			ArrayFn::clear(vertexBuffer);
 			ArrayFn::clear(indexBuffer);
 
@@ -67,163 +78,465 @@ namespace MeshResourceInternalFn
 			hasUv = false;
 		}
 
-		void parse(const char* geometry, const char* node)
+		void parse(const JsonTape& tape, uint32_t geometry, uint32_t node)
 		{
-			TempAllocator4096 ta;
-			JsonObject jsonObject(ta);
-			JsonObject nodeJsonObject(ta);
-			JsonRFn::parse(geometry, jsonObject);
-			JsonRFn::parse(node, nodeJsonObject);
-
-			hasNormal = JsonObjectFn::has(jsonObject, "normal");
-			hasUv = JsonObjectFn::has(jsonObject, "texCoord");
+			const uint32_t normal = JsonTapeFn::find(tape, geometry, "normal");
+			const uint32_t texCoord = JsonTapeFn::find(tape, geometry, "texCoord");
+			hasNormal = normal != JSON_TAPE_INVALID;
+			hasUv = texCoord != JSON_TAPE_INVALID;
 
-			parseFloatArray(jsonObject["position"], positionList);
+			parseFloatArray(tape, JsonTapeFn::get(tape, geometry, "position"), positionList);
 
 			if (hasNormal == true)
 			{
-				parseFloatArray(jsonObject["normal"], normalList);
+				parseFloatArray(tape, normal, normalList);
 			}
 			if (hasUv == true)
 			{
-				parseFloatArray(jsonObject["texCoord"], uvList);
+				parseFloatArray(tape, texCoord, uvList);
 			}
 
-			parseIndices(jsonObject["indices"]);
+			parseIndices(tape, JsonTapeFn::get(tape, geometry, "indices"));
+
+			localMatrix = JsonTapeFn::parseMatrix4x4(tape, JsonTapeFn::get(tape, node, "localMatrix"));
+		}
+
+		// Reads the vertex encodings of the mesh, the default encoding is float32 for every stream
+		void parseCompression(const JsonTape& tape, uint32_t compression)
+		{
+			const uint32_t position = JsonTapeFn::find(tape, compression, "position");
+			const uint32_t normal = JsonTapeFn::find(tape, compression, "normal");
+			const uint32_t texCoord = JsonTapeFn::find(tape, compression, "texCoord");
 
-			localMatrix = JsonRFn::parseMatrix4x4(nodeJsonObject["localMatrix"]);
+			if (position != JSON_TAPE_INVALID)
+			{
+				positionFormat = parseFormat(tape, position, positionFormatNameList, RIO_COUNTOF(positionFormatNameList));
+			}
+			if (normal != JSON_TAPE_INVALID)
+			{
+				normalFormat = parseFormat(tape, normal, normalFormatNameList, RIO_COUNTOF(normalFormatNameList));
+			}
+			if (texCoord != JSON_TAPE_INVALID)
+			{
+				uvFormat = parseFormat(tape, texCoord, uvFormatNameList, RIO_COUNTOF(uvFormatNameList));
+			}
 		}
 
-		void parseFloatArray(const char* jsonArrayStr, Array<float>& output)
+		// Reads the number of LODs to generate and the fraction of triangles kept by each
+		void parseLod(const JsonTape& tape, uint32_t lod)
 		{
-			TempAllocator4096 ta;
-			JsonArray jsonArray(ta);
-			JsonRFn::parseArray(jsonArrayStr, jsonArray);
+			const uint32_t count = JsonTapeFn::find(tape, lod, "count");
+			const uint32_t ratio = JsonTapeFn::find(tape, lod, "ratio");
 
-			ArrayFn::resize(output, ArrayFn::getCount(jsonArray));
-			for (uint32_t i = 0; i < ArrayFn::getCount(jsonArray); ++i)
+			if (count != JSON_TAPE_INVALID)
+			{
+				const int32_t value = JsonTapeFn::parseInt(tape, count);
+				RESOURCE_COMPILER_ASSERT(value >= 1 && value <= RIO_MAX_MESH_LODS
+					, compileOptions
+					, "LOD count must be in [1, %d]"
+					, RIO_MAX_MESH_LODS
+					);
+				lodOptionCount = uint32_t(value);
+			}
+			if (ratio != JSON_TAPE_INVALID)
 			{
-				output[i] = JsonRFn::parseFloat(jsonArray[i]);
+				lodRatio = JsonTapeFn::parseFloat(tape, ratio);
+				RESOURCE_COMPILER_ASSERT(lodRatio > 0.0f && lodRatio < 1.0f
+					, compileOptions
+					, "LOD ratio must be in (0, 1)"
+					);
 			}
 		}
 
-		void parseIndexArray(const char* jsonArrayStr, Array<uint16_t>& output)
+		uint32_t parseFormat(const JsonTape& tape, uint32_t i, const char* const* nameList, uint32_t nameCount)
 		{
-			TempAllocator4096 ta;
-			JsonArray jsonArray(ta);
-			JsonRFn::parseArray(jsonArrayStr, jsonArray);
+			TempAllocator256 ta;
+			DynamicString name(ta);
+			JsonTapeFn::parseString(tape, i, name);
 
-			ArrayFn::resize(output, ArrayFn::getCount(jsonArray));
-			for (uint32_t i = 0; i < ArrayFn::getCount(jsonArray); ++i)
+			for (uint32_t format = 0; format < nameCount; ++format)
 			{
-				output[i] = (uint16_t)JsonRFn::parseInt(jsonArray[i]);
+				if (name == nameList[format])
+				{
+					return format;
+				}
 			}
+
+			RESOURCE_COMPILER_ASSERT(false, compileOptions, "Unknown vertex format: '%s'", name.getCStr());
+			return 0;
+		}
+
+		void parseFloatArray(const JsonTape& tape, uint32_t array, Array<float>& output)
+		{
+			ArrayFn::resize(output, JsonTapeFn::getCount(tape, array));
+			const uint32_t count = JsonTapeFn::parseFloatArrayInto(tape, array, ArrayFn::begin(output), ArrayFn::getCount(output));
+			RESOURCE_COMPILER_ASSERT(count == ArrayFn::getCount(output), compileOptions, "Bad float array");
 		}
 
-		void parseIndices(const char* json)
+		void parseIndexArray(const JsonTape& tape, uint32_t array, Array<uint32_t>& output)
 		{
-			TempAllocator4096 ta;
-			JsonObject jsonObject(ta);
-			JsonRFn::parse(json, jsonObject);
+			ArrayFn::resize(output, JsonTapeFn::getCount(tape, array));
+			const uint32_t count = JsonTapeFn::parseUintArrayInto(tape, array, ArrayFn::begin(output), ArrayFn::getCount(output));
+			RESOURCE_COMPILER_ASSERT(count == ArrayFn::getCount(output), compileOptions, "Bad index array");
+		}
 
-			JsonArray dataJsonArray(ta);
-			JsonRFn::parseArray(jsonObject["data"], dataJsonArray);
+		void parseIndices(const JsonTape& tape, uint32_t indices)
+		{
+			const uint32_t data = JsonTapeFn::get(tape, indices, "data");
 
-			parseIndexArray(dataJsonArray[0], positionIndexList);
+			uint32_t item = JsonTapeFn::getFirstChild(tape, data);
+			parseIndexArray(tape, item, positionIndexList);
 
+			item = JsonTapeFn::getNext(tape, item);
 			if (hasNormal == true)
 			{
-				parseIndexArray(dataJsonArray[1], normalIndexList);
+				parseIndexArray(tape, item, normalIndexList);
 			}
+
+			item = item != JSON_TAPE_INVALID ? JsonTapeFn::getNext(tape, item) : item;
 			if (hasUv == true)
 			{
-				parseIndexArray(dataJsonArray[2], uvIndexList);
+				parseIndexArray(tape, item, uvIndexList);
 			}
 		}
 
 		void compile()
 		{
-			vertexStride = 0;
-			vertexStride += 3 * sizeof(float);
-			vertexStride += (hasNormal ? 3 * sizeof(float) : 0);
-			vertexStride += (hasUv ? 2 * sizeof(float) : 0);
+			// Bounds
+			AabbFn::reset(aabb);
+			AabbFn::addPoints(aabb
+				, ArrayFn::getCount(positionList) / 3
+				, sizeof(float) * 3
+				, ArrayFn::begin(positionList)
+				);
+			aabb = AabbFn::getTransformed(aabb, localMatrix);
 
-			// Generate vertex buffer / index buffer
-			ArrayFn::resize(indexBuffer, ArrayFn::getCount(positionIndexList));
+			obb.transformMatrix = createMatrix4x4(QUATERNION_IDENTITY, AabbFn::getCenter(aabb));
+			obb.halfExtents.x = (aabb.max.x - aabb.min.x) * 0.5f;
+			obb.halfExtents.y = (aabb.max.y - aabb.min.y) * 0.5f;
+			obb.halfExtents.z = (aabb.max.z - aabb.min.z) * 0.5f;
 
-			uint16_t index = 0;
-			for (uint32_t i = 0; i < ArrayFn::getCount(positionIndexList); ++i)
+			// Quantized positions are relative to the bounds
+			const Vector3 center = AabbFn::getCenter(aabb);
+			Vector3 positionOffset = VECTOR3_ZERO;
+			Vector3 positionScale = VECTOR3_ONE;
+			if (positionFormat == MeshPositionFormat::HALF)
 			{
-				indexBuffer[i] = index++;
+				positionOffset = center;
+			}
+			else if (positionFormat == MeshPositionFormat::INT16)
+			{
+				positionOffset = center;
+				positionScale.x = obb.halfExtents.x > 0.0f ? obb.halfExtents.x : 1.0f;
+				positionScale.y = obb.halfExtents.y > 0.0f ? obb.halfExtents.y : 1.0f;
+				positionScale.z = obb.halfExtents.z > 0.0f ? obb.halfExtents.z : 1.0f;
+			}
+			positionDecode[0] = createVector4(positionOffset.x, positionOffset.y, positionOffset.z, 0.0f);
+			positionDecode[1] = createVector4(positionScale.x, positionScale.y, positionScale.z, 0.0f);
 
-				const uint16_t positionIndex = positionIndexList[i] * 3;
+			// Vertex decl
+			vertexDecl.begin();
+			switch (positionFormat)
+			{
+				case MeshPositionFormat::HALF: vertexDecl.add(bgfx::Attrib::Position, 4, bgfx::AttribType::Half); break;
+				case MeshPositionFormat::INT16: vertexDecl.add(bgfx::Attrib::Position, 4, bgfx::AttribType::Int16, true); break;
+				default: vertexDecl.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float); break;
+			}
+
+			if (hasNormal == true)
+			{
+				switch (normalFormat)
+				{
+					case MeshNormalFormat::OCTAHEDRAL8: vertexDecl.add(bgfx::Attrib::Normal, 2, bgfx::AttribType::Uint8, true); break;
+					case MeshNormalFormat::OCTAHEDRAL16: vertexDecl.add(bgfx::Attrib::Normal, 2, bgfx::AttribType::Int16, true); break;
+					default: vertexDecl.add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float, true); break;
+				}
+			}
+			if (hasUv == true)
+			{
+				switch (uvFormat)
+				{
+					case MeshUvFormat::HALF: vertexDecl.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Half); break;
+					default: vertexDecl.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float); break;
+				}
+			}
+
+			vertexDecl.end();
+			vertexStride = vertexDecl.getStride();
+
+			// One vertex per index
+			const uint32_t cornerCount = ArrayFn::getCount(positionIndexList);
+			Array<char> cornerBuffer(getDefaultAllocator());
+			ArrayFn::resize(cornerBuffer, cornerCount * vertexStride);
+
+			Array<Vector3> cornerPositionList(getDefaultAllocator());
+			ArrayFn::resize(cornerPositionList, cornerCount);
+
+			float maxPositionError = 0.0f;
+			float maxNormalError = 0.0f;
+			float maxUvError = 0.0f;
+
+			for (uint32_t i = 0; i < cornerCount; ++i)
+			{
+				char* vertex = &cornerBuffer[i * vertexStride];
+
+				const uint32_t positionIndex = positionIndexList[i] * 3;
 				Vector3 xyz;
 				xyz.x = positionList[positionIndex + 0];
 				xyz.y = positionList[positionIndex + 1];
 				xyz.z = positionList[positionIndex + 2];
 				xyz = xyz * localMatrix;
-				ArrayFn::push(vertexBuffer, (char*)&xyz, sizeof(xyz));
+				cornerPositionList[i] = xyz;
+				vertex += encodePosition(xyz, vertex, maxPositionError);
 
 				if (hasNormal == true)
 				{
-					const uint16_t normalIndex = normalIndexList[i] * 3;
+					const uint32_t normalIndex = normalIndexList[i] * 3;
 					Vector3 n;
 					n.x = normalList[normalIndex + 0];
 					n.y = normalList[normalIndex + 1];
 					n.z = normalList[normalIndex + 2];
-					ArrayFn::push(vertexBuffer, (char*)&n, sizeof(n));
+					vertex += encodeNormal(n, vertex, maxNormalError);
 				}
 				if (hasUv == true)
 				{
-					const uint16_t uvIndex = uvIndexList[i] * 2;
+					const uint32_t uvIndex = uvIndexList[i] * 2;
 					Vector2 uv;
 					uv.x = uvList[uvIndex + 0];
 					uv.y = uvList[uvIndex + 1];
-					ArrayFn::push(vertexBuffer, (char*)&uv, sizeof(uv));
+					vertex += encodeUv(uv, vertex, maxUvError);
 				}
 			}
 
-			// Vertex decl
-			vertexDecl.begin();
-			vertexDecl.add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float);
+			// Share the identical corners, then reorder for the post-transform cache and for fetch locality
+			Array<uint32_t> indexList(getDefaultAllocator());
+			ArrayFn::resize(indexList, cornerCount);
+			ArrayFn::resize(vertexBuffer, cornerCount * vertexStride);
 
-			if (hasNormal == true)
+			uint32_t vertexCount = MeshOptimizerFn::weldVertices(ArrayFn::begin(cornerBuffer)
+				, cornerCount
+				, vertexStride
+				, ArrayFn::begin(vertexBuffer)
+				, ArrayFn::begin(indexList)
+				);
+			const float acmrBefore = MeshOptimizerFn::getAverageCacheMissRatio(ArrayFn::begin(indexList), cornerCount, vertexCount, 16);
+			MeshOptimizerFn::optimizeVertexCache(ArrayFn::begin(indexList), cornerCount, vertexCount);
+			const float acmrAfter = MeshOptimizerFn::getAverageCacheMissRatio(ArrayFn::begin(indexList), cornerCount, vertexCount, 16);
+
+			lodCount = 1;
+			lodList[0].indexOffset = 0;
+			lodList[0].indexCount = cornerCount;
+			lodList[0].error = 0.0f;
+
+			if (lodOptionCount > 1)
 			{
-				vertexDecl.add(bgfx::Attrib::Normal, 3, bgfx::AttribType::Float, true);
+				// Simplified LODs index the same vertices
+				Array<Vector3> positionList(getDefaultAllocator());
+				ArrayFn::resize(positionList, vertexCount);
+				for (uint32_t i = 0; i < cornerCount; ++i)
+				{
+					positionList[indexList[i]] = cornerPositionList[i];
+				}
+
+				Array<uint32_t> lodIndexList(getDefaultAllocator());
+				ArrayFn::resize(lodIndexList, cornerCount);
+
+				while (lodCount < lodOptionCount)
+				{
+					const uint32_t previousCount = lodList[lodCount - 1].indexCount;
+					const uint32_t targetCount = uint32_t(float(previousCount / 3) * lodRatio) * 3;
+
+					float error = 0.0f;
+					const uint32_t count = MeshOptimizerFn::simplify(ArrayFn::begin(lodIndexList)
+						, ArrayFn::begin(indexList)
+						, cornerCount
+						, ArrayFn::begin(positionList)
+						, vertexCount
+						, sizeof(Vector3)
+						, targetCount
+						, error
+						);
+
+					// Not worth a LOD
+					if (count == 0 || count > previousCount - previousCount / 10)
+					{
+						break;
+					}
+
+					MeshOptimizerFn::optimizeVertexCache(ArrayFn::begin(lodIndexList), count, vertexCount);
+
+					lodList[lodCount].indexOffset = ArrayFn::getCount(indexList);
+					lodList[lodCount].indexCount = count;
+					lodList[lodCount].error = error;
+					ArrayFn::push(indexList, ArrayFn::begin(lodIndexList), count);
+					++lodCount;
+
+					RIO_LOGI("Mesh geometry: LOD %u %u triangles, error %.6f", lodCount - 1, count / 3, error);
+				}
 			}
-			if (hasUv == true)
+
+			// The vertices are ordered by first use in the full detail LOD
+			const uint32_t indexCount = ArrayFn::getCount(indexList);
+			vertexCount = MeshOptimizerFn::optimizeVertexFetch(ArrayFn::begin(vertexBuffer)
+				, vertexCount
+				, vertexStride
+				, ArrayFn::begin(indexList)
+				, indexCount
+				);
+			ArrayFn::resize(vertexBuffer, vertexCount * vertexStride);
+
+			// 16 bit indices whenever they can address all the vertices
+			indexStride = vertexCount <= UINT16_MAX ? sizeof(uint16_t) : sizeof(uint32_t);
+			ArrayFn::resize(indexBuffer, indexCount * indexStride);
+			if (indexStride == sizeof(uint16_t))
 			{
-				vertexDecl.add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float);
+				uint16_t* indices = (uint16_t*)ArrayFn::begin(indexBuffer);
+				for (uint32_t i = 0; i < indexCount; ++i)
+				{
+					indices[i] = (uint16_t)indexList[i];
+				}
+			}
+			else
+			{
+				memcpy(ArrayFn::begin(indexBuffer), ArrayFn::begin(indexList), indexCount * sizeof(uint32_t));
 			}
 
-			vertexDecl.end();
+			// Size of the unwelded float32 vertices with 16 bit indices
+			const uint32_t floatStride = 3 * sizeof(float)
+				+ (hasNormal ? 3 * sizeof(float) : 0)
+				+ (hasUv ? 2 * sizeof(float) : 0)
+				;
+
+			RIO_LOGI("Mesh geometry: %u -> %u vertices, %u -> %u bytes, ACMR %.2f -> %.2f"
+				, cornerCount
+				, vertexCount
+				, cornerCount * (floatStride + (uint32_t)sizeof(uint16_t))
+				, ArrayFn::getCount(vertexBuffer) + ArrayFn::getCount(indexBuffer)
+				, acmrBefore
+				, acmrAfter
+				);
 
-			// Bounds
-			AabbFn::reset(aabb);
-			AabbFn::addPoints(aabb
-				, ArrayFn::getCount(positionList) / 3
-				, sizeof(float) * 3
-				, ArrayFn::begin(positionList)
+			RIO_LOGI("Mesh geometry: max error position %.6f, normal %.3f deg, uv %.6f"
+				, maxPositionError
+				, maxNormalError
+				, maxUvError
 				);
-			aabb = AabbFn::getTransformed(aabb, localMatrix);
+		}
 
-			obb.transformMatrix = createMatrix4x4(QUATERNION_IDENTITY, AabbFn::getCenter(aabb));
-			obb.halfExtents.x = (aabb.max.x - aabb.min.x) * 0.5f;
-			obb.halfExtents.y = (aabb.max.y - aabb.min.y) * 0.5f;
-			obb.halfExtents.z = (aabb.max.z - aabb.min.z) * 0.5f;
+		// Writes the encoded <position> to <vertex> and returns its size
+		uint32_t encodePosition(const Vector3& position, char* vertex, float& maxError)
+		{
+			const Vector3 offset = createVector3(positionDecode[0].x, positionDecode[0].y, positionDecode[0].z);
+			const Vector3 scale = createVector3(positionDecode[1].x, positionDecode[1].y, positionDecode[1].z);
+			const Vector3 relative = position - offset;
+
+			if (positionFormat == MeshPositionFormat::HALF)
+			{
+				const uint16_t q[4] = { getHalfFromFloat(relative.x), getHalfFromFloat(relative.y), getHalfFromFloat(relative.z), 0 };
+				memcpy(vertex, q, sizeof(q));
+
+				const Vector3 decoded = createVector3(getFloatFromHalf(q[0]), getFloatFromHalf(q[1]), getFloatFromHalf(q[2])) + offset;
+				maxError = getMaxFloat(maxError, getLength(decoded - position));
+				return sizeof(q);
+			}
+
+			if (positionFormat == MeshPositionFormat::INT16)
+			{
+				const int16_t q[4] =
+				{
+					getSnorm16FromFloat(relative.x / scale.x),
+					getSnorm16FromFloat(relative.y / scale.y),
+					getSnorm16FromFloat(relative.z / scale.z),
+					0
+				};
+				memcpy(vertex, q, sizeof(q));
+
+				Vector3 decoded;
+				decoded.x = getFloatFromSnorm16(q[0]) * scale.x + offset.x;
+				decoded.y = getFloatFromSnorm16(q[1]) * scale.y + offset.y;
+				decoded.z = getFloatFromSnorm16(q[2]) * scale.z + offset.z;
+				maxError = getMaxFloat(maxError, getLength(decoded - position));
+				return sizeof(q);
+			}
+
+			memcpy(vertex, &position, sizeof(position));
+			return sizeof(position);
+		}
+
+		// Writes the encoded <normal> to <vertex> and returns its size
+		uint32_t encodeNormal(const Vector3& normal, char* vertex, float& maxError)
+		{
+			if (normalFormat == MeshNormalFormat::FLOAT)
+			{
+				memcpy(vertex, &normal, sizeof(normal));
+				return sizeof(normal);
+			}
+
+			Vector3 n = normal;
+			normalize(n);
+			const Vector2 e = getOctahedralFromNormal(n);
+
+			Vector2 decoded;
+			uint32_t size = 0;
+			if (normalFormat == MeshNormalFormat::OCTAHEDRAL8)
+			{
+				const uint8_t q[2] = { getUnorm8FromFloat(e.x * 0.5f + 0.5f), getUnorm8FromFloat(e.y * 0.5f + 0.5f) };
+				memcpy(vertex, q, sizeof(q));
+				decoded.x = getFloatFromUnorm8(q[0]) * 2.0f - 1.0f;
+				decoded.y = getFloatFromUnorm8(q[1]) * 2.0f - 1.0f;
+				size = sizeof(q);
+			}
+			else
+			{
+				const int16_t q[2] = { getSnorm16FromFloat(e.x), getSnorm16FromFloat(e.y) };
+				memcpy(vertex, q, sizeof(q));
+				decoded.x = getFloatFromSnorm16(q[0]);
+				decoded.y = getFloatFromSnorm16(q[1]);
+				size = sizeof(q);
+			}
+
+			const float cosAngle = getClampedFloat(-1.0f, 1.0f, dot(getNormalFromOctahedral(decoded), n));
+			maxError = getMaxFloat(maxError, getDegreesFromRadians(acosf(cosAngle)));
+			return size;
+		}
+
+		// Writes the encoded <uv> to <vertex> and returns its size
+		uint32_t encodeUv(const Vector2& uv, char* vertex, float& maxError)
+		{
+			if (uvFormat == MeshUvFormat::HALF)
+			{
+				const uint16_t q[2] = { getHalfFromFloat(uv.x), getHalfFromFloat(uv.y) };
+				memcpy(vertex, q, sizeof(q));
+
+				const Vector2 decoded = createVector2(getFloatFromHalf(q[0]), getFloatFromHalf(q[1]));
+				maxError = getMaxFloat(maxError, getLength(decoded - uv));
+				return sizeof(q);
+			}
+
+			memcpy(vertex, &uv, sizeof(uv));
+			return sizeof(uv);
 		}
 
 		void write()
 		{
 			compileOptions.write(vertexDecl);
 			compileOptions.write(obb);
+			compileOptions.write(positionFormat);
+			compileOptions.write(positionDecode);
 
 			compileOptions.write(ArrayFn::getCount(vertexBuffer) / vertexStride);
 			compileOptions.write(vertexStride);
-			compileOptions.write(ArrayFn::getCount(indexBuffer));
+			compileOptions.write(ArrayFn::getCount(indexBuffer) / indexStride);
+			compileOptions.write(indexStride);
 
 			compileOptions.write(vertexBuffer);
-			compileOptions.write(ArrayFn::begin(indexBuffer), ArrayFn::getCount(indexBuffer) * sizeof(uint16_t));
+			compileOptions.write(indexBuffer);
+
+			compileOptions.write(lodCount);
+			for (uint32_t i = 0; i < lodCount; ++i)
+			{
+				compileOptions.write(lodList[i]);
+			}
 		}
 
 		CompileOptions& compileOptions;
@@ -234,21 +547,34 @@ namespace MeshResourceInternalFn
 		Array<float> tangentList;
 		Array<float> binormalList;
 
-		Array<uint16_t> positionIndexList;
-		Array<uint16_t> normalIndexList;
-		Array<uint16_t> uvIndexList;
-		Array<uint16_t> tangentIndexList;
-		Array<uint16_t> binormalIndexList;
+		Array<uint32_t> positionIndexList;
+		Array<uint32_t> normalIndexList;
+		Array<uint32_t> uvIndexList;
+		Array<uint32_t> tangentIndexList;
+		Array<uint32_t> binormalIndexList;
 
 		Matrix4x4 localMatrix = MATRIX4X4_IDENTITY;
 
 		uint32_t vertexStride = 0;
+		uint32_t indexStride = 0;
 		Array<char> vertexBuffer;
-		Array<uint16_t> indexBuffer;
+		Array<char> indexBuffer;
 
 		Aabb aabb;
 		Obb obb;
 
+		// Per mesh compression options
+		uint32_t positionFormat = MeshPositionFormat::FLOAT;
+		uint32_t normalFormat = MeshNormalFormat::FLOAT;
+		uint32_t uvFormat = MeshUvFormat::FLOAT;
+		Vector4 positionDecode[2];
+
+		// Per mesh LOD options, <lodOptionCount> includes the full detail LOD
+		uint32_t lodOptionCount = 1;
+		float lodRatio = 0.5f;
+		uint32_t lodCount = 0;
+		MeshLod lodList[RIO_MAX_MESH_LODS];
+
 		bgfx::VertexDecl vertexDecl;
 
 		bool hasNormal = false;
@@ -259,33 +585,38 @@ namespace MeshResourceInternalFn
 	{
 		Buffer buffer = compileOptions.read(path);
 
-		TempAllocator4096 ta;
-		JsonObject jsonObject(ta);
-		JsonRFn::parse(buffer, jsonObject);
+		JsonTape tape(getDefaultAllocator());
+		JsonTapeFn::parse(buffer, tape);
 
-		JsonObject geometries(ta);
-		JsonRFn::parse(jsonObject["geometries"], geometries);
-		JsonObject nodes(ta);
-		JsonRFn::parse(jsonObject["nodes"], nodes);
+		const uint32_t root = JsonTapeFn::getRoot(tape);
+		const uint32_t geometries = JsonTapeFn::get(tape, root, "geometries");
+		const uint32_t nodes = JsonTapeFn::get(tape, root, "nodes");
 
 		compileOptions.write(RESOURCE_VERSION_MESH);
-		compileOptions.write(JsonObjectFn::getCount(geometries));
+		compileOptions.write(JsonTapeFn::getMemberCount(tape, geometries));
 
 		MeshCompiler meshCompiler(compileOptions);
 
-		auto begin = JsonObjectFn::begin(geometries);
-		auto end = JsonObjectFn::end(geometries);
-		for (; begin != end; ++begin)
+		const uint32_t compression = JsonTapeFn::find(tape, root, "compression");
+		if (compression != JSON_TAPE_INVALID)
+		{
+			meshCompiler.parseCompression(tape, compression);
+		}
+
+		const uint32_t lod = JsonTapeFn::find(tape, root, "lod");
+		if (lod != JSON_TAPE_INVALID)
 		{
-			const FixedString key = begin->pair.first;
-			const char* geometry = begin->pair.second;
-			const char* node = nodes[key];
+			meshCompiler.parseLod(tape, lod);
+		}
+
+		for (uint32_t geometry = JsonTapeFn::getFirstMember(tape, geometries); geometry != JSON_TAPE_INVALID; geometry = JsonTapeFn::getNextMember(tape, geometry))
+		{
+			const uint32_t node = JsonTapeFn::get(tape, nodes, JsonTapeFn::getKey(tape, geometry));
 
-			const StringId32 name(key.getData(), key.getLength());
-			compileOptions.write(name.id);
+			compileOptions.write(JsonTapeFn::getKeyId(tape, geometry).id);
 
 			meshCompiler.reset();
-			meshCompiler.parse(geometry, node);
+			meshCompiler.parse(tape, geometry, node);
 			meshCompiler.compile();
 			meshCompiler.write();
 		}
@@ -317,6 +648,12 @@ namespace MeshResourceInternalFn
 			Obb obb;
 			binaryReader.read(obb);
 
+			uint32_t positionFormat;
+			binaryReader.read(positionFormat);
+
+			Vector4 positionDecode[2];
+			binaryReader.read(positionDecode);
+
 			uint32_t verticesCount;
 			binaryReader.read(verticesCount);
 
@@ -326,13 +663,19 @@ namespace MeshResourceInternalFn
 			uint32_t indicesCount;
 			binaryReader.read(indicesCount);
 
+			uint32_t indexStride;
+			binaryReader.read(indexStride);
+
 			const uint32_t verticesSize = verticesCount * stride;
-			const uint32_t indicesSize = indicesCount * sizeof(uint16_t);
+			const uint32_t indicesSize = indicesCount * indexStride;
 
 			const uint32_t size = sizeof(MeshGeometry) + verticesSize + indicesSize;
 
 			MeshGeometry* meshGeometry = (MeshGeometry*)a.allocate(size);
 			meshGeometry->obb = obb;
+			meshGeometry->positionFormat = positionFormat;
+			meshGeometry->positionDecode[0] = positionDecode[0];
+			meshGeometry->positionDecode[1] = positionDecode[1];
 			meshGeometry->vertexDecl = vertexDecl;
 			meshGeometry->vertexBufferHandle = BGFX_INVALID_HANDLE;
 			meshGeometry->indexBufferHandle = BGFX_INVALID_HANDLE;
@@ -340,11 +683,19 @@ namespace MeshResourceInternalFn
 			meshGeometry->vertices.stride = stride;
 			meshGeometry->vertices.data = (char*)&meshGeometry[1];
 			meshGeometry->indices.indicesCount = indicesCount;
+			meshGeometry->indices.stride = indexStride;
 			meshGeometry->indices.data = meshGeometry->vertices.data + verticesSize;
 
 			binaryReader.read(meshGeometry->vertices.data, verticesSize);
 			binaryReader.read(meshGeometry->indices.data, indicesSize);
 
+			binaryReader.read(meshGeometry->lodCount);
+			RIO_ASSERT(meshGeometry->lodCount <= RIO_MAX_MESH_LODS, "Too many LODs");
+			for (uint32_t lod = 0; lod < meshGeometry->lodCount; ++lod)
+			{
+				binaryReader.read(meshGeometry->lodList[lod]);
+			}
+
 			meshResource->geometryNameList[i] = name;
 			meshResource->meshGeometryList[i] = meshGeometry;
 		}
@@ -361,13 +712,15 @@ namespace MeshResourceInternalFn
 			MeshGeometry& meshGeometry = *meshResource->meshGeometryList[i];
 
 			const uint32_t verticesSize = meshGeometry.vertices.verticesCount * meshGeometry.vertices.stride;
-			const uint32_t indicesSize = meshGeometry.indices.indicesCount * sizeof(uint16_t);
+			const uint32_t indicesSize = meshGeometry.indices.indicesCount * meshGeometry.indices.stride;
 
 			const bgfx::Memory* vertexMemory = bgfx::makeRef(meshGeometry.vertices.data, verticesSize);
 			const bgfx::Memory* indexMemory = bgfx::makeRef(meshGeometry.indices.data, indicesSize);
 
 			bgfx::VertexBufferHandle vertexBufferHandle = bgfx::createVertexBuffer(vertexMemory, meshGeometry.vertexDecl);
-			bgfx::IndexBufferHandle indexBufferHandle  = bgfx::createIndexBuffer(indexMemory);
+			bgfx::IndexBufferHandle indexBufferHandle  = bgfx::createIndexBuffer(indexMemory
+				, meshGeometry.indices.stride == sizeof(uint32_t) ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE
+				);
 			RIO_ASSERT(bgfx::isValid(vertexBufferHandle), "Invalid vertex buffer");
 			RIO_ASSERT(bgfx::isValid(indexBufferHandle), "Invalid index buffer");
 
@@ -399,5 +752,40 @@ namespace MeshResourceInternalFn
 	}
 } // namespace MeshResourceInternalFn
 
+namespace MeshResourceFn
+{
+	void decodePositions(const MeshGeometry& meshGeometry, Vector3* output)
+	{
+		const Vector4& offset = meshGeometry.positionDecode[0];
+		const Vector4& scale = meshGeometry.positionDecode[1];
+		const char* vertex = meshGeometry.vertices.data;
+
+		for (uint32_t i = 0; i < meshGeometry.vertices.verticesCount; ++i, vertex += meshGeometry.vertices.stride)
+		{
+			Vector3 p;
+			if (meshGeometry.positionFormat == MeshPositionFormat::HALF)
+			{
+				uint16_t q[3];
+				memcpy(q, vertex, sizeof(q));
+				p = createVector3(getFloatFromHalf(q[0]), getFloatFromHalf(q[1]), getFloatFromHalf(q[2]));
+			}
+			else if (meshGeometry.positionFormat == MeshPositionFormat::INT16)
+			{
+				int16_t q[3];
+				memcpy(q, vertex, sizeof(q));
+				p = createVector3(getFloatFromSnorm16(q[0]), getFloatFromSnorm16(q[1]), getFloatFromSnorm16(q[2]));
+			}
+			else
+			{
+				memcpy(&p, vertex, sizeof(p));
+			}
+
+			output[i].x = p.x * scale.x + offset.x;
+			output[i].y = p.y * scale.y + offset.y;
+			output[i].z = p.z * scale.z + offset.z;
+		}
+	}
+} // namespace MeshResourceFn
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -1,6 +1,7 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #pragma once
 
+#include "Config.h"
 #include "Core/Memory/MemoryTypes.h"
 #include "Core/FileSystem/FileSystemTypes.h"
 #include "Core/Math/MathTypes.h"
@@ -16,6 +17,44 @@
 namespace Rio
 {
 
+// Vertex position encodings, quantized positions are relative to the geometry bounds
+struct MeshPositionFormat
+{
+	enum Enum
+	{
+		FLOAT,
+		HALF,
+		INT16,
+
+		COUNT
+	};
+};
+
+// Vertex normal encodings, octahedral normals are 2 components
+struct MeshNormalFormat
+{
+	enum Enum
+	{
+		FLOAT,
+		OCTAHEDRAL8,
+		OCTAHEDRAL16,
+
+		COUNT
+	};
+};
+
+// Vertex texture coordinate encodings
+struct MeshUvFormat
+{
+	enum Enum
+	{
+		FLOAT,
+		HALF,
+
+		COUNT
+	};
+};
+
 struct VertexData
 {
 	uint32_t verticesCount;
@@ -26,7 +65,16 @@ struct VertexData
 struct IndexData
 {
 	uint32_t indicesCount;
-	char* data; // size = indicesCount * sizeof(uint16_t)
+	uint32_t stride; // sizeof(uint16_t) or sizeof(uint32_t)
+	char* data; // size = indicesCount * stride
+};
+
+// Level of detail, a range of the geometry index buffer
+struct MeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error; // Largest distance from the full detail surface, in mesh units
 };
 
 struct MeshGeometry
@@ -35,8 +83,12 @@ struct MeshGeometry
 	bgfx::VertexBufferHandle vertexBufferHandle;
 	bgfx::IndexBufferHandle indexBufferHandle;
 	Obb obb;
+	uint32_t positionFormat; // MeshPositionFormat::Enum
+	Vector4 positionDecode[2]; // Offset and scale of the encoded positions, see uniformPositionDecode
 	VertexData vertices;
-	IndexData indices;
+	IndexData indices; // Indices of all the LODs
+	uint32_t lodCount;
+	MeshLod lodList[RIO_MAX_MESH_LODS]; // From full detail to coarsest
 };
 
 struct MeshResource
@@ -74,5 +126,11 @@ namespace MeshResourceInternalFn
 	void unload(Allocator& a, void* resource);
 } // namespace MeshResourceInternalFn
 
+namespace MeshResourceFn
+{
+	// Decodes the <meshGeometry> vertex positions into <output>, which must have room for all the vertices
+	void decodePositions(const MeshGeometry& meshGeometry, Vector3* output);
+} // namespace MeshResourceFn
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
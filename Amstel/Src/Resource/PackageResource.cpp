@@ -3,6 +3,7 @@
 
 #include "Core/Containers/Array.h"
 #include "Core/Containers/Map.h"
+#include "Core/Containers/Vector.h"
 #include "Core/FileSystem/File.h"
 #include "Core/FileSystem/FileSystem.h"
 #include "Core/FileSystem/ReaderWriter.h"
@@ -35,6 +36,74 @@ namespace PackageResourceInternalFn
 		}
 	}
 
+	// Sprite textures packed into an atlas are loaded with the atlas,
+	// unless a material of the package other than a sprite material samples them
+	void compileTextures(const JsonArray& names, const JsonArray& materialNames, Array<PackageResource::Resource>& output, CompileOptions& compileOptions)
+	{
+		const SpriteAtlasTable& spriteAtlasTable = compileOptions.getSpriteAtlasTable();
+
+		Vector<DynamicString> sampledTextureList(getDefaultAllocator());
+		for (uint32_t i = 0; i < ArrayFn::getCount(materialNames); ++i)
+		{
+			TempAllocator4096 ta;
+			DynamicString materialPath(ta);
+			JsonRFn::parseString(materialNames[i], materialPath);
+			RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_MATERIAL, materialPath.getCStr(), compileOptions);
+
+			if (SpriteAtlasInternalFn::getIsSpriteMaterial(spriteAtlasTable, materialPath.getCStr()))
+			{
+				continue;
+			}
+
+			materialPath += "." RESOURCE_EXTENSION_MATERIAL;
+			Buffer buffer = compileOptions.read(materialPath.getCStr());
+			JsonObject material(ta);
+			JsonRFn::parse(buffer, material);
+			if (!JsonObjectFn::has(material, "textures"))
+			{
+				continue;
+			}
+
+			JsonObject textureMap(ta);
+			JsonRFn::parse(material["textures"], textureMap);
+			auto begin = JsonObjectFn::begin(textureMap);
+			auto end = JsonObjectFn::end(textureMap);
+			for (; begin != end; ++begin)
+			{
+				DynamicString texture(ta);
+				JsonRFn::parseString(begin->pair.second, texture);
+				VectorFn::pushBack(sampledTextureList, texture);
+			}
+		}
+
+		const StringId64 typeHash = StringId64(RESOURCE_EXTENSION_TEXTURE);
+		for (uint32_t i = 0; i < ArrayFn::getCount(names); ++i)
+		{
+			TempAllocator1024 ta;
+			DynamicString name(ta);
+			JsonRFn::parseString(names[i], name);
+
+			RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_TEXTURE, name.getCStr(), compileOptions);
+
+			SpriteAtlasRegion region;
+			if (SpriteAtlasInternalFn::getRegion(spriteAtlasTable, name.getCStr(), region))
+			{
+				bool isSampled = false;
+				for (uint32_t j = 0; j < VectorFn::getCount(sampledTextureList) && !isSampled; ++j)
+				{
+					isSampled = sampledTextureList[j] == name;
+				}
+				if (!isSampled)
+				{
+					continue;
+				}
+			}
+
+			const StringId64 nameHash = JsonRFn::parseResourceId(names[i]);
+			ArrayFn::pushBack(output, PackageResource::Resource(typeHash, nameHash));
+		}
+	}
+
 	void compile(const char* path, CompileOptions& compileOptions)
 	{
 		Buffer buffer = compileOptions.read(path);
@@ -75,7 +144,7 @@ namespace PackageResourceInternalFn
 
 		Array<PackageResource::Resource> resources(getDefaultAllocator());
 
-		compileResources("texture", texture, resources, compileOptions);
+		compileTextures(texture, material, resources, compileOptions);
 		compileResources("shader", shader, resources, compileOptions);
 		compileResources("mesh", mesh, resources, compileOptions);
 		compileResources("material", material, resources, compileOptions);
@@ -91,6 +160,13 @@ namespace PackageResourceInternalFn
 		compileResources("script", script, resources, compileOptions);
 		
 		compileResources("physicsConfig", physicsConfig, resources, compileOptions);
+
+		Array<StringId64> atlasNameList(getDefaultAllocator());
+		SpriteAtlasInternalFn::getDependencies(compileOptions.getSpriteAtlasTable(), path, atlasNameList);
+		for (uint32_t i = 0; i < ArrayFn::getCount(atlasNameList); ++i)
+		{
+			ArrayFn::pushBack(resources, PackageResource::Resource(StringId64(RESOURCE_EXTENSION_TEXTURE), atlasNameList[i]));
+		}
 		
 		// Write
 		compileOptions.write(RESOURCE_VERSION_PACKAGE);
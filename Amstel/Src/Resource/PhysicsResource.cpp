@@ -182,30 +182,37 @@ namespace PhysicsResourceInternalFn
 		Matrix4x4 localMatrix = JsonRFn::parseMatrix4x4(node["localMatrix"]);
 		colliderDesc.localTransformMatrix = localMatrix;
 
-		JsonArray positionList(ta);
-		JsonRFn::parseArray(geometry["position"], positionList);
+		Array<float> positionList(getDefaultAllocator());
+		ArrayFn::resize(positionList, JsonRFn::getArrayCount(geometry["position"]));
+		const uint32_t positionCount = JsonRFn::parseFloatArrayInto(geometry["position"], ArrayFn::begin(positionList), ArrayFn::getCount(positionList));
+		RESOURCE_COMPILER_ASSERT(positionCount == ArrayFn::getCount(positionList), compileOptions, "Bad position array");
 
 		JsonObject indices(ta);
 		JsonArray indicesData(ta);
-		JsonArray positionIndexList(ta);
 		JsonRFn::parseObject(geometry["indices"], indices);
 		JsonRFn::parseArray(indices["data"], indicesData);
-		JsonRFn::parseArray(indicesData[0], positionIndexList);
+
+		Array<uint32_t> positionIndexList(getDefaultAllocator());
+		ArrayFn::resize(positionIndexList, JsonRFn::getArrayCount(indicesData[0]));
+		const uint32_t positionIndexCount = JsonRFn::parseUintArrayInto(indicesData[0], ArrayFn::begin(positionIndexList), ArrayFn::getCount(positionIndexList));
+		RESOURCE_COMPILER_ASSERT(positionIndexCount == ArrayFn::getCount(positionIndexList), compileOptions, "Bad index array");
 
 		Array<Vector3> points(getDefaultAllocator());
-		for (uint32_t i = 0; i < ArrayFn::getCount(positionList); i += 3)
+		ArrayFn::reserve(points, ArrayFn::getCount(positionList) / 3);
+		for (uint32_t i = 0; i + 2 < ArrayFn::getCount(positionList); i += 3)
 		{
 			Vector3 p;
-			p.x = JsonRFn::parseFloat(positionList[i + 0]);
-			p.y = JsonRFn::parseFloat(positionList[i + 1]);
-			p.z = JsonRFn::parseFloat(positionList[i + 2]);
+			p.x = positionList[i + 0];
+			p.y = positionList[i + 1];
+			p.z = positionList[i + 2];
 			ArrayFn::pushBack(points, p*localMatrix);
 		}
 
 		Array<uint16_t> pointIndexList(getDefaultAllocator());
+		ArrayFn::resize(pointIndexList, ArrayFn::getCount(positionIndexList));
 		for (uint32_t i = 0; i < ArrayFn::getCount(positionIndexList); ++i)
 		{
-			ArrayFn::pushBack(pointIndexList, (uint16_t)JsonRFn::parseInt(positionIndexList[i]));
+			pointIndexList[i] = (uint16_t)positionIndexList[i];
 		}
 
 		switch (colliderDesc.type)
@@ -7,6 +7,7 @@
 #include "Core/FileSystem/Path.h"
 #include "Core/Containers/Queue.h"
 #include "Core/Memory/TempAllocator.h"
+#include "Device/Profiler.h"
 
 namespace Rio
 {
@@ -85,6 +86,8 @@ void ResourceLoader::getLoaded(Array<ResourceRequest>& loaded)
 
 int32_t ResourceLoader::run()
 {
+	ProfilerFn::setThreadName("resourceLoader");
+
 	while (exitRequested == false)
 	{
 		mutex.lock();
@@ -110,10 +113,13 @@ int32_t ResourceLoader::run()
 		DynamicString path(ta);
 		PathFn::join(RIO_DATA_DIRECTORY, resoursePath.getCStr(), path);
 
-		File* file = fileSystem.open(path.getCStr(), FileOpenMode::READ);
-		
-		resourceRequest.data = resourceRequest.loadFunction(*file, *resourceRequest.allocator);
-		fileSystem.close(*file);
+		{
+			PROFILE_SCOPE("resource.load");
+			File* file = fileSystem.open(path.getCStr(), FileOpenMode::READ);
+
+			resourceRequest.data = resourceRequest.loadFunction(*file, *resourceRequest.allocator);
+			fileSystem.close(*file);
+		}
 
 		addLoaded(resourceRequest);
 		mutex.lock();
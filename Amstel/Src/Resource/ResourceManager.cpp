@@ -9,7 +9,7 @@
 namespace Rio
 {
 
-const ResourceManager::ResourceEntry ResourceManager::ResourceEntry::NOT_FOUND = { 0xffffffffu, nullptr };
+const ResourceManager::ResourceEntry ResourceManager::ResourceEntry::NOT_FOUND = { 0xffffffffu, nullptr, 0 };
 
 ResourceManager::ResourceManager(ResourceLoader& resourceLoader)
 	: resourceHeap(getDefaultAllocator(), "resource")
@@ -132,6 +132,12 @@ const void* ResourceManager::get(StringId64 type, StringId64 name)
 	return entry.data;
 }
 
+uint32_t ResourceManager::getGeneration(StringId64 type, StringId64 name)
+{
+	const ResourcePair id = { type, name };
+	return SortMapFn::get(resourceMap, id, ResourceEntry::NOT_FOUND).generation;
+}
+
 void ResourceManager::enableResourceAutoload(bool resourceAutoloadEnabled)
 {
 	this->resourceAutoloadEnabled = resourceAutoloadEnabled;
@@ -160,6 +166,7 @@ void ResourceManager::completeRequest(StringId64 type, StringId64 name, void* da
 	ResourceEntry entry;
 	entry.references = 1;
 	entry.data = data;
+	entry.generation = ++lastGeneration;
 
 	ResourcePair id = { type, name };
 
@@ -41,6 +41,7 @@ private:
 
 		uint32_t references;
 		void* data;
+		uint32_t generation;
 	};
 
 	struct ResourceTypeData
@@ -69,6 +70,9 @@ public:
 	bool canGet(StringId64 type, StringId64 name);
 	// Returns the data of the resource (<type>, <name>)
 	const void* get(StringId64 type, StringId64 name);
+	// Returns a number which changes whenever the resource (<type>, <name>) is loaded or reloaded, 0 if it is not loaded
+	// Data derived from the resource is stale when the generation changes, even if the resource lands at the same address
+	uint32_t getGeneration(StringId64 type, StringId64 name);
 	// Sets whether resources should be automatically loaded when accessed
 	void enableResourceAutoload(bool enable);
 	// Blocks until all load() requests have been completed
@@ -87,6 +91,7 @@ private:
 	ResourceLoader* resourceLoader;
 	ResourceTypeDataMap resourceTypeDataMap;
 	ResourceMap resourceMap;
+	uint32_t lastGeneration = 0;
 	bool resourceAutoloadEnabled = false;
 };
 
@@ -26,6 +26,7 @@ ResourcePackage::~ResourcePackage()
 
 void ResourcePackage::load()
 {
+	loadedCount = 0;
 	for (uint32_t i = 0; i < ArrayFn::getCount(packageResource->resources); ++i)
 	{
 		resourceManager->load(packageResource->resources[i].type, packageResource->resources[i].name);
@@ -34,6 +35,7 @@ void ResourcePackage::load()
 
 void ResourcePackage::unload()
 {
+	loadedCount = 0;
 	for (uint32_t i = 0; i < ArrayFn::getCount(packageResource->resources); ++i)
 	{
 		resourceManager->unload(packageResource->resources[i].type, packageResource->resources[i].name);
@@ -47,15 +49,22 @@ void ResourcePackage::flush()
 
 bool ResourcePackage::hasLoaded() const
 {
-	for (uint32_t i = 0; i < ArrayFn::getCount(packageResource->resources); ++i)
+	return getPendingCount() == 0;
+}
+
+uint32_t ResourcePackage::getPendingCount() const
+{
+	const uint32_t count = ArrayFn::getCount(packageResource->resources);
+	while (loadedCount < count)
 	{
-		if (!resourceManager->canGet(packageResource->resources[i].type, packageResource->resources[i].name))
+		if (!resourceManager->canGet(packageResource->resources[loadedCount].type, packageResource->resources[loadedCount].name))
 		{
-			return false;
+			break;
 		}
+		++loadedCount;
 	}
 
-	return true;
+	return count - loadedCount;
 }
 
 } // namespace Rio
@@ -26,10 +26,14 @@ public:
 	void flush();
 	// Returns whether the package has been loaded
 	bool hasLoaded() const;
+	// Returns the number of resources in the package which have not been loaded yet
+	// Resources complete in about the order they were requested, so repeated calls only check the first pending ones
+	uint32_t getPendingCount() const;
 private:
 	ResourceManager* resourceManager;
 	StringId64 id;
 	const PackageResource* packageResource = nullptr;
+	mutable uint32_t loadedCount = 0; // The resources before this index have been loaded
 };
 
 } // namespace Rio
@@ -5,6 +5,7 @@ namespace Rio
 {
 	class ResourceLoader;
 	class ResourceManager;
+	class TextureStreamer;
 	struct ResourcePackage;
 
 	struct TextureResource;
@@ -65,7 +66,7 @@ namespace Rio
 #define RESOURCE_VERSION_FONT uint32_t(1)
 #define RESOURCE_VERSION_LEVEL uint32_t(1)
 #define RESOURCE_VERSION_MATERIAL uint32_t(1)
-#define RESOURCE_VERSION_MESH uint32_t(1)
+#define RESOURCE_VERSION_MESH uint32_t(4)
 #define RESOURCE_VERSION_PACKAGE uint32_t(1)
 #define RESOURCE_VERSION_PHYSICS_CONFIG uint32_t(1)
 #define RESOURCE_VERSION_PHYSICS uint32_t(1)
@@ -74,7 +75,7 @@ namespace Rio
 #define RESOURCE_VERSION_SOUND uint32_t(1)
 #define RESOURCE_VERSION_SPRITE_ANIMATION uint32_t(1)
 #define RESOURCE_VERSION_SPRITE uint32_t(1)
-#define RESOURCE_VERSION_TEXTURE uint32_t(1)
+#define RESOURCE_VERSION_TEXTURE uint32_t(2)
 #define RESOURCE_VERSION_UNIT uint32_t(1)
 
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -4,11 +4,14 @@
 #include "Config.h"
 #include "Core/FileSystem/FileSystem.h"
 #include "Core/Containers/Map.h"
+#include "Core/Base/Murmur.h"
 #include "Core/Base/Os.h"
 #include "Core/Json/JsonR.h"
 #include "Core/Json/JsonObject.h"
 #include "Core/Strings/StringStream.h"
 #include "Core/Memory/TempAllocator.h"
+#include "Core/Thread/AtomicInt.h"
+#include "Core/Thread/Thread.h"
 
 #include "Device/Device.h"
 
@@ -445,7 +448,48 @@ namespace ShaderResourceInternalFn
 		return SamplerWrap::COUNT;
 	}
 
-	static int runExternalCompiler(const char* inputFile, const char* outputFile, const char* varying, const char* type, const char* platform, StringStream& output)
+	// Decoders of the quantized mesh vertex formats, see MeshPositionFormat and MeshNormalFormat
+	// Vertex shaders should read positions with decodePosition() whatever the mesh format
+	static const char* meshDecodeShaderCode =
+		"\n"
+		"uniform vec4 uniformPositionDecode[2];\n"
+		"vec3 decodePosition(vec3 position)\n"
+		"{\n"
+		"	return position * uniformPositionDecode[1].xyz + uniformPositionDecode[0].xyz;\n"
+		"}\n"
+		"vec3 decodeOctahedral(vec2 e)\n"
+		"{\n"
+		"	vec3 n = vec3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	float t = max(-n.z, 0.0);\n"
+		"	n.x += n.x >= 0.0 ? -t : t;\n"
+		"	n.y += n.y >= 0.0 ? -t : t;\n"
+		"	return normalize(n);\n"
+		"}\n"
+		"vec3 decodeOctahedral8(vec2 e)\n"
+		"{\n"
+		"	return decodeOctahedral(e * 2.0 - 1.0);\n"
+		"}\n"
+		;
+
+	// Returns the shader model passed to shaderc, if any
+	static const char* getShadercProfile(const char* type, const char* platform)
+	{
+		if (strcmp("windows", platform) == 0)
+		{
+			return (strcmp(type, "vertex") == 0) ? "vs_3_0" : "ps_3_0";
+		}
+
+		return "";
+	}
+
+	// Returns a value which changes whenever shaderc is rebuilt
+	static uint64_t getShadercVersion()
+	{
+		return OsFn::getDoesExist(SHADERC_PATH) ? OsFn::getLastModifiedTime(SHADERC_PATH) : 0;
+	}
+
+	// Compiles <inputFile> to <outputFile>, or only writes the preprocessed source to <outputFile> if <preprocessOnly>
+	static int runExternalCompiler(const char* inputFile, const char* outputFile, const char* varying, const char* type, const char* platform, bool preprocessOnly, StringStream& output)
 	{
 		TempAllocator512 ta;
 		StringStream arguments(ta);
@@ -454,15 +498,140 @@ namespace ShaderResourceInternalFn
 		arguments << " --varyingdef " << varying;
 		arguments << " --type " << type;
 		arguments << " --platform " << platform;
-		if (strcmp("windows", platform) == 0)
+		const char* profile = getShadercProfile(type, platform);
+		if (profile[0] != '\0')
+		{
+			arguments << " --profile " << profile;
+		}
+		if (preprocessOnly)
 		{
-			arguments << " --profile ";
-			arguments << ((strcmp(type, "vertex") == 0) ? "vs_3_0" : "ps_3_0");
+			arguments << " --preprocess";
 		}
 
 		return OsFn::executeProcess(SHADERC_PATH, StringStreamFn::getCStr(arguments), output);
 	}
 
+	// A vertex or fragment shader to compile with shaderc, or to read from the cache
+	struct ShaderCompileJob
+	{
+		ALLOCATOR_AWARE;
+
+		ShaderCompileJob(Allocator& a)
+			: source(a)
+			, sourcePath(a)
+			, varyingPath(a)
+			, preprocessedPath(a)
+			, compiledPath(a)
+			, cachePath(a)
+			, output(a)
+			, compiled(a)
+		{
+		}
+
+		const char* type = nullptr;
+		const DynamicString* varying = nullptr;
+		StringStream source;
+		// Each job has its own temporary files so that the jobs can run concurrently
+		DynamicString sourcePath;
+		DynamicString varyingPath;
+		DynamicString preprocessedPath;
+		DynamicString compiledPath;
+		DynamicString cachePath;
+		StringStream output;
+		Buffer compiled;
+		uint64_t hash = 0; // Of everything but the preprocessed source, see ShaderCompiler::addJob()
+		int exitCode = 0;
+		bool isCached = false;
+	};
+
+	struct ShaderCompileQueue
+	{
+		ShaderCompileQueue(CompileOptions& compileOptions, Allocator& a)
+			: compileOptions(compileOptions)
+			, jobList(a)
+			, nextJob(0)
+		{
+		}
+
+		CompileOptions& compileOptions;
+		Vector<ShaderCompileJob> jobList;
+		AtomicInt nextJob;
+	};
+
+	// Pulls jobs from <data>, a ShaderCompileQueue, preprocesses them and runs shaderc on those not in the cache until none is left
+	// The cache is keyed on the preprocessed source, so that changes to the included files miss the cache
+	// Only the temporary files of the job are touched, errors are reported by the compiler thread once all jobs are done
+	static int32_t compileThreadFunction(void* data)
+	{
+		ShaderCompileQueue& shaderCompileQueue = *(ShaderCompileQueue*)data;
+		CompileOptions& compileOptions = shaderCompileQueue.compileOptions;
+		const int jobCount = int(VectorFn::getCount(shaderCompileQueue.jobList));
+
+		for (int i = shaderCompileQueue.nextJob.fetchAdd(1); i < jobCount; i = shaderCompileQueue.nextJob.fetchAdd(1))
+		{
+			ShaderCompileJob& job = shaderCompileQueue.jobList[i];
+
+			compileOptions.writeTemporary(job.sourcePath.getCStr(), job.source);
+			compileOptions.writeTemporary(job.varyingPath.getCStr(), job.varying->getCStr(), job.varying->getLength());
+
+			job.exitCode = runExternalCompiler(job.sourcePath.getCStr()
+				, job.preprocessedPath.getCStr()
+				, job.varyingPath.getCStr()
+				, job.type
+				, compileOptions.getPlatform()
+				, true
+				, job.output
+				);
+			if (job.exitCode == 0)
+			{
+				const Buffer preprocessed = compileOptions.readTemporary(job.preprocessedPath.getCStr());
+				const uint64_t hash = getMurmurHash64(ArrayFn::begin(preprocessed), ArrayFn::getCount(preprocessed), job.hash);
+
+				TempAllocator128 ta;
+				DynamicString hashStr(ta);
+				StringId64(hash).toString(hashStr);
+				DynamicString cacheName(ta);
+				cacheName += "shader-";
+				cacheName += hashStr;
+				cacheName += ".bin";
+				compileOptions.getCachePath(cacheName.getCStr(), job.cachePath);
+
+				job.isCached = compileOptions.doesTemporaryExist(job.cachePath.getCStr());
+			}
+
+			if (job.isCached)
+			{
+				job.compiled = compileOptions.readTemporary(job.cachePath.getCStr());
+			}
+			else if (job.exitCode == 0)
+			{
+				job.exitCode = runExternalCompiler(job.sourcePath.getCStr()
+					, job.compiledPath.getCStr()
+					, job.varyingPath.getCStr()
+					, job.type
+					, compileOptions.getPlatform()
+					, false
+					, job.output
+					);
+				if (job.exitCode == 0)
+				{
+					job.compiled = compileOptions.readTemporary(job.compiledPath.getCStr());
+				}
+			}
+
+			const char* temporaryPathList[] = { job.sourcePath.getCStr(), job.varyingPath.getCStr(), job.preprocessedPath.getCStr(), job.compiledPath.getCStr() };
+			for (uint32_t j = 0; j < RIO_COUNTOF(temporaryPathList); ++j)
+			{
+				if (compileOptions.doesTemporaryExist(temporaryPathList[j]))
+				{
+					compileOptions.deleteFile(temporaryPathList[j]);
+				}
+			}
+		}
+
+		return 0;
+	}
+
 	struct RenderState
 	{
 		void reset()
@@ -643,17 +812,7 @@ namespace ShaderResourceInternalFn
 			, bgfxShadersMap(getDefaultAllocator())
 			, shaderPermutationsMap(getDefaultAllocator())
 			, staticCompileList(getDefaultAllocator())
-			, vertexShaderSourcePath(getDefaultAllocator())
-			, fragmentShaderSourcePath(getDefaultAllocator())
-			, varyingPath(getDefaultAllocator())
-			, vertexShaderCompiledPath(getDefaultAllocator())
-			, fragmentShaderCompiledPath(getDefaultAllocator())
 		{
-			compileOptions.getTemporaryPath("vertexShaderSource.sc", vertexShaderSourcePath);
-			compileOptions.getTemporaryPath("fragmentShaderSource.sc", fragmentShaderSourcePath);
-			compileOptions.getTemporaryPath("varying.sc", varyingPath);
-			compileOptions.getTemporaryPath("vertexShaderCompiled.bin", vertexShaderCompiledPath);
-			compileOptions.getTemporaryPath("fragmentShaderCompiled.bin", fragmentShaderCompiledPath);
 		}
 
 		void parse(const char* path)
@@ -1069,54 +1228,91 @@ namespace ShaderResourceInternalFn
 			}
 		}
 
-		void deleteTempFiles()
+		void compile()
 		{
-			const char* vertexShaderSourcePath = this->vertexShaderSourcePath.getCStr();
-			const char* fragmentShaderSourcePath = this->fragmentShaderSourcePath.getCStr();
-			const char* varyingPath = this->varyingPath.getCStr();
-			const char* vertexShaderCompiledPath = this->vertexShaderCompiledPath.getCStr();
-			const char* fragmentShaderCompiledPath = this->fragmentShaderCompiledPath.getCStr();
+			ShaderCompileQueue shaderCompileQueue(compileOptions, getDefaultAllocator());
+			const uint64_t shadercVersion = getShadercVersion();
 
-			if (compileOptions.doesFileExist(vertexShaderSourcePath))
+			for (uint32_t i = 0; i < VectorFn::getCount(staticCompileList); ++i)
 			{
-				compileOptions.deleteFile(vertexShaderSourcePath);
-			}
+				const StaticCompile& staticCompile = staticCompileList[i];
+				const DynamicString& shader = staticCompile.shaderName;
 
-			if (compileOptions.doesFileExist(fragmentShaderSourcePath))
-			{
-				compileOptions.deleteFile(fragmentShaderSourcePath);
+				RESOURCE_COMPILER_ASSERT(MapFn::has(shaderPermutationsMap, staticCompile.shaderName)
+					, compileOptions
+					, "Unknown shader: '%s'"
+					, shader.getCStr()
+					);
+				const ShaderPermutation& shaderPermutation = shaderPermutationsMap[shader];
+				const DynamicString& bgfxShader = shaderPermutation.bgfxShader;
+				const DynamicString& renderStateName = shaderPermutation.renderState;
+
+				RESOURCE_COMPILER_ASSERT(MapFn::has(bgfxShadersMap, shaderPermutation.bgfxShader)
+					, compileOptions
+					, "Unknown bgfx shader: '%s'"
+					, bgfxShader.getCStr()
+					);
+				RESOURCE_COMPILER_ASSERT(MapFn::has(renderStatesMap, shaderPermutation.renderState)
+					, compileOptions
+					, "Unknown render state: '%s'"
+					, renderStateName.getCStr()
+					);
+
+				addJobs(bgfxShader.getCStr(), staticCompile.defines, shadercVersion, shaderCompileQueue);
 			}
 
-			if (compileOptions.doesFileExist(varyingPath))
+			// Variants and backends have nothing in common, the programs are preprocessed and compiled on all the threads
+			const uint32_t jobCount = VectorFn::getCount(shaderCompileQueue.jobList);
+			const uint32_t threadCount = jobCount > RIO_SHADER_COMPILER_THREADS ? RIO_SHADER_COMPILER_THREADS : (jobCount > 0 ? jobCount - 1 : 0);
+			Thread threadList[RIO_SHADER_COMPILER_THREADS];
+			for (uint32_t i = 0; i < threadCount; ++i)
 			{
-				compileOptions.deleteFile(varyingPath);
+				threadList[i].start(compileThreadFunction, &shaderCompileQueue);
 			}
-
-			if (compileOptions.doesFileExist(vertexShaderCompiledPath))
+			compileThreadFunction(&shaderCompileQueue);
+			for (uint32_t i = 0; i < threadCount; ++i)
 			{
-				compileOptions.deleteFile(vertexShaderCompiledPath);
+				threadList[i].stop();
 			}
 
-			if (compileOptions.doesFileExist(fragmentShaderCompiledPath))
+			uint32_t compiledCount = 0;
+			for (uint32_t i = 0; i < jobCount; ++i)
 			{
-				compileOptions.deleteFile(fragmentShaderCompiledPath);
+				ShaderCompileJob& job = shaderCompileQueue.jobList[i];
+				RESOURCE_COMPILER_ASSERT(job.exitCode == 0
+					, compileOptions
+					, "Failed to compile %s shader of '%s':\n%s"
+					, job.type
+					, staticCompileList[i / 2].shaderName.getCStr()
+					, StringStreamFn::getCStr(job.output)
+					);
+
+				if (!job.isCached)
+				{
+					// Other compilers may read the cache at the same time
+					compileOptions.writeTemporaryAtomic(job.cachePath.getCStr(), job.compiled);
+					++compiledCount;
+				}
 			}
-		}
 
-		void compile()
-		{
+			RIO_LOGI("Shader: %u programs, %u shaders compiled on %u threads, %u from cache"
+				, VectorFn::getCount(staticCompileList)
+				, compiledCount
+				, threadCount + 1
+				, jobCount - compiledCount
+				);
+
 			compileOptions.write(RESOURCE_VERSION_SHADER);
 			compileOptions.write(VectorFn::getCount(staticCompileList));
 
 			for (uint32_t i = 0; i < VectorFn::getCount(staticCompileList); ++i)
 			{
 				const StaticCompile& staticCompile = staticCompileList[i];
-				const DynamicString& shader = staticCompile.shaderName;
 				const Vector<DynamicString>& defines = staticCompile.defines;
 
 				TempAllocator1024 ta;
 				DynamicString shaderNameStr(ta);
-				shaderNameStr = shader;
+				shaderNameStr = staticCompile.shaderName;
 				for (uint32_t i = 0; i < VectorFn::getCount(defines); ++i)
 				{
 					shaderNameStr += "+";
@@ -1124,31 +1320,17 @@ namespace ShaderResourceInternalFn
 				}
 				const StringId32 shaderNameHash(shaderNameStr.getCStr());
 
-				RESOURCE_COMPILER_ASSERT(MapFn::has(shaderPermutationsMap, staticCompile.shaderName)
-					, compileOptions
-					, "Unknown shader: '%s'"
-					, shader.getCStr()
-					);
-				const ShaderPermutation& shaderPermutation = shaderPermutationsMap[shader];
-				const DynamicString& bgfxShader = shaderPermutation.bgfxShader;
-				const DynamicString& renderStateName = shaderPermutation.renderState;
-
-				RESOURCE_COMPILER_ASSERT(MapFn::has(bgfxShadersMap, shaderPermutation.bgfxShader)
-					, compileOptions
-					, "Unknown bgfx shader: '%s'"
-					, bgfxShader.getCStr()
-					);
-				RESOURCE_COMPILER_ASSERT(MapFn::has(renderStatesMap, shaderPermutation.renderState)
-					, compileOptions
-					, "Unknown render state: '%s'"
-					, renderStateName.getCStr()
-					);
-
-				const RenderState& renderState = renderStatesMap[renderStateName];
+				const ShaderPermutation& shaderPermutation = shaderPermutationsMap[staticCompile.shaderName];
+				const RenderState& renderState = renderStatesMap[shaderPermutation.renderState];
+				const Buffer& vertexShader = shaderCompileQueue.jobList[i * 2 + 0].compiled;
+				const Buffer& fragmentShader = shaderCompileQueue.jobList[i * 2 + 1].compiled;
 
 				compileOptions.write(shaderNameHash.id); // Shader name
 				compileOptions.write(renderState.encode()); // Render state
-				compile(bgfxShader.getCStr(), defines); // Shader code
+				compileOptions.write(ArrayFn::getCount(vertexShader)); // Shader code
+				compileOptions.write(vertexShader);
+				compileOptions.write(ArrayFn::getCount(fragmentShader));
+				compileOptions.write(fragmentShader);
 			}
 		}
 
@@ -1174,7 +1356,8 @@ namespace ShaderResourceInternalFn
 			}
 		}
 
-		void compile(const char* bgfxShader, const Vector<DynamicString>& defines)
+		// Adds the jobs compiling the vertex and the fragment shader of <bgfxShader> with <defines> to <shaderCompileQueue>
+		void addJobs(const char* bgfxShader, const Vector<DynamicString>& defines, uint64_t shadercVersion, ShaderCompileQueue& shaderCompileQueue)
 		{
 			TempAllocator512 taa;
 			DynamicString key(taa);
@@ -1188,8 +1371,10 @@ namespace ShaderResourceInternalFn
 				includedCode = included.code;
 			}
 
-			StringStream vertexShaderCode(getDefaultAllocator());
-			StringStream fragmentShaderCode(getDefaultAllocator());
+			ShaderCompileJob vertexJob(getDefaultAllocator());
+			vertexJob.type = "vertex";
+			vertexJob.varying = &shader.varying;
+			StringStream& vertexShaderCode = vertexJob.source;
 			vertexShaderCode << shader.vertexShaderInputOutput.getCStr();
 			for (uint32_t i = 0; i < VectorFn::getCount(defines); ++i)
 			{
@@ -1197,7 +1382,14 @@ namespace ShaderResourceInternalFn
 			}
 			vertexShaderCode << includedCode.getCStr();
 			vertexShaderCode << shader.code.getCStr();
+			vertexShaderCode << meshDecodeShaderCode;
 			vertexShaderCode << shader.vertexShaderCode.getCStr();
+			addJob(vertexJob, shadercVersion, shaderCompileQueue);
+
+			ShaderCompileJob fragmentJob(getDefaultAllocator());
+			fragmentJob.type = "fragment";
+			fragmentJob.varying = &shader.varying;
+			StringStream& fragmentShaderCode = fragmentJob.source;
 			fragmentShaderCode << shader.fragmentShaderInputOutput.getCStr();
 			for (uint32_t i = 0; i < VectorFn::getCount(defines); ++i)
 			{
@@ -1206,59 +1398,28 @@ namespace ShaderResourceInternalFn
 			fragmentShaderCode << includedCode.getCStr();
 			fragmentShaderCode << shader.code.getCStr();
 			fragmentShaderCode << shader.fragmentShaderCode.getCStr();
+			addJob(fragmentJob, shadercVersion, shaderCompileQueue);
+		}
 
-			compileOptions.writeTemporary(vertexShaderSourcePath.getCStr(), vertexShaderCode);
-			compileOptions.writeTemporary(fragmentShaderSourcePath.getCStr(), fragmentShaderCode);
-			compileOptions.writeTemporary(varyingPath.getCStr(), shader.varying.getCStr(), shader.varying.getLength());
-
-			TempAllocator4096 ta;
-			StringStream output(ta);
-
-			int exitCode = runExternalCompiler(vertexShaderSourcePath.getCStr()
-				, vertexShaderCompiledPath.getCStr()
-				, varyingPath.getCStr()
-				, "vertex"
-				, compileOptions.getPlatform()
-				, output
-				);
-			if (exitCode != 0)
-			{
-				deleteTempFiles();
-				RESOURCE_COMPILER_ASSERT(false
-					, compileOptions
-					, "Failed to compile vertex shader:\n%s"
-					, StringStreamFn::getCStr(output)
-					);
-			}
-
-			ArrayFn::clear(output);
-			exitCode = runExternalCompiler(fragmentShaderSourcePath.getCStr()
-				, fragmentShaderCompiledPath.getCStr()
-				, varyingPath.getCStr()
-				, "fragment"
-				, compileOptions.getPlatform()
-				, output
-				);
-			if (exitCode != 0)
-			{
-				deleteTempFiles();
-				RESOURCE_COMPILER_ASSERT(false
-					, compileOptions
-					, "Failed to compile fragment shader:\n%s"
-					, StringStreamFn::getCStr(output)
-					);
-			}
+		// The cache is keyed on everything shaderc sees: the varyings, the target and shaderc itself here,
+		// and the preprocessed source with the defines and the included files once the job runs
+		void addJob(ShaderCompileJob& job, uint64_t shadercVersion, ShaderCompileQueue& shaderCompileQueue)
+		{
+			const char* platform = compileOptions.getPlatform();
+			const char* profile = getShadercProfile(job.type, platform);
 
-			Buffer tempVertexShader = compileOptions.readTemporary(vertexShaderCompiledPath.getCStr());
-			Buffer tempFragmentShader = compileOptions.readTemporary(fragmentShaderCompiledPath.getCStr());
+			uint64_t hash = getMurmurHash64(job.varying->getCStr(), job.varying->getLength(), shadercVersion);
+			hash = getMurmurHash64(job.type, getStringLength32(job.type), hash);
+			hash = getMurmurHash64(platform, getStringLength32(platform), hash);
+			hash = getMurmurHash64(profile, getStringLength32(profile), hash);
+			job.hash = hash;
 
-			deleteTempFiles();
+			compileOptions.getTemporaryPath("shaderSource.sc", job.sourcePath);
+			compileOptions.getTemporaryPath("varying.sc", job.varyingPath);
+			compileOptions.getTemporaryPath("shaderPreprocessed.sc", job.preprocessedPath);
+			compileOptions.getTemporaryPath("shaderCompiled.bin", job.compiledPath);
 
-			// Write
-			compileOptions.write(ArrayFn::getCount(tempVertexShader));
-			compileOptions.write(tempVertexShader);
-			compileOptions.write(ArrayFn::getCount(tempFragmentShader));
-			compileOptions.write(tempFragmentShader);
+			VectorFn::pushBack(shaderCompileQueue.jobList, job);
 		}
 
 		CompileOptions& compileOptions;
@@ -1267,12 +1428,6 @@ namespace ShaderResourceInternalFn
 		Map<DynamicString, BgfxShader> bgfxShadersMap;
 		Map<DynamicString, ShaderPermutation> shaderPermutationsMap;
 		Vector<StaticCompile> staticCompileList;
-
-		DynamicString vertexShaderSourcePath;
-		DynamicString fragmentShaderSourcePath;
-		DynamicString varyingPath;
-		DynamicString vertexShaderCompiledPath;
-		DynamicString fragmentShaderCompiledPath;
 	};
 
 	void compile(const char* path, CompileOptions& compileOptions)
@@ -0,0 +1,479 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Resource/SpriteAtlas.h"
+
+#include "Config.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Containers/Map.h"
+#include "Core/Containers/Vector.h"
+#include "Core/Json/JsonR.h"
+#include "Core/Json/JsonObject.h"
+#include "Core/Math/MaxRects.h"
+#include "Core/Memory/TempAllocator.h"
+
+#include "Device/Log.h"
+
+#include "Resource/CompileOptions.h"
+#include "Resource/ResourceTypes.h"
+#include "Resource/TextureResource.h"
+
+#include <bgfx/bgfx.h>
+#include <string.h> // memcpy, memset
+
+namespace Rio
+{
+
+namespace SpriteAtlasInternalFn
+{
+	// A sprite texture waiting to be packed
+	struct SpriteAtlasCandidate
+	{
+		ALLOCATOR_AWARE;
+
+		SpriteAtlasCandidate()
+			: textureName(getDefaultAllocator())
+		{
+		}
+
+		SpriteAtlasCandidate(Allocator& a)
+			: textureName(a)
+		{
+		}
+
+		DynamicString textureName;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t settingsKey = 0; // Textures with the same settings share the atlases
+	};
+
+	// Each texture is surrounded by a gutter of its repeated edge pixels and starts on a 4 pixels boundary,
+	// so that neither the block compression nor the first mips mix the pixels of two sprites
+	inline uint32_t getPaddedSize(uint32_t size)
+	{
+		return (size + 2 * RIO_SPRITE_ATLAS_PADDING + 3) & ~3u;
+	}
+
+	static void addDependency(SpriteAtlasTable& spriteAtlasTable, const char* path, StringId64 atlasName)
+	{
+		SpriteAtlasDependency spriteAtlasDependency;
+		spriteAtlasDependency.packageName = StringId64(path);
+		spriteAtlasDependency.atlasName = atlasName;
+
+		for (uint32_t i = 0; i < ArrayFn::getCount(spriteAtlasTable.dependencyList); ++i)
+		{
+			const SpriteAtlasDependency& other = spriteAtlasTable.dependencyList[i];
+			if (other.packageName == spriteAtlasDependency.packageName && other.atlasName == atlasName)
+			{
+				return;
+			}
+		}
+
+		ArrayFn::pushBack(spriteAtlasTable.dependencyList, spriteAtlasDependency);
+	}
+
+	static void addMaterialUser(SpriteAtlasTable& spriteAtlasTable, const DynamicString& materialName, bool isSpriteRenderer)
+	{
+		if (!MapFn::has(spriteAtlasTable.materialMap, materialName))
+		{
+			MapFn::set(spriteAtlasTable.materialMap, materialName, isSpriteRenderer);
+		}
+		else if (!isSpriteRenderer)
+		{
+			MapFn::remove(spriteAtlasTable.materialMap, materialName);
+			MapFn::set(spriteAtlasTable.materialMap, materialName, false);
+		}
+	}
+
+	// Records the materials drawn by the components of the unit <json> and of its prefabs
+	static void addMaterialUsers(const char* json, CompileOptions& compileOptions)
+	{
+		SpriteAtlasTable& spriteAtlasTable = compileOptions.getSpriteAtlasTable();
+
+		TempAllocator4096 ta;
+		JsonObject unit(ta);
+		JsonRFn::parse(json, unit);
+
+		if (JsonObjectFn::has(unit, "prefab"))
+		{
+			DynamicString prefabPath(ta);
+			JsonRFn::parseString(unit["prefab"], prefabPath);
+			RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_UNIT, prefabPath.getCStr(), compileOptions);
+			prefabPath += "." RESOURCE_EXTENSION_UNIT;
+
+			Buffer prefab = compileOptions.read(prefabPath.getCStr());
+			ArrayFn::pushBack(prefab, '\0');
+			addMaterialUsers(ArrayFn::begin(prefab), compileOptions);
+		}
+
+		const char* componentListNameList[] = { "components", "modifiedComponentList" };
+		for (uint32_t i = 0; i < RIO_COUNTOF(componentListNameList); ++i)
+		{
+			if (!JsonObjectFn::has(unit, componentListNameList[i]))
+			{
+				continue;
+			}
+
+			JsonObject componentList(ta);
+			JsonRFn::parse(unit[componentListNameList[i]], componentList);
+
+			auto begin = JsonObjectFn::begin(componentList);
+			auto end = JsonObjectFn::end(componentList);
+			for (; begin != end; ++begin)
+			{
+				TempAllocator1024 taa;
+				JsonObject component(taa);
+				JsonRFn::parse(begin->pair.second, component);
+				if (!JsonObjectFn::has(component, "data"))
+				{
+					continue;
+				}
+				JsonObject data(taa);
+				JsonRFn::parse(component["data"], data);
+
+				if (JsonObjectFn::has(data, "material"))
+				{
+					DynamicString materialName(taa);
+					JsonRFn::parseString(data["material"], materialName);
+					addMaterialUser(spriteAtlasTable, materialName, JsonRFn::parseStringId(component["type"]) == StringId32("spriteRenderer"));
+				}
+			}
+		}
+	}
+
+	void pack(const char* path, CompileOptions& compileOptions)
+	{
+		SpriteAtlasTable& spriteAtlasTable = compileOptions.getSpriteAtlasTable();
+
+		Buffer buffer = compileOptions.read(path);
+
+		TempAllocator4096 ta;
+		JsonObject object(ta);
+		JsonRFn::parse(buffer, object);
+
+		// The materials of the sprite renderers sample the atlases, whichever package packs them
+		if (JsonObjectFn::has(object, "unit"))
+		{
+			JsonArray unitList(ta);
+			JsonRFn::parseArray(object["unit"], unitList);
+			for (uint32_t i = 0; i < ArrayFn::getCount(unitList); ++i)
+			{
+				TempAllocator1024 taa;
+				DynamicString unitPath(taa);
+				JsonRFn::parseString(unitList[i], unitPath);
+				RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_UNIT, unitPath.getCStr(), compileOptions);
+				unitPath += "." RESOURCE_EXTENSION_UNIT;
+
+				Buffer unit = compileOptions.read(unitPath.getCStr());
+				ArrayFn::pushBack(unit, '\0');
+				addMaterialUsers(ArrayFn::begin(unit), compileOptions);
+			}
+		}
+		if (JsonObjectFn::has(object, "level"))
+		{
+			JsonArray levelList(ta);
+			JsonRFn::parseArray(object["level"], levelList);
+			for (uint32_t i = 0; i < ArrayFn::getCount(levelList); ++i)
+			{
+				TempAllocator1024 taa;
+				DynamicString levelPath(taa);
+				JsonRFn::parseString(levelList[i], levelPath);
+				RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_LEVEL, levelPath.getCStr(), compileOptions);
+				levelPath += "." RESOURCE_EXTENSION_LEVEL;
+
+				Buffer levelBuffer = compileOptions.read(levelPath.getCStr());
+				JsonObject level(taa);
+				JsonRFn::parse(levelBuffer, level);
+				if (!JsonObjectFn::has(level, "units"))
+				{
+					continue;
+				}
+				JsonObject unitMap(taa);
+				JsonRFn::parse(level["units"], unitMap);
+
+				auto begin = JsonObjectFn::begin(unitMap);
+				auto end = JsonObjectFn::end(unitMap);
+				for (; begin != end; ++begin)
+				{
+					addMaterialUsers(begin->pair.second, compileOptions);
+				}
+			}
+		}
+
+		if (!JsonObjectFn::has(object, "sprite"))
+		{
+			return;
+		}
+
+		JsonArray spriteList(ta);
+		JsonRFn::parseArray(object["sprite"], spriteList);
+
+		Vector<SpriteAtlasCandidate> candidateList(getDefaultAllocator());
+		Array<uint32_t> settingsKeyList(getDefaultAllocator());
+
+		for (uint32_t i = 0; i < ArrayFn::getCount(spriteList); ++i)
+		{
+			TempAllocator1024 taa;
+			DynamicString spritePath(taa);
+			JsonRFn::parseString(spriteList[i], spritePath);
+			spritePath += "." RESOURCE_EXTENSION_SPRITE;
+			RESOURCE_COMPILER_ASSERT_FILE_EXISTS(spritePath.getCStr(), compileOptions);
+
+			Buffer spriteBuffer = compileOptions.read(spritePath.getCStr());
+			JsonObject sprite(taa);
+			JsonRFn::parse(spriteBuffer, sprite);
+
+			if (!JsonObjectFn::has(sprite, "texture"))
+			{
+				continue;
+			}
+
+			SpriteAtlasCandidate candidate(getDefaultAllocator());
+			JsonRFn::parseString(sprite["texture"], candidate.textureName);
+			RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_TEXTURE, candidate.textureName.getCStr(), compileOptions);
+
+			// Packed by another package or by another sprite
+			SpriteAtlasRegion region;
+			if (getRegion(spriteAtlasTable, candidate.textureName.getCStr(), region))
+			{
+				addDependency(spriteAtlasTable, path, region.atlasName);
+				continue;
+			}
+
+			bool isDuplicate = false;
+			for (uint32_t j = 0; j < VectorFn::getCount(candidateList) && !isDuplicate; ++j)
+			{
+				isDuplicate = candidateList[j].textureName == candidate.textureName;
+			}
+			if (isDuplicate)
+			{
+				continue;
+			}
+
+			candidate.width = uint32_t(JsonRFn::parseFloat(sprite["width"]));
+			candidate.height = uint32_t(JsonRFn::parseFloat(sprite["height"]));
+
+			DynamicString texturePath(taa);
+			texturePath += candidate.textureName;
+			texturePath += "." RESOURCE_EXTENSION_TEXTURE;
+			TextureSettings textureSettings(taa);
+			TextureResourceInternalFn::parseTextureSettings(texturePath.getCStr(), textureSettings, compileOptions);
+
+			// PVRTC needs square powers of two and textures larger than an atlas stay on their own
+			if (textureSettings.format == bgfx::TextureFormat::PTC14
+				|| textureSettings.format == bgfx::TextureFormat::PTC14A
+				|| getPaddedSize(candidate.width) > RIO_SPRITE_ATLAS_SIZE
+				|| getPaddedSize(candidate.height) > RIO_SPRITE_ATLAS_SIZE
+				)
+			{
+				continue;
+			}
+
+			candidate.settingsKey = textureSettings.format
+				| (textureSettings.generateMips ? 1u << 16 : 0u)
+				| (textureSettings.isNormalMap ? 1u << 17 : 0u)
+				;
+			bool isNewSettings = true;
+			for (uint32_t j = 0; j < ArrayFn::getCount(settingsKeyList) && isNewSettings; ++j)
+			{
+				isNewSettings = settingsKeyList[j] != candidate.settingsKey;
+			}
+			if (isNewSettings)
+			{
+				ArrayFn::pushBack(settingsKeyList, candidate.settingsKey);
+			}
+
+			VectorFn::pushBack(candidateList, candidate);
+		}
+
+		// Packs the textures of each settings into as few atlases as possible
+		for (uint32_t k = 0; k < ArrayFn::getCount(settingsKeyList); ++k)
+		{
+			const uint32_t settingsKey = settingsKeyList[k];
+
+			Array<uint32_t> candidateIndexList(getDefaultAllocator());
+			Array<uint32_t> widthList(getDefaultAllocator());
+			Array<uint32_t> heightList(getDefaultAllocator());
+			for (uint32_t i = 0; i < VectorFn::getCount(candidateList); ++i)
+			{
+				if (candidateList[i].settingsKey == settingsKey)
+				{
+					ArrayFn::pushBack(candidateIndexList, i);
+					ArrayFn::pushBack(widthList, getPaddedSize(candidateList[i].width));
+					ArrayFn::pushBack(heightList, getPaddedSize(candidateList[i].height));
+				}
+			}
+
+			const uint32_t count = ArrayFn::getCount(candidateIndexList);
+			Array<uint32_t> binList(getDefaultAllocator());
+			Array<uint32_t> xList(getDefaultAllocator());
+			Array<uint32_t> yList(getDefaultAllocator());
+			ArrayFn::resize(binList, count);
+			ArrayFn::resize(xList, count);
+			ArrayFn::resize(yList, count);
+			const uint32_t binCount = MaxRectsFn::pack(ArrayFn::begin(widthList)
+				, ArrayFn::begin(heightList)
+				, count
+				, RIO_SPRITE_ATLAS_SIZE
+				, RIO_SPRITE_ATLAS_SIZE
+				, ArrayFn::begin(binList)
+				, ArrayFn::begin(xList)
+				, ArrayFn::begin(yList)
+				);
+
+			for (uint32_t bin = 0; bin < binCount; ++bin)
+			{
+				// The atlas is cropped to the textures it holds
+				SpriteAtlas spriteAtlas(getDefaultAllocator());
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					if (binList[i] == bin)
+					{
+						spriteAtlas.width = xList[i] + widthList[i] > spriteAtlas.width ? xList[i] + widthList[i] : spriteAtlas.width;
+						spriteAtlas.height = yList[i] + heightList[i] > spriteAtlas.height ? yList[i] + heightList[i] : spriteAtlas.height;
+					}
+				}
+
+				spriteAtlas.format = settingsKey & 0xffff;
+				spriteAtlas.generateMips = (settingsKey & (1u << 16)) != 0;
+				spriteAtlas.isNormalMap = (settingsKey & (1u << 17)) != 0;
+
+				// Named after the package, e.g. "units/level.package" packs "units/level-atlas0"
+				char atlasSuffix[32];
+				snPrintF(atlasSuffix, sizeof(atlasSuffix), "-atlas%u", VectorFn::getCount(spriteAtlasTable.atlasList));
+				spriteAtlas.name.set(path, getStringLength32(path) - getStringLength32("." RESOURCE_EXTENSION_PACKAGE));
+				spriteAtlas.name += atlasSuffix;
+				const StringId64 atlasName = StringId64(spriteAtlas.name.getCStr());
+
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					if (binList[i] != bin)
+					{
+						continue;
+					}
+
+					const SpriteAtlasCandidate& candidate = candidateList[candidateIndexList[i]];
+					SpriteAtlasRegion region;
+					region.atlasName = atlasName;
+					region.x = xList[i] + RIO_SPRITE_ATLAS_PADDING;
+					region.y = yList[i] + RIO_SPRITE_ATLAS_PADDING;
+					region.width = candidate.width;
+					region.height = candidate.height;
+					region.atlasWidth = spriteAtlas.width;
+					region.atlasHeight = spriteAtlas.height;
+					MapFn::set(spriteAtlasTable.regionMap, candidate.textureName, region);
+				}
+
+				RIO_LOGI("Sprite atlas: %s, %ux%u", spriteAtlas.name.getCStr(), spriteAtlas.width, spriteAtlas.height);
+
+				VectorFn::pushBack(spriteAtlasTable.atlasList, spriteAtlas);
+				addDependency(spriteAtlasTable, path, atlasName);
+			}
+		}
+	}
+
+	void compile(const SpriteAtlas& spriteAtlas, CompileOptions& compileOptions)
+	{
+		const SpriteAtlasTable& spriteAtlasTable = compileOptions.getSpriteAtlasTable();
+		const StringId64 atlasName = StringId64(spriteAtlas.name.getCStr());
+
+		Array<uint8_t> rgba(getDefaultAllocator());
+		ArrayFn::resize(rgba, spriteAtlas.width * spriteAtlas.height * 4);
+		memset(ArrayFn::begin(rgba), 0, ArrayFn::getCount(rgba));
+
+		auto current = MapFn::begin(spriteAtlasTable.regionMap);
+		auto end = MapFn::end(spriteAtlasTable.regionMap);
+		for (; current != end; ++current)
+		{
+			const SpriteAtlasRegion& region = current->pair.second;
+			if (region.atlasName != atlasName)
+			{
+				continue;
+			}
+
+			TempAllocator1024 ta;
+			DynamicString texturePath(ta);
+			texturePath += current->pair.first;
+			texturePath += "." RESOURCE_EXTENSION_TEXTURE;
+			TextureSettings textureSettings(ta);
+			TextureResourceInternalFn::parseTextureSettings(texturePath.getCStr(), textureSettings, compileOptions);
+
+			Array<uint8_t> image(getDefaultAllocator());
+			uint32_t width = 0;
+			uint32_t height = 0;
+			TextureResourceInternalFn::decodeImage(textureSettings.source.getCStr(), image, width, height, compileOptions);
+			RESOURCE_COMPILER_ASSERT(width == region.width && height == region.height
+				, compileOptions
+				, "Sprite size %ux%u does not match the texture: '%s'"
+				, region.width
+				, region.height
+				, textureSettings.source.getCStr()
+				);
+
+			// Copies the texture and extrudes its edges into the gutter
+			const int32_t padding = RIO_SPRITE_ATLAS_PADDING;
+			for (int32_t y = -padding; y < int32_t(height) + padding; ++y)
+			{
+				const int32_t sourceY = y < 0 ? 0 : (y < int32_t(height) ? y : int32_t(height) - 1);
+				for (int32_t x = -padding; x < int32_t(width) + padding; ++x)
+				{
+					const int32_t sourceX = x < 0 ? 0 : (x < int32_t(width) ? x : int32_t(width) - 1);
+					const uint32_t destination = ((region.y + y) * spriteAtlas.width + region.x + x) * 4;
+					memcpy(&rgba[destination], &image[(sourceY * width + sourceX) * 4], 4);
+				}
+			}
+		}
+
+		TextureSettings textureSettings(getDefaultAllocator());
+		textureSettings.format = spriteAtlas.format;
+		textureSettings.generateMips = spriteAtlas.generateMips;
+		textureSettings.isNormalMap = spriteAtlas.isNormalMap;
+		TextureResourceInternalFn::compileRgba8(spriteAtlas.name.getCStr(), rgba, spriteAtlas.width, spriteAtlas.height, textureSettings, compileOptions);
+	}
+
+	bool getRegion(const SpriteAtlasTable& spriteAtlasTable, const char* textureName, SpriteAtlasRegion& region)
+	{
+		TempAllocator1024 ta;
+		DynamicString key(ta);
+		key = textureName;
+
+		if (!MapFn::has(spriteAtlasTable.regionMap, key))
+		{
+			return false;
+		}
+
+		region = MapFn::get(spriteAtlasTable.regionMap, key, region);
+		return true;
+	}
+
+	bool getIsSpriteMaterial(const SpriteAtlasTable& spriteAtlasTable, const char* materialName)
+	{
+		TempAllocator1024 ta;
+		DynamicString key(ta);
+		key = materialName;
+
+		return MapFn::get(spriteAtlasTable.materialMap, key, false);
+	}
+
+	void getDependencies(const SpriteAtlasTable& spriteAtlasTable, const char* path, Array<StringId64>& atlasNameList)
+	{
+		const StringId64 packageName(path);
+		for (uint32_t i = 0; i < ArrayFn::getCount(spriteAtlasTable.dependencyList); ++i)
+		{
+			if (spriteAtlasTable.dependencyList[i].packageName == packageName)
+			{
+				ArrayFn::pushBack(atlasNameList, spriteAtlasTable.dependencyList[i].atlasName);
+			}
+		}
+	}
+
+	void clear(SpriteAtlasTable& spriteAtlasTable)
+	{
+		VectorFn::clear(spriteAtlasTable.atlasList);
+		MapFn::clear(spriteAtlasTable.regionMap);
+		ArrayFn::clear(spriteAtlasTable.dependencyList);
+		MapFn::clear(spriteAtlasTable.materialMap);
+	}
+} // namespace SpriteAtlasInternalFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
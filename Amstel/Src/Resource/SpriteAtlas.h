@@ -0,0 +1,90 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Containers/ContainerTypes.h"
+#include "Core/Memory/Memory.h"
+#include "Core/Strings/DynamicString.h"
+#include "Core/Strings/StringId.h"
+#include "Resource/CompilerTypes.h"
+
+namespace Rio
+{
+
+// Where the texture of a sprite has been packed
+struct SpriteAtlasRegion
+{
+	StringId64 atlasName; // Texture resource of the atlas
+	uint32_t x; // Top-left corner of the texture in the atlas
+	uint32_t y;
+	uint32_t width; // Size of the texture
+	uint32_t height;
+	uint32_t atlasWidth;
+	uint32_t atlasHeight;
+};
+
+// A texture made of the sprite textures of a package sharing the same settings
+struct SpriteAtlas
+{
+	ALLOCATOR_AWARE;
+
+	SpriteAtlas()
+		: name(getDefaultAllocator())
+	{
+	}
+
+	SpriteAtlas(Allocator& a)
+		: name(a)
+	{
+	}
+
+	DynamicString name;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t format = 0; // bgfx::TextureFormat::Enum
+	bool generateMips = false;
+	bool isNormalMap = false;
+};
+
+// A package loads the atlases of its sprites, which may have been packed by another package
+struct SpriteAtlasDependency
+{
+	StringId64 packageName;
+	StringId64 atlasName;
+};
+
+// The atlases packed by the DataCompiler before the resources are compiled
+struct SpriteAtlasTable
+{
+	SpriteAtlasTable(Allocator& a)
+		: atlasList(a)
+		, regionMap(a)
+		, dependencyList(a)
+		, materialMap(a)
+	{
+	}
+
+	Vector<SpriteAtlas> atlasList;
+	Map<DynamicString, SpriteAtlasRegion> regionMap; // By texture name
+	Array<SpriteAtlasDependency> dependencyList;
+	Map<DynamicString, bool> materialMap; // By name, whether the units of the packages draw the material with sprite renderers only
+};
+
+namespace SpriteAtlasInternalFn
+{
+	// Packs the textures of the sprites of the package <path> not packed yet into atlases added to the table of <compileOptions>
+	// Sprites take part when their .sprite names a "texture"
+	void pack(const char* path, CompileOptions& compileOptions);
+	// Writes the texture of <spriteAtlas>
+	void compile(const SpriteAtlas& spriteAtlas, CompileOptions& compileOptions);
+	// Returns whether the texture <textureName> has been packed into an atlas and where in <region>
+	bool getRegion(const SpriteAtlasTable& spriteAtlasTable, const char* textureName, SpriteAtlasRegion& region);
+	// Returns whether the material <materialName> is drawn by sprite renderers only, then it samples the atlases instead of the packed textures
+	// Other materials keep sampling the textures, which stay in their packages
+	bool getIsSpriteMaterial(const SpriteAtlasTable& spriteAtlasTable, const char* materialName);
+	// Appends the atlases needed by the package <path> to <atlasNameList>
+	void getDependencies(const SpriteAtlasTable& spriteAtlasTable, const char* path, Array<StringId64>& atlasNameList);
+	void clear(SpriteAtlasTable& spriteAtlasTable);
+} // namespace SpriteAtlasInternalFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
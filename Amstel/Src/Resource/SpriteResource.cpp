@@ -54,6 +54,27 @@ namespace SpriteResourceInternalFn
 		const float height = JsonRFn::parseFloat(object["height"]);
 		const uint32_t frameListCount = ArrayFn::getCount(frames);
 
+		// The frames of a sprite whose texture has been packed map to its place in the atlas
+		float textureX = 0.0f;
+		float textureY = 0.0f;
+		float textureWidth = width;
+		float textureHeight = height;
+		if (JsonObjectFn::has(object, "texture"))
+		{
+			DynamicString texture(ta);
+			JsonRFn::parseString(object["texture"], texture);
+			RESOURCE_COMPILER_ASSERT_RESOURCE_EXISTS(RESOURCE_EXTENSION_TEXTURE, texture.getCStr(), compileOptions);
+
+			SpriteAtlasRegion region;
+			if (SpriteAtlasInternalFn::getRegion(compileOptions.getSpriteAtlasTable(), texture.getCStr(), region))
+			{
+				textureX = float(region.x);
+				textureY = float(region.y);
+				textureWidth = float(region.atlasWidth);
+				textureHeight = float(region.atlasHeight);
+			}
+		}
+
 		Array<float> vertices(getDefaultAllocator());
 		Array<uint16_t> indices(getDefaultAllocator());
 		uint32_t currentIndex = 0;
@@ -65,10 +86,10 @@ namespace SpriteResourceInternalFn
 			const SpriteFrame& spriteFrame = spriteFrameParsed;
 
 			// Compute uv coords
-			const float u0 = spriteFrame.region.x / width;
-			const float v0 = (spriteFrame.region.y + spriteFrame.region.w) / height;
-			const float u1 = (spriteFrame.region.x + spriteFrame.region.z) / width;
-			const float v1 = spriteFrame.region.y / height;
+			const float u0 = (textureX + spriteFrame.region.x) / textureWidth;
+			const float v0 = (textureY + spriteFrame.region.y + spriteFrame.region.w) / textureHeight;
+			const float u1 = (textureX + spriteFrame.region.x + spriteFrame.region.z) / textureWidth;
+			const float v1 = (textureY + spriteFrame.region.y) / textureHeight;
 
 			// Compute positions
 			float x0 = spriteFrame.region.x - spriteFrame.pivot.x;
@@ -181,19 +202,15 @@ namespace SpriteAnimationResourceInternalFn
 
 		TempAllocator4096 ta;
 		JsonObject jsonObject(ta);
-		JsonArray objectFrames(ta);
 
 		Array<uint32_t> frames(getDefaultAllocator());
 		float totalTime = 0.0f;
 
 		JsonRFn::parse(buffer, jsonObject);
-		JsonRFn::parseArray(jsonObject["frames"], objectFrames);
 
-		ArrayFn::resize(frames, ArrayFn::getCount(objectFrames));
-		for (uint32_t i = 0; i < ArrayFn::getCount(objectFrames); ++i)
-		{
-			frames[i] = (uint32_t)JsonRFn::parseFloat(objectFrames[i]);
-		}
+		ArrayFn::resize(frames, JsonRFn::getArrayCount(jsonObject["frames"]));
+		const uint32_t frameCount = JsonRFn::parseUintArrayInto(jsonObject["frames"], ArrayFn::begin(frames), ArrayFn::getCount(frames));
+		RESOURCE_COMPILER_ASSERT(frameCount == ArrayFn::getCount(frames), compileOptions, "Bad frames array");
 
 		totalTime = JsonRFn::parseFloat(jsonObject["totalTime"]);
 
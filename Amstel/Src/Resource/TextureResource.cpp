@@ -1,40 +1,274 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Resource/TextureResource.h"
 
+#include "Core/Containers/Array.h"
 #include "Core/FileSystem/ReaderWriter.h"
 #include "Core/Json/JsonR.h"
 #include "Core/Json/JsonObject.h"
-#include "Core/Base/Os.h"
-#include "Core/Strings/StringStream.h"
+#include "Core/Memory/TempAllocator.h"
+#include "Core/Strings/DynamicString.h"
+#include "Core/Thread/AtomicInt.h"
+#include "Core/Thread/Thread.h"
 #include "Resource/CompileOptions.h"
 #include "Resource/ResourceManager.h"
+#include "Resource/TextureStreamer.h"
+#include "Device/Device.h"
+#include "Device/Log.h"
 
-#if RIO_DEVELOPMENT
-	#define TEXTUREC_NAME "texturec-development-"
-#elif RIO_DEBUG
-	#define TEXTUREC_NAME "texturec-debug-"
-#else
-	#define TEXTUREC_NAME "texturec-release-"
-#endif  // RIO_DEBUG
-#if RIO_ARCH_32BIT
-	#define TEXTUREC_BITS "32"
-#elif RIO_ARCH_64BIT
-	#define TEXTUREC_BITS "64"
-#endif // RIO_ARCH_32BIT
-#if RIO_PLATFORM_LINUX
-	#define TEXTUREC_PATH "./" TEXTUREC_NAME "" TEXTUREC_BITS
-#elif RIO_PLATFORM_WINDOWS
-	#define TEXTUREC_PATH TEXTUREC_NAME "" TEXTUREC_BITS ".exe"
-#else
-	#define TEXTUREC_PATH ""
-#endif // RIO_PLATFORM_LINUX
+#include <bx/readerwriter.h>
+#include "image.h" // bgfx/src
+
+#include <libsquish/squish.h>
+#include <etc1/etc1.h>
+#include <etc2/ProcessRGB.hpp>
+#include <pvrtc/PvrTcEncoder.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.c>
+
+#include <math.h> // powf, sqrtf
+#include <string.h> // memcpy
 
 namespace Rio
 {
 
 namespace TextureResourceInternalFn
 {
-	void compile(const char* path, CompileOptions& compileOptions)
+	// A strip of pixel rows of one mip level, encoded by a single job
+	struct TextureEncodeJob
+	{
+		const uint8_t* rgba;
+		uint32_t width;
+		uint32_t height;
+		uint8_t* destination;
+	};
+
+	struct TextureEncoder
+	{
+		TextureEncoder(Allocator& a)
+			: jobList(a)
+			, nextJob(0)
+		{
+		}
+
+		bgfx::TextureFormat::Enum format;
+		Array<TextureEncodeJob> jobList;
+		AtomicInt nextJob;
+	};
+
+	inline uint32_t getMinUint32(uint32_t a, uint32_t b)
+	{
+		return a < b ? a : b;
+	}
+
+	inline uint32_t getMaxUint32(uint32_t a, uint32_t b)
+	{
+		return a < b ? b : a;
+	}
+
+	static bool getIsFormatSupported(bgfx::TextureFormat::Enum format)
+	{
+		switch (format)
+		{
+			case bgfx::TextureFormat::BC1:
+			case bgfx::TextureFormat::BC2:
+			case bgfx::TextureFormat::BC3:
+			case bgfx::TextureFormat::BC4:
+			case bgfx::TextureFormat::BC5:
+			case bgfx::TextureFormat::ETC1:
+			case bgfx::TextureFormat::ETC2:
+			case bgfx::TextureFormat::PTC14:
+			case bgfx::TextureFormat::PTC14A:
+			case bgfx::TextureFormat::BGRA8:
+			case bgfx::TextureFormat::RGBA8:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// PVRTC blocks are interpolated with their neighbours so a mip can not be split in strips
+	inline bool getIsEncodedByMip(bgfx::TextureFormat::Enum format)
+	{
+		return format == bgfx::TextureFormat::PTC14 || format == bgfx::TextureFormat::PTC14A;
+	}
+
+	// Encodes the <width> x <height> RGBA8 pixels <rgba> to <destination> in <format>
+	static void encodeRgba8(void* destination, const uint8_t* rgba, uint32_t width, uint32_t height, bgfx::TextureFormat::Enum format)
+	{
+		switch (format)
+		{
+			case bgfx::TextureFormat::BC1:
+			case bgfx::TextureFormat::BC2:
+			case bgfx::TextureFormat::BC3:
+			case bgfx::TextureFormat::BC4:
+			case bgfx::TextureFormat::BC5:
+				squish::CompressImage(rgba, int(width), int(height), destination
+					, format == bgfx::TextureFormat::BC2 ? squish::kDxt3
+					: format == bgfx::TextureFormat::BC3 ? squish::kDxt5
+					: format == bgfx::TextureFormat::BC4 ? squish::kBc4
+					: format == bgfx::TextureFormat::BC5 ? squish::kBc5
+					: squish::kDxt1
+					);
+				break;
+
+			case bgfx::TextureFormat::ETC1:
+				etc1_encode_image(rgba, width, height, 4, width * 4, (uint8_t*)destination);
+				break;
+
+			case bgfx::TextureFormat::ETC2:
+			{
+				uint64_t* blocks = (uint64_t*)destination;
+				for (uint32_t blockY = 0; blockY < height; blockY += 4)
+				{
+					for (uint32_t blockX = 0; blockX < width; blockX += 4)
+					{
+						// The encoder reads BGRx pixels in column major order, edges are clamped
+						uint8_t block[4 * 4 * 4];
+						for (uint32_t i = 0; i < 16; ++i)
+						{
+							const uint32_t x = blockX + i / 4 < width ? blockX + i / 4 : width - 1;
+							const uint32_t y = blockY + i % 4 < height ? blockY + i % 4 : height - 1;
+							const uint8_t* pixel = &rgba[(y * width + x) * 4];
+							block[i * 4 + 0] = pixel[2];
+							block[i * 4 + 1] = pixel[1];
+							block[i * 4 + 2] = pixel[0];
+							block[i * 4 + 3] = pixel[3];
+						}
+
+						*blocks++ = ProcessRGB_ETC2(block);
+					}
+				}
+				break;
+			}
+
+			case bgfx::TextureFormat::PTC14:
+			case bgfx::TextureFormat::PTC14A:
+			{
+				// bgfx sizes PVRTC mips to at least 2 x 2 blocks, smaller mips are encoded
+				// from their pixels repeated up to that size
+				const bgfx::ImageBlockInfo& blockInfo = bgfx::getBlockInfo(format);
+				const uint32_t minWidth = uint32_t(blockInfo.blockWidth * blockInfo.minBlockX);
+				const uint32_t minHeight = uint32_t(blockInfo.blockHeight * blockInfo.minBlockY);
+				uint8_t padded[8 * 8 * 4];
+				RIO_ASSERT(minWidth * minHeight * 4 <= sizeof(padded), "Unexpected PVRTC block size");
+
+				Javelin::RgbaBitmap bitmap;
+				bitmap.width = int(width);
+				bitmap.height = int(height);
+				bitmap.data = const_cast<uint8_t*>(rgba);
+
+				if (width < minWidth || height < minHeight)
+				{
+					const uint32_t paddedWidth = getMaxUint32(width, minWidth);
+					const uint32_t paddedHeight = getMaxUint32(height, minHeight);
+					for (uint32_t y = 0; y < paddedHeight; ++y)
+					{
+						for (uint32_t x = 0; x < paddedWidth; ++x)
+						{
+							memcpy(&padded[(y * paddedWidth + x) * 4], &rgba[(getMinUint32(y, height - 1) * width + getMinUint32(x, width - 1)) * 4], 4);
+						}
+					}
+
+					bitmap.width = int(paddedWidth);
+					bitmap.height = int(paddedHeight);
+					bitmap.data = padded;
+				}
+
+				if (format == bgfx::TextureFormat::PTC14A)
+				{
+					Javelin::PvrTcEncoder::EncodeRgba4Bpp(destination, bitmap);
+				}
+				else
+				{
+					Javelin::PvrTcEncoder::EncodeRgb4Bpp(destination, bitmap);
+				}
+				bitmap.data = nullptr;
+				break;
+			}
+
+			case bgfx::TextureFormat::BGRA8:
+				bgfx::imageSwizzleBgra8(width, height, width * 4, rgba, destination);
+				break;
+
+			default:
+				memcpy(destination, rgba, width * height * 4);
+				break;
+		}
+	}
+
+	// Pulls jobs from <data>, a TextureEncoder, until none is left
+	static int32_t encodeThreadFunction(void* data)
+	{
+		TextureEncoder& textureEncoder = *(TextureEncoder*)data;
+		const int jobCount = int(ArrayFn::getCount(textureEncoder.jobList));
+
+		for (int i = textureEncoder.nextJob.fetchAdd(1); i < jobCount; i = textureEncoder.nextJob.fetchAdd(1))
+		{
+			const TextureEncodeJob& job = textureEncoder.jobList[i];
+			encodeRgba8(job.destination, job.rgba, job.width, job.height, textureEncoder.format);
+		}
+
+		return 0;
+	}
+
+	// Writes the <mipWidth> x <mipHeight> mip of the <width> x <height> RGBA8 image <source> to <destination>
+	// by averaging 2 x 2 pixels, colors in linear space and normals as unit vectors
+	static void downsampleRgba8(uint8_t* destination, uint32_t mipWidth, uint32_t mipHeight, const uint8_t* source, uint32_t width, uint32_t height, bool isNormalMap)
+	{
+		for (uint32_t y = 0; y < mipHeight; ++y)
+		{
+			for (uint32_t x = 0; x < mipWidth; ++x)
+			{
+				// Pixels past the edges repeat the last row or column
+				const uint32_t x0 = getMinUint32(x * 2, width - 1);
+				const uint32_t x1 = getMinUint32(x * 2 + 1, width - 1);
+				const uint32_t y0 = getMinUint32(y * 2, height - 1);
+				const uint32_t y1 = getMinUint32(y * 2 + 1, height - 1);
+				const uint8_t* pixels[4] =
+				{
+					&source[(y0 * width + x0) * 4],
+					&source[(y0 * width + x1) * 4],
+					&source[(y1 * width + x0) * 4],
+					&source[(y1 * width + x1) * 4]
+				};
+
+				float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						sum[c] += isNormalMap
+							? pixels[i][c] / 127.5f - 1.0f
+							: powf(pixels[i][c] / 255.0f, 2.2f)
+							;
+					}
+					sum[3] += pixels[i][3] / 255.0f;
+				}
+
+				uint8_t* pixel = &destination[(y * mipWidth + x) * 4];
+				if (isNormalMap)
+				{
+					const float length = sqrtf(sum[0]*sum[0] + sum[1]*sum[1] + sum[2]*sum[2]);
+					const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						pixel[c] = uint8_t((sum[c] * invLength * 0.5f + 0.5f) * 255.0f + 0.5f);
+					}
+				}
+				else
+				{
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						pixel[c] = uint8_t(powf(sum[c] * 0.25f, 1.0f / 2.2f) * 255.0f + 0.5f);
+					}
+				}
+				pixel[3] = uint8_t(sum[3] * 0.25f * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	void parseTextureSettings(const char* path, TextureSettings& textureSettings, CompileOptions& compileOptions)
 	{
 		Buffer buffer = compileOptions.read(path);
 
@@ -42,39 +276,208 @@ namespace TextureResourceInternalFn
 		JsonObject jsonObject(ta);
 		JsonRFn::parse(buffer, jsonObject);
 
-		DynamicString name(ta);
-		JsonRFn::parseString(jsonObject["source"], name);
-		RESOURCE_COMPILER_ASSERT_FILE_EXISTS(name.getCStr(), compileOptions);
+		JsonRFn::parseString(jsonObject["source"], textureSettings.source);
+		RESOURCE_COMPILER_ASSERT_FILE_EXISTS(textureSettings.source.getCStr(), compileOptions);
+
+		textureSettings.generateMips = JsonRFn::parseBool(jsonObject["generateMips"]);
+		textureSettings.isNormalMap = JsonRFn::parseBool(jsonObject["isNormalMap"]);
 
-		const bool generateMips = JsonRFn::parseBool(jsonObject["generateMips"]);
-		const bool isNormalMap  = JsonRFn::parseBool(jsonObject["isNormalMap"]);
+		// Uncompressed unless a block format is requested
+		textureSettings.format = bgfx::TextureFormat::BGRA8;
+		if (JsonObjectFn::has(jsonObject, "format"))
+		{
+			DynamicString formatName(ta);
+			JsonRFn::parseString(jsonObject["format"], formatName);
+			textureSettings.format = bgfx::getFormat(formatName.getCStr());
+			RESOURCE_COMPILER_ASSERT(getIsFormatSupported(bgfx::TextureFormat::Enum(textureSettings.format))
+				, compileOptions
+				, "Unsupported texture format: '%s'"
+				, formatName.getCStr()
+				);
+		}
+	}
+
+	void decodeImage(const char* name, Array<uint8_t>& rgba, uint32_t& imageWidth, uint32_t& imageHeight, CompileOptions& compileOptions)
+	{
+		Buffer source = compileOptions.read(name);
+		int width = 0;
+		int height = 0;
 
-		DynamicString textureSourceName(ta);
-		DynamicString textureOutputName(ta);
-		compileOptions.getAbsolutePath(name.getCStr(), textureSourceName);
-		compileOptions.getTemporaryPath("texture.ktx", textureOutputName);
+		bgfx::ImageContainer imageContainer;
+		if (bgfx::imageParse(imageContainer, ArrayFn::begin(source), ArrayFn::getCount(source)))
+		{
+			bgfx::ImageMip mip;
+			RESOURCE_COMPILER_ASSERT(bgfx::imageGetRawData(imageContainer, 0, 0, ArrayFn::begin(source), ArrayFn::getCount(source), mip)
+				, compileOptions
+				, "Bad texture: '%s'"
+				, name
+				);
+			width = int(mip.m_width);
+			height = int(mip.m_height);
 
-		StringStream args(ta);
-		args << " -f " << textureSourceName.getCStr();
-		args << " -o " << textureOutputName.getCStr();
-		args << (generateMips ? " -m " : "");
-		args << (isNormalMap ? " -n " : "");
+			ArrayFn::resize(rgba, width * height * 4);
+			bgfx::imageDecodeToRgba8(ArrayFn::begin(rgba), mip.m_data, mip.m_width, mip.m_height, mip.m_width * mip.m_bpp / 8, mip.m_format);
+		}
+		else
+		{
+			int componentCount = 0;
+			uint8_t* pixels = stbi_load_from_memory((const stbi_uc*)ArrayFn::begin(source), int(ArrayFn::getCount(source)), &width, &height, &componentCount, 4);
+			RESOURCE_COMPILER_ASSERT(pixels != nullptr
+				, compileOptions
+				, "Unknown image format: '%s'"
+				, name
+				);
+
+			ArrayFn::resize(rgba, width * height * 4);
+			memcpy(ArrayFn::begin(rgba), pixels, width * height * 4);
+			stbi_image_free(pixels);
+		}
+
+		imageWidth = uint32_t(width);
+		imageHeight = uint32_t(height);
+	}
+
+	void compileRgba8(const char* name, Array<uint8_t>& rgba, uint32_t width, uint32_t height, const TextureSettings& textureSettings, CompileOptions& compileOptions)
+	{
+		const bgfx::TextureFormat::Enum format = bgfx::TextureFormat::Enum(textureSettings.format);
+		const bool generateMips = textureSettings.generateMips;
+		const bool isNormalMap = textureSettings.isNormalMap;
 
-		StringStream output(ta);
-		int exitCode = OsFn::executeProcess(TEXTUREC_PATH, StringStreamFn::getCStr(args), output);
-		RESOURCE_COMPILER_ASSERT(exitCode == 0
+		RESOURCE_COMPILER_ASSERT(!getIsEncodedByMip(format) || (width == height && (width & (width - 1)) == 0)
 			, compileOptions
-			, "Failed to compile texture:\n%s"
-			, StringStreamFn::getCStr(output)
+			, "PVRTC textures must be square powers of two: '%s'"
+			, name
 			);
 
-		Buffer blob = compileOptions.readTemporary(textureOutputName.getCStr());
-		compileOptions.deleteFile(textureOutputName.getCStr());
+		RESOURCE_COMPILER_ASSERT(width <= 16384 && height <= 16384 // Fits RIO_MAX_TEXTURE_MIPS
+			, compileOptions
+			, "Texture too large: '%s'"
+			, name
+			);
+
+		const uint8_t mipCount = generateMips ? bgfx::imageGetNumMips(format, uint16_t(width), uint16_t(height)) : 1;
+
+		// Mip sizes follow bgfx, which halves the sizes rounded up to whole blocks
+		const bgfx::ImageBlockInfo& blockInfo = bgfx::getBlockInfo(format);
+		uint32_t mipWidthList[RIO_MAX_TEXTURE_MIPS];
+		uint32_t mipHeightList[RIO_MAX_TEXTURE_MIPS];
+		uint32_t rgbaSize = 0;
+		uint32_t encodedSize = 0;
+		mipWidthList[0] = uint32_t(width);
+		mipHeightList[0] = uint32_t(height);
+		for (uint8_t mip = 0; mip < mipCount; ++mip)
+		{
+			const uint32_t mipWidth = mipWidthList[mip];
+			const uint32_t mipHeight = mipHeightList[mip];
+			rgbaSize += mipWidth * mipHeight * 4;
+			encodedSize += bgfx::imageGetSize(format, uint16_t(mipWidth), uint16_t(mipHeight));
+
+			if (mip + 1 < mipCount)
+			{
+				const uint32_t blockAlignedWidth = (mipWidth + blockInfo.blockWidth - 1) / blockInfo.blockWidth * blockInfo.blockWidth;
+				const uint32_t blockAlignedHeight = (mipHeight + blockInfo.blockHeight - 1) / blockInfo.blockHeight * blockInfo.blockHeight;
+				mipWidthList[mip + 1] = getMaxUint32(1, getMaxUint32(blockInfo.blockWidth * blockInfo.minBlockX, blockAlignedWidth) / 2);
+				mipHeightList[mip + 1] = getMaxUint32(1, getMaxUint32(blockInfo.blockHeight * blockInfo.minBlockY, blockAlignedHeight) / 2);
+			}
+		}
+
+		// All the RGBA8 mips one after the other
+		ArrayFn::resize(rgba, rgbaSize);
+
+		// Encoded mips in the order they are written to the KTX
+		Array<uint8_t> encoded(getDefaultAllocator());
+		ArrayFn::resize(encoded, encodedSize);
+
+		TextureEncoder textureEncoder(getDefaultAllocator());
+		textureEncoder.format = format;
+
+		// Mip generation is sequential, each job encodes one row of blocks or a whole PVRTC mip
+		uint32_t rgbaOffset = 0;
+		uint32_t encodedOffset = 0;
+		for (uint8_t mip = 0; mip < mipCount; ++mip)
+		{
+			const uint32_t mipWidth = mipWidthList[mip];
+			const uint32_t mipHeight = mipHeightList[mip];
+
+			const uint32_t stripHeight = getIsEncodedByMip(format) ? mipHeight : 4;
+			const uint32_t stripSize = bgfx::imageGetSize(format, uint16_t(mipWidth), uint16_t(stripHeight));
+			for (uint32_t y = 0; y < mipHeight; y += stripHeight)
+			{
+				TextureEncodeJob job;
+				job.rgba = &rgba[rgbaOffset + y * mipWidth * 4];
+				job.width = mipWidth;
+				job.height = getMinUint32(stripHeight, mipHeight - y);
+				job.destination = &encoded[encodedOffset + y / stripHeight * stripSize];
+				ArrayFn::pushBack(textureEncoder.jobList, job);
+			}
 
-		// Write DDS
+			encodedOffset += bgfx::imageGetSize(format, uint16_t(mipWidth), uint16_t(mipHeight));
+
+			if (mip + 1 < mipCount)
+			{
+				const uint8_t* source = &rgba[rgbaOffset];
+				rgbaOffset += mipWidth * mipHeight * 4;
+				downsampleRgba8(&rgba[rgbaOffset], mipWidthList[mip + 1], mipHeightList[mip + 1], source, mipWidth, mipHeight, isNormalMap);
+			}
+		}
+
+		// Block compression is the expensive part, it runs on all the threads
+		const uint32_t jobCount = ArrayFn::getCount(textureEncoder.jobList);
+		const uint32_t threadCount = jobCount > 1 ? getMinUint32(RIO_TEXTURE_COMPILER_THREADS, jobCount - 1) : 0;
+		Thread threadList[RIO_TEXTURE_COMPILER_THREADS];
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			threadList[i].start(encodeThreadFunction, &textureEncoder);
+		}
+		encodeThreadFunction(&textureEncoder);
+		for (uint32_t i = 0; i < threadCount; ++i)
+		{
+			threadList[i].stop();
+		}
+
+		RIO_LOGI("Texture: %ux%u %s, %u mips, %u jobs on %u threads"
+			, width
+			, height
+			, bgfx::getName(format)
+			, mipCount
+			, jobCount
+			, threadCount + 1
+			);
+
+		// The mips are written largest first so that a mip and all the smaller ones are a single ranged read
 		compileOptions.write(RESOURCE_VERSION_TEXTURE);
-		compileOptions.write(ArrayFn::getCount(blob));
-		compileOptions.write(blob);
+		compileOptions.write(uint32_t(format));
+		compileOptions.write(uint32_t(width));
+		compileOptions.write(uint32_t(height));
+		compileOptions.write(uint32_t(mipCount));
+
+		uint32_t offset = sizeof(uint32_t) * 5 + sizeof(TextureMip) * mipCount;
+		for (uint8_t mip = 0; mip < mipCount; ++mip)
+		{
+			TextureMip textureMip;
+			textureMip.offset = offset;
+			textureMip.size = bgfx::imageGetSize(format, uint16_t(mipWidthList[mip]), uint16_t(mipHeightList[mip]));
+			textureMip.width = mipWidthList[mip];
+			textureMip.height = mipHeightList[mip];
+			compileOptions.write(textureMip);
+			offset += textureMip.size;
+		}
+
+		compileOptions.write(ArrayFn::begin(encoded), encodedSize);
+	}
+
+	void compile(const char* path, CompileOptions& compileOptions)
+	{
+		TextureSettings textureSettings(getDefaultAllocator());
+		parseTextureSettings(path, textureSettings, compileOptions);
+
+		// Decode the source to RGBA8, the mips are appended later
+		Array<uint8_t> rgba(getDefaultAllocator());
+		uint32_t width = 0;
+		uint32_t height = 0;
+		decodeImage(textureSettings.source.getCStr(), rgba, width, height, compileOptions);
+
+		compileRgba8(textureSettings.source.getCStr(), rgba, width, height, textureSettings, compileOptions);
 	}
 
 	void* load(File& file, Allocator& a)
@@ -85,16 +488,38 @@ namespace TextureResourceInternalFn
 		binaryReader.read(version);
 		RIO_ASSERT(version == RESOURCE_VERSION_TEXTURE, "Wrong version");
 
-		uint32_t size;
-		binaryReader.read(size);
+		TextureResource* textureResource = (TextureResource*)a.allocate(sizeof(TextureResource));
+		binaryReader.read(textureResource->format);
+		binaryReader.read(textureResource->width);
+		binaryReader.read(textureResource->height);
+		binaryReader.read(textureResource->mipCount);
+		binaryReader.read(textureResource->mipList, sizeof(TextureMip) * textureResource->mipCount);
 
-		TextureResource* textureResource = (TextureResource*)a.allocate(sizeof(TextureResource) + size);
+		// Only the small mips are read now, the TextureStreamer reads the others when they are needed
+		uint32_t tailMip = textureResource->mipCount - 1;
+		while (tailMip > 0
+			&& textureResource->mipList[tailMip - 1].width <= RIO_TEXTURE_STREAMING_RESIDENT_SIZE
+			&& textureResource->mipList[tailMip - 1].height <= RIO_TEXTURE_STREAMING_RESIDENT_SIZE
+			)
+		{
+			--tailMip;
+		}
 
-		void* data = &textureResource[1];
-		binaryReader.read(data, size);
+		const uint32_t size = TextureResourceFn::getSize(textureResource, tailMip);
+		const bgfx::Memory* memoryBuffer = bgfx::alloc(size);
+		file.seek(textureResource->mipList[tailMip].offset);
+		binaryReader.read(memoryBuffer->data, size);
 
-		textureResource->memoryBuffer = bgfx::makeRef(data, size);
+		textureResource->name = StringId64();
+		textureResource->memoryBuffer = memoryBuffer;
 		textureResource->handle.idx = bgfx::invalidHandle;
+		textureResource->tailMip = tailMip;
+		textureResource->residentMip = tailMip;
+		textureResource->wantedMip = tailMip;
+		textureResource->screenSize = 0.0f;
+		textureResource->lastUsedFrame = 0;
+		textureResource->streamIndex = 0;
+		textureResource->isPending = false;
 
 		return textureResource;
 	}
@@ -102,12 +527,25 @@ namespace TextureResourceInternalFn
 	void online(StringId64 id, ResourceManager& resourceManager)
 	{
 		TextureResource* textureResource = (TextureResource*)resourceManager.get(RESOURCE_TYPE_TEXTURE, id);
-		textureResource->handle = bgfx::createTexture(textureResource->memoryBuffer);
+		textureResource->name = id;
+
+		const TextureMip& tail = textureResource->mipList[textureResource->tailMip];
+		textureResource->handle = bgfx::createTexture2D(uint16_t(tail.width)
+			, uint16_t(tail.height)
+			, uint8_t(textureResource->mipCount - textureResource->tailMip)
+			, bgfx::TextureFormat::Enum(textureResource->format)
+			, BGFX_TEXTURE_NONE
+			, textureResource->memoryBuffer
+			);
+		textureResource->memoryBuffer = nullptr;
+
+		getDevice()->getTextureStreamer()->add(*textureResource);
 	}
 
 	void offline(StringId64 id, ResourceManager& resourceManager)
 	{
 		TextureResource* textureResource = (TextureResource*)resourceManager.get(RESOURCE_TYPE_TEXTURE, id);
+		getDevice()->getTextureStreamer()->remove(*textureResource);
 		bgfx::destroyTexture(textureResource->handle);
 	}
 
@@ -118,5 +556,14 @@ namespace TextureResourceInternalFn
 
 } // namespace TextureResourceInternalFn
 
+namespace TextureResourceFn
+{
+	uint32_t getSize(const TextureResource* textureResource, uint32_t mip)
+	{
+		const TextureMip& smallest = textureResource->mipList[textureResource->mipCount - 1];
+		return smallest.offset + smallest.size - textureResource->mipList[mip].offset;
+	}
+} // namespace TextureResourceFn
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -1,8 +1,11 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #pragma once
 
+#include "Config.h"
+#include "Core/Containers/ContainerTypes.h"
 #include "Core/Memory/MemoryTypes.h"
 #include "Core/FileSystem/FileSystemTypes.h"
+#include "Core/Strings/DynamicString.h"
 #include "Core/Strings/StringId.h"
 #include "Resource/ResourceTypes.h"
 #include "Resource/CompilerTypes.h"
@@ -12,14 +15,62 @@
 namespace Rio
 {
 
+// header
+// format, width, height, mipCount
+// mipList[mipCount]
+// mips, largest first
+
+struct TextureMip
+{
+	uint32_t offset; // From the start of the file
+	uint32_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
 struct TextureResource
 {
-	const bgfx::Memory* memoryBuffer;
+	uint32_t format; // bgfx::TextureFormat::Enum
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipCount;
+	TextureMip mipList[RIO_MAX_TEXTURE_MIPS];
+	StringId64 name;
+	const bgfx::Memory* memoryBuffer; // Mips read at load, released by bgfx once uploaded
 	bgfx::TextureHandle handle;
+
+	// Streaming state, owned by the TextureStreamer
+	uint32_t tailMip; // The mips from <tailMip> on are always resident
+	uint32_t residentMip; // The largest mip on the GPU
+	uint32_t wantedMip; // The largest mip needed by the last frame that used the texture
+	float screenSize; // Pixels covered by the texture in the last frame that used it
+	uint32_t lastUsedFrame;
+	uint32_t streamIndex;
+	bool isPending; // Whether a read is in flight
+};
+
+// Options of a .texture
+struct TextureSettings
+{
+	TextureSettings(Allocator& a)
+		: source(a)
+	{
+	}
+
+	DynamicString source; // Image file
+	uint32_t format; // bgfx::TextureFormat::Enum
+	bool generateMips;
+	bool isNormalMap;
 };
 
 namespace TextureResourceInternalFn
 {
+	// Reads the options of the .texture at <path>
+	void parseTextureSettings(const char* path, TextureSettings& textureSettings, CompileOptions& compileOptions);
+	// Decodes the image file <name> to RGBA8 pixels
+	void decodeImage(const char* name, Array<uint8_t>& rgba, uint32_t& width, uint32_t& height, CompileOptions& compileOptions);
+	// Writes the texture made of the <width> x <height> RGBA8 pixels <rgba>, which grows to hold the mips
+	void compileRgba8(const char* name, Array<uint8_t>& rgba, uint32_t width, uint32_t height, const TextureSettings& textureSettings, CompileOptions& compileOptions);
 	void compile(const char* path, CompileOptions& compileOptions);
 	void* load(File& file, Allocator& a);
 	void offline(StringId64 id, ResourceManager& resourceManager);
@@ -27,5 +78,11 @@ namespace TextureResourceInternalFn
 	void unload(Allocator& a, void* resource);
 } // namespace TextureResourceInternalFn
 
+namespace TextureResourceFn
+{
+	// Returns the size of the mips from <mip> to the smallest one
+	uint32_t getSize(const TextureResource* textureResource, uint32_t mip);
+} // namespace TextureResourceFn
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,348 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Resource/TextureStreamer.h"
+#include "Config.h"
+#include "Core/Containers/Array.h"
+#include "Core/Containers/Queue.h"
+#include "Core/FileSystem/File.h"
+#include "Core/FileSystem/FileSystem.h"
+#include "Core/FileSystem/Path.h"
+#include "Core/Memory/TempAllocator.h"
+#include "Core/Strings/DynamicString.h"
+#include "Device/Log.h"
+#include "Device/Profiler.h"
+#include "Resource/TextureResource.h"
+
+#include <math.h> // log2f
+
+namespace Rio
+{
+
+namespace TextureStreamerInternalFn
+{
+	// Called by bgfx once the mips are uploaded, on any thread
+	static void releaseMemory(void* data, void* /*userData*/)
+	{
+		getDefaultAllocator().deallocate(data);
+	}
+} // namespace TextureStreamerInternalFn
+
+namespace TextureStreamerFn
+{
+	bool read(FileSystem& fileSystem, TextureStreamRead& textureStreamRead)
+	{
+		textureStreamRead.data = nullptr;
+
+		TempAllocator128 ta;
+		DynamicString resourceTypeStr(ta);
+		DynamicString resourceNameStr(ta);
+		RESOURCE_TYPE_TEXTURE.toString(resourceTypeStr);
+		textureStreamRead.name.toString(resourceNameStr);
+
+		DynamicString resoursePath(ta);
+		resoursePath += resourceTypeStr;
+		resoursePath += '-';
+		resoursePath += resourceNameStr;
+
+		DynamicString path(ta);
+		PathFn::join(RIO_DATA_DIRECTORY, resoursePath.getCStr(), path);
+
+		if (!fileSystem.getDoesExist(path.getCStr()))
+		{
+			return false;
+		}
+
+		File* file = fileSystem.open(path.getCStr(), FileOpenMode::READ);
+		const bool isInFile = file->getSize() >= textureStreamRead.offset + textureStreamRead.size;
+		void* data = isInFile ? getDefaultAllocator().allocate(textureStreamRead.size) : nullptr;
+		if (data != nullptr)
+		{
+			file->seek(textureStreamRead.offset);
+			if (file->read(data, textureStreamRead.size) == textureStreamRead.size)
+			{
+				textureStreamRead.data = data;
+			}
+			else
+			{
+				getDefaultAllocator().deallocate(data);
+			}
+		}
+		fileSystem.close(*file);
+
+		return textureStreamRead.data != nullptr;
+	}
+} // namespace TextureStreamerFn
+
+TextureStreamer::TextureStreamer(FileSystem& fileSystem, uint32_t budget)
+	: fileSystem(fileSystem)
+	, budget(budget)
+	, textureList(getDefaultAllocator())
+	, readList(getDefaultAllocator())
+	, completedReadList(getDefaultAllocator())
+{
+	textureStreamerThread.start(TextureStreamer::threadProcedure, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	RIO_ASSERT(ArrayFn::getCount(textureList) == 0, "Textures still streaming");
+
+	mutex.lock();
+	exitRequested = true;
+	mutex.unlock();
+	semaphore.post();
+	textureStreamerThread.stop();
+}
+
+void TextureStreamer::add(TextureResource& textureResource)
+{
+	textureResource.streamIndex = ArrayFn::getCount(textureList);
+	ArrayFn::pushBack(textureList, &textureResource);
+
+	const uint32_t size = TextureResourceFn::getSize(&textureResource, textureResource.residentMip);
+	usedMemory += size;
+	committedMemory += size;
+}
+
+void TextureStreamer::remove(TextureResource& textureResource)
+{
+	if (textureResource.isPending)
+	{
+		flush();
+	}
+
+	const uint32_t size = TextureResourceFn::getSize(&textureResource, textureResource.residentMip);
+	usedMemory -= size;
+	committedMemory -= size;
+
+	const uint32_t last = ArrayFn::getCount(textureList) - 1;
+	textureList[textureResource.streamIndex] = textureList[last];
+	textureList[textureResource.streamIndex]->streamIndex = textureResource.streamIndex;
+	ArrayFn::popBack(textureList);
+}
+
+void TextureStreamer::request(TextureResource& textureResource, float screenSize)
+{
+	if (textureResource.lastUsedFrame != frame)
+	{
+		textureResource.lastUsedFrame = frame;
+		textureResource.screenSize = 0.0f;
+	}
+
+	if (screenSize <= textureResource.screenSize)
+	{
+		return;
+	}
+
+	// The smallest mip with at least one texel per pixel
+	const uint32_t size = textureResource.width > textureResource.height ? textureResource.width : textureResource.height;
+	const float texelsPerPixel = float(size) / screenSize;
+	const uint32_t mip = texelsPerPixel >= 2.0f ? uint32_t(log2f(texelsPerPixel)) : 0;
+
+	textureResource.screenSize = screenSize;
+	textureResource.wantedMip = mip < textureResource.tailMip ? mip : textureResource.tailMip;
+}
+
+void TextureStreamer::update()
+{
+	completeReads();
+
+	// Textures used in this frame which miss mips, the largest on screen goes first
+	TextureResource* best = nullptr;
+	for (uint32_t i = 0, n = ArrayFn::getCount(textureList); i < n; ++i)
+	{
+		TextureResource* textureResource = textureList[i];
+		if (textureResource->lastUsedFrame == frame
+			&& textureResource->isPending == false
+			&& textureResource->wantedMip < textureResource->residentMip
+			&& (best == nullptr || textureResource->screenSize > best->screenSize)
+			)
+		{
+			best = textureResource;
+		}
+	}
+
+	if (best != nullptr && pendingReadCount < RIO_TEXTURE_STREAMING_MAX_READS)
+	{
+		const uint32_t residentSize = TextureResourceFn::getSize(best, best->residentMip);
+		uint32_t mip = best->wantedMip;
+
+		// Give back the memory of the least recently used textures, or settle for smaller mips
+		while (mip < best->residentMip && committedMemory + TextureResourceFn::getSize(best, mip) - residentSize > budget)
+		{
+			TextureResource* leastRecentlyUsed = pendingReadCount + 1 < RIO_TEXTURE_STREAMING_MAX_READS
+				? getLeastRecentlyUsed()
+				: nullptr
+				;
+			if (leastRecentlyUsed != nullptr)
+			{
+				addRead(*leastRecentlyUsed, leastRecentlyUsed->tailMip);
+			}
+			else
+			{
+				++mip;
+			}
+		}
+
+		if (mip < best->residentMip)
+		{
+			addRead(*best, mip);
+		}
+	}
+
+	RECORD_FLOAT("textureStreamer.usedMemory", float(usedMemory));
+	RECORD_FLOAT("textureStreamer.pendingReads", float(pendingReadCount));
+
+	++frame;
+}
+
+void TextureStreamer::flush()
+{
+	while (pendingReadCount != 0)
+	{
+		completedSemaphore.wait();
+		completeReads();
+	}
+}
+
+uint32_t TextureStreamer::getUsedMemory() const
+{
+	return usedMemory;
+}
+
+void TextureStreamer::addRead(TextureResource& textureResource, uint32_t mip)
+{
+	RIO_ASSERT(textureResource.isPending == false, "Texture already streaming");
+
+	TextureStreamRead textureStreamRead;
+	textureStreamRead.textureResource = &textureResource;
+	textureStreamRead.name = textureResource.name;
+	textureStreamRead.mip = mip;
+	textureStreamRead.offset = textureResource.mipList[mip].offset;
+	textureStreamRead.size = TextureResourceFn::getSize(&textureResource, mip);
+	textureStreamRead.data = nullptr;
+
+	committedMemory += textureStreamRead.size;
+	committedMemory -= TextureResourceFn::getSize(&textureResource, textureResource.residentMip);
+	textureResource.isPending = true;
+	++pendingReadCount;
+
+	mutex.lock();
+	QueueFn::pushBack(readList, textureStreamRead);
+	mutex.unlock();
+	semaphore.post();
+}
+
+void TextureStreamer::completeReads()
+{
+	ScopedMutex scopedMutex(completedMutex);
+
+	while (!QueueFn::getIsEmpty(completedReadList))
+	{
+		const TextureStreamRead& textureStreamRead = QueueFn::front(completedReadList);
+		TextureResource& textureResource = *textureStreamRead.textureResource;
+
+		if (textureStreamRead.data == nullptr)
+		{
+			StringId64 name = textureStreamRead.name;
+			TempAllocator128 ta;
+			DynamicString resourceNameStr(ta);
+			name.toString(resourceNameStr);
+			RIO_LOGE("Failed to stream mip %u of texture '%s'", textureStreamRead.mip, resourceNameStr.getCStr());
+
+			// Keep the resident mips and stop streaming the texture
+			committedMemory -= textureStreamRead.size;
+			committedMemory += TextureResourceFn::getSize(&textureResource, textureResource.residentMip);
+			textureResource.tailMip = textureResource.residentMip;
+			textureResource.wantedMip = textureResource.residentMip;
+			textureResource.isPending = false;
+			--pendingReadCount;
+
+			QueueFn::popFront(completedReadList);
+			continue;
+		}
+
+		// A new texture with all the mips read, bgfx gives the memory back once uploaded
+		const TextureMip& largest = textureResource.mipList[textureStreamRead.mip];
+		const bgfx::TextureHandle handle = bgfx::createTexture2D(uint16_t(largest.width)
+			, uint16_t(largest.height)
+			, uint8_t(textureResource.mipCount - textureStreamRead.mip)
+			, bgfx::TextureFormat::Enum(textureResource.format)
+			, BGFX_TEXTURE_NONE
+			, bgfx::makeRef(textureStreamRead.data, textureStreamRead.size, TextureStreamerInternalFn::releaseMemory)
+			);
+		bgfx::destroyTexture(textureResource.handle);
+		textureResource.handle = handle;
+
+		usedMemory += textureStreamRead.size;
+		usedMemory -= TextureResourceFn::getSize(&textureResource, textureResource.residentMip);
+		textureResource.residentMip = textureStreamRead.mip;
+		textureResource.isPending = false;
+		--pendingReadCount;
+
+		QueueFn::popFront(completedReadList);
+	}
+}
+
+TextureResource* TextureStreamer::getLeastRecentlyUsed()
+{
+	TextureResource* leastRecentlyUsed = nullptr;
+	for (uint32_t i = 0, n = ArrayFn::getCount(textureList); i < n; ++i)
+	{
+		TextureResource* textureResource = textureList[i];
+		if (textureResource->lastUsedFrame != frame
+			&& textureResource->isPending == false
+			&& textureResource->residentMip < textureResource->tailMip
+			&& (leastRecentlyUsed == nullptr || textureResource->lastUsedFrame < leastRecentlyUsed->lastUsedFrame)
+			)
+		{
+			leastRecentlyUsed = textureResource;
+		}
+	}
+
+	return leastRecentlyUsed;
+}
+
+int32_t TextureStreamer::run()
+{
+	ProfilerFn::setThreadName("textureStreamer");
+
+	for (;;)
+	{
+		semaphore.wait();
+
+		mutex.lock();
+		if (QueueFn::getIsEmpty(readList))
+		{
+			const bool exit = exitRequested;
+			mutex.unlock();
+			if (exit)
+			{
+				break;
+			}
+			continue;
+		}
+		TextureStreamRead textureStreamRead = QueueFn::front(readList);
+		QueueFn::popFront(readList);
+		mutex.unlock();
+
+		{
+			PROFILE_SCOPE("textureStreamer.read");
+			TextureStreamerFn::read(fileSystem, textureStreamRead);
+		}
+
+		completedMutex.lock();
+		QueueFn::pushBack(completedReadList, textureStreamRead);
+		completedMutex.unlock();
+		completedSemaphore.post();
+	}
+
+	return 0;
+}
+
+int32_t TextureStreamer::threadProcedure(void* thiz)
+{
+	return ((TextureStreamer*)thiz)->run();
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,86 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+#include "Core/Containers/ContainerTypes.h"
+#include "Core/FileSystem/FileSystemTypes.h"
+#include "Core/Strings/StringId.h"
+#include "Core/Thread/Mutex.h"
+#include "Core/Thread/Semaphore.h"
+#include "Core/Thread/Thread.h"
+#include "Resource/ResourceTypes.h"
+
+#include <bgfx/bgfx.h>
+
+namespace Rio
+{
+
+// A ranged read of the mips of a texture from <mip> to the smallest one
+struct TextureStreamRead
+{
+	TextureResource* textureResource;
+	StringId64 name;
+	uint32_t mip;
+	uint32_t offset;
+	uint32_t size;
+	void* data; // The mips read from <offset>, nullptr if the read failed
+};
+
+namespace TextureStreamerFn
+{
+	// Reads the mips of <textureStreamRead> from the compiled texture in <fileSystem>
+	// Returns whether all the bytes were read, <textureStreamRead.data> is then allocated from the default allocator
+	bool read(FileSystem& fileSystem, TextureStreamRead& textureStreamRead);
+} // namespace TextureStreamerFn
+
+// Streams the large mips of the textures in a background thread
+// Textures load with their small mips only, the larger ones are read when the textures are requested,
+// largest on screen first, and given back least recently used first to stay within the memory budget
+class TextureStreamer
+{
+public:
+	// Keeps the textures within <budget> bytes of GPU memory, read from <fileSystem>
+	TextureStreamer(FileSystem& fileSystem, uint32_t budget);
+	~TextureStreamer();
+	// Starts streaming the mips of <textureResource>
+	void add(TextureResource& textureResource);
+	// Stops streaming the mips of <textureResource>
+	void remove(TextureResource& textureResource);
+	// Requests the mips needed to draw <textureResource> over <screenSize> pixels in this frame
+	void request(TextureResource& textureResource, float screenSize);
+	// Uploads the mips read so far and reads the ones requested in this frame
+	void update();
+	// Blocks until all the reads have been uploaded
+	void flush();
+	// Returns the bytes of GPU memory used by the textures
+	uint32_t getUsedMemory() const;
+private:
+	void addRead(TextureResource& textureResource, uint32_t mip);
+	void completeReads();
+	// Returns the least recently used texture that can give back memory, if any
+	TextureResource* getLeastRecentlyUsed();
+	int32_t run();
+	static int32_t threadProcedure(void* thiz);
+
+	FileSystem& fileSystem;
+	uint32_t budget;
+	uint32_t usedMemory = 0;
+	uint32_t committedMemory = 0; // <usedMemory> once the reads in flight are uploaded
+	uint32_t frame = 1;
+	uint32_t pendingReadCount = 0;
+
+	Array<TextureResource*> textureList;
+
+	Queue<TextureStreamRead> readList;
+	Queue<TextureStreamRead> completedReadList;
+
+	Thread textureStreamerThread;
+	Semaphore semaphore;
+	Semaphore completedSemaphore; // Posted for each read moved to <completedReadList>
+	Mutex mutex;
+	Mutex completedMutex;
+	bool exitRequested = false;
+};
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
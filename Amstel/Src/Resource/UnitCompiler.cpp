@@ -8,6 +8,7 @@
 #include "Core/Math/MathUtils.h"
 #include "Core/Json/JsonR.h"
 #include "Core/Json/JsonObject.h"
+#include "Core/Json/JsonTape.h"
 #include "Core/Memory/TempAllocator.h"
 
 #include "Resource/CompileOptions.h"
@@ -302,16 +303,16 @@ void UnitCompiler::compileUnitFromJson(const char* json)
 
 void UnitCompiler::compileMultipleUnits(const char* json)
 {
-	TempAllocator4096 ta;
-	JsonObject jsonObject(ta);
-	JsonRFn::parse(json, jsonObject);
-
-	auto begin = JsonObjectFn::begin(jsonObject);
-	auto end = JsonObjectFn::end(jsonObject);
+	JsonTape tape(getDefaultAllocator());
+	JsonTapeFn::parse(json, tape);
+	compileMultipleUnits(tape, JsonTapeFn::getRoot(tape));
+}
 
-	for (; begin != end; ++begin)
+void UnitCompiler::compileMultipleUnits(const JsonTape& tape, uint32_t units)
+{
+	for (uint32_t unit = JsonTapeFn::getFirstMember(tape, units); unit != JSON_TAPE_INVALID; unit = JsonTapeFn::getNextMember(tape, unit))
 	{
-		compileUnitFromJson(begin->pair.second);
+		compileUnitFromJson(JsonTapeFn::getJson(tape, unit));
 	}
 }
 
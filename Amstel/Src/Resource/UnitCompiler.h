@@ -50,6 +50,8 @@ public:
 	void compileUnit(const char* path);
 	void compileUnitFromJson(const char* json);
 	void compileMultipleUnits(const char* json);
+	// Compiles the units of the object <units> of <tape>
+	void compileMultipleUnits(const JsonTape& tape, uint32_t units);
 
 	Buffer getBlob();
 private:
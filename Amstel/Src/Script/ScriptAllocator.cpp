@@ -0,0 +1,125 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Script/ScriptAllocator.h"
+#include "Core/Error/Error.h"
+#include "Core/Memory/Allocator.h"
+
+#include <string.h> // memcpy, memset
+
+namespace Rio
+{
+
+ScriptAllocator::ScriptAllocator(Allocator& backing)
+	: backingAllocator(backing)
+{
+	memset(freeList, 0, sizeof(freeList));
+}
+
+ScriptAllocator::~ScriptAllocator()
+{
+	while (chunkList != nullptr)
+	{
+		void* next = *(void**)chunkList;
+		backingAllocator.deallocate(chunkList);
+		chunkList = next;
+	}
+}
+
+void* ScriptAllocator::reallocate(void* pointer, size_t oldSize, size_t newSize)
+{
+	if (newSize == 0)
+	{
+		deallocate(pointer, oldSize);
+		return nullptr;
+	}
+
+	if (pointer == nullptr)
+	{
+		return allocate(newSize);
+	}
+
+	// Blocks of the same size class can be resized in place
+	if (oldSize <= MAX_BLOCK_SIZE && newSize <= MAX_BLOCK_SIZE && getSizeClass(oldSize) == getSizeClass(newSize))
+	{
+		usedBytes += uint32_t(newSize) - uint32_t(oldSize);
+		return pointer;
+	}
+
+	void* newPointer = allocate(newSize);
+	memcpy(newPointer, pointer, oldSize < newSize ? oldSize : newSize);
+	deallocate(pointer, oldSize);
+	return newPointer;
+}
+
+uint32_t ScriptAllocator::getUsedBytes() const
+{
+	return usedBytes;
+}
+
+void* ScriptAllocator::luaAllocate(void* userData, void* pointer, size_t oldSize, size_t newSize)
+{
+	return ((ScriptAllocator*)userData)->reallocate(pointer, oldSize, newSize);
+}
+
+uint32_t ScriptAllocator::getSizeClass(size_t size)
+{
+	uint32_t sizeClass = 0;
+	for (size_t blockSize = MIN_BLOCK_SIZE; blockSize < size; blockSize <<= 1)
+	{
+		++sizeClass;
+	}
+	return sizeClass;
+}
+
+void* ScriptAllocator::allocate(size_t size)
+{
+	usedBytes += uint32_t(size);
+
+	if (size > MAX_BLOCK_SIZE)
+	{
+		return backingAllocator.allocate(uint32_t(size), BLOCK_ALIGN);
+	}
+
+	const uint32_t sizeClass = getSizeClass(size);
+	if (freeList[sizeClass] == nullptr)
+	{
+		// Carve a new chunk into blocks of this size class, the first block links the chunks
+		char* chunk = (char*)backingAllocator.allocate(CHUNK_SIZE, BLOCK_ALIGN);
+		*(void**)chunk = chunkList;
+		chunkList = chunk;
+
+		const uint32_t blockSize = MIN_BLOCK_SIZE << sizeClass;
+		for (uint32_t offset = blockSize; offset + blockSize <= CHUNK_SIZE; offset += blockSize)
+		{
+			*(void**)(chunk + offset) = freeList[sizeClass];
+			freeList[sizeClass] = chunk + offset;
+		}
+	}
+
+	void* block = freeList[sizeClass];
+	freeList[sizeClass] = *(void**)block;
+	return block;
+}
+
+void ScriptAllocator::deallocate(void* pointer, size_t size)
+{
+	if (pointer == nullptr)
+	{
+		return;
+	}
+
+	RIO_ASSERT(usedBytes >= size, "Block not allocated by this allocator");
+	usedBytes -= uint32_t(size);
+
+	if (size > MAX_BLOCK_SIZE)
+	{
+		backingAllocator.deallocate(pointer);
+		return;
+	}
+
+	const uint32_t sizeClass = getSizeClass(size);
+	*(void**)pointer = freeList[sizeClass];
+	freeList[sizeClass] = pointer;
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,51 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+#include "Core/Memory/MemoryTypes.h"
+
+#include <stddef.h> // size_t
+
+namespace Rio
+{
+
+// Allocator of the Lua heap, see ScriptAllocator::luaAllocate()
+// Small blocks come from size-class pools carved out of large chunks, the others from the backing allocator
+// Lua passes the size of every block it frees or resizes, so the blocks carry no header
+class ScriptAllocator
+{
+public:
+	ScriptAllocator(Allocator& backing);
+	~ScriptAllocator();
+	// Allocates, resizes or frees the block <pointer> of <oldSize> bytes, with the semantics of lua_Alloc
+	void* reallocate(void* pointer, size_t oldSize, size_t newSize);
+	// Returns the bytes allocated by Lua
+	uint32_t getUsedBytes() const;
+	// The lua_Alloc function, <userData> is the ScriptAllocator
+	static void* luaAllocate(void* userData, void* pointer, size_t oldSize, size_t newSize);
+private:
+	// Disable copying
+	ScriptAllocator(const ScriptAllocator&) = delete;
+	ScriptAllocator& operator=(const ScriptAllocator&) = delete;
+
+	enum
+	{
+		MIN_BLOCK_SIZE = 16,
+		SIZE_CLASS_COUNT = 6, // 16 to 512 bytes
+		MAX_BLOCK_SIZE = MIN_BLOCK_SIZE << (SIZE_CLASS_COUNT - 1),
+		CHUNK_SIZE = 64 * 1024,
+		BLOCK_ALIGN = 16
+	};
+
+	static uint32_t getSizeClass(size_t size);
+	void* allocate(size_t size);
+	void deallocate(void* pointer, size_t size);
+
+	Allocator& backingAllocator;
+	void* freeList[SIZE_CLASS_COUNT]; // Free blocks of each size class, linked through their first bytes
+	void* chunkList = nullptr; // Chunks of the pools, linked through their first bytes
+	uint32_t usedBytes = 0;
+};
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -1,6 +1,7 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Core/Strings/StringStream.h"
 #include "Core/Memory/TempAllocator.h"
+#include "Core/Memory/ProxyAllocator.h"
 #include "Core/Strings/DynamicString.h"
 #include "Core/Base/Guid.h"
 #include "Core/Math/Color4.h"
@@ -24,6 +25,7 @@
 
 #include "World/DebugLine.h"
 #include "World/DebugGui.h"
+#include "World/Level.h"
 #include "World/Material.h"
 #include "World/PhysicsWorld.h"
 #include "World/RenderWorld.h"
@@ -1348,6 +1350,26 @@ static int world_destroyUnit(lua_State* scriptState)
 	return 0;
 }
 
+static int world_destroyUnits(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+
+	const uint32_t count = scriptStack.getTableCount(2);
+
+	TempAllocator1024 ta;
+	Array<UnitId> unitIdList(ta);
+	ArrayFn::resize(unitIdList, count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lua_rawgeti(scriptState, 2, i + 1);
+		unitIdList[i] = scriptStack.getUnit(-1);
+		lua_pop(scriptState, 1);
+	}
+
+	scriptStack.getWorld(1)->destroyUnits(count, ArrayFn::begin(unitIdList));
+	return 0;
+}
+
 static int world_getUnitListCount(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -1610,6 +1632,19 @@ static int world_loadLevel(lua_State* scriptState)
 	return 1;
 }
 
+static int world_loadLevelAsync(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	const int argumentsCount = scriptStack.getArgumentsCount();
+
+	const StringId64 name = scriptStack.getResourceId(2);
+	const Vector3& position = argumentsCount > 2 ? scriptStack.getVector3(3) : VECTOR3_ZERO;
+	const Quaternion& rotation = argumentsCount > 3 ? scriptStack.getQuaternion(4) : QUATERNION_IDENTITY;
+	const ResourcePackage* resourcePackage = argumentsCount > 4 ? scriptStack.getResourcePackage(5) : nullptr;
+	scriptStack.pushLevel(scriptStack.getWorld(1)->loadLevelAsync(name, position, rotation, resourcePackage));
+	return 1;
+}
+
 static int world_getSceneGraph(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -1772,6 +1807,146 @@ static int sceneGraph_unlink(lua_State* scriptState)
 	return 0;
 }
 
+// Reads the table of transform instances at <i>, raises an error on an instance not in <sceneGraph>
+static void getTransformInstanceList(ScriptStack& scriptStack, int i, const SceneGraph& sceneGraph, Array<TransformInstance>& transformInstanceList)
+{
+	const uint32_t count = scriptStack.getTableCount(i);
+	const uint32_t nodeCount = sceneGraph.getNodeCount();
+	ArrayFn::resize(transformInstanceList, count);
+	for (uint32_t j = 0; j < count; ++j)
+	{
+		transformInstanceList[j].i = scriptStack.getTableUint32(i, j + 1);
+		if (transformInstanceList[j].i >= nodeCount)
+		{
+			luaL_error(scriptStack.scriptState, "Bad transform instance at index %d", (int)(j + 1));
+		}
+	}
+}
+
+// Reads <count> floats from the flat table at <i>
+static void getFloatList(ScriptStack& scriptStack, int i, float* floatList, uint32_t count)
+{
+	LUA_ASSERT(scriptStack.getTableCount(i) >= count, scriptStack, "Not enough values");
+	for (uint32_t j = 0; j < count; ++j)
+	{
+		floatList[j] = scriptStack.getTableFloat(i, j + 1);
+	}
+}
+
+// Writes the <count> <floatList> to the flat table at <i>, or to a new table when there is none
+// Returns 1, the table is left on the stack
+static int pushFloatList(ScriptStack& scriptStack, int i, const float* floatList, uint32_t count)
+{
+	if (!lua_istable(scriptStack.scriptState, i))
+	{
+		scriptStack.pushTable(count);
+	}
+	else
+	{
+		lua_pushvalue(scriptStack.scriptState, i);
+	}
+
+	const int table = lua_gettop(scriptStack.scriptState);
+	for (uint32_t j = 0; j < count; ++j)
+	{
+		scriptStack.setTableFloat(table, j + 1, floatList[j]);
+	}
+	return 1;
+}
+
+static int sceneGraph_setLocalPositionList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<TransformInstance> transformInstanceList(ta);
+	getTransformInstanceList(scriptStack, 2, *scriptStack.getSceneGraph(1), transformInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(transformInstanceList);
+	Array<Vector3> positionList(ta);
+	ArrayFn::resize(positionList, count);
+	getFloatList(scriptStack, 3, (float*)ArrayFn::begin(positionList), count * 3);
+
+	scriptStack.getSceneGraph(1)->setLocalPosition(count, ArrayFn::begin(transformInstanceList), ArrayFn::begin(positionList));
+	return 0;
+}
+
+static int sceneGraph_setLocalRotationList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<TransformInstance> transformInstanceList(ta);
+	getTransformInstanceList(scriptStack, 2, *scriptStack.getSceneGraph(1), transformInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(transformInstanceList);
+	Array<Quaternion> rotationList(ta);
+	ArrayFn::resize(rotationList, count);
+	getFloatList(scriptStack, 3, (float*)ArrayFn::begin(rotationList), count * 4);
+
+	scriptStack.getSceneGraph(1)->setLocalRotation(count, ArrayFn::begin(transformInstanceList), ArrayFn::begin(rotationList));
+	return 0;
+}
+
+static int sceneGraph_setLocalPoseList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<TransformInstance> transformInstanceList(ta);
+	getTransformInstanceList(scriptStack, 2, *scriptStack.getSceneGraph(1), transformInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(transformInstanceList);
+	Array<Matrix4x4> poseList(ta);
+	ArrayFn::resize(poseList, count);
+	getFloatList(scriptStack, 3, (float*)ArrayFn::begin(poseList), count * 16);
+
+	scriptStack.getSceneGraph(1)->setLocalPose(count, ArrayFn::begin(transformInstanceList), ArrayFn::begin(poseList));
+	return 0;
+}
+
+static int sceneGraph_getLocalPositionList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<TransformInstance> transformInstanceList(ta);
+	getTransformInstanceList(scriptStack, 2, *scriptStack.getSceneGraph(1), transformInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(transformInstanceList);
+	Array<Vector3> positionList(ta);
+	ArrayFn::resize(positionList, count);
+	scriptStack.getSceneGraph(1)->getLocalPosition(count, ArrayFn::begin(transformInstanceList), ArrayFn::begin(positionList));
+
+	return pushFloatList(scriptStack, 3, (const float*)ArrayFn::begin(positionList), count * 3);
+}
+
+static int sceneGraph_getLocalRotationList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<TransformInstance> transformInstanceList(ta);
+	getTransformInstanceList(scriptStack, 2, *scriptStack.getSceneGraph(1), transformInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(transformInstanceList);
+	Array<Quaternion> rotationList(ta);
+	ArrayFn::resize(rotationList, count);
+	scriptStack.getSceneGraph(1)->getLocalRotation(count, ArrayFn::begin(transformInstanceList), ArrayFn::begin(rotationList));
+
+	return pushFloatList(scriptStack, 3, (const float*)ArrayFn::begin(rotationList), count * 4);
+}
+
+static int sceneGraph_getLocalPoseList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<TransformInstance> transformInstanceList(ta);
+	getTransformInstanceList(scriptStack, 2, *scriptStack.getSceneGraph(1), transformInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(transformInstanceList);
+	Array<Matrix4x4> poseList(ta);
+	ArrayFn::resize(poseList, count);
+	scriptStack.getSceneGraph(1)->getLocalPose(count, ArrayFn::begin(transformInstanceList), ArrayFn::begin(poseList));
+
+	return pushFloatList(scriptStack, 3, (const float*)ArrayFn::begin(poseList), count * 16);
+}
+
 static int unitManager_create(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -1869,6 +2044,53 @@ static int renderWorld_meshSetVisible(lua_State* scriptState)
 	return 0;
 }
 
+// Reads the table of mesh instances at <i>, raises an error on an instance not in <renderWorld>
+static void getMeshInstanceList(ScriptStack& scriptStack, int i, const RenderWorld& renderWorld, Array<MeshInstance>& meshInstanceList)
+{
+	const uint32_t count = scriptStack.getTableCount(i);
+	const uint32_t meshCount = renderWorld.meshGetCount();
+	ArrayFn::resize(meshInstanceList, count);
+	for (uint32_t j = 0; j < count; ++j)
+	{
+		meshInstanceList[j].i = scriptStack.getTableUint32(i, j + 1);
+		if (meshInstanceList[j].i >= meshCount)
+		{
+			luaL_error(scriptStack.scriptState, "Bad mesh instance at index %d", (int)(j + 1));
+		}
+	}
+}
+
+static int renderWorld_meshSetVisibleList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<MeshInstance> meshInstanceList(ta);
+	getMeshInstanceList(scriptStack, 2, *scriptStack.getRenderWorld(1), meshInstanceList);
+
+	const uint32_t count = ArrayFn::getCount(meshInstanceList);
+	LUA_ASSERT(scriptStack.getTableCount(3) >= count, scriptStack, "Not enough values");
+	Array<bool> visibleList(ta);
+	ArrayFn::resize(visibleList, count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		visibleList[i] = scriptStack.getTableBool(3, i + 1);
+	}
+
+	scriptStack.getRenderWorld(1)->meshSetVisible(count, ArrayFn::begin(meshInstanceList), ArrayFn::begin(visibleList));
+	return 0;
+}
+
+static int renderWorld_meshSetMaterialList(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator4096 ta;
+	Array<MeshInstance> meshInstanceList(ta);
+	getMeshInstanceList(scriptStack, 2, *scriptStack.getRenderWorld(1), meshInstanceList);
+
+	scriptStack.getRenderWorld(1)->meshSetMaterial(ArrayFn::getCount(meshInstanceList), ArrayFn::begin(meshInstanceList), scriptStack.getResourceId(3));
+	return 0;
+}
+
 static int renderWorld_spriteCreate(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -2491,6 +2713,21 @@ static int device_createWorld(lua_State* scriptState)
 	return 1;
 }
 
+static int device_getBenchmarkWorld(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	World* world = getDevice()->getBenchmarkWorld();
+	if (world != nullptr)
+	{
+		scriptStack.pushWorld(world);
+	}
+	else
+	{
+		scriptStack.pushNil();
+	}
+	return 1;
+}
+
 static int device_destroyWorld(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -2699,6 +2936,60 @@ static int device_getGuid(lua_State* scriptState)
 	return 1;
 }
 
+static int device_getMemoryStats(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	TempAllocator1024 ta;
+	Array<ProxyAllocatorStats> statsList(ta);
+	ProxyAllocatorGlobalFn::getStats(statsList);
+	scriptStack.pushTable(ArrayFn::getCount(statsList));
+	for (uint32_t i = 0; i < ArrayFn::getCount(statsList); ++i)
+	{
+		const ProxyAllocatorStats& stats = statsList[i];
+
+		scriptStack.pushKeyBegin(i+1);
+		scriptStack.pushTable(0, 7);
+		{
+			scriptStack.pushKeyBegin("name");
+			scriptStack.pushString(stats.name);
+			scriptStack.pushKeyEnd();
+
+			scriptStack.pushKeyBegin("parent");
+			if (stats.parentName != nullptr)
+			{
+				scriptStack.pushString(stats.parentName);
+			}
+			else
+			{
+				scriptStack.pushNil();
+			}
+			scriptStack.pushKeyEnd();
+
+			scriptStack.pushKeyBegin("depth");
+			scriptStack.pushInteger(stats.depth);
+			scriptStack.pushKeyEnd();
+
+			scriptStack.pushKeyBegin("current");
+			scriptStack.pushInteger(stats.currentBytes);
+			scriptStack.pushKeyEnd();
+
+			scriptStack.pushKeyBegin("peak");
+			scriptStack.pushInteger(stats.peakBytes);
+			scriptStack.pushKeyEnd();
+
+			scriptStack.pushKeyBegin("allocations");
+			scriptStack.pushInteger(stats.allocationCount);
+			scriptStack.pushKeyEnd();
+
+			scriptStack.pushKeyBegin("frameAllocations");
+			scriptStack.pushInteger(stats.frameAllocationCount);
+			scriptStack.pushKeyEnd();
+		}
+		scriptStack.pushKeyEnd();
+	}
+	return 1;
+}
+
 static int profiler_enterProfileScope(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -2841,6 +3132,65 @@ static int debugLine_toString(lua_State* scriptState)
 	return 1;
 }
 
+static int script_spawn(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	LUA_ASSERT(scriptStack.getIsFunction(1), scriptStack, "Function expected");
+	getDevice()->getScriptEnvironment()->spawnCoroutine(scriptState, scriptStack.getArgumentsCount() - 1);
+	return 0;
+}
+
+static int script_waitForFrame(lua_State* scriptState)
+{
+	return getDevice()->getScriptEnvironment()->waitForFrame(scriptState);
+}
+
+static int script_wait(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	return getDevice()->getScriptEnvironment()->waitForTime(scriptState, scriptStack.getFloat(1));
+}
+
+static int script_waitForPackage(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	return getDevice()->getScriptEnvironment()->waitForPackage(scriptState, scriptStack.getResourcePackage(1));
+}
+
+static int script_waitForLevel(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	return getDevice()->getScriptEnvironment()->waitForLevel(scriptState, scriptStack.getLevel(1));
+}
+
+static int script_getCoroutineCount(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	scriptStack.pushInteger(getDevice()->getScriptEnvironment()->getCoroutineCount());
+	return 1;
+}
+
+static int level_getIsLoaded(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	scriptStack.pushBool(scriptStack.getLevel(1)->getIsLoaded());
+	return 1;
+}
+
+static int level_getLoadProgress(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	scriptStack.pushFloat(scriptStack.getLevel(1)->getLoadProgress());
+	return 1;
+}
+
+static int level_cancelLoad(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	scriptStack.getLevel(1)->cancelLoad();
+	return 0;
+}
+
 static int resourcePackage_load(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -2869,6 +3219,13 @@ static int resourcePackage_hasLoaded(lua_State* scriptState)
 	return 1;
 }
 
+static int resourcePackage_getPendingCount(lua_State* scriptState)
+{
+	ScriptStack scriptStack(scriptState);
+	scriptStack.pushInteger(scriptStack.getResourcePackage(1)->getPendingCount());
+	return 1;
+}
+
 static int resourcePackage_getString(lua_State* scriptState)
 {
 	ScriptStack scriptStack(scriptState);
@@ -3297,6 +3654,7 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("World", "spawnUnit", world_spawnUnit);
 	scriptEnvironment.addModuleFunction("World", "spawnEmptyUnit", world_spawnEmptyUnit);
 	scriptEnvironment.addModuleFunction("World", "destroyUnit", world_destroyUnit);
+	scriptEnvironment.addModuleFunction("World", "destroyUnits", world_destroyUnits);
 	scriptEnvironment.addModuleFunction("World", "getUnitListCount", world_getUnitListCount);
 	scriptEnvironment.addModuleFunction("World", "getUnitList", world_getUnitList);
 
@@ -3329,6 +3687,7 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("World", "createScreenDebugGui", world_createScreenDebugGui);
 	scriptEnvironment.addModuleFunction("World", "destroyGui", world_destroyGui);
 	scriptEnvironment.addModuleFunction("World", "loadLevel", world_loadLevel);
+	scriptEnvironment.addModuleFunction("World", "loadLevelAsync", world_loadLevelAsync);
 	scriptEnvironment.addModuleFunction("World", "getSceneGraph", world_getSceneGraph);
 	scriptEnvironment.addModuleFunction("World", "getRenderWorld", world_getRenderWorld);
 	scriptEnvironment.addModuleFunction("World", "getPhysicsWorld", world_getPhysicsWorld);
@@ -3350,6 +3709,12 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("SceneGraph", "setLocalRotation", sceneGraph_setLocalRotation);
 	scriptEnvironment.addModuleFunction("SceneGraph", "setLocalScale", sceneGraph_setLocalScale);
 	scriptEnvironment.addModuleFunction("SceneGraph", "setLocalPose", sceneGraph_setLocalPose);
+	scriptEnvironment.addModuleFunction("SceneGraph", "setLocalPositionList", sceneGraph_setLocalPositionList);
+	scriptEnvironment.addModuleFunction("SceneGraph", "setLocalRotationList", sceneGraph_setLocalRotationList);
+	scriptEnvironment.addModuleFunction("SceneGraph", "setLocalPoseList", sceneGraph_setLocalPoseList);
+	scriptEnvironment.addModuleFunction("SceneGraph", "getLocalPositionList", sceneGraph_getLocalPositionList);
+	scriptEnvironment.addModuleFunction("SceneGraph", "getLocalRotationList", sceneGraph_getLocalRotationList);
+	scriptEnvironment.addModuleFunction("SceneGraph", "getLocalPoseList", sceneGraph_getLocalPoseList);
 	scriptEnvironment.addModuleFunction("SceneGraph", "link", sceneGraph_link);
 	scriptEnvironment.addModuleFunction("SceneGraph", "unlink", sceneGraph_unlink);
 
@@ -3362,6 +3727,8 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("RenderWorld", "meshGetMeshObb", renderWorld_meshGetObb);
 	scriptEnvironment.addModuleFunction("RenderWorld", "meshGetMeshRaycast", renderWorld_meshGetRaycast);
 	scriptEnvironment.addModuleFunction("RenderWorld", "meshSetMeshVisible", renderWorld_meshSetVisible);
+	scriptEnvironment.addModuleFunction("RenderWorld", "meshSetMeshVisibleList", renderWorld_meshSetVisibleList);
+	scriptEnvironment.addModuleFunction("RenderWorld", "meshSetMeshMaterialList", renderWorld_meshSetMaterialList);
 
 	scriptEnvironment.addModuleFunction("RenderWorld", "spriteCreate", renderWorld_spriteCreate);
 	scriptEnvironment.addModuleFunction("RenderWorld", "spriteDestroy", renderWorld_spriteDestroy);
@@ -3448,6 +3815,7 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("Device", "quit", device_quit);
 	scriptEnvironment.addModuleFunction("Device", "getResolution", device_getResolution);
 	scriptEnvironment.addModuleFunction("Device", "createWorld", device_createWorld);
+	scriptEnvironment.addModuleFunction("Device", "getBenchmarkWorld", device_getBenchmarkWorld);
 	scriptEnvironment.addModuleFunction("Device", "destroyWorld", device_destroyWorld);
 	scriptEnvironment.addModuleFunction("Device", "render", device_render);
 	scriptEnvironment.addModuleFunction("Device", "createResourcePackage", device_createResourcePackage);
@@ -3458,6 +3826,7 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("Device", "getTemporaryObjectsCount", device_getTemporaryObjectsCount);
 	scriptEnvironment.addModuleFunction("Device", "setTemporaryObjectsCount", device_setTemporaryObjectsCount);
 	scriptEnvironment.addModuleFunction("Device", "getGuid", device_getGuid);
+	scriptEnvironment.addModuleFunction("Device", "getMemoryStats", device_getMemoryStats);
 
 	scriptEnvironment.addModuleFunction("Profiler", "enterProfileScope", profiler_enterProfileScope);
 	scriptEnvironment.addModuleFunction("Profiler", "leaveProfileScope", profiler_leaveProfileScope);
@@ -3475,10 +3844,22 @@ void loadApi(ScriptEnvironment& scriptEnvironment)
 	scriptEnvironment.addModuleFunction("DebugLine", "__getIndex", "DebugLine");
 	scriptEnvironment.addModuleFunction("DebugLine", "__getString", debugLine_toString);
 
+	scriptEnvironment.addModuleFunction("Script", "spawn", script_spawn);
+	scriptEnvironment.addModuleFunction("Script", "waitForFrame", script_waitForFrame);
+	scriptEnvironment.addModuleFunction("Script", "wait", script_wait);
+	scriptEnvironment.addModuleFunction("Script", "waitForPackage", script_waitForPackage);
+	scriptEnvironment.addModuleFunction("Script", "waitForLevel", script_waitForLevel);
+	scriptEnvironment.addModuleFunction("Script", "getCoroutineCount", script_getCoroutineCount);
+
+	scriptEnvironment.addModuleFunction("Level", "getIsLoaded", level_getIsLoaded);
+	scriptEnvironment.addModuleFunction("Level", "getLoadProgress", level_getLoadProgress);
+	scriptEnvironment.addModuleFunction("Level", "cancelLoad", level_cancelLoad);
+
 	scriptEnvironment.addModuleFunction("ResourcePackage", "load", resourcePackage_load);
 	scriptEnvironment.addModuleFunction("ResourcePackage", "unload", resourcePackage_unload);
 	scriptEnvironment.addModuleFunction("ResourcePackage", "flush", resourcePackage_flush);
 	scriptEnvironment.addModuleFunction("ResourcePackage", "hasLoaded", resourcePackage_hasLoaded);
+	scriptEnvironment.addModuleFunction("ResourcePackage", "getPendingCount", resourcePackage_getPendingCount);
 	scriptEnvironment.addModuleFunction("ResourcePackage", "__getIndex", "ResourcePackage");
 	scriptEnvironment.addModuleFunction("ResourcePackage", "__getString", resourcePackage_getString);
 
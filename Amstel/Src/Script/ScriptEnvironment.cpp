@@ -1,13 +1,19 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "Config.h"
 
+#include "Core/Base/Os.h"
+#include "Core/Containers/Array.h"
 #include "Core/Error/Error.h"
+#include "Core/Memory/Memory.h"
 #include "Device/Device.h"
 #include "Device/Log.h"
+#include "Device/Profiler.h"
 #include "Resource/ScriptResource.h"
 #include "Resource/ResourceManager.h"
+#include "Resource/ResourcePackage.h"
 #include "Script/ScriptEnvironment.h"
 #include "Script/ScriptStack.h"
+#include "World/Level.h"
 
 #include <stdarg.h>
 
@@ -15,6 +21,7 @@ namespace Rio
 {
 
 extern void loadApi(ScriptEnvironment& ScriptEnvironment);
+extern void loadFfiApi(ScriptEnvironment& scriptEnvironment);
 
 // When an error occurs, logs the error message and pauses the engine
 static int scriptErrorHandlerFunction(lua_State* scriptState)
@@ -54,14 +61,36 @@ static int require(lua_State* scriptState)
 	return 1;
 }
 
+#if RIO_SCRIPT_ALLOCATOR
+// Logs the error of an unprotected call, Lua aborts right after
+static int scriptPanicFunction(lua_State* scriptState)
+{
+	RIO_LOGE("Lua panic: %s", lua_tostring(scriptState, -1));
+	return 0;
+}
+#endif // RIO_SCRIPT_ALLOCATOR
+
 ScriptEnvironment::ScriptEnvironment()
+	: profiler(getDefaultAllocator())
+	, coroutineList(getDefaultAllocator())
+#if RIO_SCRIPT_ALLOCATOR
+	, allocator(getDefaultAllocator(), "lua")
+	, scriptAllocator(allocator)
+#endif // RIO_SCRIPT_ALLOCATOR
 {
+#if RIO_SCRIPT_ALLOCATOR
+	scriptState = lua_newstate(ScriptAllocator::luaAllocate, &scriptAllocator);
+	RIO_ASSERT(scriptState, "Unable to create lua state");
+	lua_atpanic(scriptState, scriptPanicFunction);
+#else
 	scriptState = luaL_newstate();
 	RIO_ASSERT(scriptState, "Unable to create lua state");
+#endif // RIO_SCRIPT_ALLOCATOR
 }
 
 ScriptEnvironment::~ScriptEnvironment()
 {
+	profiler.stop();
 	lua_close(scriptState);
 }
 
@@ -74,6 +103,7 @@ void ScriptEnvironment::loadScriptLibraries()
 
 	// Register Rio libraries
 	loadApi(*this);
+	loadFfiApi(*this);
 
 	// Register custom loader
 	lua_getfield(scriptState, LUA_GLOBALSINDEX, "package");
@@ -101,7 +131,8 @@ void ScriptEnvironment::loadScriptLibraries()
 	// Ensure stack is clean
 	RIO_ASSERT(lua_gettop(scriptState) == 0, "Stack not clean");
 
-	lua_gc(scriptState, LUA_GCRESTART, 0);
+	// The collector stays stopped, see collectGarbage()
+	heapSizeAfterCollection = getHeapSize();
 }
 
 void ScriptEnvironment::execute(const ScriptResource* scriptResource)
@@ -228,6 +259,245 @@ bool ScriptEnvironment::getIsMatrix4x4(const Matrix4x4* matrix4x4) const
 		&& matrix4x4 <= &matrix4Buffer[RIO_MAX_LUA_MATRIX4X4 - 1];
 }
 
+void ScriptEnvironment::collectGarbage(float budget)
+{
+	const int64_t start = OsFn::getClockTime();
+	const double frequency = double(OsFn::getClockFrequency());
+	const int64_t end = start + int64_t(budget * 0.001 * frequency);
+
+	for (;;)
+	{
+		// Each call runs a single step of the collector
+		if (lua_gc(scriptState, LUA_GCSTEP, 0) != 0)
+		{
+			heapSizeAfterCollection = getHeapSize();
+			break;
+		}
+
+		// Past twice the heap left by the last cycle, finish the cycle over budget to keep the heap bounded
+		if (OsFn::getClockTime() >= end && getHeapSize() < 2 * heapSizeAfterCollection)
+		{
+			break;
+		}
+	}
+
+	// Stepping lets the collector run on its own again
+	lua_gc(scriptState, LUA_GCSTOP, 0);
+
+	RECORD_FLOAT("lua.gc", float((OsFn::getClockTime() - start) / frequency));
+	RECORD_FLOAT("lua.heap", float(getHeapSize()));
+}
+
+uint32_t ScriptEnvironment::getHeapSize()
+{
+	return uint32_t(lua_gc(scriptState, LUA_GCCOUNT, 0)) * 1024 + uint32_t(lua_gc(scriptState, LUA_GCCOUNTB, 0));
+}
+
+void ScriptEnvironment::spawnCoroutine(lua_State* scriptState, int argumentsCount)
+{
+	ScriptCoroutine scriptCoroutine;
+	scriptCoroutine.thread = lua_newthread(scriptState);
+	scriptCoroutine.reference = luaL_ref(scriptState, LUA_REGISTRYINDEX);
+	scriptCoroutine.waitType = ScriptWaitType::FRAME;
+	scriptCoroutine.time = 0.0f;
+	scriptCoroutine.resourcePackage = nullptr;
+	scriptCoroutine.level = nullptr;
+	scriptCoroutine.isWaitFailed = false;
+
+	// Function and arguments
+	lua_xmove(scriptState, scriptCoroutine.thread, argumentsCount + 1);
+
+	ArrayFn::pushBack(coroutineList, scriptCoroutine);
+	resumeCoroutine(ArrayFn::getCount(coroutineList) - 1);
+}
+
+int ScriptEnvironment::waitForFrame(lua_State* scriptState)
+{
+	getRunningCoroutine(scriptState).waitType = ScriptWaitType::FRAME;
+	return lua_yield(scriptState, 0);
+}
+
+int ScriptEnvironment::waitForTime(lua_State* scriptState, float time)
+{
+	ScriptCoroutine& scriptCoroutine = getRunningCoroutine(scriptState);
+	scriptCoroutine.waitType = ScriptWaitType::TIME;
+	scriptCoroutine.time = time;
+	return lua_yield(scriptState, 0);
+}
+
+int ScriptEnvironment::waitForPackage(lua_State* scriptState, const ResourcePackage* resourcePackage)
+{
+	// Already loaded, no need to wait for the next frame
+	if (resourcePackage->getPendingCount() == 0)
+	{
+		lua_pushboolean(scriptState, 1);
+		return 1;
+	}
+
+	ScriptCoroutine& scriptCoroutine = getRunningCoroutine(scriptState);
+	scriptCoroutine.waitType = ScriptWaitType::PACKAGE;
+	scriptCoroutine.resourcePackage = resourcePackage;
+	return lua_yield(scriptState, 0);
+}
+
+int ScriptEnvironment::waitForLevel(lua_State* scriptState, const Level* level)
+{
+	if (!level->getIsLoading())
+	{
+		lua_pushboolean(scriptState, 1);
+		return 1;
+	}
+
+	ScriptCoroutine& scriptCoroutine = getRunningCoroutine(scriptState);
+	scriptCoroutine.waitType = ScriptWaitType::LEVEL;
+	scriptCoroutine.level = level;
+	return lua_yield(scriptState, 0);
+}
+
+void ScriptEnvironment::failWaitForPackage(const ResourcePackage* resourcePackage)
+{
+	for (uint32_t i = 0; i < ArrayFn::getCount(coroutineList); ++i)
+	{
+		ScriptCoroutine& scriptCoroutine = coroutineList[i];
+		if (scriptCoroutine.thread != nullptr && scriptCoroutine.waitType == ScriptWaitType::PACKAGE && scriptCoroutine.resourcePackage == resourcePackage)
+		{
+			scriptCoroutine.waitType = ScriptWaitType::FRAME;
+			scriptCoroutine.resourcePackage = nullptr;
+			scriptCoroutine.isWaitFailed = true;
+		}
+	}
+}
+
+void ScriptEnvironment::failWaitForLevel(const Level* level)
+{
+	for (uint32_t i = 0; i < ArrayFn::getCount(coroutineList); ++i)
+	{
+		ScriptCoroutine& scriptCoroutine = coroutineList[i];
+		if (scriptCoroutine.thread != nullptr && scriptCoroutine.waitType == ScriptWaitType::LEVEL && scriptCoroutine.level == level)
+		{
+			scriptCoroutine.waitType = ScriptWaitType::FRAME;
+			scriptCoroutine.level = nullptr;
+			scriptCoroutine.isWaitFailed = true;
+		}
+	}
+}
+
+void ScriptEnvironment::updateCoroutines(float dt)
+{
+	// Coroutines spawned while resuming the others are resumed from the next update
+	const uint32_t count = ArrayFn::getCount(coroutineList);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		ScriptCoroutine& scriptCoroutine = coroutineList[i];
+		if (scriptCoroutine.thread == nullptr)
+		{
+			continue;
+		}
+
+		bool isReady = true;
+		switch (scriptCoroutine.waitType)
+		{
+			case ScriptWaitType::TIME:
+			{
+				scriptCoroutine.time -= dt;
+				isReady = scriptCoroutine.time <= 0.0f;
+			}
+			break;
+			case ScriptWaitType::PACKAGE:
+			{
+				isReady = scriptCoroutine.resourcePackage->getPendingCount() == 0;
+			}
+			break;
+			case ScriptWaitType::LEVEL:
+			{
+				isReady = !scriptCoroutine.level->getIsLoading();
+			}
+			break;
+			default:
+			break;
+		}
+
+		if (isReady)
+		{
+			resumeCoroutine(i);
+		}
+	}
+
+	// Remove finished coroutines, keeping the others in spawn order
+	uint32_t last = 0;
+	for (uint32_t i = 0; i < ArrayFn::getCount(coroutineList); ++i)
+	{
+		if (coroutineList[i].thread != nullptr)
+		{
+			coroutineList[last++] = coroutineList[i];
+		}
+	}
+	ArrayFn::resize(coroutineList, last);
+
+	RECORD_FLOAT("lua.coroutines", float(last));
+}
+
+uint32_t ScriptEnvironment::getCoroutineCount() const
+{
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < ArrayFn::getCount(coroutineList); ++i)
+	{
+		count += coroutineList[i].thread != nullptr ? 1 : 0;
+	}
+	return count;
+}
+
+void ScriptEnvironment::resumeCoroutine(uint32_t index)
+{
+	lua_State* thread = coroutineList[index].thread;
+	const bool isWaitFailed = coroutineList[index].isWaitFailed;
+	coroutineList[index].waitType = ScriptWaitType::FRAME;
+	coroutineList[index].resourcePackage = nullptr;
+	coroutineList[index].level = nullptr;
+	coroutineList[index].isWaitFailed = false;
+
+	// The first resume passes the arguments of the function, the next ones return from the wait
+	int argumentsCount = lua_gettop(thread) - 1;
+	if (lua_status(thread) == LUA_YIELD)
+	{
+		lua_pushboolean(thread, isWaitFailed ? 0 : 1);
+		argumentsCount = 1;
+	}
+
+	// Coroutines can spawn other coroutines
+	const uint32_t previousCoroutine = runningCoroutine;
+	runningCoroutine = index;
+	const int status = lua_resume(thread, argumentsCount);
+	runningCoroutine = previousCoroutine;
+
+	if (status == LUA_YIELD)
+	{
+		return;
+	}
+
+	if (status != 0)
+	{
+		luaL_traceback(scriptState, thread, lua_tostring(thread, -1), 0);
+		RIO_LOGE(lua_tostring(scriptState, -1));
+		lua_pop(scriptState, 1);
+		getDevice()->pause();
+	}
+
+	// Finished, removed by updateCoroutines()
+	luaL_unref(scriptState, LUA_REGISTRYINDEX, coroutineList[index].reference);
+	coroutineList[index].thread = nullptr;
+}
+
+ScriptCoroutine& ScriptEnvironment::getRunningCoroutine(lua_State* scriptState)
+{
+	if (runningCoroutine == UINT32_MAX || coroutineList[runningCoroutine].thread != scriptState)
+	{
+		luaL_error(scriptState, "Can only wait in a coroutine started with Script.spawn()");
+	}
+
+	return coroutineList[runningCoroutine];
+}
+
 void ScriptEnvironment::getTemporaryObjectsCount(uint32_t& vector3ListUsedCount, uint32_t& quaternionListUsedCount, uint32_t& matrix4ListUsedCount)
 {
 	vector3ListUsedCount = this->vector3ListUsedCount;
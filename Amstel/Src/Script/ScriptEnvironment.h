@@ -3,8 +3,16 @@
 
 #include "Config.h"
 #include "Core/Base/Types.h"
+#include "Core/Containers/ContainerTypes.h"
 #include "Core/Math/MathTypes.h"
 #include "Resource/ResourceTypes.h"
+#include "Script/ScriptProfiler.h"
+#include "World/WorldTypes.h"
+
+#if RIO_SCRIPT_ALLOCATOR
+	#include "Core/Memory/ProxyAllocator.h"
+	#include "Script/ScriptAllocator.h"
+#endif // RIO_SCRIPT_ALLOCATOR
 
 #include <lua.hpp>
 
@@ -16,6 +24,31 @@ enum LuaArgumentType
 	ARGUMENT_FLOAT
 };
 
+struct ScriptWaitType
+{
+	enum Enum
+	{
+		FRAME,
+		TIME,
+		PACKAGE,
+		LEVEL,
+
+		COUNT
+	};
+};
+
+// A Lua coroutine and what it waits for before it is resumed
+struct ScriptCoroutine
+{
+	lua_State* thread;
+	int reference; // Keeps <thread> from being collected
+	ScriptWaitType::Enum waitType;
+	float time; // Seconds left to wait
+	const ResourcePackage* resourcePackage;
+	const Level* level;
+	bool isWaitFailed; // What it waited for was destroyed, the wait returns false
+};
+
 // Wraps a subset of Lua functions and provides utilities for extending Lua
 struct ScriptEnvironment
 {
@@ -40,6 +73,33 @@ struct ScriptEnvironment
 	// callGlobalFunction("myFunction", 1, ARGUMENT_FLOAT, 3.14f)
 	// Returns true if success, false otherwise
 	void callGlobalFunction(const char* function, uint8_t argumentListCount, ...);
+	// Runs incremental garbage collection steps for about <budget> milliseconds
+	// The collector does not run on its own, so that it does not stall frames at random points
+	void collectGarbage(float budget);
+	// Returns the bytes allocated by Lua
+	uint32_t getHeapSize();
+	// Runs the function below the <argumentsCount> arguments on top of the stack of <scriptState> in a new coroutine
+	// The coroutine runs until it first waits, the wait functions below yield it to updateCoroutines()
+	void spawnCoroutine(lua_State* scriptState, int argumentsCount);
+	// The wait functions below return true to the coroutine, or false if what it waited for was destroyed first
+	// Suspends the running coroutine <scriptState> until the next frame
+	int waitForFrame(lua_State* scriptState);
+	// Suspends the running coroutine <scriptState> for <time> seconds
+	int waitForTime(lua_State* scriptState, float time);
+	// Suspends the running coroutine <scriptState> until all the resources of <resourcePackage> have been loaded
+	int waitForPackage(lua_State* scriptState, const ResourcePackage* resourcePackage);
+	// Suspends the running coroutine <scriptState> until <level> is not loading anymore
+	int waitForLevel(lua_State* scriptState, const Level* level);
+	// Stops the coroutines waiting for <resourcePackage>, which is about to be destroyed
+	// They are resumed by the next updateCoroutines() and their wait returns false
+	void failWaitForPackage(const ResourcePackage* resourcePackage);
+	// Stops the coroutines waiting for <level>, which is about to be destroyed
+	// They are resumed by the next updateCoroutines() and their wait returns false
+	void failWaitForLevel(const Level* level);
+	// Resumes the coroutines which are done waiting, <dt> seconds after the last call
+	void updateCoroutines(float dt);
+	// Returns the number of coroutines which have not finished yet
+	uint32_t getCoroutineCount() const;
 	// Returns the number of temporary objects in use
 	void getTemporaryObjectsCount(uint32_t& vector3ListUsedCount, uint32_t& quaternionListUsedCount, uint32_t& matrix4ListUsedCount);
 	// Sets the number of temporary objects in use
@@ -66,10 +126,24 @@ struct ScriptEnvironment
 	Quaternion quaternionBuffer[RIO_MAX_LUA_QUATERNION];
 	uint32_t matrix4ListUsedCount = 0;
 	Matrix4x4 matrix4Buffer[RIO_MAX_LUA_MATRIX4X4];
+	uint32_t heapSizeAfterCollection = 0; // Heap size at the end of the last garbage collection cycle
+	ScriptProfiler profiler;
 private:
 	// Disable copying
 	ScriptEnvironment(const ScriptEnvironment&) = delete;
 	ScriptEnvironment& operator=(const ScriptEnvironment&) = delete;
+
+	void resumeCoroutine(uint32_t index);
+	// Returns the waiting state of the running coroutine <scriptState>
+	ScriptCoroutine& getRunningCoroutine(lua_State* scriptState);
+
+	Array<ScriptCoroutine> coroutineList;
+	uint32_t runningCoroutine = UINT32_MAX; // Index of the coroutine being resumed
+
+#if RIO_SCRIPT_ALLOCATOR
+	ProxyAllocator allocator;
+	ScriptAllocator scriptAllocator;
+#endif // RIO_SCRIPT_ALLOCATOR
 };
 
 } // namespace Rio
@@ -0,0 +1,562 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Core/Error/Error.h"
+#include "Core/Math/MathTypes.h"
+#include "Core/Strings/StringId.h"
+#include "Device/Log.h"
+#include "Script/ScriptEnvironment.h"
+#include "Script/ScriptStack.h"
+#include "World/PhysicsWorld.h"
+#include "World/RenderWorld.h"
+#include "World/SceneGraph.h"
+#include "World/World.h"
+
+#include <string.h> // strlen
+
+namespace Rio
+{
+
+// Plain C entry points called by the LuaJIT FFI
+// Engine objects are passed as the lightuserdata pointers of the Lua API, results are written through out-pointers
+// The layout must match the RioFfiApi declaration in <ffiScript>
+struct FfiApi
+{
+	uint32_t (*sceneGraphGetTransformInstance)(SceneGraph* sceneGraph, void* unit);
+	void (*sceneGraphGetLocalPosition)(SceneGraph* sceneGraph, uint32_t i, Vector3* position);
+	void (*sceneGraphGetLocalRotation)(SceneGraph* sceneGraph, uint32_t i, Quaternion* rotation);
+	void (*sceneGraphGetLocalScale)(SceneGraph* sceneGraph, uint32_t i, Vector3* scale);
+	void (*sceneGraphGetLocalPose)(SceneGraph* sceneGraph, uint32_t i, Matrix4x4* pose);
+	void (*sceneGraphGetWorldPosition)(SceneGraph* sceneGraph, uint32_t i, Vector3* position);
+	void (*sceneGraphGetWorldRotation)(SceneGraph* sceneGraph, uint32_t i, Quaternion* rotation);
+	void (*sceneGraphGetWorldPose)(SceneGraph* sceneGraph, uint32_t i, Matrix4x4* pose);
+	void (*sceneGraphSetLocalPosition)(SceneGraph* sceneGraph, uint32_t i, const Vector3* position);
+	void (*sceneGraphSetLocalRotation)(SceneGraph* sceneGraph, uint32_t i, const Quaternion* rotation);
+	void (*sceneGraphSetLocalScale)(SceneGraph* sceneGraph, uint32_t i, const Vector3* scale);
+	void (*sceneGraphSetLocalPose)(SceneGraph* sceneGraph, uint32_t i, const Matrix4x4* pose);
+	void (*sceneGraphSetLocalPositionList)(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, const Vector3* positionList);
+	void (*sceneGraphSetLocalRotationList)(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, const Quaternion* rotationList);
+	void (*sceneGraphSetLocalPoseList)(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, const Matrix4x4* poseList);
+	void (*sceneGraphGetLocalPositionList)(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, Vector3* positionList);
+	void (*sceneGraphGetLocalRotationList)(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, Quaternion* rotationList);
+	void (*sceneGraphGetLocalPoseList)(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, Matrix4x4* poseList);
+
+	void (*renderWorldMeshSetVisibleList)(RenderWorld* renderWorld, uint32_t count, const MeshInstance* meshInstanceList, const bool* visibleList);
+	void (*renderWorldMeshSetMaterialList)(RenderWorld* renderWorld, uint32_t count, const MeshInstance* meshInstanceList, const char* material);
+
+	uint32_t (*worldGetUnitListCount)(World* world);
+	void (*worldDestroyUnit)(World* world, void* unit);
+
+	uint32_t (*physicsWorldActorGet)(PhysicsWorld* physicsWorld, void* unit);
+	void (*physicsWorldActorGetWorldPosition)(PhysicsWorld* physicsWorld, uint32_t i, Vector3* position);
+	void (*physicsWorldActorGetWorldRotation)(PhysicsWorld* physicsWorld, uint32_t i, Quaternion* rotation);
+	void (*physicsWorldActorTeleportWorldPosition)(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* position);
+	void (*physicsWorldActorMove)(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* position);
+	void (*physicsWorldActorGetLinearVelocity)(PhysicsWorld* physicsWorld, uint32_t i, Vector3* velocity);
+	void (*physicsWorldActorSetLinearVelocity)(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* velocity);
+	void (*physicsWorldActorGetAngularVelocity)(PhysicsWorld* physicsWorld, uint32_t i, Vector3* velocity);
+	void (*physicsWorldActorSetAngularVelocity)(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* velocity);
+	void (*physicsWorldActorAddImpulse)(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* impulse);
+};
+
+namespace ScriptFfiInternalFn
+{
+	// Decodes the lightuserdata of ScriptStack::pushUnit()
+	// The Lua side checks the marker with checkUnit() before calling, errors can not be raised from here
+	inline UnitId getUnit(void* unit)
+	{
+		RIO_ASSERT((uint32_t(uintptr_t(unit)) & LIGHTDATA_TYPE_MASK) == UNIT_MARKER, "Not a unit: %p", unit);
+		UnitId id;
+		id.index = uint32_t(uintptr_t(unit)) >> LIGHTDATA_TYPE_BITS;
+		return id;
+	}
+
+	inline TransformInstance getTransform(uint32_t i)
+	{
+		TransformInstance transformInstance = { i };
+		return transformInstance;
+	}
+
+	inline ActorInstance getActor(uint32_t i)
+	{
+		ActorInstance actorInstance = { i };
+		return actorInstance;
+	}
+
+	static uint32_t sceneGraphGetTransformInstance(SceneGraph* sceneGraph, void* unit)
+	{
+		return sceneGraph->get(getUnit(unit)).i;
+	}
+
+	static void sceneGraphGetLocalPosition(SceneGraph* sceneGraph, uint32_t i, Vector3* position)
+	{
+		*position = sceneGraph->getLocalPosition(getTransform(i));
+	}
+
+	static void sceneGraphGetLocalRotation(SceneGraph* sceneGraph, uint32_t i, Quaternion* rotation)
+	{
+		*rotation = sceneGraph->getLocalRotation(getTransform(i));
+	}
+
+	static void sceneGraphGetLocalScale(SceneGraph* sceneGraph, uint32_t i, Vector3* scale)
+	{
+		*scale = sceneGraph->getLocalScale(getTransform(i));
+	}
+
+	static void sceneGraphGetLocalPose(SceneGraph* sceneGraph, uint32_t i, Matrix4x4* pose)
+	{
+		*pose = sceneGraph->getLocalPose(getTransform(i));
+	}
+
+	static void sceneGraphGetWorldPosition(SceneGraph* sceneGraph, uint32_t i, Vector3* position)
+	{
+		*position = sceneGraph->getWorldPosition(getTransform(i));
+	}
+
+	static void sceneGraphGetWorldRotation(SceneGraph* sceneGraph, uint32_t i, Quaternion* rotation)
+	{
+		*rotation = sceneGraph->getWorldRotation(getTransform(i));
+	}
+
+	static void sceneGraphGetWorldPose(SceneGraph* sceneGraph, uint32_t i, Matrix4x4* pose)
+	{
+		*pose = sceneGraph->getWorldPose(getTransform(i));
+	}
+
+	static void sceneGraphSetLocalPosition(SceneGraph* sceneGraph, uint32_t i, const Vector3* position)
+	{
+		sceneGraph->setLocalPosition(getTransform(i), *position);
+	}
+
+	static void sceneGraphSetLocalRotation(SceneGraph* sceneGraph, uint32_t i, const Quaternion* rotation)
+	{
+		sceneGraph->setLocalRotation(getTransform(i), *rotation);
+	}
+
+	static void sceneGraphSetLocalScale(SceneGraph* sceneGraph, uint32_t i, const Vector3* scale)
+	{
+		sceneGraph->setLocalScale(getTransform(i), *scale);
+	}
+
+	static void sceneGraphSetLocalPose(SceneGraph* sceneGraph, uint32_t i, const Matrix4x4* pose)
+	{
+		sceneGraph->setLocalPose(getTransform(i), *pose);
+	}
+
+	static void sceneGraphSetLocalPositionList(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, const Vector3* positionList)
+	{
+		sceneGraph->setLocalPosition(count, transformInstanceList, positionList);
+	}
+
+	static void sceneGraphSetLocalRotationList(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, const Quaternion* rotationList)
+	{
+		sceneGraph->setLocalRotation(count, transformInstanceList, rotationList);
+	}
+
+	static void sceneGraphSetLocalPoseList(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, const Matrix4x4* poseList)
+	{
+		sceneGraph->setLocalPose(count, transformInstanceList, poseList);
+	}
+
+	static void sceneGraphGetLocalPositionList(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, Vector3* positionList)
+	{
+		sceneGraph->getLocalPosition(count, transformInstanceList, positionList);
+	}
+
+	static void sceneGraphGetLocalRotationList(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, Quaternion* rotationList)
+	{
+		sceneGraph->getLocalRotation(count, transformInstanceList, rotationList);
+	}
+
+	static void sceneGraphGetLocalPoseList(SceneGraph* sceneGraph, uint32_t count, const TransformInstance* transformInstanceList, Matrix4x4* poseList)
+	{
+		sceneGraph->getLocalPose(count, transformInstanceList, poseList);
+	}
+
+	static void renderWorldMeshSetVisibleList(RenderWorld* renderWorld, uint32_t count, const MeshInstance* meshInstanceList, const bool* visibleList)
+	{
+		renderWorld->meshSetVisible(count, meshInstanceList, visibleList);
+	}
+
+	static void renderWorldMeshSetMaterialList(RenderWorld* renderWorld, uint32_t count, const MeshInstance* meshInstanceList, const char* material)
+	{
+		renderWorld->meshSetMaterial(count, meshInstanceList, StringId64(material));
+	}
+
+	static uint32_t worldGetUnitListCount(World* world)
+	{
+		return world->getUnitListCount();
+	}
+
+	static void worldDestroyUnit(World* world, void* unit)
+	{
+		world->destroyUnit(getUnit(unit));
+	}
+
+	static uint32_t physicsWorldActorGet(PhysicsWorld* physicsWorld, void* unit)
+	{
+		return physicsWorld->actorGet(getUnit(unit)).i;
+	}
+
+	static void physicsWorldActorGetWorldPosition(PhysicsWorld* physicsWorld, uint32_t i, Vector3* position)
+	{
+		*position = physicsWorld->actorGetWorldPosition(getActor(i));
+	}
+
+	static void physicsWorldActorGetWorldRotation(PhysicsWorld* physicsWorld, uint32_t i, Quaternion* rotation)
+	{
+		*rotation = physicsWorld->actorGetWorldRotation(getActor(i));
+	}
+
+	static void physicsWorldActorTeleportWorldPosition(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* position)
+	{
+		physicsWorld->actorTeleportWorldPosition(getActor(i), *position);
+	}
+
+	static void physicsWorldActorMove(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* position)
+	{
+		physicsWorld->actorMove(getActor(i), *position);
+	}
+
+	static void physicsWorldActorGetLinearVelocity(PhysicsWorld* physicsWorld, uint32_t i, Vector3* velocity)
+	{
+		*velocity = physicsWorld->actorGetLinearVelocity(getActor(i));
+	}
+
+	static void physicsWorldActorSetLinearVelocity(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* velocity)
+	{
+		physicsWorld->actorSetLinearVelocity(getActor(i), *velocity);
+	}
+
+	static void physicsWorldActorGetAngularVelocity(PhysicsWorld* physicsWorld, uint32_t i, Vector3* velocity)
+	{
+		*velocity = physicsWorld->actorGetAngularVelocity(getActor(i));
+	}
+
+	static void physicsWorldActorSetAngularVelocity(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* velocity)
+	{
+		physicsWorld->actorSetAngularVelocity(getActor(i), *velocity);
+	}
+
+	static void physicsWorldActorAddImpulse(PhysicsWorld* physicsWorld, uint32_t i, const Vector3* impulse)
+	{
+		physicsWorld->actorAddImpulse(getActor(i), *impulse);
+	}
+
+	static const FfiApi ffiApi =
+	{
+		sceneGraphGetTransformInstance,
+		sceneGraphGetLocalPosition,
+		sceneGraphGetLocalRotation,
+		sceneGraphGetLocalScale,
+		sceneGraphGetLocalPose,
+		sceneGraphGetWorldPosition,
+		sceneGraphGetWorldRotation,
+		sceneGraphGetWorldPose,
+		sceneGraphSetLocalPosition,
+		sceneGraphSetLocalRotation,
+		sceneGraphSetLocalScale,
+		sceneGraphSetLocalPose,
+		sceneGraphSetLocalPositionList,
+		sceneGraphSetLocalRotationList,
+		sceneGraphSetLocalPoseList,
+		sceneGraphGetLocalPositionList,
+		sceneGraphGetLocalRotationList,
+		sceneGraphGetLocalPoseList,
+
+		renderWorldMeshSetVisibleList,
+		renderWorldMeshSetMaterialList,
+
+		worldGetUnitListCount,
+		worldDestroyUnit,
+
+		physicsWorldActorGet,
+		physicsWorldActorGetWorldPosition,
+		physicsWorldActorGetWorldRotation,
+		physicsWorldActorTeleportWorldPosition,
+		physicsWorldActorMove,
+		physicsWorldActorGetLinearVelocity,
+		physicsWorldActorSetLinearVelocity,
+		physicsWorldActorGetAngularVelocity,
+		physicsWorldActorSetAngularVelocity,
+		physicsWorldActorAddImpulse,
+	};
+
+	// Defines the global Ffi module, called with the address of <ffiApi> and whether to check the units passed in
+	// Math values are cdata structs with the layout of the engine types, the JIT compiler keeps their arithmetic
+	// in registers instead of going through the temporary pools of the lua_CFunction API,
+	// engine calls go straight to the function pointers of <ffiApi>
+	// Ffi functions mirror the names and arguments of the lua_CFunction ones, which remain available
+	static const char* ffiScript = R"lua(
+local ffi = require("ffi")
+local api, isCheckingUnits = ...
+
+ffi.cdef[[
+typedef struct { float x, y, z; } Vector3;
+typedef struct { float x, y, z, w; } Vector4;
+typedef struct { float x, y, z, w; } Quaternion;
+typedef struct { Vector4 x, y, z, t; } Matrix4x4;
+
+typedef struct
+{
+	uint32_t (*sceneGraphGetTransformInstance)(void* sceneGraph, void* unit);
+	void (*sceneGraphGetLocalPosition)(void* sceneGraph, uint32_t i, Vector3* position);
+	void (*sceneGraphGetLocalRotation)(void* sceneGraph, uint32_t i, Quaternion* rotation);
+	void (*sceneGraphGetLocalScale)(void* sceneGraph, uint32_t i, Vector3* scale);
+	void (*sceneGraphGetLocalPose)(void* sceneGraph, uint32_t i, Matrix4x4* pose);
+	void (*sceneGraphGetWorldPosition)(void* sceneGraph, uint32_t i, Vector3* position);
+	void (*sceneGraphGetWorldRotation)(void* sceneGraph, uint32_t i, Quaternion* rotation);
+	void (*sceneGraphGetWorldPose)(void* sceneGraph, uint32_t i, Matrix4x4* pose);
+	void (*sceneGraphSetLocalPosition)(void* sceneGraph, uint32_t i, const Vector3* position);
+	void (*sceneGraphSetLocalRotation)(void* sceneGraph, uint32_t i, const Quaternion* rotation);
+	void (*sceneGraphSetLocalScale)(void* sceneGraph, uint32_t i, const Vector3* scale);
+	void (*sceneGraphSetLocalPose)(void* sceneGraph, uint32_t i, const Matrix4x4* pose);
+	void (*sceneGraphSetLocalPositionList)(void* sceneGraph, uint32_t count, const uint32_t* transformInstanceList, const void* positionList);
+	void (*sceneGraphSetLocalRotationList)(void* sceneGraph, uint32_t count, const uint32_t* transformInstanceList, const void* rotationList);
+	void (*sceneGraphSetLocalPoseList)(void* sceneGraph, uint32_t count, const uint32_t* transformInstanceList, const void* poseList);
+	void (*sceneGraphGetLocalPositionList)(void* sceneGraph, uint32_t count, const uint32_t* transformInstanceList, void* positionList);
+	void (*sceneGraphGetLocalRotationList)(void* sceneGraph, uint32_t count, const uint32_t* transformInstanceList, void* rotationList);
+	void (*sceneGraphGetLocalPoseList)(void* sceneGraph, uint32_t count, const uint32_t* transformInstanceList, void* poseList);
+
+	void (*renderWorldMeshSetVisibleList)(void* renderWorld, uint32_t count, const uint32_t* meshInstanceList, const bool* visibleList);
+	void (*renderWorldMeshSetMaterialList)(void* renderWorld, uint32_t count, const uint32_t* meshInstanceList, const char* material);
+
+	uint32_t (*worldGetUnitListCount)(void* world);
+	void (*worldDestroyUnit)(void* world, void* unit);
+
+	uint32_t (*physicsWorldActorGet)(void* physicsWorld, void* unit);
+	void (*physicsWorldActorGetWorldPosition)(void* physicsWorld, uint32_t i, Vector3* position);
+	void (*physicsWorldActorGetWorldRotation)(void* physicsWorld, uint32_t i, Quaternion* rotation);
+	void (*physicsWorldActorTeleportWorldPosition)(void* physicsWorld, uint32_t i, const Vector3* position);
+	void (*physicsWorldActorMove)(void* physicsWorld, uint32_t i, const Vector3* position);
+	void (*physicsWorldActorGetLinearVelocity)(void* physicsWorld, uint32_t i, Vector3* velocity);
+	void (*physicsWorldActorSetLinearVelocity)(void* physicsWorld, uint32_t i, const Vector3* velocity);
+	void (*physicsWorldActorGetAngularVelocity)(void* physicsWorld, uint32_t i, Vector3* velocity);
+	void (*physicsWorldActorSetAngularVelocity)(void* physicsWorld, uint32_t i, const Vector3* velocity);
+	void (*physicsWorldActorAddImpulse)(void* physicsWorld, uint32_t i, const Vector3* impulse);
+} RioFfiApi;
+]]
+
+api = ffi.cast("const RioFfiApi*", api)
+
+local sqrt = math.sqrt
+local format = string.format
+local INVALID = 0xffffffff
+
+-- Raises the error of ScriptStack::getUnit() if <unit> is not the lightuserdata of a unit, see UNIT_MARKER
+local function checkUnit() end
+if isCheckingUnits then
+	local band = require("bit").band
+	checkUnit = function(unit, functionName)
+		if type(unit) ~= "userdata" or band(tonumber(ffi.cast("uintptr_t", unit)), 0x3) ~= 0x1 then
+			error(format("bad argument #2 to '%s' (UnitId expected, got %s)", functionName, type(unit)), 3)
+		end
+	end
+end
+
+local Vector3_t, Quaternion_t, Matrix4x4_t
+local Vector3Pointer_t = ffi.typeof("const Vector3*")
+local QuaternionPointer_t = ffi.typeof("const Quaternion*")
+local Matrix4x4Pointer_t = ffi.typeof("const Matrix4x4*")
+
+local Vector3Methods = {}
+Vector3Methods.__index = Vector3Methods
+
+function Vector3Methods.__add(a, b) return Vector3_t(a.x + b.x, a.y + b.y, a.z + b.z) end
+function Vector3Methods.__sub(a, b) return Vector3_t(a.x - b.x, a.y - b.y, a.z - b.z) end
+function Vector3Methods.__unm(a) return Vector3_t(-a.x, -a.y, -a.z) end
+function Vector3Methods.__div(a, k) return Vector3_t(a.x / k, a.y / k, a.z / k) end
+function Vector3Methods.__mul(a, b)
+	if type(a) == "number" then return Vector3_t(a * b.x, a * b.y, a * b.z) end
+	return Vector3_t(a.x * b, a.y * b, a.z * b)
+end
+function Vector3Methods.__tostring(a) return format("Vector3(%.4f, %.4f, %.4f)", a.x, a.y, a.z) end
+
+function Vector3Methods.dot(a, b) return a.x * b.x + a.y * b.y + a.z * b.z end
+function Vector3Methods.cross(a, b) return Vector3_t(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x) end
+function Vector3Methods.getLengthSquared(a) return a.x * a.x + a.y * a.y + a.z * a.z end
+function Vector3Methods.getLength(a) return sqrt(a.x * a.x + a.y * a.y + a.z * a.z) end
+function Vector3Methods.getDistance(a, b) return (b - a):getLength() end
+function Vector3Methods.lerp(a, b, t) return Vector3_t(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t) end
+function Vector3Methods.normalize(a)
+	local length = a:getLength()
+	if length == 0 then return Vector3_t(a) end
+	local inverseLength = 1 / length
+	return Vector3_t(a.x * inverseLength, a.y * inverseLength, a.z * inverseLength)
+end
+
+Vector3_t = ffi.metatype("Vector3", Vector3Methods)
+
+local QuaternionMethods = {}
+QuaternionMethods.__index = QuaternionMethods
+
+-- Same product as the engine, see Quaternion.h
+function QuaternionMethods.__mul(a, b)
+	return Quaternion_t(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y
+		, a.w * b.y + a.y * b.w + a.z * b.x - a.x * b.z
+		, a.w * b.z + a.z * b.w + a.x * b.y - a.y * b.x
+		, a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+		)
+end
+function QuaternionMethods.__unm(a) return Quaternion_t(-a.x, -a.y, -a.z, -a.w) end
+function QuaternionMethods.__tostring(a) return format("Quaternion(%.4f, %.4f, %.4f, %.4f)", a.x, a.y, a.z, a.w) end
+
+function QuaternionMethods.dot(a, b) return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w end
+function QuaternionMethods.getConjugate(a) return Quaternion_t(-a.x, -a.y, -a.z, a.w) end
+function QuaternionMethods.getLength(a) return sqrt(a.x * a.x + a.y * a.y + a.z * a.z + a.w * a.w) end
+function QuaternionMethods.normalize(a)
+	local inverseLength = 1 / a:getLength()
+	return Quaternion_t(a.x * inverseLength, a.y * inverseLength, a.z * inverseLength, a.w * inverseLength)
+end
+
+Quaternion_t = ffi.metatype("Quaternion", QuaternionMethods)
+
+local Matrix4x4Methods = {}
+Matrix4x4Methods.__index = Matrix4x4Methods
+
+local function multiplyRow(r, b)
+	return r.x * b.x.x + r.y * b.y.x + r.z * b.z.x + r.w * b.t.x
+		, r.x * b.x.y + r.y * b.y.y + r.z * b.z.y + r.w * b.t.y
+		, r.x * b.x.z + r.y * b.y.z + r.z * b.z.z + r.w * b.t.z
+		, r.x * b.x.w + r.y * b.y.w + r.z * b.z.w + r.w * b.t.w
+end
+
+-- Same row-vector product as the engine, see Matrix4x4.h
+function Matrix4x4Methods.__mul(a, b)
+	local m = Matrix4x4_t()
+	m.x.x, m.x.y, m.x.z, m.x.w = multiplyRow(a.x, b)
+	m.y.x, m.y.y, m.y.z, m.y.w = multiplyRow(a.y, b)
+	m.z.x, m.z.y, m.z.z, m.z.w = multiplyRow(a.z, b)
+	m.t.x, m.t.y, m.t.z, m.t.w = multiplyRow(a.t, b)
+	return m
+end
+
+function Matrix4x4Methods.getTranslation(m) return Vector3_t(m.t.x, m.t.y, m.t.z) end
+function Matrix4x4Methods.setTranslation(m, v) m.t.x, m.t.y, m.t.z = v.x, v.y, v.z end
+-- Transforms the point <v> by <m>
+function Matrix4x4Methods.transform(m, v)
+	return Vector3_t(v.x * m.x.x + v.y * m.y.x + v.z * m.z.x + m.t.x
+		, v.x * m.x.y + v.y * m.y.y + v.z * m.z.y + m.t.y
+		, v.x * m.x.z + v.y * m.y.z + v.z * m.z.z + m.t.z
+		)
+end
+
+Matrix4x4_t = ffi.metatype("Matrix4x4", Matrix4x4Methods)
+
+local Ffi = {}
+Ffi.Vector3 = Vector3_t
+Ffi.Quaternion = Quaternion_t
+Ffi.Matrix4x4 = Matrix4x4_t
+
+function Ffi.createQuaternion(axis, angle)
+	local s = math.sin(angle * 0.5)
+	return Quaternion_t(axis.x * s, axis.y * s, axis.z * s, math.cos(angle * 0.5))
+end
+
+function Ffi.createMatrix4x4Identity()
+	return Matrix4x4_t({ 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 })
+end
+
+-- Conversions from and to the temporary values of the lua_CFunction API
+local Vector3Api, QuaternionApi, Matrix4x4Api = Vector3, Quaternion, Matrix4x4
+
+function Ffi.fromVector3(vector3) return Vector3_t(ffi.cast(Vector3Pointer_t, vector3)[0]) end
+function Ffi.fromQuaternion(quaternion) return Quaternion_t(ffi.cast(QuaternionPointer_t, quaternion)[0]) end
+function Ffi.fromMatrix4x4(matrix4x4) return Matrix4x4_t(ffi.cast(Matrix4x4Pointer_t, matrix4x4)[0]) end
+function Ffi.toVector3(v) return Vector3Api(v.x, v.y, v.z) end
+function Ffi.toQuaternion(q) return QuaternionApi.createFromElements(q.x, q.y, q.z, q.w) end
+function Ffi.toMatrix4x4(m)
+	return Matrix4x4Api(m.x.x, m.x.y, m.x.z, m.x.w
+		, m.y.x, m.y.y, m.y.z, m.y.w
+		, m.z.x, m.z.y, m.z.z, m.z.w
+		, m.t.x, m.t.y, m.t.z, m.t.w
+		)
+end
+
+-- Getters of math values write to <result>, if given, instead of allocating a new value
+local SceneGraph = {}
+
+function SceneGraph.getTransformInstanceList(sceneGraph, unit)
+	checkUnit(unit, "getTransformInstanceList")
+	local i = api.sceneGraphGetTransformInstance(sceneGraph, unit)
+	if i == INVALID then return nil end
+	return i
+end
+function SceneGraph.getLocalPosition(sceneGraph, i, result) local v = result or Vector3_t() api.sceneGraphGetLocalPosition(sceneGraph, i, v) return v end
+function SceneGraph.getLocalRotation(sceneGraph, i, result) local q = result or Quaternion_t() api.sceneGraphGetLocalRotation(sceneGraph, i, q) return q end
+function SceneGraph.getLocalScale(sceneGraph, i, result) local v = result or Vector3_t() api.sceneGraphGetLocalScale(sceneGraph, i, v) return v end
+function SceneGraph.getLocalPose(sceneGraph, i, result) local m = result or Matrix4x4_t() api.sceneGraphGetLocalPose(sceneGraph, i, m) return m end
+function SceneGraph.getWorldPosition(sceneGraph, i, result) local v = result or Vector3_t() api.sceneGraphGetWorldPosition(sceneGraph, i, v) return v end
+function SceneGraph.getWorldRotation(sceneGraph, i, result) local q = result or Quaternion_t() api.sceneGraphGetWorldRotation(sceneGraph, i, q) return q end
+function SceneGraph.getWorldPose(sceneGraph, i, result) local m = result or Matrix4x4_t() api.sceneGraphGetWorldPose(sceneGraph, i, m) return m end
+function SceneGraph.setLocalPosition(sceneGraph, i, position) api.sceneGraphSetLocalPosition(sceneGraph, i, position) end
+function SceneGraph.setLocalRotation(sceneGraph, i, rotation) api.sceneGraphSetLocalRotation(sceneGraph, i, rotation) end
+function SceneGraph.setLocalScale(sceneGraph, i, scale) api.sceneGraphSetLocalScale(sceneGraph, i, scale) end
+function SceneGraph.setLocalPose(sceneGraph, i, pose) api.sceneGraphSetLocalPose(sceneGraph, i, pose) end
+
+-- Bulk versions take <count> and cdata arrays: uint32_t[?] instances, and float[?] or math struct values
+function SceneGraph.setLocalPositionList(sceneGraph, count, transformInstanceList, positionList) api.sceneGraphSetLocalPositionList(sceneGraph, count, transformInstanceList, positionList) end
+function SceneGraph.setLocalRotationList(sceneGraph, count, transformInstanceList, rotationList) api.sceneGraphSetLocalRotationList(sceneGraph, count, transformInstanceList, rotationList) end
+function SceneGraph.setLocalPoseList(sceneGraph, count, transformInstanceList, poseList) api.sceneGraphSetLocalPoseList(sceneGraph, count, transformInstanceList, poseList) end
+function SceneGraph.getLocalPositionList(sceneGraph, count, transformInstanceList, result) api.sceneGraphGetLocalPositionList(sceneGraph, count, transformInstanceList, result) return result end
+function SceneGraph.getLocalRotationList(sceneGraph, count, transformInstanceList, result) api.sceneGraphGetLocalRotationList(sceneGraph, count, transformInstanceList, result) return result end
+function SceneGraph.getLocalPoseList(sceneGraph, count, transformInstanceList, result) api.sceneGraphGetLocalPoseList(sceneGraph, count, transformInstanceList, result) return result end
+
+local RenderWorld = {}
+
+function RenderWorld.meshSetMeshVisibleList(renderWorld, count, meshInstanceList, visibleList) api.renderWorldMeshSetVisibleList(renderWorld, count, meshInstanceList, visibleList) end
+function RenderWorld.meshSetMeshMaterialList(renderWorld, count, meshInstanceList, material) api.renderWorldMeshSetMaterialList(renderWorld, count, meshInstanceList, material) end
+
+local World = {}
+
+function World.getUnitListCount(world) return api.worldGetUnitListCount(world) end
+function World.destroyUnit(world, unit) checkUnit(unit, "destroyUnit") api.worldDestroyUnit(world, unit) end
+
+local PhysicsWorld = {}
+
+function PhysicsWorld.actorGetInstanceList(physicsWorld, unit)
+	checkUnit(unit, "actorGetInstanceList")
+	local i = api.physicsWorldActorGet(physicsWorld, unit)
+	if i == INVALID then return nil end
+	return i
+end
+function PhysicsWorld.actorGetWorldPosition(physicsWorld, i, result) local v = result or Vector3_t() api.physicsWorldActorGetWorldPosition(physicsWorld, i, v) return v end
+function PhysicsWorld.actorGetWorldRotation(physicsWorld, i, result) local q = result or Quaternion_t() api.physicsWorldActorGetWorldRotation(physicsWorld, i, q) return q end
+function PhysicsWorld.actorTeleportWorldPosition(physicsWorld, i, position) api.physicsWorldActorTeleportWorldPosition(physicsWorld, i, position) end
+function PhysicsWorld.actorMove(physicsWorld, i, position) api.physicsWorldActorMove(physicsWorld, i, position) end
+function PhysicsWorld.actorGetLinearVelocity(physicsWorld, i, result) local v = result or Vector3_t() api.physicsWorldActorGetLinearVelocity(physicsWorld, i, v) return v end
+function PhysicsWorld.actorSetLinearVelocity(physicsWorld, i, velocity) api.physicsWorldActorSetLinearVelocity(physicsWorld, i, velocity) end
+function PhysicsWorld.actorGetAngularVelocity(physicsWorld, i, result) local v = result or Vector3_t() api.physicsWorldActorGetAngularVelocity(physicsWorld, i, v) return v end
+function PhysicsWorld.actorSetAngularVelocity(physicsWorld, i, velocity) api.physicsWorldActorSetAngularVelocity(physicsWorld, i, velocity) end
+function PhysicsWorld.actorAddImpulse(physicsWorld, i, impulse) api.physicsWorldActorAddImpulse(physicsWorld, i, impulse) end
+
+Ffi.SceneGraph = SceneGraph
+Ffi.RenderWorld = RenderWorld
+Ffi.World = World
+Ffi.PhysicsWorld = PhysicsWorld
+
+_G.Ffi = Ffi
+)lua";
+} // namespace ScriptFfiInternalFn
+
+void loadFfiApi(ScriptEnvironment& scriptEnvironment)
+{
+	using namespace ScriptFfiInternalFn;
+
+	lua_State* scriptState = scriptEnvironment.scriptState;
+	if (luaL_loadbuffer(scriptState, ffiScript, strlen(ffiScript), "Ffi") != 0)
+	{
+		RIO_LOGE("Unable to load the FFI API: %s", lua_tostring(scriptState, -1));
+		lua_pop(scriptState, 1);
+		return;
+	}
+
+	lua_pushlightuserdata(scriptState, (void*)&ffiApi);
+	lua_pushboolean(scriptState, !RIO_RELEASE);
+	if (lua_pcall(scriptState, 2, 0, 0) != 0)
+	{
+		RIO_LOGE("Unable to load the FFI API: %s", lua_tostring(scriptState, -1));
+		lua_pop(scriptState, 1);
+	}
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -0,0 +1,128 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "Script/ScriptProfiler.h"
+#include "Core/Containers/Array.h"
+#include "Core/Containers/HashMap.h"
+#include "Core/Error/Error.h"
+#include "Core/Memory/TempAllocator.h"
+#include "Core/Strings/StringStream.h"
+#include "Core/Strings/StringUtils.h"
+
+#include <string.h> // strlen
+
+namespace Rio
+{
+
+ScriptProfiler::ScriptProfiler(Allocator& a)
+	: stackNameBuffer(a)
+	, stackList(a)
+	, stackMap(a)
+{
+}
+
+ScriptProfiler::~ScriptProfiler()
+{
+	RIO_ASSERT(scriptState == nullptr, "Profiler still running");
+}
+
+void ScriptProfiler::start(lua_State* scriptState, uint32_t interval)
+{
+	stop();
+
+	char mode[16];
+	snPrintF(mode, sizeof(mode), "fi%u", interval);
+
+	this->scriptState = scriptState;
+	luaJIT_profile_start(scriptState, mode, ScriptProfiler::sampleCallback, this);
+}
+
+void ScriptProfiler::stop()
+{
+	if (scriptState != nullptr)
+	{
+		luaJIT_profile_stop(scriptState);
+		scriptState = nullptr;
+	}
+}
+
+bool ScriptProfiler::getIsRunning() const
+{
+	return scriptState != nullptr;
+}
+
+void ScriptProfiler::clear()
+{
+	sampleCount = 0;
+	ArrayFn::clear(stackNameBuffer);
+	ArrayFn::clear(stackList);
+	HashMapFn::clear(stackMap);
+}
+
+uint32_t ScriptProfiler::getSampleCount() const
+{
+	return sampleCount;
+}
+
+void ScriptProfiler::writeFolded(StringStream& folded) const
+{
+	for (uint32_t i = 0; i < ArrayFn::getCount(stackList); ++i)
+	{
+		const Stack& stack = stackList[i];
+		ArrayFn::push(folded, ArrayFn::begin(stackNameBuffer) + stack.offset, stack.length);
+		folded << ' ' << stack.sampleCount << '\n';
+	}
+}
+
+void ScriptProfiler::sampleCallback(void* data, lua_State* scriptState, int sampleCount, int vmState)
+{
+	ScriptProfiler* scriptProfiler = (ScriptProfiler*)data;
+
+	// Outermost caller first, names only, no trailing separator
+	size_t length = 0;
+	const char* stack = luaJIT_profile_dumpstack(scriptState, "fZ;", -64, &length);
+
+	const char* vmFrame = vmState == 'C' ? "[C]"
+		: vmState == 'G' ? "[GC]"
+		: vmState == 'J' ? "[JIT]"
+		: nullptr
+		;
+	if (vmFrame == nullptr)
+	{
+		scriptProfiler->addSamples(stack, uint32_t(length), uint32_t(sampleCount));
+		return;
+	}
+
+	TempAllocator1024 ta;
+	Array<char> fullStack(ta);
+	ArrayFn::push(fullStack, stack, uint32_t(length));
+	if (length != 0)
+	{
+		ArrayFn::pushBack(fullStack, ';');
+	}
+	ArrayFn::push(fullStack, vmFrame, uint32_t(strlen(vmFrame)));
+	scriptProfiler->addSamples(ArrayFn::begin(fullStack), ArrayFn::getCount(fullStack), uint32_t(sampleCount));
+}
+
+void ScriptProfiler::addSamples(const char* stack, uint32_t length, uint32_t sampleCount)
+{
+	this->sampleCount += sampleCount;
+
+	const StringId64 id(stack, length);
+	const uint32_t index = HashMapFn::get(stackMap, id, UINT32_MAX);
+	if (index != UINT32_MAX)
+	{
+		stackList[index].sampleCount += sampleCount;
+		return;
+	}
+
+	Stack newStack;
+	newStack.offset = ArrayFn::getCount(stackNameBuffer);
+	newStack.length = length;
+	newStack.sampleCount = sampleCount;
+	ArrayFn::push(stackNameBuffer, stack, length);
+
+	HashMapFn::set(stackMap, id, ArrayFn::getCount(stackList));
+	ArrayFn::pushBack(stackList, newStack);
+}
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
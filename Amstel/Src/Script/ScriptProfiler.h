@@ -0,0 +1,58 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Base/Types.h"
+#include "Core/Containers/ContainerTypes.h"
+#include "Core/Memory/MemoryTypes.h"
+#include "Core/Strings/StringId.h"
+#include "Core/Strings/StringTypes.h"
+
+#include <lua.hpp>
+
+namespace Rio
+{
+
+// Samples the Lua call stacks with the LuaJIT profiler and counts the samples of each distinct stack
+// Samples taken while the VM is in C code, in the garbage collector or in the JIT compiler
+// get a [C], [GC] or [JIT] frame on top of the Lua stack
+class ScriptProfiler
+{
+public:
+	ScriptProfiler(Allocator& a);
+	~ScriptProfiler();
+	// Starts sampling <scriptState> every <interval> milliseconds
+	void start(lua_State* scriptState, uint32_t interval);
+	// Stops sampling, the samples collected so far are kept
+	void stop();
+	bool getIsRunning() const;
+	// Drops the samples collected so far
+	void clear();
+	// Returns the number of samples collected so far
+	uint32_t getSampleCount() const;
+	// Writes the stacks sampled so far in the folded format of the flamegraph tools:
+	// one "caller;callee samples" line per distinct stack
+	void writeFolded(StringStream& folded) const;
+private:
+	// Disable copying
+	ScriptProfiler(const ScriptProfiler&) = delete;
+	ScriptProfiler& operator=(const ScriptProfiler&) = delete;
+
+	struct Stack
+	{
+		uint32_t offset; // Into <stackNameBuffer>
+		uint32_t length;
+		uint32_t sampleCount;
+	};
+
+	static void sampleCallback(void* data, lua_State* scriptState, int sampleCount, int vmState);
+	void addSamples(const char* stack, uint32_t length, uint32_t sampleCount);
+
+	lua_State* scriptState = nullptr;
+	uint32_t sampleCount = 0;
+	Array<char> stackNameBuffer;
+	Array<Stack> stackList;
+	HashMap<StringId64, uint32_t> stackMap; // Index into <stackList> of each stack
+};
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -154,6 +154,47 @@ struct ScriptStack
 		return StringId64(getString(i));
 	}
 
+	// Returns the number of array elements of the table at <i>
+	uint32_t getTableCount(int i)
+	{
+		return (uint32_t)lua_objlen(scriptState, i);
+	}
+
+	// Returns the array element <index>, counting from 1, of the table at <i> as a number
+	float getTableFloat(int i, uint32_t index)
+	{
+		lua_rawgeti(scriptState, i, index);
+		const float value = (float)lua_tonumber(scriptState, -1);
+		lua_pop(scriptState, 1);
+		return value;
+	}
+
+	// Returns the array element <index>, counting from 1, of the table at <i> as an unsigned integer
+	// Returns UINT32_MAX when the element is not a whole number in range
+	uint32_t getTableUint32(int i, uint32_t index)
+	{
+		lua_rawgeti(scriptState, i, index);
+		const lua_Number number = lua_type(scriptState, -1) == LUA_TNUMBER ? lua_tonumber(scriptState, -1) : -1.0;
+		lua_pop(scriptState, 1);
+		return (number >= 0.0 && number < (lua_Number)UINT32_MAX && number == (lua_Number)(uint32_t)number) ? (uint32_t)number : UINT32_MAX;
+	}
+
+	// Returns the array element <index>, counting from 1, of the table at <i> as a bool
+	bool getTableBool(int i, uint32_t index)
+	{
+		lua_rawgeti(scriptState, i, index);
+		const bool value = lua_toboolean(scriptState, -1) == 1;
+		lua_pop(scriptState, 1);
+		return value;
+	}
+
+	// Sets the array element <index>, counting from 1, of the table at <i> to the number <value>
+	void setTableFloat(int i, uint32_t index, float value)
+	{
+		lua_pushnumber(scriptState, value);
+		lua_rawseti(scriptState, i, index);
+	}
+
 	StringId64 getResourceId(int i)
 	{
 		return StringId64(getString(i));
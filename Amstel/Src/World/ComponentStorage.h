@@ -0,0 +1,507 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Config.h"
+#include "Core/Base/Os.h"
+#include "Core/Containers/Array.h"
+#include "Core/Error/Error.h"
+#include "Core/Memory/Memory.h"
+#include "World/UnitManager.h"
+#include "World/WorldTypes.h"
+
+#include <string.h> // memcpy, memset
+
+namespace Rio
+{
+
+// Instances of a component, stored as a structure of arrays: the units owning the instances, then one array for each of the <Fields>
+// Fields are plain data, moved with memcpy, and their arrays are aligned to RIO_COMPONENT_ALIGNMENT
+// The instance of a unit is found at the index of the unit, without hashing
+template <typename... Fields>
+struct ComponentStorage
+{
+	ALLOCATOR_AWARE;
+
+	static const uint32_t FIELD_COUNT = 1 + sizeof...(Fields);
+
+	// The arrays are reserved in virtual memory for <maxInstancesCount> instances, so that they never move when growing
+	// If <maxInstancesCount> is 0 they are allocated from <a> in one buffer, copied when growing
+	// Past <maxInstancesCount> instances, or if memory cannot be committed, they move to <a> for good
+	ComponentStorage(Allocator& a, uint32_t maxInstancesCount = RIO_COMPONENT_MAX_INSTANCES);
+	~ComponentStorage();
+
+	Allocator* allocator;
+	uint32_t size = 0;
+	uint32_t capacity = 0;
+	uint32_t maxInstancesCount;
+	void* buffer = nullptr;
+	void* fieldList[FIELD_COUNT];
+	void** boundFieldList[FIELD_COUNT]; // Pointers updated whenever the arrays move, see ComponentStorageFn::bind()
+	Array<uint32_t> unitInstanceList; // Instance of each unit index, UINT32_MAX if none
+private:
+	// Disable copying
+	ComponentStorage(const ComponentStorage&);
+	ComponentStorage& operator=(const ComponentStorage&);
+};
+
+namespace ComponentStorageInternalFn
+{
+	template <uint32_t N, typename T, typename... Types>
+	struct TypeAt
+	{
+		using Type = typename TypeAt<N - 1, Types...>::Type;
+	};
+
+	template <typename T, typename... Types>
+	struct TypeAt<0, T, Types...>
+	{
+		using Type = T;
+	};
+} // namespace ComponentStorageInternalFn
+
+// Type of the field <N> of ComponentStorage<Fields...>, the field 0 being the units
+template <uint32_t N, typename... Fields>
+struct ComponentField
+{
+	using Type = typename ComponentStorageInternalFn::TypeAt<N, UnitId, Fields...>::Type;
+};
+
+namespace ComponentStorageFn
+{
+	// Keeps <unitList> and each of the <fieldList> pointing to the arrays of <s>
+	template <typename... Fields> void bind(ComponentStorage<Fields...>& s, UnitId** unitList, Fields**... fieldList);
+	// Returns the units owning the instances of <s>
+	template <typename... Fields> UnitId* getUnitList(const ComponentStorage<Fields...>& s);
+	// Returns the array of the field <N> of the instances of <s>
+	template <uint32_t N, typename... Fields> typename ComponentField<N, Fields...>::Type* getField(const ComponentStorage<Fields...>& s);
+	// Makes room for <count> more instances
+	template <typename... Fields> void reserve(ComponentStorage<Fields...>& s, uint32_t count);
+	// Appends an instance for the unit <id> and returns its index, the fields are left to be set
+	// The unit is found at the new instance unless it already had one
+	template <typename... Fields> uint32_t create(ComponentStorage<Fields...>& s, UnitId id);
+	// Appends an instance for each of the <count> units in <unitIdList> and returns the index of the first one
+	template <typename... Fields> uint32_t create(ComponentStorage<Fields...>& s, uint32_t count, const UnitId* unitIdList);
+	// Destroys the instance <i> moving the last instance in its place
+	// Returns the previous index of the instance moved, UINT32_MAX if <i> was the last one
+	template <typename... Fields> uint32_t destroy(ComponentStorage<Fields...>& s, uint32_t i);
+	// Destroys the instances of the units not alive anymore, the instances left keep their order
+	// Fills <indexList>, if any, with the new index of each instance, UINT32_MAX if it is destroyed
+	template <typename... Fields> void destroyDead(ComponentStorage<Fields...>& s, const UnitManager& unitManager, uint32_t* indexList = nullptr);
+	// Returns the instance of the unit <id>, UINT32_MAX if it has none
+	template <typename... Fields> uint32_t getInstance(const ComponentStorage<Fields...>& s, UnitId id);
+	// Returns how many of the <count> units in <unitIdList> have an instance
+	template <typename... Fields> uint32_t getUnitsWithInstanceCount(const ComponentStorage<Fields...>& s, const UnitId* unitIdList, uint32_t count);
+	// Sets the instance <i> of the unit <id>, UINT32_MAX to remove it
+	template <typename... Fields> void setInstance(ComponentStorage<Fields...>& s, UnitId id, uint32_t i);
+	// Returns the number of ranges of at most <rangeSize> instances
+	template <typename... Fields> uint32_t getRangeCount(const ComponentStorage<Fields...>& s, uint32_t rangeSize);
+	// Returns the instances [<begin>, <end>) of the range <rangeIndex>
+	// Ranges start at multiples of <rangeSize>, so kernels on ranges of 4, 8 or 16 instances can load the fields aligned
+	template <typename... Fields> void getRange(const ComponentStorage<Fields...>& s, uint32_t rangeSize, uint32_t rangeIndex, uint32_t& begin, uint32_t& end);
+	// Calls <function>(begin, end) on each range of at most <rangeSize> instances, in order
+	template <typename Function, typename... Fields> void forEachRange(const ComponentStorage<Fields...>& s, uint32_t rangeSize, Function& function);
+} // namespace ComponentStorageFn
+
+namespace ComponentStorageInternalFn
+{
+	template <typename... Fields>
+	inline const uint32_t* getFieldSizeList()
+	{
+		static const uint32_t fieldSizeList[] = { sizeof(UnitId), sizeof(Fields)... };
+		return fieldSizeList;
+	}
+
+	template <typename... Fields>
+	inline uint32_t getFieldAlignment()
+	{
+		const uint32_t fieldAlignmentList[] = { alignof(UnitId), alignof(Fields)... };
+
+		uint32_t alignment = RIO_COMPONENT_ALIGNMENT;
+		for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+		{
+			alignment = fieldAlignmentList[k] > alignment ? fieldAlignmentList[k] : alignment;
+		}
+
+		return alignment;
+	}
+
+	inline size_t alignToPage(size_t size, uint32_t pageSize)
+	{
+		return (size + pageSize - 1) / pageSize * pageSize;
+	}
+
+	template <typename... Fields>
+	inline void updateBoundFieldList(ComponentStorage<Fields...>& s)
+	{
+		for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+		{
+			if (s.boundFieldList[k] != nullptr)
+			{
+				*s.boundFieldList[k] = s.fieldList[k];
+			}
+		}
+	}
+
+	// Copies the fields of the instance <from> to the instance <to>
+	template <typename... Fields>
+	inline void copyInstance(ComponentStorage<Fields...>& s, uint32_t to, uint32_t from)
+	{
+		const uint32_t* fieldSizeList = getFieldSizeList<Fields...>();
+		for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+		{
+			char* field = (char*)s.fieldList[k];
+			memcpy(field + to * fieldSizeList[k], field + from * fieldSizeList[k], fieldSizeList[k]);
+		}
+	}
+
+	// Commits the pages of the reserved arrays of <s> up to <capacity> instances, in place
+	// Returns false if the pages could not all be committed
+	template <typename... Fields>
+	inline bool commit(ComponentStorage<Fields...>& s, uint32_t capacity)
+	{
+		const uint32_t* fieldSizeList = getFieldSizeList<Fields...>();
+		const uint32_t pageSize = OsFn::getPageSize();
+		for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+		{
+			const size_t committedSize = alignToPage(size_t(s.capacity) * fieldSizeList[k], pageSize);
+			const size_t newCommittedSize = alignToPage(size_t(capacity) * fieldSizeList[k], pageSize);
+			if (newCommittedSize > committedSize && !OsFn::commitVirtualMemory((char*)s.fieldList[k] + committedSize, newCommittedSize - committedSize))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Makes room for <capacity> instances in total
+	template <typename... Fields>
+	inline void allocate(ComponentStorage<Fields...>& s, uint32_t capacity)
+	{
+		RIO_ASSERT(capacity > s.capacity, "capacity > s.capacity");
+
+		const uint32_t* fieldSizeList = getFieldSizeList<Fields...>();
+
+		// The reserved arrays grow in place while they can, nothing moves
+		if (s.maxInstancesCount != 0 && capacity <= s.maxInstancesCount && commit(s, capacity))
+		{
+			s.capacity = capacity;
+			return;
+		}
+
+		// Out of reserved instances or of memory to commit, the instances move to the heap and stay there
+		const uint32_t reservedInstancesCount = s.maxInstancesCount;
+		void* reservedFieldList[ComponentStorage<Fields...>::FIELD_COUNT];
+		memcpy(reservedFieldList, s.fieldList, sizeof(reservedFieldList));
+
+		const uint32_t alignment = getFieldAlignment<Fields...>();
+
+		uint32_t bytes = 0;
+		for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+		{
+			bytes += capacity * fieldSizeList[k] + alignment;
+		}
+
+		void* buffer = s.allocator->allocate(bytes, alignment);
+
+		char* field = (char*)buffer;
+		for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+		{
+			field = (char*)MemoryFn::alignTop(field, alignment);
+			memcpy(field, s.fieldList[k], s.size * fieldSizeList[k]);
+			s.fieldList[k] = field;
+			field += capacity * fieldSizeList[k];
+		}
+
+		s.allocator->deallocate(s.buffer);
+		s.buffer = buffer;
+		s.capacity = capacity;
+
+		if (reservedInstancesCount != 0)
+		{
+			const uint32_t pageSize = OsFn::getPageSize();
+			for (uint32_t k = 0; k < ComponentStorage<Fields...>::FIELD_COUNT; ++k)
+			{
+				OsFn::releaseVirtualMemory(reservedFieldList[k], alignToPage(size_t(reservedInstancesCount) * fieldSizeList[k], pageSize));
+			}
+			s.maxInstancesCount = 0;
+		}
+
+		updateBoundFieldList(s);
+	}
+
+	template <typename... Fields>
+	inline void setUnitInstance(ComponentStorage<Fields...>& s, UnitId id, uint32_t i)
+	{
+		const uint32_t index = id.getIndex();
+		const uint32_t count = ArrayFn::getCount(s.unitInstanceList);
+		if (index >= count)
+		{
+			ArrayFn::reserve(s.unitInstanceList, index + 1);
+			ArrayFn::resize(s.unitInstanceList, index + 1);
+			// UINT32_MAX for the units without instances
+			memset(ArrayFn::begin(s.unitInstanceList) + count, 0xff, (index + 1 - count) * sizeof(uint32_t));
+		}
+
+		s.unitInstanceList[index] = i;
+	}
+} // namespace ComponentStorageInternalFn
+
+template <typename... Fields>
+inline ComponentStorage<Fields...>::ComponentStorage(Allocator& a, uint32_t maxInstancesCount)
+	: allocator(&a)
+	, maxInstancesCount(maxInstancesCount)
+	, unitInstanceList(a)
+{
+	memset(fieldList, 0, sizeof(fieldList));
+	memset(boundFieldList, 0, sizeof(boundFieldList));
+
+	if (maxInstancesCount == 0)
+	{
+		return;
+	}
+
+	const uint32_t* fieldSizeList = ComponentStorageInternalFn::getFieldSizeList<Fields...>();
+	const uint32_t pageSize = OsFn::getPageSize();
+	for (uint32_t k = 0; k < FIELD_COUNT; ++k)
+	{
+		fieldList[k] = OsFn::reserveVirtualMemory(ComponentStorageInternalFn::alignToPage(size_t(maxInstancesCount) * fieldSizeList[k], pageSize));
+		if (fieldList[k] != nullptr)
+		{
+			continue;
+		}
+
+		// Out of address space, the arrays are allocated instead
+		for (uint32_t j = 0; j < k; ++j)
+		{
+			OsFn::releaseVirtualMemory(fieldList[j], ComponentStorageInternalFn::alignToPage(size_t(maxInstancesCount) * fieldSizeList[j], pageSize));
+			fieldList[j] = nullptr;
+		}
+		this->maxInstancesCount = 0;
+		return;
+	}
+}
+
+template <typename... Fields>
+inline ComponentStorage<Fields...>::~ComponentStorage()
+{
+	if (maxInstancesCount == 0)
+	{
+		allocator->deallocate(buffer);
+		return;
+	}
+
+	const uint32_t* fieldSizeList = ComponentStorageInternalFn::getFieldSizeList<Fields...>();
+	const uint32_t pageSize = OsFn::getPageSize();
+	for (uint32_t k = 0; k < FIELD_COUNT; ++k)
+	{
+		OsFn::releaseVirtualMemory(fieldList[k], ComponentStorageInternalFn::alignToPage(size_t(maxInstancesCount) * fieldSizeList[k], pageSize));
+	}
+}
+
+namespace ComponentStorageFn
+{
+	template <typename... Fields>
+	inline void bind(ComponentStorage<Fields...>& s, UnitId** unitList, Fields**... fieldList)
+	{
+		void** addressList[] = { (void**)unitList, (void**)fieldList... };
+		memcpy(s.boundFieldList, addressList, sizeof(addressList));
+
+		ComponentStorageInternalFn::updateBoundFieldList(s);
+	}
+
+	template <typename... Fields>
+	inline UnitId* getUnitList(const ComponentStorage<Fields...>& s)
+	{
+		return (UnitId*)s.fieldList[0];
+	}
+
+	template <uint32_t N, typename... Fields>
+	inline typename ComponentField<N, Fields...>::Type* getField(const ComponentStorage<Fields...>& s)
+	{
+		return (typename ComponentField<N, Fields...>::Type*)s.fieldList[N];
+	}
+
+	template <typename... Fields>
+	inline void reserve(ComponentStorage<Fields...>& s, uint32_t count)
+	{
+		const uint32_t size = s.size + count;
+		if (size > s.capacity)
+		{
+			const uint32_t grownCapacity = s.capacity * 2 + 1;
+			uint32_t capacity = size > grownCapacity ? size : grownCapacity;
+			if (s.maxInstancesCount != 0 && capacity > s.maxInstancesCount)
+			{
+				capacity = size > s.maxInstancesCount ? size : s.maxInstancesCount;
+			}
+			ComponentStorageInternalFn::allocate(s, capacity);
+		}
+	}
+
+	template <typename... Fields>
+	inline uint32_t create(ComponentStorage<Fields...>& s, UnitId id)
+	{
+		reserve(s, 1);
+
+		const uint32_t last = s.size;
+		getUnitList(s)[last] = id;
+		++s.size;
+
+		if (getInstance(s, id) == UINT32_MAX)
+		{
+			ComponentStorageInternalFn::setUnitInstance(s, id, last);
+		}
+
+		return last;
+	}
+
+	template <typename... Fields>
+	inline uint32_t create(ComponentStorage<Fields...>& s, uint32_t count, const UnitId* unitIdList)
+	{
+		reserve(s, count);
+
+		const uint32_t first = s.size;
+		memcpy(getUnitList(s) + first, unitIdList, count * sizeof(UnitId));
+		s.size += count;
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (getInstance(s, unitIdList[i]) == UINT32_MAX)
+			{
+				ComponentStorageInternalFn::setUnitInstance(s, unitIdList[i], first + i);
+			}
+		}
+
+		return first;
+	}
+
+	template <typename... Fields>
+	inline uint32_t destroy(ComponentStorage<Fields...>& s, uint32_t i)
+	{
+		RIO_ASSERT(i < s.size, "Index out of bounds");
+
+		UnitId* unitList = getUnitList(s);
+		const uint32_t last = s.size - 1;
+
+		if (getInstance(s, unitList[i]) == i)
+		{
+			setInstance(s, unitList[i], UINT32_MAX);
+		}
+
+		--s.size;
+
+		if (i == last)
+		{
+			return UINT32_MAX;
+		}
+
+		ComponentStorageInternalFn::copyInstance(s, i, last);
+
+		// The unit found at the last instance is found at <i>
+		if (s.unitInstanceList[unitList[i].getIndex()] == last)
+		{
+			s.unitInstanceList[unitList[i].getIndex()] = i;
+		}
+
+		return last;
+	}
+
+	template <typename... Fields>
+	inline void destroyDead(ComponentStorage<Fields...>& s, const UnitManager& unitManager, uint32_t* indexList)
+	{
+		UnitId* unitList = getUnitList(s);
+
+		uint32_t last = 0;
+		for (uint32_t i = 0; i < s.size; ++i)
+		{
+			s.unitInstanceList[unitList[i].getIndex()] = UINT32_MAX;
+
+			if (!unitManager.getIsAlive(unitList[i]))
+			{
+				if (indexList != nullptr)
+				{
+					indexList[i] = UINT32_MAX;
+				}
+				continue;
+			}
+
+			if (last != i)
+			{
+				ComponentStorageInternalFn::copyInstance(s, last, i);
+			}
+			if (indexList != nullptr)
+			{
+				indexList[i] = last;
+			}
+			++last;
+		}
+
+		s.size = last;
+
+		// Walking backwards finds each unit at its first instance
+		for (uint32_t i = s.size; i-- > 0; )
+		{
+			s.unitInstanceList[unitList[i].getIndex()] = i;
+		}
+	}
+
+	template <typename... Fields>
+	inline uint32_t getInstance(const ComponentStorage<Fields...>& s, UnitId id)
+	{
+		const uint32_t index = id.getIndex();
+		if (index >= ArrayFn::getCount(s.unitInstanceList))
+		{
+			return UINT32_MAX;
+		}
+
+		// A unit index reused by another unit can still lead to the instance of the previous one
+		const uint32_t i = s.unitInstanceList[index];
+		return i != UINT32_MAX && getUnitList(s)[i] == id ? i : UINT32_MAX;
+	}
+
+	template <typename... Fields>
+	inline uint32_t getUnitsWithInstanceCount(const ComponentStorage<Fields...>& s, const UnitId* unitIdList, uint32_t count)
+	{
+		uint32_t unitsCount = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (getInstance(s, unitIdList[i]) != UINT32_MAX)
+			{
+				++unitsCount;
+			}
+		}
+		return unitsCount;
+	}
+
+	template <typename... Fields>
+	inline void setInstance(ComponentStorage<Fields...>& s, UnitId id, uint32_t i)
+	{
+		RIO_ASSERT(i == UINT32_MAX || getUnitList(s)[i] == id, "Instance of another unit");
+		ComponentStorageInternalFn::setUnitInstance(s, id, i);
+	}
+
+	template <typename... Fields>
+	inline uint32_t getRangeCount(const ComponentStorage<Fields...>& s, uint32_t rangeSize)
+	{
+		return (s.size + rangeSize - 1) / rangeSize;
+	}
+
+	template <typename... Fields>
+	inline void getRange(const ComponentStorage<Fields...>& s, uint32_t rangeSize, uint32_t rangeIndex, uint32_t& begin, uint32_t& end)
+	{
+		begin = rangeIndex * rangeSize;
+		end = s.size - begin > rangeSize ? begin + rangeSize : s.size;
+	}
+
+	template <typename Function, typename... Fields>
+	inline void forEachRange(const ComponentStorage<Fields...>& s, uint32_t rangeSize, Function& function)
+	{
+		for (uint32_t begin = 0; begin < s.size; begin += rangeSize)
+		{
+			function(begin, s.size - begin > rangeSize ? begin + rangeSize : s.size);
+		}
+	}
+} // namespace ComponentStorageFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
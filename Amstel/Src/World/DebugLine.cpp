@@ -1,6 +1,7 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "World/DebugLine.h"
 
+#include "Core/Containers/Array.h"
 #include "Core/Math/Color4.h"
 #include "Core/Math/MathUtils.h"
 #include "Core/Math/Matrix4x4.h"
@@ -160,6 +161,24 @@ void DebugLine::addMesh(const Matrix4x4& transformMatrix, const void* vertices,
 	}
 }
 
+void DebugLine::addMesh(const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint32_t* indices, uint32_t indicesCount, const Color4& color)
+{
+	for (uint32_t i = 0; i < indicesCount; i += 3)
+	{
+		const uint32_t i0 = indices[i + 0];
+		const uint32_t i1 = indices[i + 1];
+		const uint32_t i2 = indices[i + 2];
+
+		const Vector3& v0 = *(const Vector3*)((const char*)vertices + i0*stride) * transformMatrix;
+		const Vector3& v1 = *(const Vector3*)((const char*)vertices + i1*stride) * transformMatrix;
+		const Vector3& v2 = *(const Vector3*)((const char*)vertices + i2*stride) * transformMatrix;
+
+		addLine(v0, v1, color);
+		addLine(v1, v2, color);
+		addLine(v2, v0, color);
+	}
+}
+
 void DebugLine::addUnit(ResourceManager& resourceManager, const Matrix4x4& transformMatrix, StringId64 name, const Color4& color)
 {
 	const UnitResource& unitResource = *(const UnitResource*)resourceManager.get(RESOURCE_TYPE_UNIT, name);
@@ -180,13 +199,39 @@ void DebugLine::addUnit(ResourceManager& resourceManager, const Matrix4x4& trans
 				const MeshResource* meshResource = (const MeshResource*)resourceManager.get(RESOURCE_TYPE_MESH, meshRendererDesc->meshResource);
 				const MeshGeometry* meshGeometry = meshResource->getMeshGeometry(meshRendererDesc->geometryName);
 
-				addMesh(transformMatrix
-					, meshGeometry->vertices.data
-					, meshGeometry->vertices.stride
-					, (uint16_t*)meshGeometry->indices.data
-					, meshGeometry->indices.indicesCount
-					, color
-					);
+				const char* vertices = meshGeometry->vertices.data;
+				uint32_t stride = meshGeometry->vertices.stride;
+
+				// Quantized positions are decoded first
+				Array<Vector3> positionList(getDefaultAllocator());
+				if (meshGeometry->positionFormat != MeshPositionFormat::FLOAT)
+				{
+					ArrayFn::resize(positionList, meshGeometry->vertices.verticesCount);
+					MeshResourceFn::decodePositions(*meshGeometry, ArrayFn::begin(positionList));
+					vertices = (const char*)ArrayFn::begin(positionList);
+					stride = sizeof(Vector3);
+				}
+
+				if (meshGeometry->indices.stride == sizeof(uint32_t))
+				{
+					addMesh(transformMatrix
+						, vertices
+						, stride
+						, (const uint32_t*)meshGeometry->indices.data
+						, meshGeometry->lodList[0].indexCount
+						, color
+						);
+				}
+				else
+				{
+					addMesh(transformMatrix
+						, vertices
+						, stride
+						, (const uint16_t*)meshGeometry->indices.data
+						, meshGeometry->lodList[0].indexCount
+						, color
+						);
+				}
 			}
 		}
 
@@ -48,6 +48,8 @@ public:
 	void addObb(const Matrix4x4& transformMatrix, const Vector3& halfExtents, const Color4& color);
 	// Adds the mesh described by (vertices, stride, indices, num)
 	void addMesh(const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint16_t* indices, uint32_t indicesCount, const Color4& color);
+	// Adds the mesh described by (vertices, stride, 32 bit indices, num)
+	void addMesh(const Matrix4x4& transformMatrix, const void* vertices, uint32_t stride, const uint32_t* indices, uint32_t indicesCount, const Color4& color);
 	// Adds the meshes from the unit <name>
 	void addUnit(ResourceManager& resourceManager, const Matrix4x4& transformMatrix, StringId64 name, const Color4& color);
 	// Resets all the lines
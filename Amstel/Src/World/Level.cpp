@@ -1,7 +1,17 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "World/Level.h"
 
+#include "Config.h"
+
+#include "Core/Base/Os.h"
+#include "Core/Containers/Array.h"
+#include "Core/Error/Error.h"
+#include "Core/Math/Matrix4x4.h"
+#include "Core/Memory/TempAllocator.h"
+
 #include "Resource/LevelResource.h"
+#include "Resource/ResourceManager.h"
+#include "Resource/ResourcePackage.h"
 #include "Resource/UnitResource.h"
 
 #include "World/World.h"
@@ -10,38 +20,183 @@
 namespace Rio
 {
 
-Level::Level(Allocator& a, UnitManager& unitManager, World& world, const LevelResource& levelResource)
+Level::Level(Allocator& a, ResourceManager& resourceManager, UnitManager& unitManager, World& world, StringId64 name)
 	: marker(LEVEL_MARKER)
 	, allocator(&a)
+	, resourceManager(&resourceManager)
 	, unitManager(&unitManager)
 	, world(&world)
-	, levelResource(&levelResource)
+	, name(name)
+	, spawnTemplate(a)
+	, unitPoseList(a)
 	, unitLookupList(a)
 {
 }
 
 Level::~Level()
 {
+	if (isResourceRequested)
+	{
+		resourceManager->unload(RESOURCE_TYPE_LEVEL, name);
+	}
+
 	marker = 0;
 }
 
 void Level::load(const Vector3& position, const Quaternion& rotation)
 {
-	// Spawn units
+	RIO_ASSERT(resourceManager->canGet(RESOURCE_TYPE_LEVEL, name), "Level not loaded");
+
+	beginLoad(position, rotation, nullptr);
+	update(INT64_MAX);
+}
+
+void Level::beginLoad(const Vector3& position, const Quaternion& rotation, const ResourcePackage* resourcePackage)
+{
+	RIO_ASSERT(loadState == LevelLoadState::WAITING && levelResource == nullptr, "Level already loaded");
+
+	this->resourcePackage = resourcePackage;
+	spawnPose = createMatrix4x4(rotation, position);
+
+	if (!resourceManager->canGet(RESOURCE_TYPE_LEVEL, name))
+	{
+		resourceManager->load(RESOURCE_TYPE_LEVEL, name);
+		isResourceRequested = true;
+	}
+}
+
+bool Level::update(int64_t endTime)
+{
+	if (loadState == LevelLoadState::WAITING)
+	{
+		if (!resourceManager->canGet(RESOURCE_TYPE_LEVEL, name))
+		{
+			return false;
+		}
+		if (resourcePackage != nullptr && resourcePackage->getPendingCount() != 0)
+		{
+			return false;
+		}
+
+		createUnits();
+		loadState = LevelLoadState::SPAWNING;
+	}
+
+	if (loadState != LevelLoadState::SPAWNING)
+	{
+		return false;
+	}
+
+	// The components are created in the order of their blocks, so that transforms come before the components using their poses
+	do
+	{
+		const uint32_t instancesLeft = spawnTemplate.instancesCount - instancesSpawned;
+		const uint32_t chunkSize = instancesLeft < RIO_LEVEL_LOAD_CHUNK_SIZE ? instancesLeft : RIO_LEVEL_LOAD_CHUNK_SIZE;
+
+		SpawnTemplateFn::spawnInstances(spawnTemplate
+			, *world
+			, 1
+			, &spawnPose
+			, ArrayFn::begin(unitPoseList)
+			, ArrayFn::begin(unitLookupList)
+			, instancesSpawned
+			, chunkSize
+			);
+		instancesSpawned += chunkSize;
+	}
+	while (instancesSpawned < spawnTemplate.instancesCount && OsFn::getClockTime() < endTime);
+
+	if (instancesSpawned < spawnTemplate.instancesCount)
+	{
+		return false;
+	}
+
+	completeLoad();
+	loadState = LevelLoadState::LOADED;
+	return true;
+}
+
+void Level::cancelLoad()
+{
+	if (!getIsLoading())
+	{
+		return;
+	}
+
+	// Destroying the units removes the components created so far
+	TempAllocator4096 ta;
+	Array<UnitId> destroyedUnitIdList(ta);
+	unitManager->destroyBatch(ArrayFn::begin(unitLookupList), ArrayFn::getCount(unitLookupList), destroyedUnitIdList);
+	ArrayFn::clear(unitLookupList);
+
+	loadState = LevelLoadState::CANCELED;
+}
+
+void Level::failWaitForPackage(const ResourcePackage* resourcePackage)
+{
+	if (this->resourcePackage != resourcePackage)
+	{
+		return;
+	}
+
+	this->resourcePackage = nullptr;
+	if (loadState == LevelLoadState::WAITING)
+	{
+		cancelLoad();
+	}
+}
+
+LevelLoadState::Enum Level::getLoadState() const
+{
+	return loadState;
+}
+
+bool Level::getIsLoading() const
+{
+	return loadState == LevelLoadState::WAITING || loadState == LevelLoadState::SPAWNING;
+}
+
+bool Level::getIsLoaded() const
+{
+	return loadState == LevelLoadState::LOADED;
+}
+
+float Level::getLoadProgress() const
+{
+	if (loadState == LevelLoadState::LOADED)
+	{
+		return 1.0f;
+	}
+	if (spawnTemplate.instancesCount == 0)
+	{
+		return 0.0f;
+	}
+	return float(instancesSpawned) / float(spawnTemplate.instancesCount);
+}
+
+void Level::createUnits()
+{
+	levelResource = (const LevelResource*)resourceManager->get(RESOURCE_TYPE_LEVEL, name);
+
 	const UnitResource* unitResource = LevelResourceFn::getUnitResource(levelResource);
+	SpawnTemplateFn::create(spawnTemplate, *unitResource);
+
 	const uint32_t unitListCount = unitResource->unitListCount;
 
 	ArrayFn::resize(unitLookupList, unitListCount);
+	ArrayFn::resize(unitPoseList, unitListCount);
 
 	for (uint32_t i = 0; i < unitListCount; ++i)
 	{
 		unitLookupList[i] = unitManager->create();
+		unitPoseList[i] = MATRIX4X4_IDENTITY;
 	}
+}
 
-	spawnUnits(*world, *unitResource, position, rotation, ArrayFn::begin(unitLookupList));
-
+void Level::completeLoad()
+{
 	// Post events
-	for (uint32_t i = 0; i < unitListCount; ++i)
+	for (uint32_t i = 0; i < ArrayFn::getCount(unitLookupList); ++i)
 	{
 		world->postUnitSpawnedEvent(unitLookupList[i]);
 	}
@@ -58,6 +213,9 @@ void Level::load(const Vector3& position, const Quaternion& rotation)
 			, levelSound->range
 			);
 	}
+
+	// The spawn state is not needed anymore
+	ArrayFn::clear(unitPoseList);
 }
 
 } // namespace Rio
@@ -4,25 +4,73 @@
 #include "Core/Containers/ContainerTypes.h"
 #include "Core/Math/MathTypes.h"
 #include "Core/Memory/MemoryTypes.h"
+#include "Core/Strings/StringId.h"
 #include "Resource/ResourceTypes.h"
+#include "World/SpawnTemplate.h"
 #include "World/WorldTypes.h"
 
 namespace Rio
 {
 
+struct LevelLoadState
+{
+	enum Enum
+	{
+		WAITING, // For the level resource or the resource package
+		SPAWNING,
+		LOADED,
+		CANCELED,
+
+		COUNT
+	};
+};
+
 class Level
 {
 private:
 	uint32_t marker;
 public:
-	Level(Allocator& a, UnitManager& unitManager, World& world, const LevelResource& levelResource);
+	Level(Allocator& a, ResourceManager& resourceManager, UnitManager& unitManager, World& world, StringId64 name);
 	~Level();
+	// Loads the whole level at once, the level resource must be loaded
 	void load(const Vector3& position, const Quaternion& rotation);
+	// Starts loading the level, update() spawns it a chunk at a time
+	// The level resource is read in the background if it is not loaded yet, and the units are spawned
+	// once the resources of <resourcePackage>, if any, have been loaded too
+	void beginLoad(const Vector3& position, const Quaternion& rotation, const ResourcePackage* resourcePackage);
+	// Spawns chunks of the level until the clock reaches <endTime>, always at least one chunk
+	// Returns true if the level has finished loading during this call
+	bool update(int64_t endTime);
+	// Stops loading the level and destroys the units spawned so far
+	void cancelLoad();
+	// Forgets <resourcePackage>, which is about to be destroyed
+	// The level is canceled if it still waits for it, its units could not be spawned without the resources
+	void failWaitForPackage(const ResourcePackage* resourcePackage);
+	LevelLoadState::Enum getLoadState() const;
+	// Returns whether the level is waiting for its resources or spawning
+	bool getIsLoading() const;
+	bool getIsLoaded() const;
+	// Returns the fraction of the component instances of the level spawned so far
+	float getLoadProgress() const;
 private:
+	// Creates the units of the level, once its resources have been loaded
+	void createUnits();
+	// Posts the unit events and plays the sounds of the level, once all its units have been spawned
+	void completeLoad();
+
 	Allocator* allocator;
+	ResourceManager* resourceManager;
 	UnitManager* unitManager;
 	World* world;
-	const LevelResource* levelResource;
+	StringId64 name;
+	const LevelResource* levelResource = nullptr;
+	const ResourcePackage* resourcePackage = nullptr;
+	bool isResourceRequested = false; // Whether the level resource has been loaded by the level itself
+	LevelLoadState::Enum loadState = LevelLoadState::WAITING;
+	Matrix4x4 spawnPose;
+	SpawnTemplate spawnTemplate;
+	uint32_t instancesSpawned = 0;
+	Array<Matrix4x4> unitPoseList;
 	Array<UnitId> unitLookupList;
 };
 
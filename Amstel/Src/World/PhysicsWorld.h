@@ -16,11 +16,15 @@ public:
 	virtual ~PhysicsWorld() {}
 
 	virtual ColliderInstance colliderCreate(UnitId id, const ColliderDesc* colliderDesc) = 0;
+	// Creates the collider <colliderDesc> for each of the <count> units in <unitIdList>
+	virtual void colliderCreate(uint32_t count, const UnitId* unitIdList, const ColliderDesc* colliderDesc) = 0;
 	virtual void colliderDestroy(ColliderInstance colliderInstance) = 0;
 	virtual ColliderInstance colliderGetFirst(UnitId id) = 0;
 	virtual ColliderInstance colliderGetNext(ColliderInstance colliderInstance) = 0;
 
 	virtual ActorInstance actorCreate(UnitId id, const ActorResource* actorResource, const Matrix4x4& transformMatrix) = 0;
+	// Creates the actor <actorResource> for each of the <count> units in <unitIdList>, at the matching pose in <transformMatrixList>
+	virtual void actorCreate(uint32_t count, const UnitId* unitIdList, const ActorResource* actorResource, const Matrix4x4* transformMatrixList) = 0;
 	virtual void actorDestroy(ActorInstance i) = 0;
 	virtual ActorInstance actorGet(UnitId id) = 0;
 	// Returns the world position of the actor
@@ -6,6 +6,7 @@
 #include "Core/Math/Color4.h"
 #include "Core/Containers/HashMap.h"
 #include "Core/Math/Matrix4x4.h"
+#include "Core/Memory/ArenaAllocator.h"
 #include "Core/Memory/ProxyAllocator.h"
 #include "Core/Math/Quaternion.h"
 #include "Core/Math/Vector3.h"
@@ -47,27 +48,79 @@ namespace Rio
 
 namespace PhysicsGlobalFn
 {
-	static btDefaultCollisionConfiguration* defaultCollisionConfiguration;
-	static btCollisionDispatcher* collisionDispatcher;
-	static btBroadphaseInterface* broadphaseInterface;
-	static btSequentialImpulseConstraintSolver* sequentialImpulseConstraintSolver;
+	// Every Bullet allocation is tagged by the "physics" proxy
+	static ProxyAllocator* physicsAllocator = nullptr;
+
+	// Arena of the world which is currently running Bullet code on this thread
+	// Allocations made outside of any world go straight to the physics proxy
+	static RIO_THREAD Allocator* threadAllocator = nullptr;
+
+	// Stored right before the memory returned to Bullet
+	struct BulletAllocationHeader
+	{
+		Allocator* allocator;
+		uint32_t offset;
+	};
+
+	static const uint32_t BULLET_HEADER_SIZE = 16;
+
+	static void* bulletAlignedAlloc(size_t size, int alignment)
+	{
+		Allocator* a = threadAllocator != nullptr ? threadAllocator : physicsAllocator;
+		const uint32_t align = alignment < (int)BULLET_HEADER_SIZE ? BULLET_HEADER_SIZE : (uint32_t)alignment;
+
+		char* p = (char*)a->allocate((uint32_t)size + align, align);
+		char* data = p + align;
+
+		BulletAllocationHeader* header = (BulletAllocationHeader*)(data - BULLET_HEADER_SIZE);
+		header->allocator = a;
+		header->offset = align;
+		return data;
+	}
+
+	static void bulletAlignedFree(void* data)
+	{
+		if (data == nullptr)
+		{
+			return;
+		}
+
+		// Memory is always given back to where it came from
+		const BulletAllocationHeader* header = (const BulletAllocationHeader*)((char*)data - BULLET_HEADER_SIZE);
+		header->allocator->deallocate((char*)data - header->offset);
+	}
 
 	void init(Allocator& a)
 	{
-		defaultCollisionConfiguration = RIO_NEW(a, btDefaultCollisionConfiguration);
-		collisionDispatcher = RIO_NEW(a, btCollisionDispatcher)(defaultCollisionConfiguration);
-		broadphaseInterface = RIO_NEW(a, btDbvtBroadphase);
-		sequentialImpulseConstraintSolver = RIO_NEW(a, btSequentialImpulseConstraintSolver);
+		RIO_STATIC_ASSERT(sizeof(BulletAllocationHeader) <= BULLET_HEADER_SIZE);
+
+		physicsAllocator = RIO_NEW(a, ProxyAllocator)(getDefaultAllocator(), "physics");
+		btAlignedAllocSetCustomAligned(bulletAlignedAlloc, bulletAlignedFree);
 	}
 
 	void shutdown(Allocator& a)
 	{
-		RIO_DELETE(a, sequentialImpulseConstraintSolver);
-		RIO_DELETE(a, broadphaseInterface);
-		RIO_DELETE(a, collisionDispatcher);
-		RIO_DELETE(a, defaultCollisionConfiguration);
+		btAlignedAllocSetCustomAligned(nullptr, nullptr);
+		RIO_DELETE(a, physicsAllocator);
+		physicsAllocator = nullptr;
 	}
-	
+
+	// Routes the Bullet allocations made on this thread to <a> for as long as it lives
+	struct AllocatorScope
+	{
+		AllocatorScope(Allocator& a)
+			: previous(threadAllocator)
+		{
+			threadAllocator = &a;
+		}
+
+		~AllocatorScope()
+		{
+			threadAllocator = previous;
+		}
+
+		Allocator* previous;
+	};
 } // namespace PhysicsGlobalFn
 
 static btVector3 getBtVector3(const Vector3& v)
@@ -161,7 +214,7 @@ class BulletWorld : public PhysicsWorld
 {
 public:
 	BulletWorld(Allocator& a, ResourceManager& resourceManager, UnitManager& unitManager, DebugLine& debugLine)
-		: allocator(&a)
+		: arena(*PhysicsGlobalFn::physicsAllocator)
 		, unitManager(&unitManager)
 		, colliderMap(a)
 		, actorMap(a)
@@ -173,10 +226,17 @@ public:
 		, debugDrawer(debugLine)
 		, eventStream(a)
 	{
-		discreteDynamicsWorld = RIO_NEW(*allocator, btDiscreteDynamicsWorld)(PhysicsGlobalFn::collisionDispatcher
-			, PhysicsGlobalFn::broadphaseInterface
-			, PhysicsGlobalFn::sequentialImpulseConstraintSolver
-			, PhysicsGlobalFn::defaultCollisionConfiguration
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
+		defaultCollisionConfiguration = RIO_NEW(arena, btDefaultCollisionConfiguration);
+		collisionDispatcher = RIO_NEW(arena, btCollisionDispatcher)(defaultCollisionConfiguration);
+		broadphaseInterface = RIO_NEW(arena, btDbvtBroadphase);
+		sequentialImpulseConstraintSolver = RIO_NEW(arena, btSequentialImpulseConstraintSolver);
+
+		discreteDynamicsWorld = RIO_NEW(arena, btDiscreteDynamicsWorld)(collisionDispatcher
+			, broadphaseInterface
+			, sequentialImpulseConstraintSolver
+			, defaultCollisionConfiguration
 			);
 
 		discreteDynamicsWorld->getCollisionWorld()->setDebugDrawer(&debugDrawer);
@@ -185,47 +245,57 @@ public:
 
 		physicsConfigResource = (const PhysicsConfigResource*)resourceManager.get(RESOURCE_TYPE_PHYSICS_CONFIG, StringId64("global"));
 
-		unitManager.registerDestroyFunction(BulletWorld::unitDestroyedCallback, this);
+		unitManager.registerDestroyFunction(BulletWorld::unitDestroyedCallback, this, BulletWorld::unitsDestroyedCallback);
 	}
 
 	~BulletWorld()
 	{
 		unitManager->unregisterDestroyFunction(this);
 
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		for (uint32_t i = 0; i < ArrayFn::getCount(actorList); ++i)
 		{
 			btRigidBody* rigidBody = actorList[i].actor;
 
 			discreteDynamicsWorld->removeRigidBody(rigidBody);
-			RIO_DELETE(*allocator, rigidBody->getMotionState());
-			RIO_DELETE(*allocator, rigidBody->getCollisionShape());
-			RIO_DELETE(*allocator, rigidBody);
+			RIO_DELETE(arena, rigidBody->getMotionState());
+			RIO_DELETE(arena, rigidBody->getCollisionShape());
+			RIO_DELETE(arena, rigidBody);
 		}
 
 		for (uint32_t i = 0; i < ArrayFn::getCount(colliderList); ++i)
 		{
-			RIO_DELETE(*allocator, colliderList[i].vertexArray);
-			RIO_DELETE(*allocator, colliderList[i].shape);
+			RIO_DELETE(arena, colliderList[i].vertexArray);
+			RIO_DELETE(arena, colliderList[i].shape);
 		}
 
-		RIO_DELETE(*allocator, discreteDynamicsWorld);
+		RIO_DELETE(arena, discreteDynamicsWorld);
+		RIO_DELETE(arena, sequentialImpulseConstraintSolver);
+		RIO_DELETE(arena, broadphaseInterface);
+		RIO_DELETE(arena, collisionDispatcher);
+		RIO_DELETE(arena, defaultCollisionConfiguration);
+
+		// Whatever Bullet still holds goes away with the arena
 	}
 
 	virtual ColliderInstance colliderCreate(UnitId id, const ColliderDesc* colliderDesc) override
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		btTriangleIndexVertexArray* vertexArray = nullptr;
 		btCollisionShape* childShape = nullptr;
 
 		switch(colliderDesc->type)
 		{
 			case ColliderType::SPHERE:
-				childShape = RIO_NEW(*allocator, btSphereShape)(colliderDesc->sphere.radius);
+				childShape = RIO_NEW(arena, btSphereShape)(colliderDesc->sphere.radius);
 				break;
 			case ColliderType::CAPSULE:
-				childShape = RIO_NEW(*allocator, btCapsuleShape)(colliderDesc->capsule.radius, colliderDesc->capsule.height);
+				childShape = RIO_NEW(arena, btCapsuleShape)(colliderDesc->capsule.radius, colliderDesc->capsule.height);
 				break;
 			case ColliderType::BOX:
-				childShape = RIO_NEW(*allocator, btBoxShape)(getBtVector3(colliderDesc->box.halfSize));
+				childShape = RIO_NEW(arena, btBoxShape)(getBtVector3(colliderDesc->box.halfSize));
 				break;
 			case ColliderType::CONVEX_HULL:
 			{
@@ -233,7 +303,7 @@ public:
 				const uint32_t count = *(uint32_t*)data;
 				const btScalar* pointList = (btScalar*)(data + sizeof(uint32_t));
 
-				childShape = RIO_NEW(*allocator, btConvexHullShape)(pointList, (int)count, sizeof(Vector3));
+				childShape = RIO_NEW(arena, btConvexHullShape)(pointList, (int)count, sizeof(Vector3));
 			}
 			break;
 			case ColliderType::MESH:
@@ -253,12 +323,12 @@ public:
 				part.m_numTriangles = indicesCount / 3;
 				part.m_indexType = PHY_SHORT;
 
-				vertexArray = RIO_NEW(*allocator, btTriangleIndexVertexArray)();
+				vertexArray = RIO_NEW(arena, btTriangleIndexVertexArray)();
 				vertexArray->addIndexedMesh(part, PHY_SHORT);
 
 				const btVector3 aabbMin(-1000.0f,-1000.0f,-1000.0f);
 				const btVector3 aabbMax(1000.0f,1000.0f,1000.0f);
-				childShape = RIO_NEW(*allocator, btBvhTriangleMeshShape)(vertexArray, false, aabbMin, aabbMax);
+				childShape = RIO_NEW(arena, btBvhTriangleMeshShape)(vertexArray, false, aabbMin, aabbMax);
 			}
 			break;
 			case ColliderType::HEIGHTFIELD:
@@ -301,6 +371,17 @@ public:
 		return makeColliderInstance(last);
 	}
 
+	virtual void colliderCreate(uint32_t count, const UnitId* unitIdList, const ColliderDesc* colliderDesc) override
+	{
+		ArrayFn::reserve(colliderList, ArrayFn::getCount(colliderList) + count);
+		HashMapFn::reserve(colliderMap, HashMapFn::getCount(colliderMap) + count);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			colliderCreate(unitIdList[i], colliderDesc);
+		}
+	}
+
 	// private implementation
 	// auxiliary function
 	void colliderRemoveNode(ColliderInstance first, ColliderInstance colliderInstance)
@@ -378,6 +459,8 @@ public:
 
 	virtual void colliderDestroy(ColliderInstance colliderInstance) override
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		RIO_ASSERT(colliderInstance.i < ArrayFn::getCount(this->colliderList), "Index out of bounds");
 
 		const uint32_t last = ArrayFn::getCount(this->colliderList) - 1;
@@ -388,8 +471,8 @@ public:
 		colliderSwapNode(lastColliderInstance, colliderInstance);
 		colliderRemoveNode(firstColliderInstance, colliderInstance);
 
-		RIO_DELETE(*(this->allocator), this->colliderList[colliderInstance.i].vertexArray);
-		RIO_DELETE(*(this->allocator), this->colliderList[colliderInstance.i].shape);
+		RIO_DELETE(arena, this->colliderList[colliderInstance.i].vertexArray);
+		RIO_DELETE(arena, this->colliderList[colliderInstance.i].shape);
 
 		this->colliderList[colliderInstance.i] = colliderList[last];
 
@@ -398,6 +481,8 @@ public:
 
 	ActorInstance actorCreate(UnitId unitId, const ActorResource* actorResource, const Matrix4x4& transformMatrix)
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		const PhysicsConfigActor* actorClass = PhysicsConfigResourceFn::getPhysicsConfigActor(physicsConfigResource, actorResource->actorClass);
 
 		const bool isKinematic = (actorClass->flags & PhysicsConfigActor::KINEMATIC) != 0;
@@ -406,7 +491,7 @@ public:
 		const float mass = isDynamic ? actorResource->mass : 0.0f;
 
 		// Create compound shape
-		btCompoundShape* shape = RIO_NEW(*allocator, btCompoundShape)(true);
+		btCompoundShape* shape = RIO_NEW(arena, btCompoundShape)(true);
 
 		ColliderInstance colliderInstance = colliderGetFirst(unitId);
 		while (getIsValid(colliderInstance) == true)
@@ -416,7 +501,7 @@ public:
 		}
 
 		// Create motion state
-		btDefaultMotionState* defaultMotionState = RIO_NEW(*allocator, btDefaultMotionState)(getBtTransform(transformMatrix));
+		btDefaultMotionState* defaultMotionState = RIO_NEW(arena, btDefaultMotionState)(getBtTransform(transformMatrix));
 
 		// If dynamic, calculate inertia
 		btVector3 inertia;
@@ -435,7 +520,7 @@ public:
 		rigidBodyConstructionInfo.m_angularSleepingThreshold = 0.01f; // TODO
 
 		// Create rigid body
-		btRigidBody* actor = RIO_NEW(*allocator, btRigidBody)(rigidBodyConstructionInfo);
+		btRigidBody* actor = RIO_NEW(arena, btRigidBody)(rigidBodyConstructionInfo);
 
 		int collisionFlags = actor->getCollisionFlags();
 		collisionFlags |= isKinematic ? btCollisionObject::CF_KINEMATIC_OBJECT : 0;
@@ -473,16 +558,29 @@ public:
 		return makeActorInstance(last);
 	}
 
+	virtual void actorCreate(uint32_t count, const UnitId* unitIdList, const ActorResource* actorResource, const Matrix4x4* transformMatrixList) override
+	{
+		ArrayFn::reserve(actorList, ArrayFn::getCount(actorList) + count);
+		HashMapFn::reserve(actorMap, HashMapFn::getCount(actorMap) + count);
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			actorCreate(unitIdList[i], actorResource, transformMatrixList[i]);
+		}
+	}
+
 	void actorDestroy(ActorInstance actorInstance)
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		const uint32_t lastActorIndex = ArrayFn::getCount(actorList) - 1;
 		const UnitId unitId = actorList[actorInstance.i].unitId;
 		const UnitId lastUnitId = actorList[lastActorIndex].unitId;
 
 		discreteDynamicsWorld->removeRigidBody(actorList[actorInstance.i].actor);
-		RIO_DELETE(*allocator, actorList[actorInstance.i].actor->getMotionState());
-		RIO_DELETE(*allocator, actorList[actorInstance.i].actor->getCollisionShape());
-		RIO_DELETE(*allocator, actorList[actorInstance.i].actor);
+		RIO_DELETE(arena, actorList[actorInstance.i].actor->getMotionState());
+		RIO_DELETE(arena, actorList[actorInstance.i].actor->getCollisionShape());
+		RIO_DELETE(arena, actorList[actorInstance.i].actor);
 
 		actorList[actorInstance.i] = actorList[lastActorIndex];
 		actorList[actorInstance.i].actor->setUserPointer((void*)(uintptr_t)actorInstance.i);
@@ -758,6 +856,8 @@ public:
 
 	JointInstance jointCreate(ActorInstance a0, ActorInstance a1, const JointDesc& jointDesc)
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		const btVector3 anchor0 = getBtVector3(jointDesc.anchor0);
 		const btVector3 anchor1 = getBtVector3(jointDesc.anchor1);
 		btRigidBody* actor0 = actorList[a0.i].actor;
@@ -770,7 +870,7 @@ public:
 			{
 				const btTransform frame0 = btTransform(btQuaternion::getIdentity(), anchor0);
 				const btTransform frame1 = btTransform(btQuaternion::getIdentity(), anchor1);
-	 			joint = RIO_NEW(*allocator, btFixedConstraint)(*actor0
+	 			joint = RIO_NEW(arena, btFixedConstraint)(*actor0
 	 				, *actor1
 	 				, frame0
 	 				, frame1
@@ -779,7 +879,7 @@ public:
 			break;
 			case JointType::SPRING:
 			{
-				joint = RIO_NEW(*allocator, btPoint2PointConstraint)(*actor0
+				joint = RIO_NEW(arena, btPoint2PointConstraint)(*actor0
 					, *actor1
 					, anchor0
 					, anchor1
@@ -788,7 +888,7 @@ public:
 			break;
 			case JointType::HINGE:
 			{
-				btHingeConstraint* hinge = RIO_NEW(*allocator, btHingeConstraint)(*actor0
+				btHingeConstraint* hinge = RIO_NEW(arena, btHingeConstraint)(*actor0
 					, *actor1
 					, anchor0
 					, anchor1
@@ -829,6 +929,8 @@ public:
 
 	void raycast(const Vector3& from, const Vector3& direction, float length, RaycastMode::Enum mode, Array<RaycastHit>& hits)
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		const btVector3 start = getBtVector3(from);
 		const btVector3 end = getBtVector3(from + direction*length);
 
@@ -903,6 +1005,8 @@ public:
 
 	void update(float dt)
 	{
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		discreteDynamicsWorld->stepSimulation(dt);
 
 		const int collisionObjectsCount = discreteDynamicsWorld->getNumCollisionObjects();
@@ -946,6 +1050,8 @@ public:
 			return;
 		}
 
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
 		discreteDynamicsWorld->debugDrawWorld();
 		debugDrawer.debugLine->submit();
 		debugDrawer.debugLine->reset();
@@ -1028,6 +1134,83 @@ public:
 		}
 	}
 
+	void unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count)
+	{
+		uint32_t unitsCount = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (HashMapFn::has(actorMap, unitIdList[i]) || HashMapFn::has(colliderMap, unitIdList[i]))
+			{
+				++unitsCount;
+			}
+		}
+		if (unitsCount == 0)
+		{
+			return;
+		}
+
+		// Swap-removing the actors and colliders of a few units is cheaper than compacting all of them
+		if (unitsCount * RIO_COMPONENT_COMPACT_FRACTION < ArrayFn::getCount(actorList) + ArrayFn::getCount(colliderList))
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				unitDestroyedCallback(unitIdList[i]);
+			}
+			return;
+		}
+
+		PhysicsGlobalFn::AllocatorScope allocatorScope(arena);
+
+		// The units are not alive anymore, which is cheaper to check than looking each of them up
+
+		// Actors first, their compound shapes hold the collider shapes
+		uint32_t last = 0;
+		for (uint32_t i = 0; i < ArrayFn::getCount(actorList); ++i)
+		{
+			if (!unitManager->getIsAlive(actorList[i].unitId))
+			{
+				discreteDynamicsWorld->removeRigidBody(actorList[i].actor);
+				RIO_DELETE(arena, actorList[i].actor->getMotionState());
+				RIO_DELETE(arena, actorList[i].actor->getCollisionShape());
+				RIO_DELETE(arena, actorList[i].actor);
+				continue;
+			}
+
+			actorList[last] = actorList[i];
+			actorList[last].actor->setUserPointer((void*)(uintptr_t)last);
+			++last;
+		}
+		ArrayFn::resize(actorList, last);
+
+		HashMapFn::clear(actorMap);
+		for (uint32_t i = 0; i < ArrayFn::getCount(actorList); ++i)
+		{
+			HashMapFn::set(actorMap, actorList[i].unitId, i);
+		}
+
+		last = 0;
+		for (uint32_t i = 0; i < ArrayFn::getCount(colliderList); ++i)
+		{
+			if (!unitManager->getIsAlive(colliderList[i].unitId))
+			{
+				RIO_DELETE(arena, colliderList[i].vertexArray);
+				RIO_DELETE(arena, colliderList[i].shape);
+				continue;
+			}
+
+			colliderList[last++] = colliderList[i];
+		}
+		ArrayFn::resize(colliderList, last);
+
+		// Walking backwards links the colliders of each unit in index order
+		HashMapFn::clear(colliderMap);
+		for (uint32_t i = ArrayFn::getCount(colliderList); i-- > 0; )
+		{
+			colliderList[i].next = makeColliderInstance(HashMapFn::get(colliderMap, colliderList[i].unitId, UINT32_MAX));
+			HashMapFn::set(colliderMap, colliderList[i].unitId, i);
+		}
+	}
+
 	static void tickCallbackWrapper(btDynamicsWorld* world, btScalar dt)
 	{
 		BulletWorld* bulletWorld = static_cast<BulletWorld*>(world->getWorldUserInfo());
@@ -1039,6 +1222,11 @@ public:
 		((BulletWorld*)userPtr)->unitDestroyedCallback(unitId);
 	}
 
+	static void unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count, void* userPtr)
+	{
+		((BulletWorld*)userPtr)->unitsDestroyedCallback(unitIdList, count);
+	}
+
 private:
 
 	bool getIsValid(ColliderInstance i) 
@@ -1116,7 +1304,7 @@ private:
 		btKinematicCharacterController* kinematicCharacterController;
 	};
 
-	Allocator* allocator;
+	ArenaAllocator arena;
 	UnitManager* unitManager;
 
 	HashMap<UnitId, uint32_t> colliderMap;
@@ -1128,6 +1316,10 @@ private:
 	Array<btTypedConstraint*> jointList;
 
 	OverlapFilterCallback overlapFilterCallback;
+	btDefaultCollisionConfiguration* defaultCollisionConfiguration = nullptr;
+	btCollisionDispatcher* collisionDispatcher = nullptr;
+	btBroadphaseInterface* broadphaseInterface = nullptr;
+	btSequentialImpulseConstraintSolver* sequentialImpulseConstraintSolver = nullptr;
 	btDiscreteDynamicsWorld* discreteDynamicsWorld = nullptr;
 	DebugDrawer debugDrawer;
 
@@ -36,6 +36,10 @@ public:
 		return makeColliderInstance(UINT32_MAX);
 	}
 
+	virtual void colliderCreate(uint32_t /*count*/, const UnitId* /*unitIdList*/, const ColliderDesc* /*colliderDesc*/) override
+	{
+	}
+
 	virtual void colliderDestroy(ColliderInstance colliderInstance) override
 	{
 	}
@@ -55,6 +59,10 @@ public:
 		return makeActorInstance(UINT32_MAX);
 	}
 
+	virtual void actorCreate(uint32_t /*count*/, const UnitId* /*unitIdList*/, const ActorResource* /*actorResource*/, const Matrix4x4* /*transformMatrixList*/) override
+	{
+	}
+
 	virtual void actorDestroy(ActorInstance /*i*/)
 	{
 	}
@@ -3,13 +3,19 @@
 
 #include "Core/Math/Aabb.h"
 #include "Core/Math/Color4.h"
-#include "Core/Containers/HashMap.h"
 #include "Core/Math/Intersection.h"
 #include "Core/Math/Matrix4x4.h"
+#include "Core/Math/Vector3.h"
 
+#include "Device/Device.h"
+#include "Device/Profiler.h"
+
+#include "Resource/MaterialResource.h"
 #include "Resource/MeshResource.h"
 #include "Resource/ResourceManager.h"
 #include "Resource/SpriteResource.h"
+#include "Resource/TextureResource.h"
+#include "Resource/TextureStreamer.h"
 
 #include "World/DebugLine.h"
 #include "World/Material.h"
@@ -21,6 +27,50 @@
 namespace Rio
 {
 
+namespace RenderWorldInternalFn
+{
+	// Fraction of the tolerated error by which a LOD switch must be exceeded, avoids popping back and forth
+	const float LOD_HYSTERESIS = 0.25f;
+
+	// Returns the coarsest LOD of <meshGeometry> whose error, scaled by <errorToScreen>, is tolerated
+	static uint32_t selectLod(const MeshGeometry& meshGeometry, uint32_t currentLod, float errorToScreen)
+	{
+		for (uint32_t lod = meshGeometry.lodCount - 1; lod > 0; --lod)
+		{
+			// Coarser LODs must be well under the tolerance, the current and finer ones are kept longer
+			const float tolerance = lod > currentLod
+				? RIO_MESH_LOD_SCREEN_ERROR * (1.0f - LOD_HYSTERESIS)
+				: RIO_MESH_LOD_SCREEN_ERROR * (1.0f + LOD_HYSTERESIS)
+				;
+			if (meshGeometry.lodList[lod].error * errorToScreen <= tolerance)
+			{
+				return lod;
+			}
+		}
+
+		return 0;
+	}
+
+	// Requests the mips of the textures of <material> when a world unit covers <pixelsPerUnit> pixels on screen
+	// Meshes are assumed to map their textures once over <unitsPerTexture>, the diameter of their bounds,
+	// sprites, with <unitsPerTexture> 0, have RIO_DEFAULT_PIXELS_PER_METER texels per unit
+	static void requestTextures(ResourceManager& resourceManager, TextureStreamer& textureStreamer, const Material& material, float pixelsPerUnit, float unitsPerTexture)
+	{
+		const MaterialResource* materialResource = material.materialResource;
+		for (uint32_t i = 0; i < materialResource->textureListCount; ++i)
+		{
+			const TextureData* textureData = MaterialResourceFn::getTextureData(materialResource, i);
+			TextureResource* textureResource = (TextureResource*)resourceManager.get(RESOURCE_TYPE_TEXTURE, textureData->id);
+
+			const float textureUnits = unitsPerTexture > 0.0f
+				? unitsPerTexture
+				: float(textureResource->width) / RIO_DEFAULT_PIXELS_PER_METER
+				;
+			textureStreamer.request(*textureResource, textureUnits * pixelsPerUnit);
+		}
+	}
+} // namespace RenderWorldInternalFn
+
 RenderWorld::RenderWorld(Allocator& a, ResourceManager& resourceManager, ShaderManager& shaderManager, MaterialManager& materialManager, UnitManager& unitManager)
 	: marker(RENDER_WORLD_MARKER)
 	, allocator(&a)
@@ -32,11 +82,12 @@ RenderWorld::RenderWorld(Allocator& a, ResourceManager& resourceManager, ShaderM
 	, spriteManager(a)
 	, lightManager(a)
 {
-	unitManager.registerDestroyFunction(RenderWorld::unitDestroyedCallback, this);
+	unitManager.registerDestroyFunction(RenderWorld::unitDestroyedCallback, this, RenderWorld::unitsDestroyedCallback);
 
 	uniformLightPosition = bgfx::createUniform("uniformLightPosition", bgfx::UniformType::Vec4);
 	uniformLightDirection = bgfx::createUniform("uniformLightDirection", bgfx::UniformType::Vec4);
 	uniformLightColor = bgfx::createUniform("uniformLightColor", bgfx::UniformType::Vec4);
+	uniformPositionDecode = bgfx::createUniform("uniformPositionDecode", bgfx::UniformType::Vec4, 2);
 }
 
 RenderWorld::~RenderWorld()
@@ -46,10 +97,7 @@ RenderWorld::~RenderWorld()
 	bgfx::destroyUniform(uniformLightPosition);
 	bgfx::destroyUniform(uniformLightDirection);
 	bgfx::destroyUniform(uniformLightColor);
-
-	meshManager.destroy();
-	spriteManager.destroy();
-	lightManager.destroy();
+	bgfx::destroyUniform(uniformPositionDecode);
 
 	marker = 0;
 }
@@ -63,6 +111,19 @@ MeshInstance RenderWorld::meshCreate(UnitId id, const MeshRendererDesc& meshRend
 	return meshManager.create(id, meshResource, meshGeometry, meshRendererDesc.materialResource, transform);
 }
 
+void RenderWorld::meshCreate(uint32_t count, const UnitId* unitIdList, const MeshRendererDesc& meshRendererDesc, const Matrix4x4* transformList)
+{
+	const MeshResource* meshResource = (const MeshResource*)resourceManager->get(RESOURCE_TYPE_MESH, meshRendererDesc.meshResource);
+	const MeshGeometry* meshGeometry = meshResource->getMeshGeometry(meshRendererDesc.geometryName);
+	materialManager->createMaterial(meshRendererDesc.materialResource);
+
+	meshManager.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		meshManager.create(unitIdList[i], meshResource, meshGeometry, meshRendererDesc.materialResource, transformList[i]);
+	}
+}
+
 void RenderWorld::meshDestroy(MeshInstance i)
 {
 	meshManager.destroy(i);
@@ -85,9 +146,43 @@ void RenderWorld::meshSetMaterial(MeshInstance i, StringId64 id)
 	meshManager.data.material[i.i] = id;
 }
 
+void RenderWorld::meshSetMaterial(uint32_t count, const MeshInstance* meshInstanceList, StringId64 id)
+{
+	materialManager->createMaterial(id);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t index = meshInstanceList[i].i;
+		RIO_ASSERT(index < meshManager.data.size, "Index out of bounds");
+		if (index < meshManager.data.size)
+		{
+			meshManager.data.material[index] = id;
+		}
+	}
+}
+
 void RenderWorld::meshSetVisible(MeshInstance i, bool visible)
 {
 	RIO_ASSERT(i.i < meshManager.data.size, "Index out of bounds");
+	meshManager.data.visible[i.i] = visible;
+}
+
+void RenderWorld::meshSetVisible(uint32_t count, const MeshInstance* meshInstanceList, const bool* visibleList)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t index = meshInstanceList[i].i;
+		RIO_ASSERT(index < meshManager.data.size, "Index out of bounds");
+		if (index < meshManager.data.size)
+		{
+			meshManager.data.visible[index] = visibleList[i];
+		}
+	}
+}
+
+uint32_t RenderWorld::meshGetCount() const
+{
+	return meshManager.data.size;
 }
 
 Obb RenderWorld::meshGetObb(MeshInstance i)
@@ -107,13 +202,39 @@ float RenderWorld::meshGetRaycast(MeshInstance i, const Vector3& from, const Vec
 {
 	RIO_ASSERT(i.i < meshManager.data.size, "Index out of bounds");
 	const MeshGeometry* meshGeometry = meshManager.data.geometry[i.i];
+
+	const char* vertices = meshGeometry->vertices.data;
+	uint32_t stride = meshGeometry->vertices.stride;
+
+	// Quantized positions are decoded for the test
+	Array<Vector3> positionList(*allocator);
+	if (meshGeometry->positionFormat != MeshPositionFormat::FLOAT)
+	{
+		ArrayFn::resize(positionList, meshGeometry->vertices.verticesCount);
+		MeshResourceFn::decodePositions(*meshGeometry, ArrayFn::begin(positionList));
+		vertices = (const char*)ArrayFn::begin(positionList);
+		stride = sizeof(Vector3);
+	}
+
+	if (meshGeometry->indices.stride == sizeof(uint32_t))
+	{
+		return getRayMeshIntersection(from
+			, direction
+			, meshManager.data.world[i.i]
+			, vertices
+			, stride
+			, (const uint32_t*)meshGeometry->indices.data
+			, meshGeometry->lodList[0].indexCount
+			);
+	}
+
 	return getRayMeshIntersection(from
 		, direction
 		, meshManager.data.world[i.i]
-		, meshGeometry->vertices.data
-		, meshGeometry->vertices.stride
-		, (uint16_t*)meshGeometry->indices.data
-		, meshGeometry->indices.indicesCount
+		, vertices
+		, stride
+		, (const uint16_t*)meshGeometry->indices.data
+		, meshGeometry->lodList[0].indexCount
 		);
 }
 
@@ -125,6 +246,18 @@ SpriteInstance RenderWorld::spriteCreate(UnitId id, const SpriteRendererDesc& sp
 	return spriteManager.create(id, spriteResource, spriteRendererDesc.materialResource, transform);
 }
 
+void RenderWorld::spriteCreate(uint32_t count, const UnitId* unitIdList, const SpriteRendererDesc& spriteRendererDesc, const Matrix4x4* transformList)
+{
+	const SpriteResource* spriteResource = (const SpriteResource*)resourceManager->get(RESOURCE_TYPE_SPRITE, spriteRendererDesc.spriteResourceName);
+	materialManager->createMaterial(spriteRendererDesc.materialResource);
+
+	spriteManager.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		spriteManager.create(unitIdList[i], spriteResource, spriteRendererDesc.materialResource, transformList[i]);
+	}
+}
+
 void RenderWorld::spriteDestroy(SpriteInstance i)
 {
 	RIO_ASSERT(i.i < spriteManager.data.size, "Index out of bounds");
@@ -158,6 +291,15 @@ LightInstance RenderWorld::lightCreate(UnitId id, const LightDesc& lightDesc, co
 	return lightManager.create(id, lightDesc, transform);
 }
 
+void RenderWorld::lightCreate(uint32_t count, const UnitId* unitIdList, const LightDesc& lightDesc, const Matrix4x4* transformList)
+{
+	lightManager.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lightManager.create(unitIdList[i], lightDesc, transformList[i]);
+	}
+}
+
 void RenderWorld::lightDestroy(LightInstance i)
 {
 	RIO_ASSERT(i.i < lightManager.data.size, "Index out of bounds");
@@ -263,6 +405,56 @@ void RenderWorld::render(const Matrix4x4& view, const Matrix4x4& projection)
 	SpriteManager::SpriteInstanceData& spriteInstanceData = spriteManager.data;
 	LightManager::LightInstanceData& lightInstanceData = lightManager.data;
 
+	// Pick the LOD of each mesh and the mips of its textures from its projected size
+	// Perspective projections shrink the sizes with the distance, orthographic ones do not
+	const Vector3 cameraPosition = getTranslation(getInverted(view));
+	const bool isPerspective = projection.t.w == 0.0f;
+	const float screenScale = projection.y.y * 0.5f;
+
+	uint16_t viewportWidth;
+	uint16_t viewportHeight;
+	getDevice()->getResolution(viewportWidth, viewportHeight);
+	TextureStreamer& textureStreamer = *getDevice()->getTextureStreamer();
+
+	uint32_t triangleCount = 0;
+	for (uint32_t i = 0; i < meshInstanceData.firstHidden; ++i)
+	{
+		if (!meshInstanceData.visible[i])
+		{
+			continue;
+		}
+
+		const MeshGeometry& meshGeometry = *meshInstanceData.geometry[i];
+
+		const Matrix4x4& world = meshInstanceData.world[i];
+		const Vector3 scale = getScale(world);
+		const float maxScale = getMaxFloat(scale.x, getMaxFloat(scale.y, scale.z));
+		const float radius = getLength(meshInstanceData.obb[i].halfExtents) * maxScale;
+		float errorToScreen = screenScale * maxScale;
+
+		if (isPerspective)
+		{
+			const Vector3 center = getTranslation(meshInstanceData.obb[i].transformMatrix * world);
+			const float distance = getMaxFloat(getLength(center - cameraPosition) - radius, 0.0001f);
+			errorToScreen /= distance;
+		}
+
+		// <errorToScreen> is the fraction of the screen height covered by a unit of the mesh
+		RenderWorldInternalFn::requestTextures(*resourceManager
+			, textureStreamer
+			, *materialManager->get(meshInstanceData.material[i])
+			, errorToScreen / maxScale * viewportHeight
+			, 2.0f * radius
+			);
+
+		if (meshGeometry.lodCount >= 2)
+		{
+			meshInstanceData.lod[i] = RenderWorldInternalFn::selectLod(meshGeometry, meshInstanceData.lod[i], errorToScreen);
+		}
+		triangleCount += meshGeometry.lodList[meshInstanceData.lod[i]].indexCount / 3;
+	}
+	RECORD_FLOAT("renderWorld.meshTriangles", float(triangleCount));
+
 	for (uint32_t lightInstanceIndex = 0; lightInstanceIndex < lightInstanceData.size; ++lightInstanceIndex)
 	{
 		const Vector4 ligthDirection = normalize(lightInstanceData.world[lightInstanceIndex].z) * view;
@@ -275,9 +467,16 @@ void RenderWorld::render(const Matrix4x4& view, const Matrix4x4& projection)
 		// Render meshes
 		for (uint32_t i = 0; i < meshInstanceData.firstHidden; ++i)
 		{
+			if (!meshInstanceData.visible[i])
+			{
+				continue;
+			}
+
 			bgfx::setTransform(getFloatPointer(meshInstanceData.world[i]));
+			bgfx::setUniform(uniformPositionDecode, meshInstanceData.geometry[i]->positionDecode, 2);
+			const MeshLod& meshLod = meshInstanceData.geometry[i]->lodList[meshInstanceData.lod[i]];
 			bgfx::setVertexBuffer(meshInstanceData.mesh[i].vertexBufferHandle);
-			bgfx::setIndexBuffer(meshInstanceData.mesh[i].indexBufferHandle);
+			bgfx::setIndexBuffer(meshInstanceData.mesh[i].indexBufferHandle, meshLod.indexOffset, meshLod.indexCount);
 
 			materialManager->get(meshInstanceData.material[i])->bind(*resourceManager, *shaderManager);
 		}
@@ -286,11 +485,21 @@ void RenderWorld::render(const Matrix4x4& view, const Matrix4x4& projection)
 	// Render sprites
 	for (uint32_t i = 0; i < spriteInstanceData.firstHidden; ++i)
 	{
+		const Vector3 scale = getScale(spriteInstanceData.world[i]);
+		float pixelsPerUnit = screenScale * getMaxFloat(scale.x, scale.y) * viewportHeight;
+		if (isPerspective)
+		{
+			pixelsPerUnit /= getMaxFloat(getLength(getTranslation(spriteInstanceData.world[i]) - cameraPosition), 0.0001f);
+		}
+
+		const Material& material = *materialManager->get(spriteInstanceData.material[i]);
+		RenderWorldInternalFn::requestTextures(*resourceManager, textureStreamer, material, pixelsPerUnit, 0.0f);
+
 		bgfx::setVertexBuffer(spriteInstanceData.sprite[i].vertexBufferHandle);
 		bgfx::setIndexBuffer(spriteInstanceData.sprite[i].indexBufferHandle, spriteInstanceData.frame[i] * 6, 6);
 		bgfx::setTransform(getFloatPointer(spriteInstanceData.world[i]));
 
-		materialManager->get(spriteInstanceData.material[i])->bind(*resourceManager, *shaderManager);
+		material.bind(*resourceManager, *shaderManager);
 	}
 }
 
@@ -393,65 +602,53 @@ void RenderWorld::unitDestroyedCallback(UnitId id)
 	}
 }
 
-void RenderWorld::MeshManager::allocate(uint32_t meshInstancesCount)
+void RenderWorld::unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count)
 {
-	RIO_ENSURE(num > this->data.size);
-
-	const uint32_t bytes = 0
-		+ meshInstancesCount * sizeof(UnitId) + alignof(UnitId)
-		+ meshInstancesCount * sizeof(MeshResource*) + alignof(MeshResource*)
-		+ meshInstancesCount * sizeof(MeshGeometry*) + alignof(MeshGeometry*)
-		+ meshInstancesCount * sizeof(MeshData) + alignof(MeshData)
-		+ meshInstancesCount * sizeof(StringId64) + alignof(StringId64)
-		+ meshInstancesCount * sizeof(Matrix4x4) + alignof(Matrix4x4)
-		+ meshInstancesCount * sizeof(Obb) + alignof(Obb)
-		+ meshInstancesCount * sizeof(MeshInstance) + alignof(MeshInstance)
-		;
-
-	MeshInstanceData newMeshInstanceData;
-	newMeshInstanceData.size = this->data.size;
-	newMeshInstanceData.capacity = meshInstancesCount;
-	newMeshInstanceData.buffer = allocator->allocate(bytes);
-	newMeshInstanceData.firstHidden = this->data.firstHidden;
-
-	newMeshInstanceData.unit = (UnitId*)(newMeshInstanceData.buffer);
-
-	newMeshInstanceData.resource = (const MeshResource**)MemoryFn::alignTop(newMeshInstanceData.unit + meshInstancesCount, alignof(const MeshResource*));
-	newMeshInstanceData.geometry = (const MeshGeometry**)MemoryFn::alignTop(newMeshInstanceData.resource + meshInstancesCount, alignof(const MeshGeometry*));
-	newMeshInstanceData.mesh = (MeshData*)MemoryFn::alignTop(newMeshInstanceData.geometry + meshInstancesCount, alignof(MeshData));
-	newMeshInstanceData.material = (StringId64*)MemoryFn::alignTop(newMeshInstanceData.mesh + meshInstancesCount, alignof(StringId64));
-	newMeshInstanceData.world = (Matrix4x4*)MemoryFn::alignTop(newMeshInstanceData.material + meshInstancesCount, alignof(Matrix4x4));
-	newMeshInstanceData.obb = (Obb*)MemoryFn::alignTop(newMeshInstanceData.world + meshInstancesCount, alignof(Obb));
-	newMeshInstanceData.nextInstance = (MeshInstance*)MemoryFn::alignTop(newMeshInstanceData.obb + meshInstancesCount, alignof(MeshInstance));
+	const uint32_t meshUnitsCount = ComponentStorageFn::getUnitsWithInstanceCount(meshManager.data, unitIdList, count);
+	const uint32_t spriteUnitsCount = ComponentStorageFn::getUnitsWithInstanceCount(spriteManager.data, unitIdList, count);
+	const uint32_t lightUnitsCount = ComponentStorageFn::getUnitsWithInstanceCount(lightManager.data, unitIdList, count);
+	const uint32_t unitsCount = meshUnitsCount + spriteUnitsCount + lightUnitsCount;
+	if (unitsCount == 0)
+	{
+		return;
+	}
 
-	memcpy(newMeshInstanceData.unit, this->data.unit, this->data.size * sizeof(UnitId));
-	memcpy(newMeshInstanceData.resource, this->data.resource, this->data.size * sizeof(MeshResource*));
-	memcpy(newMeshInstanceData.geometry, this->data.geometry, this->data.size * sizeof(MeshGeometry*));
-	memcpy(newMeshInstanceData.mesh, this->data.mesh, this->data.size * sizeof(MeshData));
-	memcpy(newMeshInstanceData.material, this->data.material, this->data.size * sizeof(StringId64));
-	memcpy(newMeshInstanceData.world, this->data.world, this->data.size * sizeof(Matrix4x4));
-	memcpy(newMeshInstanceData.obb, this->data.obb, this->data.size * sizeof(Obb));
-	memcpy(newMeshInstanceData.nextInstance, this->data.nextInstance, this->data.size * sizeof(MeshInstance));
+	// Swap-removing the instances of a few units is cheaper than compacting all of them
+	const uint32_t instancesCount = meshManager.data.size + spriteManager.data.size + lightManager.data.size;
+	if (unitsCount * RIO_COMPONENT_COMPACT_FRACTION < instancesCount)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			unitDestroyedCallback(unitIdList[i]);
+		}
+		return;
+	}
 
-	allocator->deallocate(this->data.buffer);
-	this->data = newMeshInstanceData;
+	// The units are not alive anymore, which is cheaper to check than looking each of them up
+	if (meshUnitsCount != 0)
+	{
+		meshManager.destroyDead(*unitManager);
+	}
+	if (spriteUnitsCount != 0)
+	{
+		spriteManager.destroyDead(*unitManager);
+	}
+	if (lightUnitsCount != 0)
+	{
+		lightManager.destroyDead(*unitManager);
+	}
 }
 
-void RenderWorld::MeshManager::grow()
+void RenderWorld::MeshManager::reserve(uint32_t meshInstancesCount)
 {
-	allocate(this->data.capacity * 2 + 1);
+	ComponentStorageFn::reserve(this->data, meshInstancesCount);
 }
 
 MeshInstance RenderWorld::MeshManager::create(UnitId id, const MeshResource* meshResource, const MeshGeometry* meshGeometry, StringId64 material, const Matrix4x4& transform)
 {
-	if (this->data.size == this->data.capacity)
-	{
-		grow();
-	}
+	const MeshInstance first = getFirst(id);
+	const uint32_t last = ComponentStorageFn::create(this->data, id);
 
-	const uint32_t last = this->data.size;
-
-	this->data.unit[last] = id;
 	this->data.resource[last] = meshResource;
 	this->data.geometry[last] = meshGeometry;
 	this->data.mesh[last].vertexBufferHandle = meshGeometry->vertexBufferHandle;
@@ -459,19 +656,15 @@ MeshInstance RenderWorld::MeshManager::create(UnitId id, const MeshResource* mes
 	this->data.material[last] = material;
 	this->data.world[last] = transform;
 	this->data.obb[last] = meshGeometry->obb;
+	this->data.lod[last] = 0;
+	this->data.visible[last] = true;
 	this->data.nextInstance[last] = makeInstance(UINT32_MAX);
 
-	++this->data.size;
 	++this->data.firstHidden;
 
-	MeshInstance current = getFirst(id);
-	if (getIsValid(current) == false)
+	if (getIsValid(first))
 	{
-		HashMapFn::set(unitIdToMeshMap, id, last);
-	}
-	else
-	{
-		addNode(current, makeInstance(last));
+		addNode(first, makeInstance(last));
 	}
 
 	return makeInstance(last);
@@ -481,26 +674,42 @@ void RenderWorld::MeshManager::destroy(MeshInstance i)
 {
 	RIO_ASSERT(i.i < this->data.size, "Index out of bounds");
 
-	const uint32_t last = this->data.size - 1;
-	const UnitId unitId = this->data.unit[i.i];
-	const MeshInstance firstMeshInstance = getFirst(unitId);
-	const MeshInstance lastMeshInstance = makeInstance(last);
-
-	swapNode(lastMeshInstance, i);
-	removeNode(firstMeshInstance, i);
-
-	this->data.unit[i.i] = this->data.unit[last];
-	this->data.resource[i.i] = this->data.resource[last];
-	this->data.geometry[i.i] = this->data.geometry[last];
-	this->data.mesh[i.i].vertexBufferHandle = this->data.mesh[last].vertexBufferHandle;
-	this->data.mesh[i.i].indexBufferHandle = this->data.mesh[last].indexBufferHandle;
-	this->data.material[i.i] = this->data.material[last];
-	this->data.world[i.i] = this->data.world[last];
-	this->data.obb[i.i] = this->data.obb[last];
-	this->data.nextInstance[i.i] = this->data.nextInstance[last];
-
-	--this->data.size;
+	removeNode(getFirst(this->data.unit[i.i]), i);
+
+	const uint32_t moved = ComponentStorageFn::destroy(this->data, i.i);
 	--this->data.firstHidden;
+
+	// The link to the instance moved in place of <i> follows it, the first instance of a unit is already found there
+	if (moved != UINT32_MAX)
+	{
+		MeshInstance current = getFirst(this->data.unit[i.i]);
+		if (current.i != i.i)
+		{
+			while (getNext(current).i != moved)
+			{
+				current = getNext(current);
+			}
+			this->data.nextInstance[current.i] = i;
+		}
+	}
+}
+
+void RenderWorld::MeshManager::destroyDead(const UnitManager& unitManager)
+{
+	const uint32_t size = this->data.size;
+	ComponentStorageFn::destroyDead(this->data, unitManager);
+	this->data.firstHidden -= size - this->data.size;
+
+	// Walking backwards links the meshes of each unit in index order
+	for (uint32_t i = 0; i < this->data.size; ++i)
+	{
+		ComponentStorageFn::setInstance(this->data, this->data.unit[i], UINT32_MAX);
+	}
+	for (uint32_t i = this->data.size; i-- > 0; )
+	{
+		this->data.nextInstance[i] = getFirst(this->data.unit[i]);
+		ComponentStorageFn::setInstance(this->data, this->data.unit[i], i);
+	}
 }
 
 bool RenderWorld::MeshManager::has(UnitId id)
@@ -510,7 +719,7 @@ bool RenderWorld::MeshManager::has(UnitId id)
 
 MeshInstance RenderWorld::MeshManager::getFirst(UnitId id)
 {
-	return makeInstance(HashMapFn::get(unitIdToMeshMap, id, UINT32_MAX));
+	return makeInstance(ComponentStorageFn::getInstance(this->data, id));
 }
 
 MeshInstance RenderWorld::MeshManager::getNext(MeshInstance i)
@@ -560,14 +769,7 @@ void RenderWorld::MeshManager::removeNode(MeshInstance first, MeshInstance i)
 
 	if (i.i == first.i)
 	{
-		if (!getIsValid(getNext(i)))
-		{
-			HashMapFn::set(unitIdToMeshMap, u, UINT32_MAX);
-		}
-		else
-		{
-			HashMapFn::set(unitIdToMeshMap, u, getNext(i).i);
-		}
+		ComponentStorageFn::setInstance(this->data, u, getNext(i).i);
 	}
 	else
 	{
@@ -576,89 +778,15 @@ void RenderWorld::MeshManager::removeNode(MeshInstance first, MeshInstance i)
 	}
 }
 
-void RenderWorld::MeshManager::swapNode(MeshInstance a, MeshInstance b)
-{
-	RIO_ASSERT(a.i < this->data.size, "Index out of bounds");
-	RIO_ASSERT(b.i < this->data.size, "Index out of bounds");
-
-	const UnitId unitId = this->data.unit[a.i];
-	const MeshInstance firstMeshInstance = getFirst(unitId);
-
-	if (a.i == firstMeshInstance.i)
-	{
-		HashMapFn::set(unitIdToMeshMap, unitId, b.i);
-	}
-	else
-	{
-		const MeshInstance prevA = getPrev(a);
-		RIO_ENSURE(prevA.i != a.i);
-		this->data.nextInstance[prevA.i] = b;
-	}
-}
-
-void RenderWorld::MeshManager::destroy()
-{
-	allocator->deallocate(this->data.buffer);
-}
-
-void RenderWorld::SpriteManager::allocate(uint32_t spriteInstancesCount)
+void RenderWorld::SpriteManager::reserve(uint32_t spriteInstancesCount)
 {
-	RIO_ENSURE(spriteInstancesCount > this->data.size);
-
-	const uint32_t bytes = 0
-		+ spriteInstancesCount + sizeof(UnitId) + alignof(UnitId)
-		+ spriteInstancesCount + sizeof(SpriteResource**) + alignof(SpriteResource*)
-		+ spriteInstancesCount + sizeof(SpriteData) + alignof(SpriteData)
-		+ spriteInstancesCount + sizeof(StringId64) + alignof(StringId64)
-		+ spriteInstancesCount + sizeof(uint32_t) + alignof(uint32_t)
-		+ spriteInstancesCount + sizeof(Matrix4x4) + alignof(Matrix4x4)
-		+ spriteInstancesCount + sizeof(Aabb) + alignof(Aabb)
-		+ spriteInstancesCount + sizeof(SpriteInstance) + alignof(SpriteInstance)
-		;
-
-	SpriteInstanceData newSpriteInstanceData;
-	newSpriteInstanceData.size = this->data.size;
-	newSpriteInstanceData.capacity = spriteInstancesCount;
-	newSpriteInstanceData.buffer = allocator->allocate(bytes);
-	newSpriteInstanceData.firstHidden = this->data.firstHidden;
-
-	newSpriteInstanceData.unit = (UnitId*)(newSpriteInstanceData.buffer);
-	newSpriteInstanceData.resource = (const SpriteResource**)MemoryFn::alignTop(newSpriteInstanceData.unit + spriteInstancesCount, alignof(const SpriteResource*));
-	newSpriteInstanceData.sprite = (SpriteData*)MemoryFn::alignTop(newSpriteInstanceData.resource + spriteInstancesCount, alignof(SpriteData));
-	newSpriteInstanceData.material = (StringId64*)MemoryFn::alignTop(newSpriteInstanceData.sprite + spriteInstancesCount, alignof(StringId64));
-	newSpriteInstanceData.frame = (uint32_t*)MemoryFn::alignTop(newSpriteInstanceData.material + spriteInstancesCount, alignof(uint32_t));
-	newSpriteInstanceData.world = (Matrix4x4*)MemoryFn::alignTop(newSpriteInstanceData.frame + spriteInstancesCount, alignof(Matrix4x4));
-	newSpriteInstanceData.aabb = (Aabb*)MemoryFn::alignTop(newSpriteInstanceData.world + spriteInstancesCount, alignof(Aabb));
-	newSpriteInstanceData.nextInstance = (SpriteInstance*)MemoryFn::alignTop(newSpriteInstanceData.aabb + spriteInstancesCount, alignof(SpriteInstance));
-
-	memcpy(newSpriteInstanceData.unit, this->data.unit, this->data.size * sizeof(UnitId));
-	memcpy(newSpriteInstanceData.resource, this->data.resource, this->data.size * sizeof(SpriteResource**));
-	memcpy(newSpriteInstanceData.sprite, this->data.sprite, this->data.size * sizeof(SpriteData));
-	memcpy(newSpriteInstanceData.material, this->data.material, this->data.size * sizeof(StringId64));
-	memcpy(newSpriteInstanceData.frame, this->data.frame, this->data.size * sizeof(uint32_t));
-	memcpy(newSpriteInstanceData.world, this->data.world, this->data.size * sizeof(Matrix4x4));
-	memcpy(newSpriteInstanceData.aabb, this->data.aabb, this->data.size * sizeof(Aabb));
-	memcpy(newSpriteInstanceData.nextInstance, this->data.nextInstance, this->data.size * sizeof(SpriteInstance));
-
-	allocator->deallocate(this->data.buffer);
-	this->data = newSpriteInstanceData;
-}
-
-void RenderWorld::SpriteManager::grow()
-{
-	allocate(this->data.capacity * 2 + 1);
+	ComponentStorageFn::reserve(this->data, spriteInstancesCount);
 }
 
 SpriteInstance RenderWorld::SpriteManager::create(UnitId id, const SpriteResource* spriteResource, StringId64 material, const Matrix4x4& transform)
 {
-	if (this->data.size == this->data.capacity)
-	{
-		grow();
-	}
+	const uint32_t last = ComponentStorageFn::create(this->data, id);
 
-	const uint32_t last = this->data.size;
-
-	this->data.unit[last] = id;
 	this->data.resource[last] = spriteResource;
 	this->data.sprite[last].vertexBufferHandle = spriteResource->vertexBufferHandle;
 	this->data.sprite[last].indexBufferHandle = spriteResource->indexBufferHandle;
@@ -668,37 +796,22 @@ SpriteInstance RenderWorld::SpriteManager::create(UnitId id, const SpriteResourc
 	this->data.aabb[last] = Aabb();
 	this->data.nextInstance[last] = makeInstance(UINT32_MAX);
 
-	++this->data.size;
 	++this->data.firstHidden;
 
-	HashMapFn::set(unitIdToSpriteMap, id, last);
-
 	return makeInstance(last);
 }
 
 void RenderWorld::SpriteManager::destroy(SpriteInstance i)
 {
-	RIO_ASSERT(i.i < this->data.size, "Index out of bounds");
-
-	const uint32_t last = this->data.size - 1;
-	const UnitId unitId = this->data.unit[i.i];
-	const UnitId lastUnitId = this->data.unit[last];
-
-	this->data.unit[i.i] = this->data.unit[last];
-	this->data.resource[i.i] = this->data.resource[last];
-	this->data.sprite[i.i].vertexBufferHandle = this->data.sprite[last].vertexBufferHandle;
-	this->data.sprite[i.i].indexBufferHandle = this->data.sprite[last].indexBufferHandle;
-	this->data.material[i.i] = this->data.material[last];
-	this->data.frame[i.i] = this->data.frame[last];
-	this->data.world[i.i] = this->data.world[last];
-	this->data.aabb[i.i] = this->data.aabb[last];
-	this->data.nextInstance[i.i] = this->data.nextInstance[last];
-
-	--this->data.size;
+	ComponentStorageFn::destroy(this->data, i.i);
 	--this->data.firstHidden;
+}
 
-	HashMapFn::set(unitIdToSpriteMap, lastUnitId, i.i);
-	HashMapFn::remove(unitIdToSpriteMap, unitId);
+void RenderWorld::SpriteManager::destroyDead(const UnitManager& unitManager)
+{
+	const uint32_t size = this->data.size;
+	ComponentStorageFn::destroyDead(this->data, unitManager);
+	this->data.firstHidden -= size - this->data.size;
 }
 
 bool RenderWorld::SpriteManager::has(UnitId id)
@@ -708,70 +821,20 @@ bool RenderWorld::SpriteManager::has(UnitId id)
 
 SpriteInstance RenderWorld::SpriteManager::getSprite(UnitId id)
 {
-	return makeInstance(HashMapFn::get(unitIdToSpriteMap, id, UINT32_MAX));
+	return makeInstance(ComponentStorageFn::getInstance(this->data, id));
 }
 
-void RenderWorld::SpriteManager::destroy()
+void RenderWorld::LightManager::reserve(uint32_t lightInstancesCount)
 {
-	allocator->deallocate(this->data.buffer);
-}
-
-void RenderWorld::LightManager::allocate(uint32_t lightInstancesCount)
-{
-	RIO_ENSURE(lightInstancesCount > this->data.size);
-
-	const uint32_t bytes = 0
-		+ lightInstancesCount * sizeof(UnitId) + alignof(UnitId)
-		+ lightInstancesCount * sizeof(Matrix4x4) + alignof(Matrix4x4)
-		+ lightInstancesCount * sizeof(float) + alignof(float)
-		+ lightInstancesCount * sizeof(float) + alignof(float)
-		+ lightInstancesCount * sizeof(float) + alignof(float)
-		+ lightInstancesCount * sizeof(Color4) + alignof(Color4)
-		+ lightInstancesCount * sizeof(uint32_t) + alignof(uint32_t)
-		;
-
-	LightInstanceData newLightInstanceData;
-	newLightInstanceData.size = this->data.size;
-	newLightInstanceData.capacity = lightInstancesCount;
-	newLightInstanceData.buffer = allocator->allocate(bytes);
-
-	newLightInstanceData.unit = (UnitId*)(newLightInstanceData.buffer);
-	newLightInstanceData.world = (Matrix4x4*)MemoryFn::alignTop(newLightInstanceData.unit + lightInstancesCount, alignof(Matrix4x4));
-	newLightInstanceData.range = (float*)MemoryFn::alignTop(newLightInstanceData.world + lightInstancesCount, alignof(float));
-	newLightInstanceData.intensity = (float*)MemoryFn::alignTop(newLightInstanceData.range + lightInstancesCount, alignof(float));
-	newLightInstanceData.spotAngle = (float*)MemoryFn::alignTop(newLightInstanceData.intensity + lightInstancesCount, alignof(float));
-	newLightInstanceData.color = (Color4*)MemoryFn::alignTop(newLightInstanceData.spotAngle + lightInstancesCount, alignof(Color4));
-	newLightInstanceData.type = (uint32_t*)MemoryFn::alignTop(newLightInstanceData.color + lightInstancesCount, alignof(uint32_t));
-
-	memcpy(newLightInstanceData.unit, this->data.unit, this->data.size * sizeof(UnitId));
-	memcpy(newLightInstanceData.world, this->data.world, this->data.size * sizeof(Matrix4x4));
-	memcpy(newLightInstanceData.range, this->data.range, this->data.size * sizeof(float));
-	memcpy(newLightInstanceData.intensity, this->data.intensity, this->data.size * sizeof(float));
-	memcpy(newLightInstanceData.spotAngle, this->data.spotAngle, this->data.size * sizeof(float));
-	memcpy(newLightInstanceData.color, this->data.color, this->data.size * sizeof(Color4));
-	memcpy(newLightInstanceData.type, this->data.type, this->data.size * sizeof(uint32_t));
-
-	allocator->deallocate(this->data.buffer);
-	this->data = newLightInstanceData;
-}
-
-void RenderWorld::LightManager::grow()
-{
-	allocate(this->data.capacity * 2 + 1);
+	ComponentStorageFn::reserve(this->data, lightInstancesCount);
 }
 
 LightInstance RenderWorld::LightManager::create(UnitId id, const LightDesc& lightDesc, const Matrix4x4& transform)
 {
-	RIO_ASSERT(!HashMapFn::has(unitIdToLightMap, id), "Unit already has light");
-
-	if (this->data.size == this->data.capacity)
-	{
-		grow();
-	}
+	RIO_ASSERT(!has(id), "Unit already has light");
 
-	const uint32_t last = this->data.size;
+	const uint32_t last = ComponentStorageFn::create(this->data, id);
 
-	this->data.unit[last] = id;
 	this->data.world[last] = transform;
 	this->data.range[last] = lightDesc.range;
 	this->data.intensity[last] = lightDesc.intensity;
@@ -779,32 +842,17 @@ LightInstance RenderWorld::LightManager::create(UnitId id, const LightDesc& ligh
 	this->data.color[last] = createVector4(lightDesc.color.x, lightDesc.color.y, lightDesc.color.z, 1.0f);
 	this->data.type[last] = lightDesc.type;
 
-	++this->data.size;
-
-	HashMapFn::set(unitIdToLightMap, id, last);
 	return makeInstance(last);
 }
 
 void RenderWorld::LightManager::destroy(LightInstance i)
 {
-	RIO_ASSERT(i.i < this->data.size, "Index out of bounds");
-
-	const uint32_t last = this->data.size - 1;
-	const UnitId unitId = this->data.unit[i.i];
-	const UnitId lastUnitId = this->data.unit[last];
-
-	this->data.unit[i.i] = this->data.unit[last];
-	this->data.world[i.i] = this->data.world[last];
-	this->data.range[i.i] = this->data.range[last];
-	this->data.intensity[i.i] = this->data.intensity[last];
-	this->data.spotAngle[i.i] = this->data.spotAngle[last];
-	this->data.color[i.i] = this->data.color[last];
-	this->data.type[i.i] = this->data.type[last];
-
-	--this->data.size;
+	ComponentStorageFn::destroy(this->data, i.i);
+}
 
-	HashMapFn::set(unitIdToLightMap, lastUnitId, i.i);
-	HashMapFn::remove(unitIdToLightMap, unitId);
+void RenderWorld::LightManager::destroyDead(const UnitManager& unitManager)
+{
+	ComponentStorageFn::destroyDead(this->data, unitManager);
 }
 
 bool RenderWorld::LightManager::has(UnitId id)
@@ -814,12 +862,7 @@ bool RenderWorld::LightManager::has(UnitId id)
 
 LightInstance RenderWorld::LightManager::getLight(UnitId id)
 {
-	return makeInstance(HashMapFn::get(unitIdToLightMap, id, UINT32_MAX));
-}
-
-void RenderWorld::LightManager::destroy()
-{
-	allocator->deallocate(this->data.buffer);
+	return makeInstance(ComponentStorageFn::getInstance(this->data, id));
 }
 
 } // namespace Rio
@@ -8,6 +8,7 @@
 #include "Resource/ResourceTypes.h"
 #include "Resource/MeshResource.h"
 
+#include "World/ComponentStorage.h"
 #include "World/WorldTypes.h"
 
 #include <bgfx/bgfx.h>
@@ -24,14 +25,24 @@ public:
 	~RenderWorld();
 
 	MeshInstance meshCreate(UnitId id, const MeshRendererDesc& meshRendererDesc, const Matrix4x4& transform);
+	// Creates the mesh <meshRendererDesc> for each of the <count> units in <unitIdList>, at the matching pose in <transformList>
+	void meshCreate(uint32_t count, const UnitId* unitIdList, const MeshRendererDesc& meshRendererDesc, const Matrix4x4* transformList);
 	void meshDestroy(MeshInstance i);
 	void meshGetInstanceList(UnitId id, Array<MeshInstance>& instances);
 	void meshSetMaterial(MeshInstance i, StringId64 id);
+	// Sets the material <id> of the <count> meshes in <meshInstanceList>
+	void meshSetMaterial(uint32_t count, const MeshInstance* meshInstanceList, StringId64 id);
 	void meshSetVisible(MeshInstance i, bool visible);
+	// Sets the visibility of the <count> meshes in <meshInstanceList>, one flag each in <visibleList>
+	void meshSetVisible(uint32_t count, const MeshInstance* meshInstanceList, const bool* visibleList);
+	// Returns the number of mesh instances, valid instances are below it
+	uint32_t meshGetCount() const;
 	Obb meshGetObb(MeshInstance i);
 	float meshGetRaycast(MeshInstance i, const Vector3& from, const Vector3& direction);
 
 	SpriteInstance spriteCreate(UnitId id, const SpriteRendererDesc& spriteRendererDesc, const Matrix4x4& transform);
+	// Creates the sprite <spriteRendererDesc> for each of the <count> units in <unitIdList>, at the matching pose in <transformList>
+	void spriteCreate(uint32_t count, const UnitId* unitIdList, const SpriteRendererDesc& spriteRendererDesc, const Matrix4x4* transformList);
 	void spriteDestroy(SpriteInstance i);
 	// Returns the sprite instances of the unit <id>
 	SpriteInstance spriteGet(UnitId id);
@@ -40,6 +51,8 @@ public:
 	void spriteSetVisible(SpriteInstance i, bool visible);
 
 	LightInstance lightCreate(UnitId id, const LightDesc& lightDesc, const Matrix4x4& transform);
+	// Creates the light <lightDesc> for each of the <count> units in <unitIdList>, at the matching pose in <transformList>
+	void lightCreate(uint32_t count, const UnitId* unitIdList, const LightDesc& lightDesc, const Matrix4x4* transformList);
 	void lightDestroy(LightInstance i);
 	// Returns the light of the unit <id>
 	LightInstance lightGet(UnitId id);
@@ -79,6 +92,13 @@ private:
 
 	void unitDestroyedCallback(UnitId id);
 
+	static void unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count, void* userPtr)
+	{
+		((RenderWorld*)userPtr)->unitsDestroyedCallback(unitIdList, count);
+	}
+
+	void unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count);
+
 	struct MeshManager
 	{
 		struct MeshData
@@ -87,13 +107,15 @@ private:
 			bgfx::IndexBufferHandle indexBufferHandle;
 		};
 
-		struct MeshInstanceData
+		struct MeshInstanceData : public ComponentStorage<const MeshResource*, const MeshGeometry*, MeshData, StringId64, Matrix4x4, Obb, uint32_t, bool, MeshInstance>
 		{
-			uint32_t size;
-			uint32_t capacity;
-			void* buffer;
+			MeshInstanceData(Allocator& a)
+				: ComponentStorage(a)
+			{
+				ComponentStorageFn::bind(*this, &unit, &resource, &geometry, &mesh, &material, &world, &obb, &lod, &visible, &nextInstance);
+			}
 
-			uint32_t firstHidden;
+			uint32_t firstHidden = 0;
 
 			UnitId* unit;
 			const MeshResource** resource;
@@ -102,28 +124,29 @@ private:
 			StringId64* material;
 			Matrix4x4* world;
 			Obb* obb;
+			uint32_t* lod; // Index into the geometry lodList
+			bool* visible;
 			MeshInstance* nextInstance;
 		};
 
 		MeshManager(Allocator& a)
 			: allocator(&a)
-			, unitIdToMeshMap(a)
+			, data(a)
 		{
-			memset(&data, 0, sizeof(data));
 		}
 
-		void allocate(uint32_t meshInstancesCount);
-		void grow();
+		// Makes room for <meshInstancesCount> more instances
+		void reserve(uint32_t meshInstancesCount);
 		MeshInstance create(UnitId id, const MeshResource* meshResource, const MeshGeometry* meshGeometry, StringId64 material, const Matrix4x4& transform);
 		void destroy(MeshInstance i);
+		// Destroys the instances of the units not alive anymore, compacting the instances once
+		void destroyDead(const UnitManager& unitManager);
 		bool has(UnitId id);
 		MeshInstance getFirst(UnitId id);
 		MeshInstance getNext(MeshInstance i);
 		MeshInstance getPrev(MeshInstance i);
 		void addNode(MeshInstance first, MeshInstance i);
 		void removeNode(MeshInstance first, MeshInstance i);
-		void swapNode(MeshInstance a, MeshInstance b);
-		void destroy();
 
 		MeshInstance makeInstance(uint32_t i) 
 		{ 
@@ -136,7 +159,6 @@ private:
 		}
 
 		Allocator* allocator;
-		HashMap<UnitId, uint32_t> unitIdToMeshMap;
 		MeshInstanceData data;
 	};
 
@@ -148,13 +170,15 @@ private:
 			bgfx::IndexBufferHandle indexBufferHandle;
 		};
 
-		struct SpriteInstanceData
+		struct SpriteInstanceData : public ComponentStorage<const SpriteResource*, SpriteData, StringId64, uint32_t, Matrix4x4, Aabb, SpriteInstance>
 		{
-			uint32_t size;
-			uint32_t capacity;
-			void* buffer;
+			SpriteInstanceData(Allocator& a)
+				: ComponentStorage(a)
+			{
+				ComponentStorageFn::bind(*this, &unit, &resource, &sprite, &material, &frame, &world, &aabb, &nextInstance);
+			}
 
-			uint32_t firstHidden;
+			uint32_t firstHidden = 0;
 
 			UnitId* unit;
 			const SpriteResource** resource;
@@ -168,18 +192,18 @@ private:
 
 		SpriteManager(Allocator& a)
 			: allocator(&a)
-			, unitIdToSpriteMap(a)
+			, data(a)
 		{
-			memset(&data, 0, sizeof(data));
 		}
 
 		SpriteInstance create(UnitId id, const SpriteResource* spriteResource, StringId64 material, const Matrix4x4& transform);
 		void destroy(SpriteInstance i);
+		// Destroys the instances of the units not alive anymore, compacting the instances once
+		void destroyDead(const UnitManager& unitManager);
 		SpriteInstance getSprite(UnitId id);
 		bool has(UnitId id);
-		void allocate(uint32_t spriteInstancesCount);
-		void grow();
-		void destroy();
+		// Makes room for <spriteInstancesCount> more instances
+		void reserve(uint32_t spriteInstancesCount);
 
 		SpriteInstance makeInstance(uint32_t i) 
 		{ 
@@ -192,17 +216,18 @@ private:
 		}
 
 		Allocator* allocator;
-		HashMap<UnitId, uint32_t> unitIdToSpriteMap;
 		SpriteInstanceData data;
 	};
 
 	struct LightManager
 	{
-		struct LightInstanceData
+		struct LightInstanceData : public ComponentStorage<Matrix4x4, float, float, float, Color4, uint32_t>
 		{
-			uint32_t size;
-			uint32_t capacity;
-			void* buffer;
+			LightInstanceData(Allocator& a)
+				: ComponentStorage(a)
+			{
+				ComponentStorageFn::bind(*this, &unit, &world, &range, &intensity, &spotAngle, &color, &type);
+			}
 
 			UnitId* unit;
 			Matrix4x4* world;
@@ -215,18 +240,18 @@ private:
 
 		LightManager(Allocator& a)
 			: allocator(&a)
-			, unitIdToLightMap(a)
+			, data(a)
 		{
-			memset(&data, 0, sizeof(data));
 		}
 
 		LightInstance create(UnitId id, const LightDesc& lightDesc, const Matrix4x4& transform);
 		void destroy(LightInstance i);
+		// Destroys the instances of the units not alive anymore, compacting the instances once
+		void destroyDead(const UnitManager& unitManager);
 		bool has(UnitId id);
 		LightInstance getLight(UnitId id);
-		void allocate(uint32_t lightInstancesCount);
-		void grow();
-		void destroy();
+		// Makes room for <lightInstancesCount> more instances
+		void reserve(uint32_t lightInstancesCount);
 
 		LightInstance makeInstance(uint32_t i) 
 		{ 
@@ -239,7 +264,6 @@ private:
 		}
 
 		Allocator* allocator;
-		HashMap<UnitId, uint32_t> unitIdToLightMap;
 		LightInstanceData data;
 	};
 
@@ -252,6 +276,7 @@ private:
 	bgfx::UniformHandle uniformLightPosition;
 	bgfx::UniformHandle uniformLightDirection;
 	bgfx::UniformHandle uniformLightColor;
+	bgfx::UniformHandle uniformPositionDecode;
 
 	bool isDebugDrawing = false;
 	MeshManager meshManager;
@@ -2,14 +2,15 @@
 #include "World/SceneGraph.h"
 #include "Core/Memory/Allocator.h"
 #include "Core/Containers/Array.h"
-#include "Core/Containers/HashMap.h"
 #include "Core/Math/Matrix3x3.h"
 #include "Core/Math/Matrix4x4.h"
 #include "Core/Math/Quaternion.h"
 #include "Core/Math/Vector3.h"
+#include "Core/Memory/TempAllocator.h"
+#include "World/UnitManager.h"
 
 #include <stdint.h> // UINT_MAX
-#include <string.h> // memcpy
+#include <string.h> // memcpy, memset
 
 namespace Rio
 {
@@ -27,16 +28,18 @@ SceneGraph::Pose& SceneGraph::Pose::operator=(const Matrix4x4& m)
 	return *this;
 }
 
-SceneGraph::SceneGraph(Allocator& a)
+SceneGraph::SceneGraph(Allocator& a, UnitManager& unitManager)
 	: marker(SCENE_GRAPH_MARKER)
 	, allocator(a)
-	, unitIdMap(a)
+	, unitManager(&unitManager)
+	, instanceData(a)
 {
+	unitManager.registerDestroyFunction(SceneGraph::unitDestroyedCallback, this, SceneGraph::unitsDestroyedCallback);
 }
 
 SceneGraph::~SceneGraph()
 {
-	allocator.deallocate(instanceData.buffer);
+	unitManager->unregisterDestroyFunction(this);
 	marker = 0;
 }
 
@@ -46,45 +49,6 @@ TransformInstance SceneGraph::makeInstance(uint32_t i)
 	return transformInstance;
 }
 
-void SceneGraph::allocate(uint32_t instancesCount)
-{
-	RIO_ASSERT(instancesCount > this->instanceData.size, "instancesCount > instanceData.size");
-
-	const uint32_t bytes = 0
-		+ instancesCount * sizeof(UnitId) + alignof(UnitId)
-		+ instancesCount * sizeof(Matrix4x4) + alignof(Matrix4x4)
-		+ instancesCount * sizeof(Pose) + alignof(Pose)
-		+ instancesCount * sizeof(TransformInstance) * 4 + alignof(TransformInstance)
-		+ instancesCount * sizeof(bool) + alignof(bool)
-		;
-
-	InstanceData newInstanceData;
-	newInstanceData.size = this->instanceData.size;
-	newInstanceData.capacity = instancesCount;
-	newInstanceData.buffer = allocator.allocate(bytes);
-
-	newInstanceData.unit = (UnitId*)(newInstanceData.buffer);
-	newInstanceData.world = (Matrix4x4*)MemoryFn::alignTop(newInstanceData.unit + instancesCount, alignof(Matrix4x4));
-	newInstanceData.local = (Pose*)MemoryFn::alignTop(newInstanceData.world + instancesCount, alignof(Pose));
-	newInstanceData.parent = (TransformInstance*)MemoryFn::alignTop(newInstanceData.local + instancesCount, alignof(TransformInstance));
-	newInstanceData.firstChild = (TransformInstance*)MemoryFn::alignTop(newInstanceData.parent + instancesCount, alignof(TransformInstance));
-	newInstanceData.nextSibling = (TransformInstance*)MemoryFn::alignTop(newInstanceData.firstChild + instancesCount, alignof(TransformInstance));
-	newInstanceData.prevSibling = (TransformInstance*)MemoryFn::alignTop(newInstanceData.nextSibling + instancesCount, alignof(TransformInstance));
-	newInstanceData.changed = (bool*)MemoryFn::alignTop(newInstanceData.prevSibling + instancesCount, alignof(bool));
-
-	memcpy(newInstanceData.unit, this->instanceData.unit, this->instanceData.size * sizeof(UnitId));
-	memcpy(newInstanceData.world, this->instanceData.world, this->instanceData.size * sizeof(Matrix4x4));
-	memcpy(newInstanceData.local, this->instanceData.local, this->instanceData.size * sizeof(Pose));
-	memcpy(newInstanceData.parent, this->instanceData.parent, this->instanceData.size * sizeof(TransformInstance));
-	memcpy(newInstanceData.firstChild, this->instanceData.firstChild, this->instanceData.size * sizeof(TransformInstance));
-	memcpy(newInstanceData.nextSibling, this->instanceData.nextSibling, this->instanceData.size * sizeof(TransformInstance));
-	memcpy(newInstanceData.prevSibling, this->instanceData.prevSibling, this->instanceData.size * sizeof(TransformInstance));
-	memcpy(newInstanceData.changed, this->instanceData.changed, this->instanceData.size * sizeof(bool));
-
-	allocator.deallocate(this->instanceData.buffer);
-	this->instanceData = newInstanceData;
-}
-
 TransformInstance SceneGraph::create(UnitId id, const Vector3& position, const Quaternion& rotation, const Vector3& scale)
 {
 	Matrix4x4 pose;
@@ -98,16 +62,10 @@ TransformInstance SceneGraph::create(UnitId id, const Vector3& position, const Q
 
 TransformInstance SceneGraph::create(UnitId id, const Matrix4x4& pose)
 {
-	RIO_ASSERT(!HashMapFn::has(unitIdMap, id), "Unit already has transform");
-
-	if (this->instanceData.capacity == this->instanceData.size)
-	{
-		grow();
-	}
+	RIO_ASSERT(!getIsValid(get(id)), "Unit already has transform");
 
-	const uint32_t last = this->instanceData.size;
+	const uint32_t last = ComponentStorageFn::create(this->instanceData, id);
 
-	this->instanceData.unit[last] = id;
 	this->instanceData.world[last] = pose;
 	this->instanceData.local[last] = pose;
 	this->instanceData.parent[last].i = UINT32_MAX;
@@ -116,39 +74,150 @@ TransformInstance SceneGraph::create(UnitId id, const Matrix4x4& pose)
 	this->instanceData.prevSibling[last].i = UINT32_MAX;
 	this->instanceData.changed[last] = false;
 
-	++this->instanceData.size;
+	return makeInstance(last);
+}
 
-	HashMapFn::set(unitIdMap, id, last);
+TransformInstance SceneGraph::create(uint32_t count, const UnitId* unitIdList, const Matrix4x4* poseList)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		RIO_ASSERT(!getIsValid(get(unitIdList[i])), "Unit already has transform");
+	}
 
-	return makeInstance(last);
+	const uint32_t first = ComponentStorageFn::create(this->instanceData, count, unitIdList);
+
+	memcpy(this->instanceData.world + first, poseList, count * sizeof(Matrix4x4));
+	// UINT32_MAX in every link
+	memset(this->instanceData.parent + first, 0xff, count * sizeof(TransformInstance));
+	memset(this->instanceData.firstChild + first, 0xff, count * sizeof(TransformInstance));
+	memset(this->instanceData.nextSibling + first, 0xff, count * sizeof(TransformInstance));
+	memset(this->instanceData.prevSibling + first, 0xff, count * sizeof(TransformInstance));
+	memset(this->instanceData.changed + first, 0, count * sizeof(bool));
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		this->instanceData.local[first + i] = poseList[i];
+	}
+
+	return makeInstance(first);
 }
 
 void SceneGraph::destroy(TransformInstance i)
 {
 	RIO_ASSERT(i.i < this->instanceData.size, "Index out of bounds");
 
-	const uint32_t last = this->instanceData.size - 1;
-	const UnitId unitId = this->instanceData.unit[i.i];
-	const UnitId lastUnitId = this->instanceData.unit[last];
+	TransformInstance child = this->instanceData.firstChild[i.i];
+	while (getIsValid(child))
+	{
+		const TransformInstance nextChild = this->instanceData.nextSibling[child.i];
+		unlink(child);
+		this->instanceData.local[child.i] = this->instanceData.world[child.i];
+		child = nextChild;
+	}
+	unlink(i);
 
-	this->instanceData.unit[i.i] = this->instanceData.unit[last];
-	this->instanceData.world[i.i] = this->instanceData.world[last];
-	this->instanceData.local[i.i] = this->instanceData.local[last];
-	this->instanceData.parent[i.i] = this->instanceData.parent[last];
-	this->instanceData.firstChild[i.i] = this->instanceData.firstChild[last];
-	this->instanceData.nextSibling[i.i] = this->instanceData.nextSibling[last];
-	this->instanceData.prevSibling[i.i] = this->instanceData.prevSibling[last];
-	this->instanceData.changed[i.i] = this->instanceData.changed[last];
+	const uint32_t last = ComponentStorageFn::destroy(this->instanceData, i.i);
 
-	HashMapFn::set(unitIdMap, lastUnitId, i.i);
-	HashMapFn::remove(unitIdMap, unitId);
+	// The links to the last node follow it
+	if (last != UINT32_MAX)
+	{
+		const TransformInstance parent = this->instanceData.parent[i.i];
+		if (getIsValid(parent) && this->instanceData.firstChild[parent.i].i == last)
+		{
+			this->instanceData.firstChild[parent.i] = i;
+		}
+		if (getIsValid(this->instanceData.prevSibling[i.i]))
+		{
+			this->instanceData.nextSibling[this->instanceData.prevSibling[i.i].i] = i;
+		}
+		if (getIsValid(this->instanceData.nextSibling[i.i]))
+		{
+			this->instanceData.prevSibling[this->instanceData.nextSibling[i.i].i] = i;
+		}
+		for (child = this->instanceData.firstChild[i.i]; getIsValid(child); child = this->instanceData.nextSibling[child.i])
+		{
+			this->instanceData.parent[child.i] = i;
+		}
+	}
+}
 
-	--this->instanceData.size;
+// Returns <i> at its index in <indexList>
+static TransformInstance remapInstance(const Array<uint32_t>& indexList, TransformInstance i)
+{
+	TransformInstance transformInstance = { i.i == UINT32_MAX ? UINT32_MAX : indexList[i.i] };
+	return transformInstance;
+}
+
+void SceneGraph::unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count)
+{
+	const uint32_t unitsCount = ComponentStorageFn::getUnitsWithInstanceCount(this->instanceData, unitIdList, count);
+	if (unitsCount == 0)
+	{
+		return;
+	}
+
+	const uint32_t size = this->instanceData.size;
+
+	// Swap-removing the nodes of a few units is cheaper than compacting all of them
+	if (unitsCount * RIO_COMPONENT_COMPACT_FRACTION < size)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			unitDestroyedCallback(unitIdList[i]);
+		}
+		return;
+	}
+
+	// New index of each node, UINT32_MAX if it is destroyed
+	TempAllocator4096 ta;
+	Array<uint32_t> indexList(ta);
+	ArrayFn::resize(indexList, size);
+
+	uint32_t last = 0;
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		indexList[i] = unitManager->getIsAlive(this->instanceData.unit[i]) ? last++ : UINT32_MAX;
+	}
+
+	if (last == size)
+	{
+		return;
+	}
+
+	// No node left links to a node destroyed
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		if (indexList[i] != UINT32_MAX)
+		{
+			continue;
+		}
+
+		TransformInstance child = this->instanceData.firstChild[i];
+		while (getIsValid(child))
+		{
+			const TransformInstance nextChild = this->instanceData.nextSibling[child.i];
+			unlink(child);
+			this->instanceData.local[child.i] = this->instanceData.world[child.i];
+			child = nextChild;
+		}
+		unlink(makeInstance(i));
+	}
+
+	ComponentStorageFn::destroyDead(this->instanceData, *unitManager);
+
+	// The links follow the nodes left
+	for (uint32_t i = 0; i < this->instanceData.size; ++i)
+	{
+		this->instanceData.parent[i] = remapInstance(indexList, this->instanceData.parent[i]);
+		this->instanceData.firstChild[i] = remapInstance(indexList, this->instanceData.firstChild[i]);
+		this->instanceData.nextSibling[i] = remapInstance(indexList, this->instanceData.nextSibling[i]);
+		this->instanceData.prevSibling[i] = remapInstance(indexList, this->instanceData.prevSibling[i]);
+	}
 }
 
 TransformInstance SceneGraph::get(UnitId id)
 {
-	return makeInstance(HashMapFn::get(unitIdMap, id, UINT32_MAX));
+	return makeInstance(ComponentStorageFn::getInstance(this->instanceData, id));
 }
 
 void SceneGraph::setLocalPosition(TransformInstance i, const Vector3& position)
@@ -179,6 +248,51 @@ void SceneGraph::setLocalPose(TransformInstance i, const Matrix4x4& pose)
 	setLocal(i);
 }
 
+void SceneGraph::setLocalPosition(uint32_t count, const TransformInstance* transformInstanceList, const Vector3* positionList)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t index = transformInstanceList[i].i;
+		RIO_ASSERT(index < this->instanceData.size, "Index out of bounds");
+		if (index >= this->instanceData.size)
+		{
+			continue;
+		}
+		this->instanceData.local[index].position = positionList[i];
+	}
+	setLocal(count, transformInstanceList);
+}
+
+void SceneGraph::setLocalRotation(uint32_t count, const TransformInstance* transformInstanceList, const Quaternion* rotationList)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t index = transformInstanceList[i].i;
+		RIO_ASSERT(index < this->instanceData.size, "Index out of bounds");
+		if (index >= this->instanceData.size)
+		{
+			continue;
+		}
+		this->instanceData.local[index].rotation = createMatrix3x3(rotationList[i]);
+	}
+	setLocal(count, transformInstanceList);
+}
+
+void SceneGraph::setLocalPose(uint32_t count, const TransformInstance* transformInstanceList, const Matrix4x4* poseList)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t index = transformInstanceList[i].i;
+		RIO_ASSERT(index < this->instanceData.size, "Index out of bounds");
+		if (index >= this->instanceData.size)
+		{
+			continue;
+		}
+		this->instanceData.local[index] = poseList[i];
+	}
+	setLocal(count, transformInstanceList);
+}
+
 Vector3 SceneGraph::getLocalPosition(TransformInstance i) const
 {
 	RIO_ASSERT(i.i < this->instanceData.size, "Index out of bounds");
@@ -205,6 +319,39 @@ Matrix4x4 SceneGraph::getLocalPose(TransformInstance i) const
 	return transform;
 }
 
+void SceneGraph::getLocalPosition(uint32_t count, const TransformInstance* transformInstanceList, Vector3* result) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (transformInstanceList[i].i < this->instanceData.size)
+		{
+			result[i] = getLocalPosition(transformInstanceList[i]);
+		}
+	}
+}
+
+void SceneGraph::getLocalRotation(uint32_t count, const TransformInstance* transformInstanceList, Quaternion* result) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (transformInstanceList[i].i < this->instanceData.size)
+		{
+			result[i] = getLocalRotation(transformInstanceList[i]);
+		}
+	}
+}
+
+void SceneGraph::getLocalPose(uint32_t count, const TransformInstance* transformInstanceList, Matrix4x4* result) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (transformInstanceList[i].i < this->instanceData.size)
+		{
+			result[i] = getLocalPose(transformInstanceList[i]);
+		}
+	}
+}
+
 Vector3 SceneGraph::getWorldPosition(TransformInstance i) const
 {
 	RIO_ASSERT(i.i < this->instanceData.size, "Index out of bounds");
@@ -353,6 +500,51 @@ void SceneGraph::setLocal(TransformInstance i)
 	this->instanceData.changed[i.i] = true;
 }
 
+void SceneGraph::setLocal(uint32_t count, const TransformInstance* transformInstanceList)
+{
+	// Mark the nodes first, so that each subtree is transformed from its topmost marked node only
+	// Out of range instances are skipped, the list may come straight from a script
+	TempAllocator4096 ta;
+	Array<bool> isMarkedList(ta);
+	ArrayFn::resize(isMarkedList, this->instanceData.size);
+	memset(ArrayFn::begin(isMarkedList), 0, this->instanceData.size * sizeof(bool));
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (transformInstanceList[i].i < this->instanceData.size)
+		{
+			isMarkedList[transformInstanceList[i].i] = true;
+			this->instanceData.changed[transformInstanceList[i].i] = true;
+		}
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const TransformInstance transformInstance = transformInstanceList[i];
+		if (transformInstance.i >= this->instanceData.size)
+		{
+			continue;
+		}
+
+		const TransformInstance parent = this->instanceData.parent[transformInstance.i];
+
+		bool hasMarkedAncestor = false;
+		for (TransformInstance ancestor = parent; getIsValid(ancestor); ancestor = this->instanceData.parent[ancestor.i])
+		{
+			if (isMarkedList[ancestor.i])
+			{
+				hasMarkedAncestor = true;
+				break;
+			}
+		}
+
+		if (!hasMarkedAncestor)
+		{
+			transform(getIsValid(parent) ? this->instanceData.world[parent.i] : MATRIX4X4_IDENTITY, transformInstance);
+		}
+	}
+}
+
 void SceneGraph::transform(const Matrix4x4& parent, TransformInstance i)
 {
 	this->instanceData.world[i.i] = getLocalPose(i) * parent;
@@ -365,9 +557,18 @@ void SceneGraph::transform(const Matrix4x4& parent, TransformInstance i)
 	}
 }
 
-void SceneGraph::grow()
+void SceneGraph::unitDestroyedCallback(UnitId id)
+{
+	const TransformInstance i = get(id);
+	if (getIsValid(i))
+	{
+		destroy(i);
+	}
+}
+
+void SceneGraph::reserve(uint32_t instancesCount)
 {
-	allocate(this->instanceData.capacity * 2 + 1);
+	ComponentStorageFn::reserve(this->instanceData, instancesCount);
 }
 
 } // namespace Rio
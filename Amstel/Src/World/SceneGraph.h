@@ -5,6 +5,7 @@
 #include "Core/Math/MathTypes.h"
 #include "Core/Memory/MemoryTypes.h"
 #include "Core/Base/Types.h"
+#include "World/ComponentStorage.h"
 #include "World/WorldTypes.h"
 
 namespace Rio
@@ -26,33 +27,38 @@ public:
 		Pose& operator=(const Matrix4x4& m);
 	};
 
-	struct InstanceData
+	struct InstanceData : public ComponentStorage<Matrix4x4, Pose, TransformInstance, TransformInstance, TransformInstance, TransformInstance, bool>
 	{
-		uint32_t size = 0;
-		uint32_t capacity = 0;
-		void* buffer = nullptr;
-
-		UnitId* unit = nullptr;
-		Matrix4x4* world = nullptr;
-		Pose* local = nullptr;
-		TransformInstance* parent = nullptr;
-		TransformInstance* firstChild = nullptr;
-		TransformInstance* nextSibling = nullptr;
-		TransformInstance* prevSibling = nullptr;
-		bool* changed = nullptr;
+		InstanceData(Allocator& a)
+			: ComponentStorage(a)
+		{
+			ComponentStorageFn::bind(*this, &unit, &world, &local, &parent, &firstChild, &nextSibling, &prevSibling, &changed);
+		}
+
+		UnitId* unit;
+		Matrix4x4* world;
+		Pose* local;
+		TransformInstance* parent;
+		TransformInstance* firstChild;
+		TransformInstance* nextSibling;
+		TransformInstance* prevSibling;
+		bool* changed;
 	};
 
-	SceneGraph(Allocator& a);
+	SceneGraph(Allocator& a, UnitManager& unitManager);
 	~SceneGraph();
 
-	void grow();
-	void allocate(uint32_t instancesCount);
+	// Makes room for <instancesCount> more transform instances
+	void reserve(uint32_t instancesCount);
 	TransformInstance makeInstance(uint32_t i);
 	// Creates a new transform instance for unit <id>
 	TransformInstance create(UnitId id, const Matrix4x4& pose);
 	// Creates a new transform instance for unit <id>
 	TransformInstance create(UnitId id, const Vector3& position, const Quaternion& rotation, const Vector3& scale);
-	// Destroys the transform <i>
+	// Creates a new transform instance for each of the <count> units in <unitIdList>, at the matching pose in <poseList>
+	// The instances are created one after another, the first one is returned
+	TransformInstance create(uint32_t count, const UnitId* unitIdList, const Matrix4x4* poseList);
+	// Destroys the transform <i>, its children become roots
 	void destroy(TransformInstance i);
 	// Returns the transform instance of unit <id>
 	TransformInstance get(UnitId id);
@@ -61,12 +67,21 @@ public:
 	void setLocalRotation(TransformInstance i, const Quaternion& rotation);
 	void setLocalScale(TransformInstance i, const Vector3& scale);
 	void setLocalPose(TransformInstance i, const Matrix4x4& pose);
+	// Sets the local position, rotation or pose of the <count> nodes in <transformInstanceList>, one value each
+	// The world poses are recomputed once, after all the local ones are set
+	void setLocalPosition(uint32_t count, const TransformInstance* transformInstanceList, const Vector3* positionList);
+	void setLocalRotation(uint32_t count, const TransformInstance* transformInstanceList, const Quaternion* rotationList);
+	void setLocalPose(uint32_t count, const TransformInstance* transformInstanceList, const Matrix4x4* poseList);
 
 	// Returns the local position, rotation or pose of the given node
 	Vector3 getLocalPosition(TransformInstance i) const;
 	Quaternion getLocalRotation(TransformInstance i) const;
 	Vector3 getLocalScale(TransformInstance i) const;
 	Matrix4x4 getLocalPose(TransformInstance i) const;
+	// Writes the local position, rotation or pose of the <count> nodes in <transformInstanceList> to <result>
+	void getLocalPosition(uint32_t count, const TransformInstance* transformInstanceList, Vector3* result) const;
+	void getLocalRotation(uint32_t count, const TransformInstance* transformInstanceList, Quaternion* result) const;
+	void getLocalPose(uint32_t count, const TransformInstance* transformInstanceList, Matrix4x4* result) const;
 
 	// Returns the world position, rotation or pose of the given node
 	Vector3 getWorldPosition(TransformInstance i) const;
@@ -86,11 +101,30 @@ public:
 	void getChanged(Array<UnitId>& units, Array<Matrix4x4>& worldPoseList);
 	bool getIsValid(TransformInstance i);
 	void setLocal(TransformInstance i);
+	// Like setLocal() for the <count> nodes in <transformInstanceList>
+	// Nodes whose ancestor is in the list are transformed along with it, only once
+	void setLocal(uint32_t count, const TransformInstance* transformInstanceList);
 	void transform(const Matrix4x4& parent, TransformInstance i);
 
+	static void unitDestroyedCallback(UnitId id, void* userPtr)
+	{
+		((SceneGraph*)userPtr)->unitDestroyedCallback(id);
+	}
+
+	void unitDestroyedCallback(UnitId id);
+
+	static void unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count, void* userPtr)
+	{
+		((SceneGraph*)userPtr)->unitsDestroyedCallback(unitIdList, count);
+	}
+
+	// Destroys the transforms of the units not alive anymore, compacting the instances once
+	// The children of the transforms destroyed become roots
+	void unitsDestroyedCallback(const UnitId* unitIdList, uint32_t count);
+
 	Allocator& allocator;
+	UnitManager* unitManager;
 	InstanceData instanceData;
-	HashMap<UnitId, uint32_t> unitIdMap;
 };
 
 } // namespace Rio
@@ -0,0 +1,263 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#include "World/SpawnTemplate.h"
+
+#include "Core/Containers/Array.h"
+#include "Core/Error/Error.h"
+#include "Core/Math/Matrix4x4.h"
+#include "Core/Memory/TempAllocator.h"
+
+#include "Resource/UnitResource.h"
+
+#include "World/PhysicsWorld.h"
+#include "World/RenderWorld.h"
+#include "World/SceneGraph.h"
+#include "World/World.h"
+
+namespace Rio
+{
+
+SpawnTemplate::SpawnTemplate(Allocator& a)
+	: componentList(a)
+	, localPoseList(a)
+	, colliderDescList(a)
+{
+}
+
+namespace SpawnTemplateFn
+{
+	void create(SpawnTemplate& spawnTemplate, const UnitResource& unitResource)
+	{
+		ArrayFn::clear(spawnTemplate.componentList);
+		ArrayFn::clear(spawnTemplate.localPoseList);
+		ArrayFn::clear(spawnTemplate.colliderDescList);
+
+		spawnTemplate.unitResource = &unitResource;
+		spawnTemplate.unitListCount = unitResource.unitListCount;
+		spawnTemplate.instancesCount = 0;
+
+		// Start of components data
+		const char* componentListBegin = (const char*)(&unitResource + 1);
+
+		for (uint32_t componentTypeListIndex = 0; componentTypeListIndex < unitResource.componentTypesCount; ++componentTypeListIndex)
+		{
+			const ComponentData* component = (const ComponentData*)componentListBegin;
+			componentListBegin += component->size + sizeof(ComponentData);
+
+			SpawnTemplateComponent spawnTemplateComponent;
+			spawnTemplateComponent.instancesCount = component->instancesCount;
+			spawnTemplateComponent.unitIndexList = (const uint32_t*)(component + 1);
+			spawnTemplateComponent.data = (const char*)(spawnTemplateComponent.unitIndexList + component->instancesCount);
+			spawnTemplateComponent.first = 0;
+
+			if (component->type == COMPONENT_TYPE_TRANSFORM)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::TRANSFORM;
+				spawnTemplateComponent.first = ArrayFn::getCount(spawnTemplate.localPoseList);
+
+				const TransformDesc* transformDesc = (const TransformDesc*)spawnTemplateComponent.data;
+				for (uint32_t i = 0; i < component->instancesCount; ++i, ++transformDesc)
+				{
+					ArrayFn::pushBack(spawnTemplate.localPoseList, createMatrix4x4(transformDesc->rotation, transformDesc->position));
+				}
+			}
+			else if (component->type == COMPONENT_TYPE_CAMERA)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::CAMERA;
+			}
+			else if (component->type == COMPONENT_TYPE_COLLIDER)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::COLLIDER;
+				spawnTemplateComponent.first = ArrayFn::getCount(spawnTemplate.colliderDescList);
+
+				// Colliders have variable size
+				const ColliderDesc* colliderDesc = (const ColliderDesc*)spawnTemplateComponent.data;
+				for (uint32_t i = 0; i < component->instancesCount; ++i)
+				{
+					ArrayFn::pushBack(spawnTemplate.colliderDescList, colliderDesc);
+					colliderDesc = (ColliderDesc*)((char*)(colliderDesc + 1) + colliderDesc->size);
+				}
+			}
+			else if (component->type == COMPONENT_TYPE_ACTOR)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::ACTOR;
+			}
+			else if (component->type == COMPONENT_TYPE_CONTROLLER)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::CONTROLLER;
+			}
+			else if (component->type == COMPONENT_TYPE_MESH_RENDERER)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::MESH_RENDERER;
+			}
+			else if (component->type == COMPONENT_TYPE_SPRITE_RENDERER)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::SPRITE_RENDERER;
+			}
+			else if (component->type == COMPONENT_TYPE_LIGHT)
+			{
+				spawnTemplateComponent.type = SpawnComponentType::LIGHT;
+			}
+			else
+			{
+				RIO_FATAL("Unknown component type");
+			}
+
+			ArrayFn::pushBack(spawnTemplate.componentList, spawnTemplateComponent);
+			spawnTemplate.instancesCount += component->instancesCount;
+		}
+	}
+
+	void spawn(const SpawnTemplate& spawnTemplate, World& world, uint32_t count, const Vector3* positionList, const Quaternion* rotationList, const UnitId* unitLookupList)
+	{
+		const uint32_t unitListCount = spawnTemplate.unitListCount;
+
+		TempAllocator4096 ta;
+		Array<Matrix4x4> spawnPoseList(ta);
+		Array<Matrix4x4> unitPoseList(ta);
+		ArrayFn::resize(spawnPoseList, count);
+		ArrayFn::resize(unitPoseList, count * unitListCount);
+
+		// The pose of each copy is computed once, the world pose of each unit when its transform is created
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			spawnPoseList[k] = createMatrix4x4(rotationList[k], positionList[k]);
+		}
+		for (uint32_t i = 0; i < count * unitListCount; ++i)
+		{
+			unitPoseList[i] = MATRIX4X4_IDENTITY;
+		}
+
+		spawnInstances(spawnTemplate
+			, world
+			, count
+			, ArrayFn::begin(spawnPoseList)
+			, ArrayFn::begin(unitPoseList)
+			, unitLookupList
+			, 0
+			, spawnTemplate.instancesCount
+			);
+	}
+
+	void spawnInstances(const SpawnTemplate& spawnTemplate, World& world, uint32_t count, const Matrix4x4* spawnPoseList, Matrix4x4* unitPoseList, const UnitId* unitLookupList, uint32_t first, uint32_t instancesCount)
+	{
+		RIO_ASSERT(first + instancesCount <= spawnTemplate.instancesCount, "Index out of bounds");
+
+		SceneGraph* sceneGraph = world.getSceneGraph();
+		RenderWorld* renderWorld = world.getRenderWorld();
+		PhysicsWorld* physicsWorld = world.getPhysicsWorld();
+
+		const uint32_t unitListCount = spawnTemplate.unitListCount;
+		const uint32_t last = first + instancesCount;
+
+		TempAllocator1024 ta;
+		Array<UnitId> unitIdList(ta);
+		Array<Matrix4x4> poseList(ta);
+		ArrayFn::resize(unitIdList, count);
+		ArrayFn::resize(poseList, count);
+
+		// Index of the first instance of the current block
+		uint32_t blockFirst = 0;
+
+		for (uint32_t componentIndex = 0; componentIndex < ArrayFn::getCount(spawnTemplate.componentList) && blockFirst < last; ++componentIndex)
+		{
+			const SpawnTemplateComponent& component = spawnTemplate.componentList[componentIndex];
+			const uint32_t blockLast = blockFirst + component.instancesCount;
+
+			// Instances of the block in [first, last)
+			const uint32_t begin = (first > blockFirst ? first : blockFirst) - blockFirst;
+			const uint32_t end = (last < blockLast ? last : blockLast) - blockFirst;
+			blockFirst = blockLast;
+
+			if (begin >= end)
+			{
+				continue;
+			}
+
+			if (component.type == SpawnComponentType::TRANSFORM)
+			{
+				sceneGraph->reserve((end - begin) * count);
+			}
+
+			// Each instance of the component is created for all the copies at once
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const uint32_t unitIndex = component.unitIndexList[i];
+				for (uint32_t k = 0; k < count; ++k)
+				{
+					unitIdList[k] = unitLookupList[k * unitListCount + unitIndex];
+					poseList[k] = unitPoseList[k * unitListCount + unitIndex];
+				}
+
+				switch (component.type)
+				{
+					case SpawnComponentType::TRANSFORM:
+					{
+						const Matrix4x4& localPose = spawnTemplate.localPoseList[component.first + i];
+						for (uint32_t k = 0; k < count; ++k)
+						{
+							poseList[k] = localPose * spawnPoseList[k];
+							unitPoseList[k * unitListCount + unitIndex] = poseList[k];
+						}
+						sceneGraph->create(count, ArrayFn::begin(unitIdList), ArrayFn::begin(poseList));
+					}
+					break;
+					case SpawnComponentType::CAMERA:
+					{
+						const CameraDesc& cameraDesc = ((const CameraDesc*)component.data)[i];
+						for (uint32_t k = 0; k < count; ++k)
+						{
+							world.cameraCreate(unitIdList[k], cameraDesc, MATRIX4X4_IDENTITY);
+						}
+					}
+					break;
+					case SpawnComponentType::COLLIDER:
+					{
+						physicsWorld->colliderCreate(count, ArrayFn::begin(unitIdList), spawnTemplate.colliderDescList[component.first + i]);
+					}
+					break;
+					case SpawnComponentType::ACTOR:
+					{
+						const ActorResource* actorResource = &((const ActorResource*)component.data)[i];
+						physicsWorld->actorCreate(count, ArrayFn::begin(unitIdList), actorResource, ArrayFn::begin(poseList));
+					}
+					break;
+					case SpawnComponentType::CONTROLLER:
+					{
+						const ControllerDesc& controllerDesc = ((const ControllerDesc*)component.data)[i];
+						for (uint32_t k = 0; k < count; ++k)
+						{
+							physicsWorld->controllerCreate(unitIdList[k], controllerDesc, poseList[k]);
+						}
+					}
+					break;
+					case SpawnComponentType::MESH_RENDERER:
+					{
+						const MeshRendererDesc& meshRendererDesc = ((const MeshRendererDesc*)component.data)[i];
+						renderWorld->meshCreate(count, ArrayFn::begin(unitIdList), meshRendererDesc, ArrayFn::begin(poseList));
+					}
+					break;
+					case SpawnComponentType::SPRITE_RENDERER:
+					{
+						const SpriteRendererDesc& spriteRendererDesc = ((const SpriteRendererDesc*)component.data)[i];
+						renderWorld->spriteCreate(count, ArrayFn::begin(unitIdList), spriteRendererDesc, ArrayFn::begin(poseList));
+					}
+					break;
+					case SpawnComponentType::LIGHT:
+					{
+						const LightDesc& lightDesc = ((const LightDesc*)component.data)[i];
+						renderWorld->lightCreate(count, ArrayFn::begin(unitIdList), lightDesc, ArrayFn::begin(poseList));
+					}
+					break;
+					default:
+					{
+						RIO_FATAL("Unknown component type");
+					}
+					break;
+				}
+			}
+		}
+	}
+} // namespace SpawnTemplateFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
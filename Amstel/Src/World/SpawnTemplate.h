@@ -0,0 +1,73 @@
+// Copyright (c) 2016 Volodymyr Syvochka
+#pragma once
+
+#include "Core/Containers/ContainerTypes.h"
+#include "Core/Math/MathTypes.h"
+#include "Core/Memory/MemoryTypes.h"
+#include "Resource/ResourceTypes.h"
+#include "World/WorldTypes.h"
+
+namespace Rio
+{
+
+struct SpawnComponentType
+{
+	enum Enum
+	{
+		TRANSFORM,
+		CAMERA,
+		COLLIDER,
+		ACTOR,
+		CONTROLLER,
+		MESH_RENDERER,
+		SPRITE_RENDERER,
+		LIGHT,
+
+		COUNT
+	};
+};
+
+// A component block of a unit resource
+struct SpawnTemplateComponent
+{
+	SpawnComponentType::Enum type;
+	uint32_t instancesCount;
+	const uint32_t* unitIndexList;
+	const char* data;
+	// Index of the first instance in SpawnTemplate::localPoseList (transforms) or SpawnTemplate::colliderDescList (colliders)
+	uint32_t first;
+};
+
+// The components of a unit resource decoded once, so that spawning many copies of the unit
+// neither walks the resource data nor looks up the component types again
+// Points into the unit resource, which must stay loaded
+struct SpawnTemplate
+{
+	ALLOCATOR_AWARE;
+
+	SpawnTemplate(Allocator& a);
+
+	const UnitResource* unitResource = nullptr;
+	uint32_t generation = 0; // Of the unit resource when decoded, see ResourceManager::getGeneration()
+	uint32_t unitListCount = 0;
+	uint32_t instancesCount = 0; // Component instances in all the blocks
+	Array<SpawnTemplateComponent> componentList;
+	Array<Matrix4x4> localPoseList;
+	Array<const ColliderDesc*> colliderDescList;
+};
+
+namespace SpawnTemplateFn
+{
+	// Decodes the components of <unitResource> into <spawnTemplate>
+	void create(SpawnTemplate& spawnTemplate, const UnitResource& unitResource);
+	// Spawns <count> copies of the units of <spawnTemplate> into <world>, the k-th copy at <positionList>[k] and <rotationList>[k]
+	// The k-th copy uses the ids from <unitLookupList>[k * unitListCount] to <unitLookupList>[(k + 1) * unitListCount - 1]
+	void spawn(const SpawnTemplate& spawnTemplate, World& world, uint32_t count, const Vector3* positionList, const Quaternion* rotationList, const UnitId* unitLookupList);
+	// Creates the component instances <first> to <first> + <instancesCount> - 1 of <spawnTemplate> for the <count> copies, numbering the instances block after block
+	// The k-th copy is at <spawnPoseList>[k], <unitPoseList> holds the world pose of each unit of each copy and must be kept between calls
+	// Spawning all the instances in order over several calls is the same as spawning them at once
+	void spawnInstances(const SpawnTemplate& spawnTemplate, World& world, uint32_t count, const Matrix4x4* spawnPoseList, Matrix4x4* unitPoseList, const UnitId* unitLookupList, uint32_t first, uint32_t instancesCount);
+} // namespace SpawnTemplateFn
+
+} // namespace Rio
+// Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
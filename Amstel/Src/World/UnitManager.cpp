@@ -60,10 +60,39 @@ void UnitManager::destroy(UnitId id)
 	triggerDestroyCallbacks(id);
 }
 
-void UnitManager::registerDestroyFunction(DestroyFunction destroyFunction, void* userPtr)
+void UnitManager::destroyBatch(const UnitId* unitIdList, uint32_t count, Array<UnitId>& destroyedUnitIdList)
+{
+	const uint32_t first = ArrayFn::getCount(destroyedUnitIdList);
+	ArrayFn::reserve(destroyedUnitIdList, first + count);
+
+	// A unit listed twice is not alive anymore the second time
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const UnitId id = unitIdList[i];
+		if (!getIsAlive(id))
+		{
+			continue;
+		}
+
+		const uint32_t index = id.getIndex();
+		++generation[index];
+		QueueFn::pushBack(freeIndicesQueue, index);
+		ArrayFn::pushBack(destroyedUnitIdList, id);
+	}
+
+	if (ArrayFn::getCount(destroyedUnitIdList) == first)
+	{
+		return;
+	}
+
+	triggerDestroyCallbacks(ArrayFn::begin(destroyedUnitIdList) + first, ArrayFn::getCount(destroyedUnitIdList) - first);
+}
+
+void UnitManager::registerDestroyFunction(DestroyFunction destroyFunction, void* userPtr, DestroyBatchFunction destroyBatchFunction)
 {
 	DestroyData destroyData;
 	destroyData.destroyFunction = destroyFunction;
+	destroyData.destroyBatchFunction = destroyBatchFunction;
 	destroyData.userPtr = userPtr;
 	ArrayFn::pushBack(destroyCallbackList, destroyData);
 }
@@ -91,5 +120,23 @@ void UnitManager::triggerDestroyCallbacks(UnitId id)
 	}
 }
 
+void UnitManager::triggerDestroyCallbacks(const UnitId* unitIdList, uint32_t count)
+{
+	for (uint32_t i = 0; i < ArrayFn::getCount(destroyCallbackList); ++i)
+	{
+		const DestroyData& destroyData = destroyCallbackList[i];
+		if (destroyData.destroyBatchFunction != nullptr)
+		{
+			destroyData.destroyBatchFunction(unitIdList, count, destroyData.userPtr);
+			continue;
+		}
+
+		for (uint32_t j = 0; j < count; ++j)
+		{
+			destroyData.destroyFunction(unitIdList[j], destroyData.userPtr);
+		}
+	}
+}
+
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -11,10 +11,12 @@ class UnitManager
 {
 private:
 	using DestroyFunction = void (*)(UnitId unit, void* userPtr);
+	using DestroyBatchFunction = void (*)(const UnitId* unitIdList, uint32_t count, void* userPtr);
 
 	struct DestroyData
 	{
 		DestroyFunction destroyFunction;
+		DestroyBatchFunction destroyBatchFunction;
 		void* userPtr;
 	};
 public:
@@ -27,9 +29,16 @@ public:
 	// Returns whether the unit <id> is alive
 	bool getIsAlive(UnitId id) const;
 	void destroy(UnitId id);
-	void registerDestroyFunction(DestroyFunction destroyFunction, void* userPtr);
+	// Destroys the <count> units in <unitIdList>, skipping the duplicates and the units not alive
+	// Each manager is called back once with all the units, already not alive, instead of once per unit
+	// The units actually destroyed are appended to <destroyedUnitIdList>, in the order of <unitIdList>
+	void destroyBatch(const UnitId* unitIdList, uint32_t count, Array<UnitId>& destroyedUnitIdList);
+	// Registers the functions called when units are destroyed
+	// <destroyBatchFunction> is called by destroyBatch(), if there is none <destroyFunction> is called for each unit
+	void registerDestroyFunction(DestroyFunction destroyFunction, void* userPtr, DestroyBatchFunction destroyBatchFunction = nullptr);
 	void unregisterDestroyFunction(void* userPtr);
 	void triggerDestroyCallbacks(UnitId id);
+	void triggerDestroyCallbacks(const UnitId* unitIdList, uint32_t count);
 private:
 	Array<uint8_t> generation;
 	Queue<uint32_t> freeIndicesQueue;
@@ -1,6 +1,9 @@
 // Copyright (c) 2016 Volodymyr Syvochka
 #include "World/World.h"
 
+#include "Config.h"
+
+#include "Core/Base/Os.h"
 #include "Core/Error/Error.h"
 #include "Core/Containers/HashMap.h"
 #include "Core/Math/Matrix4x4.h"
@@ -8,6 +11,9 @@
 #include "Core/Math/Vector3.h"
 #include "Core/Math/Vector4.h"
 
+#include "Device/Benchmark.h"
+#include "Device/Profiler.h"
+
 #include "Resource/ResourceManager.h"
 #include "Resource/UnitResource.h"
 
@@ -18,6 +24,7 @@
 #include "World/RenderWorld.h"
 #include "World/SceneGraph.h"
 #include "World/SoundWorld.h"
+#include "World/SpawnTemplate.h"
 #include "World/UnitManager.h"
 
 #include "Script/ScriptEnvironment.h"
@@ -37,10 +44,12 @@ World::World(Allocator& a, ResourceManager& resourceManager, ShaderManager& shad
 	, levelList(a)
 	, cameraList(a)
 	, cameraMap(a)
+	, spawnTemplateList(a)
+	, spawnTemplateMap(a)
 	, eventStream(a)
 {
 	debugLine = createDebugLine(true);
-	sceneGraph = RIO_NEW(*allocator, SceneGraph)(*allocator);
+	sceneGraph = RIO_NEW(*allocator, SceneGraph)(*allocator, unitManager);
 	renderWorld = RIO_NEW(*allocator, RenderWorld)(*allocator, resourceManager, shaderManager, materialManager, unitManager);
 	physicsWorld = PhysicsWorldFn::create(*allocator, resourceManager, unitManager, *debugLine);
 	soundWorld = SoundWorldFn::create(*allocator);
@@ -57,22 +66,79 @@ World::~World()
 
 	for (uint32_t i = 0; i < ArrayFn::getCount(levelList); ++i)
 	{
+		scriptEnvironment->failWaitForLevel(levelList[i]);
 		RIO_DELETE(*allocator, levelList[i]);
 	}
 
+	for (uint32_t i = 0; i < ArrayFn::getCount(spawnTemplateList); ++i)
+	{
+		RIO_DELETE(*allocator, spawnTemplateList[i]);
+	}
+
 	marker = 0;
 }
 
 UnitId World::spawnUnit(StringId64 name, const Vector3& position, const Quaternion& rotation)
 {
-	const UnitResource* unitResource = (const UnitResource*)resourceManager->get(RESOURCE_TYPE_UNIT, name);
-	UnitId id = unitManager->create();
-	spawnUnits(*this, *unitResource, position, rotation, &id);
-	ArrayFn::pushBack(unitIdList, id);
-	postUnitSpawnedEvent(id);
+	UnitId id;
+	spawnUnits(name, 1, &position, &rotation, &id);
 	return id;
 }
 
+void World::spawnUnits(StringId64 name, uint32_t count, const Vector3* positionList, const Quaternion* rotationList, UnitId* unitIdList)
+{
+	PROFILE_SCOPE("world.spawnUnits");
+	BenchmarkScope benchmarkScope(BenchmarkCounter::SPAWN);
+
+	const SpawnTemplate& spawnTemplate = getSpawnTemplate(name);
+	const uint32_t unitListCount = spawnTemplate.unitListCount;
+
+	TempAllocator1024 ta;
+	Array<UnitId> unitLookupList(ta);
+	ArrayFn::resize(unitLookupList, count * unitListCount);
+	for (uint32_t i = 0; i < count * unitListCount; ++i)
+	{
+		unitLookupList[i] = unitManager->create();
+	}
+
+	SpawnTemplateFn::spawn(spawnTemplate, *this, count, positionList, rotationList, ArrayFn::begin(unitLookupList));
+
+	ArrayFn::push(this->unitIdList, ArrayFn::begin(unitLookupList), count * unitListCount);
+	for (uint32_t i = 0; i < count * unitListCount; ++i)
+	{
+		postUnitSpawnedEvent(unitLookupList[i]);
+	}
+
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		unitIdList[k] = unitLookupList[k * unitListCount];
+	}
+}
+
+const SpawnTemplate& World::getSpawnTemplate(StringId64 name)
+{
+	const UnitResource* unitResource = (const UnitResource*)resourceManager->get(RESOURCE_TYPE_UNIT, name);
+
+	uint32_t i = HashMapFn::get(spawnTemplateMap, name, UINT32_MAX);
+	if (i == UINT32_MAX)
+	{
+		i = ArrayFn::getCount(spawnTemplateList);
+		ArrayFn::pushBack(spawnTemplateList, RIO_NEW(*allocator, SpawnTemplate)(*allocator));
+		HashMapFn::set(spawnTemplateMap, name, i);
+	}
+
+	// Decoded again if the resource has been reloaded, which may have put it at the same address
+	SpawnTemplate& spawnTemplate = *spawnTemplateList[i];
+	const uint32_t generation = resourceManager->getGeneration(RESOURCE_TYPE_UNIT, name);
+	if (spawnTemplate.generation != generation)
+	{
+		SpawnTemplateFn::create(spawnTemplate, *unitResource);
+		spawnTemplate.generation = generation;
+	}
+
+	return spawnTemplate;
+}
+
 UnitId World::spawnEmptyUnit()
 {
 	UnitId id = unitManager->create();
@@ -87,6 +153,20 @@ void World::destroyUnit(UnitId id)
 	postUnitDestroyedEvent(id);
 }
 
+void World::destroyUnits(uint32_t count, const UnitId* unitIdList)
+{
+	PROFILE_SCOPE("world.destroyUnits");
+
+	// Duplicates and units already destroyed get no event
+	TempAllocator4096 ta;
+	Array<UnitId> destroyedUnitIdList(ta);
+	unitManager->destroyBatch(unitIdList, count, destroyedUnitIdList);
+	for (uint32_t i = 0; i < ArrayFn::getCount(destroyedUnitIdList); ++i)
+	{
+		postUnitDestroyedEvent(destroyedUnitIdList[i]);
+	}
+}
+
 uint32_t World::getUnitListCount() const
 {
 	return ArrayFn::getCount(unitIdList);
@@ -115,7 +195,11 @@ void World::updateScene(float dt)
 		, ArrayFn::begin(changedWorldTransformList)
 		);
 
-	physicsWorld->update(dt);
+	{
+		PROFILE_SCOPE("physics.update");
+		BenchmarkScope benchmarkScope(BenchmarkCounter::PHYSICS);
+		physicsWorld->update(dt);
+	}
 
 	// Process physics events
 	EventStream& physicsEventStream = physicsWorld->getEventStream();
@@ -168,12 +252,17 @@ void World::updateScene(float dt)
 
 void World::update(float dt)
 {
+	PROFILE_SCOPE("world.update");
+	BenchmarkScope benchmarkScope(BenchmarkCounter::SCENE_UPDATE);
+	updateLevels();
 	updateAnimations(dt);
 	updateScene(dt);
 }
 
 void World::render(const Matrix4x4& view, const Matrix4x4& projection)
 {
+	PROFILE_SCOPE("world.render");
+	BenchmarkScope benchmarkScope(BenchmarkCounter::RENDER_SUBMISSION);
 	renderWorld->render(view, projection);
 
 	physicsWorld->debugDraw();
@@ -216,6 +305,11 @@ CameraInstance World::cameraGet(UnitId id)
 	return makeCameraInstance(HashMapFn::get(cameraMap, id, UINT32_MAX));
 }
 
+uint32_t World::cameraGetCount() const
+{
+	return ArrayFn::getCount(cameraList);
+}
+
 void World::cameraSetProjectionType(CameraInstance i, ProjectionType::Enum type)
 {
 	cameraList[i.i].projectionType = type;
@@ -422,17 +516,55 @@ void World::destroyGui(DebugGui& debugGui)
 
 Level* World::loadLevel(StringId64 name, const Vector3& position, const Quaternion& rotation)
 {
-	const LevelResource* levelResource = (const LevelResource*)resourceManager->get(RESOURCE_TYPE_LEVEL, name);
-
-	Level* level = RIO_NEW(*allocator, Level)(*allocator, *unitManager, *this, *levelResource);
+	Level* level = RIO_NEW(*allocator, Level)(*allocator, *resourceManager, *unitManager, *this, name);
 	level->load(position, rotation);
 
 	ArrayFn::pushBack(levelList, level);
-	postLevelLoadedEvent();
+	postLevelLoadedEvent(level);
 
 	return level;
 }
 
+Level* World::loadLevelAsync(StringId64 name, const Vector3& position, const Quaternion& rotation, const ResourcePackage* resourcePackage)
+{
+	Level* level = RIO_NEW(*allocator, Level)(*allocator, *resourceManager, *unitManager, *this, name);
+	level->beginLoad(position, rotation, resourcePackage);
+
+	ArrayFn::pushBack(levelList, level);
+
+	return level;
+}
+
+void World::failWaitForPackage(const ResourcePackage* resourcePackage)
+{
+	for (uint32_t i = 0; i < ArrayFn::getCount(levelList); ++i)
+	{
+		levelList[i]->failWaitForPackage(resourcePackage);
+	}
+}
+
+void World::updateLevels()
+{
+	PROFILE_SCOPE("world.updateLevels");
+
+	// The budget is shared by all the levels being loaded, the first ones loaded first
+	const int64_t endTime = OsFn::getClockTime() + RIO_LEVEL_LOAD_BUDGET * OsFn::getClockFrequency() / 1000;
+
+	for (uint32_t i = 0; i < ArrayFn::getCount(levelList); ++i)
+	{
+		Level* level = levelList[i];
+		if (!level->getIsLoading())
+		{
+			continue;
+		}
+
+		if (level->update(endTime))
+		{
+			postLevelLoadedEvent(level);
+		}
+	}
+}
+
 EventStream& World::getEventStream()
 {
 	return eventStream;
@@ -472,9 +604,10 @@ void World::postUnitDestroyedEvent(UnitId id)
 	EventStreamFn::write(eventStream, EventType::UNIT_DESTROYED, ev);
 }
 
-void World::postLevelLoadedEvent()
+void World::postLevelLoadedEvent(Level* level)
 {
 	LevelLoadedEvent ev;
+	ev.level = level;
 	EventStreamFn::write(eventStream, EventType::LEVEL_LOADED, ev);
 }
 
@@ -512,100 +645,5 @@ void World::Camera::updateProjectionMatrix()
 	}
 }
 
-void spawnUnits(World& world, const UnitResource& unitResource, const Vector3& position, const Quaternion& rotation, const UnitId* unitLookupList)
-{
-	SceneGraph* sceneGraph = world.getSceneGraph();
-	RenderWorld* renderWorld = world.getRenderWorld();
-	PhysicsWorld* physicsWorld = world.getPhysicsWorld();
-
-	// Start of components data
-	const char* componentListBegin = (const char*)(&unitResource + 1);
-	const ComponentData* component = nullptr;
-
-	for (uint32_t componentTypeListIndex = 0; componentTypeListIndex < unitResource.componentTypesCount; ++componentTypeListIndex, componentListBegin += component->size + sizeof(ComponentData))
-	{
-		component = (const ComponentData*)componentListBegin;
-		const uint32_t* unitIndexList = (const uint32_t*)(component + 1);
-		const char* data = (const char*)(unitIndexList + component->instancesCount);
-
-		if (component->type == COMPONENT_TYPE_TRANSFORM)
-		{
-			const TransformDesc* transformDesc = (const TransformDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++transformDesc)
-			{
-				Matrix4x4 matrix = createMatrix4x4(rotation, position);
-				Matrix4x4 matrix_res = createMatrix4x4(transformDesc->rotation, transformDesc->position);
-				sceneGraph->create(unitLookupList[unitIndexList[i]], matrix_res*matrix);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_CAMERA)
-		{
-			const CameraDesc* cameraDesc = (const CameraDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++cameraDesc)
-			{
-				world.cameraCreate(unitLookupList[unitIndexList[i]], *cameraDesc, MATRIX4X4_IDENTITY);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_COLLIDER)
-		{
-			const ColliderDesc* colliderDesc = (const ColliderDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i)
-			{
-				physicsWorld->colliderCreate(unitLookupList[unitIndexList[i]], colliderDesc);
-				colliderDesc = (ColliderDesc*)((char*)(colliderDesc + 1) + colliderDesc->size);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_ACTOR)
-		{
-			const ActorResource* actorResource = (const ActorResource*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++actorResource)
-			{
-				Matrix4x4 transformMatrix = sceneGraph->getWorldPose(sceneGraph->get(unitLookupList[unitIndexList[i]]));
-				physicsWorld->actorCreate(unitLookupList[unitIndexList[i]], actorResource, transformMatrix);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_CONTROLLER)
-		{
-			const ControllerDesc* controllerDesc = (const ControllerDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++controllerDesc)
-			{
-				Matrix4x4 transformMatrix = sceneGraph->getWorldPose(sceneGraph->get(unitLookupList[unitIndexList[i]]));
-				physicsWorld->controllerCreate(unitLookupList[unitIndexList[i]], *controllerDesc, transformMatrix);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_MESH_RENDERER)
-		{
-			const MeshRendererDesc* meshRendererDesc = (const MeshRendererDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++meshRendererDesc)
-			{
-				Matrix4x4 transformMatrix = sceneGraph->getWorldPose(sceneGraph->get(unitLookupList[unitIndexList[i]]));
-				renderWorld->meshCreate(unitLookupList[unitIndexList[i]], *meshRendererDesc, transformMatrix);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_SPRITE_RENDERER)
-		{
-			const SpriteRendererDesc* spriteRendererDesc = (const SpriteRendererDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++spriteRendererDesc)
-			{
-				Matrix4x4 transformMatrix = sceneGraph->getWorldPose(sceneGraph->get(unitLookupList[unitIndexList[i]]));
-				renderWorld->spriteCreate(unitLookupList[unitIndexList[i]], *spriteRendererDesc, transformMatrix);
-			}
-		}
-		else if (component->type == COMPONENT_TYPE_LIGHT)
-		{
-			const LightDesc* lightDesc = (const LightDesc*)data;
-			for (uint32_t i = 0; i < component->instancesCount; ++i, ++lightDesc)
-			{
-				Matrix4x4 transformMatrix = sceneGraph->getWorldPose(sceneGraph->get(unitLookupList[unitIndexList[i]]));
-				renderWorld->lightCreate(unitLookupList[unitIndexList[i]], *lightDesc, transformMatrix);
-			}
-		}
-		else
-		{
-			RIO_FATAL("Unknown component type");
-		}
-	}
-}
-
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
@@ -48,8 +48,13 @@ public:
 	~World();
 
 	UnitId spawnUnit(StringId64 name, const Vector3& position = VECTOR3_ZERO, const Quaternion& rotation = QUATERNION_IDENTITY);
+	// Spawns <count> copies of the unit <name>, the k-th copy at <positionList>[k] and <rotationList>[k]
+	// Writes the id of the k-th copy to <unitIdList>[k]
+	void spawnUnits(StringId64 name, uint32_t count, const Vector3* positionList, const Quaternion* rotationList, UnitId* unitIdList);
 	UnitId spawnEmptyUnit();
 	void destroyUnit(UnitId id);
+	// Destroys the <count> units in <unitIdList>, each component manager removes all of them at once
+	void destroyUnits(uint32_t count, const UnitId* unitIdList);
 
 	// Returns the number of units in the world
 	uint32_t getUnitListCount() const;
@@ -63,6 +68,8 @@ public:
 	void cameraDestroy(CameraInstance cameraInstance);
 	// Returns the camera owned by unit <id>
 	CameraInstance cameraGet(UnitId id);
+	// Returns the number of cameras in the world
+	uint32_t cameraGetCount() const;
 	// Sets the projection type of the camera
 	void cameraSetProjectionType(CameraInstance i, ProjectionType::Enum type);
 	ProjectionType::Enum cameraGetProjectionType(CameraInstance i) const;
@@ -136,6 +143,12 @@ public:
 
 	// Loads the level <name> into the world
 	Level* loadLevel(StringId64 name, const Vector3& position, const Quaternion& rotation);
+	// Starts loading the level <name> into the world, update() spawns it for up to RIO_LEVEL_LOAD_BUDGET milliseconds per frame
+	// The level resource is read in the background if needed, and the units are spawned once <resourcePackage>, if any, has been loaded
+	// Posts a LEVEL_LOADED event when the level has been loaded
+	Level* loadLevelAsync(StringId64 name, const Vector3& position, const Quaternion& rotation, const ResourcePackage* resourcePackage = nullptr);
+	// Cancels the levels still waiting for <resourcePackage>, which is about to be destroyed
+	void failWaitForPackage(const ResourcePackage* resourcePackage);
 
 	// Returns the events.
 	EventStream& getEventStream();
@@ -147,7 +160,7 @@ public:
 
 	void postUnitSpawnedEvent(UnitId id);
 	void postUnitDestroyedEvent(UnitId id);
-	void postLevelLoadedEvent();
+	void postLevelLoadedEvent(Level* level);
 
 private:
 	Allocator* allocator;
@@ -167,9 +180,17 @@ private:
 	Array<Level*> levelList;
 	Array<Camera> cameraList;
 	HashMap<UnitId, uint32_t> cameraMap;
+	Array<SpawnTemplate*> spawnTemplateList;
+	HashMap<StringId64, uint32_t> spawnTemplateMap;
 
 	EventStream eventStream;
 
+	// Spawns the levels being loaded until the level load budget of the frame is spent
+	void updateLevels();
+
+	// Returns the spawn template of the unit <name>, decoded on first use
+	const SpawnTemplate& getSpawnTemplate(StringId64 name);
+
 	CameraInstance makeCameraInstance(uint32_t i) 
 	{ 
 		CameraInstance cameraInstance = { i };
@@ -177,7 +198,5 @@ private:
 	}
 };
 
-void spawnUnits(World& world, const UnitResource& unitResource, const Vector3& position, const Quaternion& rotation, const UnitId* unitLookupList);
-
 } // namespace Rio
 // Copyright (c) 2016 Volodymyr Syvochka
\ No newline at end of file
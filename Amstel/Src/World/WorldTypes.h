@@ -21,6 +21,7 @@ struct DebugLine;
 struct DebugGui;
 struct Material;
 struct SceneGraph;
+struct SpawnTemplate;
 
 using SoundInstanceId = uint32_t;
 
@@ -198,7 +199,7 @@ struct UnitId
 
 	uint32_t getId() const
 	{
-		return (index >> UNIT_INDEX_BITS) & UNIT_ID_MASK;
+		return (index & UNIT_ID_MASK) >> UNIT_INDEX_BITS;
 	}
 
 	bool getIsValid()
@@ -422,6 +423,7 @@ struct UnitDestroyedEvent
 
 struct LevelLoadedEvent
 {
+	Level* level; // The level loaded.
 };
 
 struct PhysicsCollisionEvent